@@ -36,13 +36,15 @@
  *  Etype: must have zero-parameter and copy constructor, <br>
  *     and must have operator<, operator!=, and operator= <br>
  *  CONSTRUCTION: with (a) no initializer <br>
- *  Deep copy is supported.
+ *  Copies share their nodes until one of them is changed, and then
+ *  copy the path of the change only (see SearchTreeCore::Share).
  * 
  *  ******************PUBLIC OPERATIONS********************* <br>  
  *  int Insert( const Etype& X )  --> Insert X <br> 
  *  int Remove( const Etype& X )  --> Remove X <br> 
- *  Etype Find( const Etype& X )  --> Return item that matches X <br> 
  *  ------------- Inherited ----------------------------- <br>
+ *  Etype Find( const Etype& X )  --> Return item that matches X <br> 
+ *  BinaryNode* Lookup( const Etype& X ) --> Return node holding X, or NULL <br>
  *  int WasFound( )        	  --> Return 1 if last Find succeeded <br> 
  *  int IsFound( const Etype& X ) --> Return 1 if X would be found <br> 
  *  Etype FindMin( )              --> Return smallest item <br> 
@@ -52,43 +54,51 @@
  *  BinayNode<Etype>* GetRoot()   --> Return root node <br>
  *  int Height( const BinaryNode* T ) --> Calculates the height of a node <br>
  *  int Size ( const BinaryNode* T )  --> Calculates the size of a node <br>
+ *  Etype FindKth( int K )        --> Return Kth smallest item (see utlCounted) <br>
+ *  int Rank( const Etype& X )    --> Number of items before X (see utlCounted) <br>
+ *  RangeAggregate( A, B )        --> Aggregate of the items in [A, B] (see utlAugmented) <br>
  *  ******************ERRORS********************************  <br>
  *  Predefined exception is propagated if new fails. <br>
  *  Item in sentinel node returned on various degenerate conditions.
+ *
+ *  AATreeCore has no virtual function. AATree adds the AbsBst 
+ *  interface to it, and StaticAATree does not (see SearchTreeCore).
  */
 
-template <class Etype, class Cmp=compare_to<Etype> >
-class AATree: public SearchTree<Etype,Cmp>
+template <class Derived, class Etype, class Cmp, class Alloc>
+class AATreeCore: public SearchTreeCore<Derived,Etype,Cmp,Alloc>
 {
+  /// the core builds trees through SetBalance.
+  friend class SearchTreeCore<Derived,Etype,Cmp,Alloc>;
+
   public:
 
   /// a binary node definition.
-  typedef typename SearchTree<Etype,Cmp>::BinaryNode BinaryNode;
+  typedef typename SearchTreeCore<Derived,Etype,Cmp,Alloc>::BinaryNode BinaryNode;
+
+  /// a link between nodes.
+  typedef typename SearchTreeCore<Derived,Etype,Cmp,Alloc>::Link Link;
 
   /** @name constructors  */ 
   //@{
 
     /// empty constructor.
-    AATree( const Cmp& comp = Cmp() ) : SearchTree<Etype,Cmp>(comp) {
-    	this->NullNode = new BinaryNode( );
-    	this->NullNode->Left = this->NullNode->Right = this->NullNode;
-    	this->NullNode->Level = 0;
+    AATreeCore( const Cmp& comp = Cmp() ) : SearchTreeCore<Derived,Etype,Cmp,Alloc>(comp) {
+    	this->MakeNullNode( 0 );
     	this->Root = this->NullNode;
     }
 
     /// copy constructor.
-    AATree( const AATree& Rsh ) {
-    	this->NullNode = new BinaryNode( );
-    	this->NullNode->Left = this->NullNode->Right = this->NullNode;
-    	this->NullNode->Level = 0;
+    AATreeCore( const AATreeCore& Rsh ) : SearchTreeCore<Derived,Etype,Cmp,Alloc>( Rsh.key_comp() ) {
+    	this->MakeNullNode( 0 );
     	this->Root = this->NullNode;
-        *this = Rsh;
+        this->Clone( Rsh );
     }
 
     /// destructor. Deletes the tree and NullNode.
-    virtual ~AATree( ) { 
-	this->FreeTree( this->Root ); this->Root = NULL;  
-	delete this->NullNode; this->NullNode = NULL;
+    ~AATreeCore( ) { 
+	this->ReleaseTree( this->Root ); this->Root = NULL;  
+	this->FreeNullNode( );
     }
 
   //@}
@@ -98,72 +108,47 @@ class AATree: public SearchTree<Etype,Cmp>
      *  @param X item to be inserted.
      *	@return true if insertion was successful.
      */
-    virtual int Insert( const Etype& X )
-        { return Insert( X, this->Root ); }
+    int Insert( const Etype& X )
+        { this->Unshare( X ); return Insert( X, this->Root ); }
 
     /** removes X from tree. 
      *
      *  @param X item to be deleted.
      *	@return 1 if X was found, and 0 otherwise.
      */
-    virtual int Remove( const Etype& X )
-        { return Remove( X, this->Root ); }
-
-    /** returns item X in tree. 
-     *	Result can be checked by calling WasFound().
-     *
-     *  @param X item to be searched for.
-     *  @return ItemNotFound, if X is not found.
-     */
-    virtual const Etype& Find ( const Etype& X ) const {
-    	this->NullNode->setElement ( X );	// avoids a test in the while below
-
-        BinaryNode** tempCurrent = (BinaryNode**)&this->Current;
-
-    	while ( 1 ) {
-            if ( this->compare(X, this->Current->Element) )
-                *tempCurrent = this->Current->Left;
-            else if (this->compare (this->Current->Element, X) )
-                *tempCurrent = this->Current->Right;
-            else
-                break;
-        }
-
-        return ( this->Current != this->NullNode ) ?
-             this->Current->Element:
-             this->ItemNotFound;
+    int Remove( const Etype& X ) {
+        this->Unshare( X );
+        BinaryNode* DeletePtr = this->NullNode;
+        BinaryNode* LastPtr = this->NullNode;
+        return Remove( X, this->Root, DeletePtr, LastPtr );
     }
 
-    /** returns item X in tree. 
-     *  Version specialized for pairs, since it uses operator neq.
-     *	Result can be checked by calling WasFound.
-     *
-     *  @param X item to be searched for.
-     *  @return ItemNotFound, if X is not found.
-     */
-    virtual const Etype& FindP( const Etype& X ) const {
-    	this->NullNode->setElement ( X );	// avoids a test in the while below
+  private:
 
-        BinaryNode** tempCurrent = (BinaryNode**)&this->Current;
-    	*tempCurrent = this->Root;
+    /// sizes of nodes are kept (see utlCounted).
+    enum { KeepsSizes = 1 };
 
-    	while ( this->compare.neq (X, this->Current->Element) ) {
-            *tempCurrent = ( this->compare(X, this->Current->Element) ?
-            this->Current->Left : this->Current->Right );
-        }
+    /// aggregates of nodes are kept with their sizes (see utlAugmented).
+    enum { KeepsAggregates = 1 };
 
-        return ( this->Current != this->NullNode ) ?
-             this->Current->Element:
-             this->ItemNotFound;
-    }
+    /// the skews of Remove reach the grandchildren of the siblings of the path.
+    enum { WriteReach = 3 };
 
-  private:
+    /** sets the level of a node made by SearchTreeCore::MakeTree,
+     *  whose subtree has n nodes: the number of nodes on its shortest
+     *  path down to the NullNode. Left children are one level below their
+     *  parents, since left subtrees are never the larger ones, and a right
+     *  child on the level of its parent has a right child one level below.
+     */
+    void SetBalance( BinaryNode* T, int n ) { T->Level = this->Log2( n + 1 ); }
 
     /// usual rotation routine with left child.
     BinaryNode* RotateWithLeftChild( BinaryNode* K2 ) {
     	BinaryNode* K1 = K2->Left;
     	K2->Left  = K1->Right;
     	K1->Right = K2;
+        this->Resize ( K2 );
+        this->Resize ( K1 );
     	return K1;
     }
 
@@ -172,18 +157,20 @@ class AATree: public SearchTree<Etype,Cmp>
     	BinaryNode* K2 = K1->Right;
     	K1->Right = K2->Left;
     	K2->Left  = K1;
+        this->Resize ( K1 );
+        this->Resize ( K2 );
     	return K2;
     }
 
-    /// skew primitive.
-    void Skew ( BinaryNode*& T ) {
-    	if( T->Left->Level == T->Level )
+    /// skew primitive. The NullNode, which trees may share, is left alone.
+    void Skew ( Link& T ) {
+    	if( T != this->NullNode && T->Left->Level == T->Level )
             T = RotateWithLeftChild( T );
     }
 
-    /// split primitive.
-    void Split( BinaryNode*& T ) {
-    	if( T->Right->Right->Level == T->Level )
+    /// split primitive. The NullNode, which trees may share, is left alone.
+    void Split( Link& T ) {
+    	if( T != this->NullNode && T->Right->Right->Level == T->Level )
           {
            T = RotateWithRightChild( T );
            T->Level++;
@@ -196,80 +183,143 @@ class AATree: public SearchTree<Etype,Cmp>
      *	@param T root node.
      *	@return true unless X is a duplicate.
      */
-    virtual int Insert( const Etype& X, BinaryNode*& T ) {
+    int Insert( const Etype& X, Link& T ) {
     	if( T == this->NullNode )
     	  {
-           T = new BinaryNode( X, this->NullNode, this->NullNode );
+           T = this->MakeNode( X, this->NullNode, this->NullNode );
            return 1;
     	  }
     	else if( this->compare(X, T->Element) )
-           Insert( X, T->Left );
+          {
+           if( !Insert( X, T->Left ) ) return 0;
+          }
     	else if( this->compare(T->Element, X) )
-           Insert( X, T->Right );
+          {
+           if( !Insert( X, T->Right ) ) return 0;
+          }
     	else
            return 0;
 
+        this->Resize( T );
     	Skew( T );
     	Split( T );
     	return 1;
     }
 
     /** removes node "X" from the AA tree rooted at "T".
+     *  The state of the search is kept by the caller, not in static
+     *  variables, so that trees of the same type may be changed by
+     *  several threads at once.
      *
      *	@param X item to be removed.
      *	@param T root node.
+     *	@param DeletePtr last node where the search went right: 
+     *	       the node of X, if X is there. NullNode at first.
+     *	@param LastPtr last node of the search, at the bottom of the tree.
      *	@return true unless X was not found.
      */
-    virtual int Remove( const Etype& X, BinaryNode*& T ) {
-    	static int ItemFound = 0;
-    	static BinaryNode* DeletePtr;
-    	static BinaryNode* LastPtr;
+    int Remove( const Etype& X, Link& T, BinaryNode*& DeletePtr, BinaryNode*& LastPtr ) {
+    	if( T == this->NullNode )
+            return 0;
+
+        // Step 1: Search down the tree and set LastPtr and DeletePtr
+        int ItemFound;
+        LastPtr = T;
+        if( this->compare(X, T->Element) )
+            ItemFound = Remove( X, T->Left, DeletePtr, LastPtr );
+        else
+          {
+           DeletePtr = T;
+           ItemFound = Remove( X, T->Right, DeletePtr, LastPtr );
+          }
+
+        // Step 2: If at the bottom of the tree and
+        //         X is present, we remove it.
+        //         X is not smaller than DeletePtr, so it matches unless greater.
 
-    	if( T != this->NullNode )
+        if( T == LastPtr )
           {
-           // Step 1: Search down the tree and set LastPtr and DeletePtr
-           LastPtr = T;
-           if( this->compare(X, T->Element) )
-               Remove( X, T->Left );
-           else
-             {
-              DeletePtr = T;
-              Remove( X, T->Right );
-             }
-
-           // Step 2: If at the bottom of the tree and
-           //         X is present, we remove it
-
-           if( T == LastPtr )
-             {
-              if( DeletePtr != this->NullNode && X == DeletePtr->Element )
-                {
-                 DeletePtr->setElement ( T->Element );
-                 DeletePtr = this->NullNode;
-                 T = T->Right;
-                 delete LastPtr;
-                 ItemFound = 1;
-                }
-              else
-                 ItemFound = 0;
-             }
-
-           // Step 3: Otherwise, we are not at the bottom; rebalance
-           else if( T->Left->Level  < T->Level - 1 || 
-		    T->Right->Level < T->Level - 1 )
-             {
-              if( T->Right->Level > --T->Level )
-                  T->Right->Level = T->Level;
-
-              Skew( T );
-              Skew( T->Right );
-              Skew( T->Right->Right );
-              Split( T );
-              Split( T->Right );
-             }
+           if( DeletePtr == this->NullNode || this->compare(DeletePtr->Element, X) )
+               return 0;
+           DeletePtr->setElement ( T->Element );
+           DeletePtr = this->NullNode;
+           T = T->Right;
+           this->FreeNode( LastPtr );
+           return 1;
+          }
+
+        // Step 3: Otherwise, we are not at the bottom; rebalance
+        if ( ItemFound ) this->Resize( T );
+        if( T->Left->Level  < T->Level - 1 || 
+            T->Right->Level < T->Level - 1 )
+          {
+           if( T->Right->Level > --T->Level )
+               T->Right->Level = T->Level;
+
+           Skew( T );
+           Skew( T->Right );
+           Skew( T->Right->Right );
+           Split( T );
+           Split( T->Right );
           }
 
         return ItemFound;
     }
 };
+
+/// AA tree with the virtual AbsBst interface.
+template <class Etype, class Cmp=compare_to<Etype>,
+          class Alloc=utlNodePool<BinNode<Etype,Cmp> > >
+class AATree : 
+   public AbsBstAdapter<AATreeCore<AATree<Etype,Cmp,Alloc>,Etype,Cmp,Alloc>,Etype,Cmp>
+{
+  public:
+
+    /// empty constructor.
+    AATree( const Cmp& comp = Cmp() ) : 
+        AbsBstAdapter<AATreeCore<AATree,Etype,Cmp,Alloc>,Etype,Cmp>( comp ) { }
+};
+
+/// AA tree without virtual functions.
+template <class Etype, class Cmp=compare_to<Etype>,
+          class Alloc=utlNodePool<BinNode<Etype,Cmp> > >
+class StaticAATree : 
+   public AATreeCore<StaticAATree<Etype,Cmp,Alloc>,Etype,Cmp,Alloc>
+{
+  public:
+
+    /// empty constructor.
+    StaticAATree( const Cmp& comp = Cmp() ) : 
+        AATreeCore<StaticAATree,Etype,Cmp,Alloc>( comp ) { }
+};
+
+/** AATree with compact nodes: the level is kept in a byte,
+ *  and there is no size field.
+ *  For small keys, such as int, nodes take 24 bytes instead of 32.
+ */
+template <class Etype, class Cmp=compare_to<Etype> >
+using CompactAATree = StaticAATree<Etype,Cmp,utlNodePool<BinNode<Etype,Cmp,utlAALayout> > >;
+
+/** AATree with compact nodes which also keep the size of their subtrees
+ *  (see utlCounted), for order statistics in O(log n).
+ */
+template <class Etype, class Cmp=compare_to<Etype> >
+using CountedAATree = 
+      StaticAATree<Etype,Cmp,utlNodePool<BinNode<Etype,Cmp,utlCounted<utlAALayout> > > >;
+
+/** AATree whose nodes also aggregate the items of their subtrees with
+ *  a Monoid (see utlAugmented and utlMonoid.h), for RangeAggregate in O(log n).
+ */
+template <class Etype, class Monoid, class Cmp=compare_to<Etype> >
+using AugmentedAATree = 
+      StaticAATree<Etype,Cmp,utlNodePool<BinNode<Etype,Cmp,utlAugmented<utlAALayout,Monoid> > > >;
+
+/** AATree with compact nodes linked by 32-bit indices.
+ *  For small keys, such as int, nodes take 16 bytes.
+ *  All trees of this type share the same NullNode (index 0).
+ */
+template <class Etype, class Cmp=compare_to<Etype> >
+using IndexedAATree = 
+      StaticAATree<Etype,Cmp,utlIndexPool<BinNode<Etype,Cmp,utlIndexed<utlAALayout> > > >;
+
 #endif
@@ -34,14 +34,19 @@
  *  Etype: must have zero-parameter and copy constructor, <br>
  *     and must have operator<, operator!=, and operator= <br>
  *  CONSTRUCTION: with (a) no initializer <br>
- *  Deep copy is supported.
+ *  Copies share their nodes until one of them is changed, and then
+ *  copy the path of the change only (see SearchTreeCore::Share).
+ *  ParentAVLTree copies its nodes at once.
  * 
  *  ******************PUBLIC OPERATIONS********************* <br>  
  *  int Insert( const Etype& X )  --> Insert X <br> 
  *  int Remove( const Etype& X )  --> Remove X <br> 
- *  Etype Find( const Etype& X )  --> Return item that matches X <br> 
  *  int Height( const BinaryNode* T ) --> Calculates the height of a node <br>
+ *  void Join( T1, X, T2 )        --> Make tree from T1, X and T2 <br>
+ *  int Split( X, Less, Greater ) --> Move items below/above X into two trees <br>
  *  ------------- Inherited ----------------------------- <br>
+ *  Etype Find( const Etype& X )  --> Return item that matches X <br> 
+ *  BinaryNode* Lookup( const Etype& X ) --> Return node holding X, or NULL <br>
  *  int WasFound( )               --> Return 1 if last Find succeeded <br> 
  *  int IsFound( const Etype& X ) --> Return 1 if X would be found <br> 
  *  Etype FindMin( )              --> Return smallest item <br> 
@@ -50,130 +55,236 @@
  *  BinayNode<Etype>* GetRoot()   --> Return root node <br>
  *  void MakeEmpty( )             --> Remove all items <br>
  *  int Size ( const BinaryNode* T )  --> Calculates the size of a node <br>
+ *  Etype FindKth( int K )        --> Return Kth smallest item (see utlCounted) <br>
+ *  int Rank( const Etype& X )    --> Number of items before X (see utlCounted) <br>
+ *  RangeAggregate( A, B )        --> Aggregate of the items in [A, B] (see utlAugmented) <br>
  *  ******************ERRORS********************************  <br>
  *  Predefined exception is propagated if new fails. <br>
  *  Item in sentinel node returned on various degenerate conditions.
+ *
+ *  Join and Split take O(log n): nodes are moved, not copied, and
+ *  the trees involved share their NullNode (see ShareNullNode).
+ *  Union, Intersection and Difference join subtrees as well.
+ *
+ *  AVLTreeCore has no virtual function. AVLTree adds the AbsBst 
+ *  interface to it, and StaticAVLTree does not (see SearchTreeCore).
  */
 
-template <class Etype, class Cmp=compare_to<Etype> >
-class AVLTree: public SearchTree<Etype,Cmp>
+template <class Derived, class Etype, class Cmp, class Alloc>
+class AVLTreeCore: public SearchTreeCore<Derived,Etype,Cmp,Alloc>
 {
-  /// a binary node definition.
-  typedef typename SearchTree<Etype,Cmp>::BinaryNode BinaryNode;
+  /// the core builds trees through SetBalance.
+  friend class SearchTreeCore<Derived,Etype,Cmp,Alloc>;
 
   public:
 
+  /// a binary node definition.
+  typedef typename SearchTreeCore<Derived,Etype,Cmp,Alloc>::BinaryNode BinaryNode;
+
+  /// a link between nodes.
+  typedef typename SearchTreeCore<Derived,Etype,Cmp,Alloc>::Link Link;
+
+
   /** @name constructors  */ 
   //@{
 
     /// empty constructor.
-    AVLTree( const Cmp& comp = Cmp() ) : SearchTree<Etype,Cmp> (comp) {
-    	this->NullNode = new BinaryNode( );
-    	this->NullNode->Left = this->NullNode->Right = this->NullNode;
-    	this->NullNode->Level = -1;
+    AVLTreeCore( const Cmp& comp = Cmp() ) : SearchTreeCore<Derived,Etype,Cmp,Alloc> (comp) {
+    	this->MakeNullNode( -1 );
     	this->Root = this->NullNode;
     }
 
     /// copy constructor.
-    AVLTree( const AVLTree& Rsh ) {
-    	this->NullNode = new BinaryNode( );
-    	this->NullNode->Left = this->NullNode->Right = this->NullNode;
-    	this->NullNode->Level = -1;
+    AVLTreeCore( const AVLTreeCore& Rsh ) : SearchTreeCore<Derived,Etype,Cmp,Alloc>( Rsh.key_comp() ) {
+    	this->MakeNullNode( -1 );
     	this->Root = this->NullNode;
-        *this = Rsh;
+        this->Clone( Rsh );
     }
 
     /// destructor. Deletes the tree and NullNode.
-    virtual ~AVLTree( ) { 
-	this->FreeTree( this->Root ); this->Root = NULL;  
-	delete this->NullNode; this->NullNode = NULL;
+    ~AVLTreeCore( ) { 
+	this->ReleaseTree( this->Root ); this->Root = NULL;  
+	this->FreeNullNode( );
     }
 
   //@}
 
     /** adds X into the tree. If X already present, do nothing.
+     *  The links followed down are kept, and walked back up (see Retrace).
      *
      *  @param X item to be inserted.
      *	@return true if insertion was successful.
      */
-    virtual int Insert( const Etype& X ) { 
- 	BinaryNode* node = InsertAVL( X, this->Root );
-        if ( node != NULL ) {
-             this->Root = node;
-             return 1;
+    int Insert( const Etype& X ) { 
+        this->Unshare( X );
+        Link* Path[MaxHeight];
+        int n = 0;
+        Link* L = &this->Root;
+        BinaryNode* T;
+        while ( ( T = *L ) != this->NullNode ) {
+            Path[n++] = L;
+            if ( this->compare (X, T->Element) )
+                 L = &T->Left;
+            else if ( this->compare (T->Element, X) )
+                 L = &T->Right;
+            else
+                 return 0;                              // already present (duplicate)
         }
-        return 0;
+        T = this->MakeNode( X, this->NullNode, this->NullNode );
+        T->Level = 0;
+        *L = T;
+        if ( n > 0 ) this->SetParent ( T, *Path[n-1] );
+        Retrace ( Path, n );
+        return 1;
     }
 
-    /** removes X from tree. 
+    /** removes X from tree. If X has two children, its successor
+     *  node takes its place, so that no item is copied. As in Insert,
+     *  the links followed down are walked back up (see Retrace).
      *
      *  @param X item to be removed.
      *	@return 1 if X was found, and 0 otherwise.
      */
-    virtual int Remove( const Etype& X )
-        { return Remove( X, this->Root ); }
-
-    /** returns item X in tree. 
-     *	Result can be checked by calling WasFound.
-     *
-     *  @param X item to be searched for.
-     *  @return ItemNotFound, if X is not found.
-     */
-    virtual const Etype& Find( const Etype& X ) const {
-    	this->NullNode->setElement ( X );	// avoids a test in the while below
-
-        BinaryNode** tempCurrent = (BinaryNode**)&this->Current;
-    	*tempCurrent = this->Root;
-
-    	while ( 1 ) {
-            if ( this->compare(X, this->Current->Element) )
-                *tempCurrent = this->Current->Left;
-            else if (this->compare (this->Current->Element, X) )
-                *tempCurrent = this->Current->Right;
+    int Remove( const Etype& X ) {
+        this->Unshare( X );
+        Link* Path[MaxHeight];
+        int n = 0;
+        Link* L = &this->Root;
+        BinaryNode* T;
+        while ( ( T = *L ) != this->NullNode ) {
+            if ( this->compare (X, T->Element) ) {
+                 Path[n++] = L;
+                 L = &T->Left;
+            }
+            else if ( this->compare (T->Element, X) ) {
+                 Path[n++] = L;
+                 L = &T->Right;
+            }
             else
-                break;
+                 break;
         }
-
-        return ( this->Current != this->NullNode ) ?
-             this->Current->Element:
-             this->ItemNotFound;
+        if ( T == this->NullNode ) return 0;             // not found
+
+        if ( T->Left != this->NullNode && T->Right != this->NullNode ) {
+             // the successor node S leaves its place, and takes the place of T.
+             int k = n;
+             Path[n++] = L;
+             Link* SL = &T->Right;
+             BinaryNode* S = *SL;
+             while ( S->Left != this->NullNode ) {
+                 Path[n++] = SL;
+                 SL = &S->Left;
+                 S = *SL;
+             }
+             *SL = S->Right;
+             this->SetParent ( *SL, S->GetParent() );
+             S->Left  = T->Left;
+             S->Right = T->Right;
+             S->Level = T->Level;
+             *L = S;
+             this->SetParent ( S, T->GetParent() );
+             this->Adopt ( S );
+             if ( n > k + 1 ) Path[k+1] = &S->Right;    // it was &T->Right
+        }
+        else {
+             *L = ( T->Left != this->NullNode ) ? T->Left : T->Right;
+             this->SetParent ( *L, T->GetParent() );
+        }
+        this->FreeNode( T );
+        Retrace ( Path, n );
+        return 1;
     }
 
-    /** returns item X in tree. 
-     *  Version specialized for pairs, since it uses operator neq.
-     *	Result can be checked by calling WasFound.
+    /** makes this tree hold the items of T1, X and the items of T2,
+     *  which must all be smaller than X, and greater than X, respectively.
+     *  T1 and T2 are left empty, and this tree may be any of them. 
+     *  Only the heights of the trees are walked down, in O(log n). 
+     *  If T1 and T2 do not share their NullNode, the nodes of the 
+     *  lower one are relinked to the NullNode of the other, though.
      *
-     *  @param X item to be searched for.
-     *  @return ItemNotFound, if X is not found.
+     *  @param T1 tree of the smaller items.
+     *  @param X item between them.
+     *  @param T2 tree of the greater items.
      */
-    virtual const Etype& FindP( const Etype& X ) const {
-    	this->NullNode->setElement ( X );	// avoids a test in the while below
-
-        BinaryNode** tempCurrent = (BinaryNode**)&this->Current;
-    	*tempCurrent = this->Root;
+    void Join( Derived& T1, const Etype& X, Derived& T2 )
+        { this->JoinTrees( T1, X, T2 ); }
 
-    	while ( this->compare.neq (X, this->Current->Element) ) {
-            *tempCurrent = ( this->compare(X, this->Current->Element) ?
-                this->Current->Left : this->Current->Right );
-        }
-
-        return ( this->Current != this->NullNode ) ?
-             this->Current->Element:
-             this->ItemNotFound;
-    }
+    /** moves the items smaller than X into Less, and the items greater
+     *  than X into Greater, in O(log n). X itself, if present, is removed.
+     *  This tree is left empty, unless it is Less or Greater.
+     *  The three trees then share their NullNode.
+     *
+     *  @param X splitting item.
+     *  @param Less tree of the smaller items.
+     *  @param Greater tree of the greater items.
+     *	@return 1 if X was found, and 0 otherwise.
+     */
+    int Split( const Etype& X, Derived& Less, Derived& Greater )
+        { return this->SplitTree( X, Less, Greater ); }
 
     /** computes the height of a node.
      *  The height is the length of the longest path from 
      *  a node to a leaf. All leaves have height 0.
      */
-    virtual int Height ( const BinaryNode* T ) const {
+    int Height ( const BinaryNode* T ) const {
     	if ( T == this->NullNode )
              return -1;
         else
     	     return T->Level;
     }
 
-  private:
+  protected:
+
+    /// links of nodes to their parents are kept (see utlParented).
+    enum { KeepsParents = 1 };
+
+    /// sizes of nodes are kept (see utlCounted).
+    enum { KeepsSizes = 1 };
+
+    /// aggregates of nodes are kept with their sizes (see utlAugmented).
+    enum { KeepsAggregates = 1 };
+
+    /// the rotations of Remove move siblings of the path, and their children.
+    enum { WriteReach = 2 };
+
+    /** called by the rotations, before the links of K are changed,
+     *  K being the node which goes down. Does nothing here; 
+     *  ConcurrentAVLTree marks K, so that readers do not trust it.
+     */
+    void Rotating( BinaryNode* ) { }
+
+    /** longest path from the root followed by Insert and Remove.
+     *  An AVL tree of height 64 has more than 2^44 nodes.
+     */
+    enum { MaxHeight = 64 };
+
+    /** walks back up the path of an insertion or a removal, rebalancing
+     *  and updating the heights of its nodes, the lowest one first. 
+     *  *Path[i] is the link to the i-th node on the path, down from the root.
+     *  It stops as soon as the height of a subtree did not change, since
+     *  the nodes above are not affected. Thus, an insertion makes at most 
+     *  one rotation (single or double), and a removal O(log n) rotations.
+     *  Only the sizes of the nodes above are then updated, if kept.
+     *
+     *	@param Path links to the nodes on the path.
+     *	@param n number of nodes on the path.
+     */
+    void Retrace( Link** Path, int n ) {
+        while ( n-- > 0 ) {
+            BinaryNode* T = *Path[n];
+            int h = T->Level;
+            BinaryNode* K = Balance ( T );
+            if ( K != T ) *Path[n] = K;
+            if ( K->Level == h ) break;
+        }
+        if ( this->HasSizes )
+             while ( n-- > 0 ) this->Resize ( *Path[n] );
+    }
+
+    /** sets the height of a node made by SearchTreeCore::MakeTree,
+     *  whose subtree has n nodes.
+     */
+    void SetBalance( BinaryNode* T, int n ) { T->Level = this->Log2( n ); }
 
     // usual rotation routines 
 
@@ -182,11 +293,17 @@ class AVLTree: public SearchTree<Etype,Cmp>
      */
     BinaryNode* RotateWithLeftChild( BinaryNode* K2 ) {
     	BinaryNode* K1 = K2->Left;
+        this->self().Rotating( K2 );
     	K2->Left  = K1->Right;
     	K1->Right = K2;
+        this->SetParent ( K1, K2->GetParent() );
+        this->SetParent ( K2, K1 );
+        this->SetParent ( K2->Left, K2 );
 
         K2->Level = max ( Height(K2->Left), Height (K2->Right) ) + 1;        
         K1->Level = max ( Height(K1->Left), Height (K1->Right) ) + 1;        
+        this->Resize ( K2 );
+        this->Resize ( K1 );
 
     	return K1;
     }
@@ -196,11 +313,17 @@ class AVLTree: public SearchTree<Etype,Cmp>
      */
     BinaryNode* RotateWithRightChild( BinaryNode* K1 ) {
     	BinaryNode* K2 = K1->Right;
+        this->self().Rotating( K1 );
     	K1->Right = K2->Left;
     	K2->Left  = K1;
+        this->SetParent ( K2, K1->GetParent() );
+        this->SetParent ( K1, K2 );
+        this->SetParent ( K1->Right, K1 );
 
         K1->Level = max ( Height(K1->Left), Height (K1->Right) ) + 1;        
         K2->Level = max ( Height(K2->Left), Height (K2->Right) ) + 1;        
+        this->Resize ( K1 );
+        this->Resize ( K2 );
 
     	return K2;
     }
@@ -223,176 +346,192 @@ class AVLTree: public SearchTree<Etype,Cmp>
     	return RotateWithRightChild ( K1 );
     }
 
-    /** inserts a new node "X" into the AVL tree rooted at "T".
-     *  At most one rotation (single or double) rebalances the tree. 
-     *  The overall operation is O(log n).
-     *
-     * 	@param X new node.
-     *	@param T root node.
-     *	@return root node or NULL, if X is a duplicate.
-     */
-    BinaryNode* InsertAVL( const Etype& X, BinaryNode* T ) {
-    	if ( T == this->NullNode )				// empty tree: create new node
-    	  {
-           T = new BinaryNode( X, this->NullNode, this->NullNode );
-           T->Level = 0;
-    	  }
-    	else if ( this->compare (X, T->Element) ) 
-          {
-           BinaryNode* ptr = InsertAVL( X, T->Left );	// insert recursively on left
-           if ( ptr == NULL ) return NULL;  		// already present (duplicate)
-           T->Left = ptr; 
-           if ( (Height(T->Left) - Height(T->Right)) == 2 ) // check height condition
-              {
-               if ( this->compare (X, T->Left->Element) )	// rotate up the left side
-                  T = RotateWithLeftChild ( T );	// left-left insertion
-               else
-                  T = DoubleRotateWithLeftChild ( T );  // left-right insertion
-              }
-           else						// balance OK: update height
-               T->Level = 1 + max (Height(T->Left), Height(T->Right));
-          }
-    	else if ( this->compare (T->Element, X) ) 
-          {
-           BinaryNode* ptr = InsertAVL( X, T->Right );	// insert recursively on right
-           if ( ptr == NULL ) return NULL;  		// already present (duplicate)
-           T->Right = ptr;
-           if ( (Height(T->Right) - Height(T->Left)) == 2 ) // check height condition
-              {
-               if ( this->compare ( T->Right->Element, X ) )	// rotate up the right side
-                  T = RotateWithRightChild ( T );	// right-right insertion
-               else
-                  T = DoubleRotateWithRightChild ( T ); // right-left insertion
-              }
-           else						// balance OK: update height
-               T->Level = 1 + max (Height(T->Left), Height(T->Right));
-          }
-    	else
-           return NULL;					// already present (duplicate)
-
-    	return T;
+    /// subtrees are joined and split in O(log n).
+    enum { Joinable = 1 };
+
+    /// the height compared by joins.
+    int JoinHeight( const BinaryNode* T ) const { return Height( T ); }
+
+    /// returns the heights of the children of T.
+    void ChildHeights( const BinaryNode* T, int, int& hl, int& hr ) const {
+        hl = Height( T->Left );
+        hr = Height( T->Right );
     }
 
+    /// JoinNodes, as called by SearchTreeCore: heights are kept in the nodes.
+    BinaryNode* JoinNodes( BinaryNode* L, int, BinaryNode* K, BinaryNode* R, int, int& h ) {
+        K = JoinNodes ( L, K, R );
+        h = Height( K );
+        return K;
+    }
 
-    /** internal RemoveMinAVL routine for AVLTree.
-     *	Remove minimum item in tree rooted at T.
+    /// SplitNodes, as called by SearchTreeCore: heights are kept in the nodes.
+    template <class Less>
+    BinaryNode* SplitNodes( BinaryNode* T, int, const Etype& X, BinaryNode*& L, int& hl,
+                            BinaryNode*& R, int& hr, const Less& less ) {
+        BinaryNode* F = SplitNodes ( T, X, L, R, less );
+        hl = Height( L );
+        hr = Height( R );
+        return F;
+    }
+
+    /** restores the balance of node T, whose subtrees may differ
+     *  in height by 2, and updates its height and size.
      *
-     *  @param T root node.
-     *  @param LastPtr parent of minimum node.
-     *	@return false only if tree is empty
+     *	@param T root node.
+     *	@return new root node.
      */
-    int RemoveMinAVL( BinaryNode*& T, BinaryNode*& LastPtr ) {
-    	if( T == this->NullNode )
-            return 0;
-    	else if( T->Left != this->NullNode ) {
-            LastPtr = T;
-            return RemoveMinAVL( T->Left, LastPtr );
+    BinaryNode* Balance( BinaryNode* T ) {
+        int hl = Height(T->Left);
+        int hr = Height(T->Right);
+        if ( (hl - hr) == 2 ) {
+             if ( Height (T->Left->Left) < Height (T->Left->Right) )
+                  return DoubleRotateWithLeftChild ( T );
+             return RotateWithLeftChild ( T );
+        }
+        if ( (hr - hl) == 2 ) {
+             if ( Height (T->Right->Right) < Height (T->Right->Left) )
+                  return DoubleRotateWithRightChild ( T );
+             return RotateWithRightChild ( T );
         }
-    	BinaryNode* Tmp = T;
-    	T = T->Right;
-    	delete Tmp;
-    	return 1;
+        T->Level = 1 + max (hl, hr);
+        this->Resize ( T );
+        return T;
     }
 
-    /** rebalances the tree after a remove operation.
+    /** joins the AVL trees rooted at L and R with node K, whose item
+     *  lies between theirs. K is hung from the spine of the higher tree, 
+     *  where it meets a subtree as high as the lower one, and the nodes
+     *  above are rebalanced. The overall operation is O(|h(L) - h(R)| + 1).
      *
-     *  @param X contents of the parent of the deleted node.
-     *	@param T root.
+     *	@param L root of the smaller items.
+     *	@param K node between them.
+     *	@param R root of the greater items.
+     *	@return root node.
      */
-    void Rebalance( const Etype& X, BinaryNode*& T ) {
-    	if( T == this->NullNode )
-            return;		     
-    	else if( this->compare (X, T->Element) ) {  // Go left
-           Rebalance( X, T->Left );
-           if ( (Height(T->Right) - Height(T->Left)) == 2 ) 
-              {
-               if ( Height (T->Right->Right) < Height (T->Right->Left) )
-                  T = DoubleRotateWithRightChild ( T );
-               else
-                  T = RotateWithRightChild ( T );
-              }
-           else
-               T->Level = 1 + max (Height(T->Left), Height(T->Right));
-          }
-    	else if( this->compare (T->Element, X) ) {  // Go right
-           Rebalance( X, T->Right );
-           if ( (Height(T->Left) - Height(T->Right)) == 2 ) 
-              {
-               if ( Height (T->Left->Left) < Height (T->Left->Right) )
-                  T = DoubleRotateWithLeftChild ( T );
-               else
-                  T = RotateWithLeftChild ( T );
-              }
-           else
-               T->Level = 1 + max (Height(T->Left), Height(T->Right));
-          }
-        else {
-           int hr = Height(T->Right);
-           int hl = Height(T->Left); 
-           if ( hr < hl ) {
-              if ( (hl - hr) == 2 ) 
-                 {
-                  if ( Height (T->Left->Left) < Height (T->Left->Right) )
-                     T = DoubleRotateWithLeftChild ( T );
-                  else
-                     T = RotateWithLeftChild ( T );
-                 }
-              else
-                  T->Level = 1 + max (hl, hr);
-           }
-           else if ( hr > hl ) { 
-              if ( (hr - hl) == 2 ) 
-                 {
-                  if ( Height (T->Right->Right) < Height (T->Right->Left) )
-                     T = DoubleRotateWithRightChild ( T );
-                  else
-                     T = RotateWithRightChild ( T );
-                 }
-              else
-                  T->Level = 1 + max (hl, hr);
-           }
-           else T->Level = 1 + hr;
+    BinaryNode* JoinNodes( BinaryNode* L, BinaryNode* K, BinaryNode* R ) {
+        int hl = Height(L);
+        int hr = Height(R);
+        if ( hl > hr + 1 ) {
+             L->Right = JoinNodes ( L->Right, K, R );
+             this->SetParent ( L->Right, L );
+             return Balance ( L );
+        }
+        if ( hr > hl + 1 ) {
+             R->Left = JoinNodes ( L, K, R->Left );
+             this->SetParent ( R->Left, R );
+             return Balance ( R );
         }
+        K->Left  = L;
+        K->Right = R;
+        this->Adopt ( K );
+        K->Level = 1 + max (hl, hr);
+        this->Resize ( K );
+        return K;
     }
 
-    /** removes node "X" from the AVL tree rooted at "T".
-     *  A total of O(log n) rotations may be performed. 
-     *  The overall operation is O(log n).
+    /** splits the AVL tree rooted at T by X. The nodes on the path 
+     *  down to X are joined back, bottom up, to the subtrees hanging 
+     *  on their other side. Since these are ever higher, the joins
+     *  add up to O(log n).
      *
-     *	@param X item to be removed.
      *	@param T root node.
-     *	@return true unless X was not found.
+     *  @param X splitting item.
+     *	@param L returns the root of the smaller items.
+     *	@param R returns the root of the greater items.
+     *	@param less orders pointers to items.
+     *	@return node of X, taken out of the tree, or NULL if X was not found.
      */
-    virtual int Remove( const Etype& X, BinaryNode*& T ) {
-    	BinaryNode* Tmp;
-    	static BinaryNode *LastPtr = this->Root;
-
-    	if( T == this->NullNode )					// not found
-            return 0;
-    	else if( this->compare (X, T->Element) ) {  // Go left
-           LastPtr = T;
-           return Remove( X, T->Left );
+    template <class Less>
+    BinaryNode* SplitNodes( BinaryNode* T, const Etype& X, BinaryNode*& L, BinaryNode*& R,
+                            const Less& less ) {
+        if ( T == this->NullNode ) {
+             L = R = this->NullNode;
+             return NULL;
         }
-    	else if( this->compare (T->Element, X) ) {  // Go right
-           LastPtr = T;
-           return Remove( X, T->Right );
+        BinaryNode* A = T->Left;
+        BinaryNode* B = T->Right;
+        BinaryNode* F;
+        if ( less ( &X, &T->Element ) ) {
+             F = SplitNodes ( A, X, L, R, less );
+             R = JoinNodes ( R, T, B );
         }
-    	else if( T->Left != this->NullNode && T->Right != this->NullNode )  // Two children
-           {
-            // Copy from node to delete into node to keep; then delete
-            Tmp = (BinaryNode*) this->FindMin( T->Right );
-            T->setElement (Tmp->Element);
-            LastPtr = T;
-            int resp = RemoveMinAVL( T->Right, LastPtr ); 		// Remove minimum
-            Rebalance ( LastPtr->Element, this->Root ); 
-            return resp;
-           }
-    	// One or zero children
-    	Tmp = T;
-    	T = ( T->Left != this->NullNode ) ? T->Left : T->Right;  	// Reroot T
-    	delete Tmp;                                    		// Delete old root
-        Rebalance ( LastPtr->Element, this->Root ); 
-    	return 1;
+        else if ( less ( &T->Element, &X ) ) {
+             F = SplitNodes ( B, X, L, R, less );
+             L = JoinNodes ( A, T, L );
+        }
+        else {
+             L = A;
+             R = B;
+             F = T;
+        }
+        return F;
     }
 };
+
+/// AVL tree with the virtual AbsBst interface.
+template <class Etype, class Cmp=compare_to<Etype>,
+          class Alloc=utlNodePool<BinNode<Etype,Cmp> > >
+class AVLTree : 
+   public AbsBstAdapter<AVLTreeCore<AVLTree<Etype,Cmp,Alloc>,Etype,Cmp,Alloc>,Etype,Cmp>
+{
+  public:
+
+    /// empty constructor.
+    AVLTree( const Cmp& comp = Cmp() ) : 
+        AbsBstAdapter<AVLTreeCore<AVLTree,Etype,Cmp,Alloc>,Etype,Cmp>( comp ) { }
+};
+
+/// AVL tree without virtual functions.
+template <class Etype, class Cmp=compare_to<Etype>,
+          class Alloc=utlNodePool<BinNode<Etype,Cmp> > >
+class StaticAVLTree : 
+   public AVLTreeCore<StaticAVLTree<Etype,Cmp,Alloc>,Etype,Cmp,Alloc>
+{
+  public:
+
+    /// empty constructor.
+    StaticAVLTree( const Cmp& comp = Cmp() ) : 
+        AVLTreeCore<StaticAVLTree,Etype,Cmp,Alloc>( comp ) { }
+};
+
+/** AVL tree with compact nodes: the height is kept in a byte,
+ *  and there is no size field.
+ *  For small keys, such as int, nodes take 24 bytes instead of 32.
+ */
+template <class Etype, class Cmp=compare_to<Etype> >
+using CompactAVLTree = StaticAVLTree<Etype,Cmp,utlNodePool<BinNode<Etype,Cmp,utlAVLLayout> > >;
+
+/** AVL tree with compact nodes which also link to their parents
+ *  (see utlParented). Its iterators in utlSet and utlMap step 
+ *  in O(1) amortized, and hold no stack (see ParentInOrder). Copies of
+ *  the tree do not share its nodes (see SearchTreeCore::Shareable).
+ *  For small keys, such as int, nodes take 32 bytes.
+ */
+template <class Etype, class Cmp=compare_to<Etype> >
+using ParentAVLTree = 
+      StaticAVLTree<Etype,Cmp,utlNodePool<BinNode<Etype,Cmp,utlParented<utlAVLLayout> > > >;
+
+/** AVL tree with compact nodes which also keep the size of their subtrees
+ *  (see utlCounted), for order statistics in O(log n).
+ */
+template <class Etype, class Cmp=compare_to<Etype> >
+using CountedAVLTree = 
+      StaticAVLTree<Etype,Cmp,utlNodePool<BinNode<Etype,Cmp,utlCounted<utlAVLLayout> > > >;
+
+/** AVL tree whose nodes also aggregate the items of their subtrees with
+ *  a Monoid (see utlAugmented and utlMonoid.h), for RangeAggregate in O(log n).
+ */
+template <class Etype, class Monoid, class Cmp=compare_to<Etype> >
+using AugmentedAVLTree = 
+      StaticAVLTree<Etype,Cmp,utlNodePool<BinNode<Etype,Cmp,utlAugmented<utlAVLLayout,Monoid> > > >;
+
+/** AVL tree with compact nodes linked by 32-bit indices.
+ *  For small keys, such as int, nodes take 16 bytes.
+ *  All trees of this type share the same NullNode (index 0).
+ */
+template <class Etype, class Cmp=compare_to<Etype> >
+using IndexedAVLTree = 
+      StaticAVLTree<Etype,Cmp,utlIndexPool<BinNode<Etype,Cmp,utlIndexed<utlAVLLayout> > > >;
+
 #endif
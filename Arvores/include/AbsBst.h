@@ -69,4 +69,50 @@ class AbsBst
     /// Disable copy constructor.
     AbsBst( const AbsBst & ) { }
 };
+
+/** implements the AbsBst interface for a tree without virtual functions.
+ *
+ *  Tree: a non-virtual tree core, such as SearchTreeCore or AVLTreeCore.
+ *  Each virtual function just forwards to the corresponding function
+ *  of Tree. Therefore, the tree calls no virtual function internally,
+ *  and only calls through an AbsBst reference are dynamically bound.
+ */
+template <class Tree, class Etype, class Cmp>
+class AbsBstAdapter : public Tree, public AbsBst<Etype,Cmp>
+{
+  public:
+
+  /** @name constructors  */ 
+  //@{
+    /// constructor. Forwards its arguments to the tree.
+    template <class... Args>
+    explicit AbsBstAdapter( const Args&... args ) : Tree( args... ) { }
+
+    /// copy constructor.
+    AbsBstAdapter( const AbsBstAdapter& T ) : Tree( T ), AbsBst<Etype,Cmp>( ) { }
+  //@}
+
+    /// inserts a given element into the tree.
+    virtual int Insert( const Etype& X ) { return Tree::Insert( X ); }
+    /// removes a given element from the tree.
+    virtual int Remove( const Etype& X ) { return Tree::Remove( X ); }
+    /// finds a given element in the tree.
+    virtual const Etype& Find ( const Etype& X ) const { return Tree::Find( X ); }
+    /** returns whether a given element was found in the tree, 
+     *  since the last call to Find().
+     */
+    virtual int WasFound( ) const { return Tree::WasFound( ); }
+    /// finds minimum element in tree.
+    virtual const Etype& FindMin( ) const { return Tree::FindMin( ); }
+    /// finds maximum element in tree.
+    virtual const Etype& FindMax( ) const { return Tree::FindMax( ); }
+    /// returns whether the given element is in the tree.
+    virtual int IsFound( const Etype& X ) const { return Tree::IsFound( X ); }
+    /// returns whether this tree is empty.
+    virtual int IsEmpty( ) const { return Tree::IsEmpty( ); }
+    /// returns whether this tree is full.
+    virtual int IsFull( ) const { return Tree::IsFull( ); }
+    /// makes this tree empty.
+    virtual void MakeEmpty( ) { Tree::MakeEmpty( ); }
+};
 #endif
@@ -15,6 +15,8 @@
 #ifndef __BinNode
 #define __BinNode
 
+#include "utlNodePool.h"
+
 #ifndef NULL
 #define NULL 0L
 #endif
@@ -24,49 +26,384 @@
 #endif
 
 #include "utlSorter.h"
+#include "utlMonoid.h"
+
+/// foward declaration of external SearchTreeCore class.
+template <class Derived, class Etype, class Cmp, class Alloc> class SearchTreeCore;
+/// foward declaration of external OrderedSearchTreeCore class.
+template <class Derived, class Etype, class Cmp, class Alloc> class OrderedSearchTreeCore;
+/// foward declaration of external AVLTreeCore class.
+template <class Derived, class Etype, class Cmp, class Alloc> class AVLTreeCore;
+/// foward declaration of external AATreeCore class.
+template <class Derived, class Etype, class Cmp, class Alloc> class AATreeCore;
+/// foward declaration of external RedBlackTreeCore class.
+template <class Derived, class Etype, class Cmp, class Alloc> class RedBlackTreeCore;
+/// foward declaration of external SplayTreeCore class.
+template <class Derived, class Etype, class Cmp, class Alloc> class SplayTreeCore;
+
+/** describes which fields a tree node holds.
+ *
+ *  Balance: type of the balancing information
+ *     (AVL height, Red-Black color or AA level). <br>
+ *  HasSize: whether nodes have a Size field for the size of their
+ *     subtrees. Only OrderedSearchTree, and the trees of utlCounted
+ *     nodes, keep it up to date. <br>
+ *
+ *  A node is laid out as Left, Right, Element, Size, BalancingInfo and
+ *  Shares (then Parent, see utlParented, and Aggregate, see utlAugmented).
+ *  A one-byte balancing field and the two-byte count of Shares thus fit 
+ *  in what would otherwise be padding at the end of the node.
+ *
+ *  Children are linked by pointers. See utlIndexed for 32-bit links.
+ */
+template <class Balance, int HasSize>
+struct utlNodeLayout {
+  /// type of the balancing information.
+  typedef Balance balance_type;
+  /// whether nodes have a Size field.
+  enum { has_size = HasSize };
+  /// whether nodes link to their parents (see utlParented).
+  enum { has_parent = 0 };
+  /// whether balanced trees keep the Size field up to date (see utlCounted).
+  enum { keeps_size = 0 };
+  /// whether nodes aggregate the items of their subtrees (see utlAugmented).
+  enum { has_aggregate = 0 };
+  /// monoid aggregating the items of a subtree, or void (see utlAugmented).
+  typedef void monoid_type;
+  /** balancing information given by the empty constructor of a node, 
+   *  as to the NullNode. The NullNode of an indexed pool is shared by 
+   *  all trees, and must be made with the one of an empty subtree.
+   */
+  enum { null_balance = 1 };
+  /// type of the links to the children.
+  template <class Node> struct link { typedef Node* type; };
+};
+
+/// full layout: int balancing information and size. Used by default.
+typedef utlNodeLayout<int,1> utlFullLayout;
+
+/** AVL layout: height in a byte (heights stay below 127), no size.
+ *  The compact layouts are distinct types, so that each kind of tree
+ *  has its own node type, and its own shared NullNode when indexed.
+ */
+struct utlAVLLayout : utlNodeLayout<signed char,0> { 
+  /// height of an empty subtree.
+  enum { null_balance = -1 };
+};
+
+/// Red-Black layout: color in a byte, no size.
+struct utlRBLayout : utlNodeLayout<signed char,0> { };
+
+/// AA layout: level in a byte (levels stay below log2(n)+1), no size.
+struct utlAALayout : utlNodeLayout<signed char,0> { 
+  /// level of an empty subtree.
+  enum { null_balance = 0 };
+};
+
+/// Splay and unbalanced trees: balancing byte unused, no size.
+struct utlPlainLayout : utlNodeLayout<signed char,0> { };
+
+/// ordered trees: balancing byte and size, for order statistics.
+typedef utlNodeLayout<signed char,1> utlOrderedLayout;
+
+/** a layout whose children are linked by 32-bit indices instead of
+ *  pointers (see utlIndexLink). Nodes must come from a utlIndexPool.
+ *  For small keys, such as int, nodes take 16 bytes.
+ */
+template <class Layout>
+struct utlIndexed : Layout {
+  /// type of the links to the children.
+  template <class Node> struct link { typedef utlIndexLink<Node> type; };
+};
+
+/** a layout whose nodes also link to their parents. The root links
+ *  to the NullNode. An in-order iterator then steps from node to node
+ *  in O(1) amortized, with no stack (see ParentInOrder).
+ *  For small keys, such as int, nodes take 8 more bytes (4 if indexed).
+ *  Only trees keeping these links (AVLTreeCore) may use it, and copies
+ *  of such trees do not share nodes (see SearchTreeCore::Shareable).
+ */
+template <class Layout>
+struct utlParented : Layout {
+  /// whether nodes link to their parents.
+  enum { has_parent = 1 };
+};
+
+/** a layout whose nodes have a Size field, which the balanced trees
+ *  (AVLTreeCore, RedBlackTreeCore, AATreeCore, SplayTreeCore) update
+ *  in every insertion, removal and rotation. Order statistics (FindKth, 
+ *  Rank, RemoveKth, Sample) then take O(log n), and CountRange too.
+ *  For small keys, such as int, nodes take 32 bytes instead of 24.
+ */
+template <class Layout>
+struct utlCounted : Layout {
+  /// whether nodes have a Size field.
+  enum { has_size = 1 };
+  /// whether the trees keep the Size field up to date.
+  enum { keeps_size = 1 };
+};
+
+/** a layout whose nodes also keep an aggregate of the items of their
+ *  subtrees, such as the sum or the maximum of the values of a utlMap.
+ *  The aggregate of a node combines, in order, that of its left child, 
+ *  the value of its item and that of its right child, and is recomputed
+ *  wherever sizes are (see utlCounted). Only AVLTreeCore, RedBlackTreeCore
+ *  and AATreeCore keep it (KeepsAggregates). RangeAggregate then 
+ *  combines the items in a range of keys in O(log n).
+ *
+ *  Monoid: value_type, and static functions identity(), value(item)
+ *  and combine(a, b), which must be associative (see utlMonoid.h).
+ */
+template <class Layout, class Monoid>
+struct utlAugmented : utlCounted<Layout> {
+  /// whether nodes aggregate the items of their subtrees.
+  enum { has_aggregate = 1 };
+  /// monoid aggregating the items of a subtree.
+  typedef Monoid monoid_type;
+};
+
+/** balancing information with a version number, for trees which are
+ *  read by some threads while another one changes them.
+ *  It is read and written as the balancing information itself.
+ *  The version is odd while the links of the node are being changed,
+ *  and grows every time they are (see ConcurrentAVLTree).
+ */
+template <class Balance>
+struct utlVersioned {
+  /// constructor given the balancing information.
+  utlVersioned ( int b = 0 ) : Info ( b ), Version ( 0 ) { }
+  /// copy constructor. The version is not copied.
+  utlVersioned ( const utlVersioned& v ) : Info ( v.Info ), Version ( 0 ) { }
+  /// assignment operator. The version is not copied.
+  utlVersioned& operator = ( const utlVersioned& v ) { Info = v.Info; return *this; }
+  /// sets the balancing information.
+  utlVersioned& operator = ( int b ) { Info = b; return *this; }
+  /// returns the balancing information.
+  operator int ( ) const { return Info; }
+
+  /// balancing information.
+  Balance Info;
+  /// version number.
+  std::atomic<unsigned> Version;
+};
+
+/** concurrent AVL layout: int height with a version number, no size,
+ *  and children linked by utlAtomicLink. Used by ConcurrentAVLTree.
+ */
+struct utlConcurrentAVLLayout : utlNodeLayout<utlVersioned<int>,0> {
+  /// type of the links to the children.
+  template <class Node> struct link { typedef utlAtomicLink<Node> type; };
+};
+
+/** number of links to a node besides the first one, for trees whose
+ *  copies share their nodes (see SearchTreeCore::Share). A node whose 
+ *  count is 0 is linked once, and belongs to the tree linking it, which
+ *  may write it. The trees sharing a node may belong to different threads,
+ *  so the count is atomic. It is not copied with the node: a copy is 
+ *  linked once.
+ */
+struct utlShareCount {
+  /// largest count. A node linked that many more times is copied instead.
+  enum { Most = 0xffff };
+  /// empty constructor.
+  utlShareCount ( ) : Count ( 0 ) { }
+  /// copy constructor. The count is not copied.
+  utlShareCount ( const utlShareCount& ) : Count ( 0 ) { }
+  /// assignment operator. The count is not copied.
+  utlShareCount& operator = ( const utlShareCount& ) { return *this; }
+  /// number of links besides the first one.
+  std::atomic<unsigned short> Count;
+};
+
+/** fields of a node, according to its layout.
+ *  Size is only present if Layout::has_size is true.
+ */
+template <class Node, class Etype, class Layout, int HasSize=Layout::has_size>
+struct utlNodeFields
+{
+  /// type of the links to the children.
+  typedef typename Layout::template link<Node>::type Link;
+
+  /// empty constructor.
+  utlNodeFields( Node* L = NULL, Node* R = NULL ) : 
+        Left( L ), Right( R ), Size( 1 ), BalancingInfo( Layout::null_balance ) { }
+
+  /// contructor given data, left child and right child.
+  utlNodeFields( const Etype& E, Node* L = NULL, Node* R = NULL ) : 
+        Left( L ), Right( R ), Element( E ), Size( 1 ), BalancingInfo( 1 ) { }
+
+  /// Left child.
+  Link Left;
+  /// Right child.
+  Link Right;   
+
+ protected:
+
+  /// the data in the node.
+  Etype Element;
+
+  /// node's size  (used for order stats).
+  int Size;            
 
-/// foward declaration of external SerachTree class.
-template <class Etype, class Cmp> class SearchTree;
-/// foward declaration of external OrderedSearchTree class.
-template <class Etype, class Cmp> class OrderedSearchTree;
-/// foward declaration of external AVLTree class.
-template <class Etype, class Cmp> class AVLTree;
-/// foward declaration of external AATree class.
-template <class Etype, class Cmp> class AATree;
-/// foward declaration of external RedBlackTree class.
-template <class Etype, class Cmp> class RedBlackTree;
-/// foward declaration of external RedBlackTree class.
-template <class Etype, class Cmp> class SplayTree;
+ public:
+
+  /// information used for balancing.
+  typename Layout::balance_type BalancingInfo;
+
+ protected:
+
+  /// number of links to the node besides the first one (see utlShareCount).
+  utlShareCount Shares;
+
+  /// copies balancing information and size from a given node.
+  void copyData ( const utlNodeFields& n ) {
+     this->Size = n.Size;
+     this->BalancingInfo = n.BalancingInfo;
+  }
+};
+
+/// fields of a node without size.
+template <class Node, class Etype, class Layout>
+struct utlNodeFields<Node,Etype,Layout,0>
+{
+  /// type of the links to the children.
+  typedef typename Layout::template link<Node>::type Link;
+
+  /// empty constructor.
+  utlNodeFields( Node* L = NULL, Node* R = NULL ) : 
+        Left( L ), Right( R ), BalancingInfo( Layout::null_balance ) { }
+
+  /// contructor given data, left child and right child.
+  utlNodeFields( const Etype& E, Node* L = NULL, Node* R = NULL ) : 
+        Left( L ), Right( R ), Element( E ), BalancingInfo( 1 ) { }
+
+  /// Left child.
+  Link Left;
+  /// Right child.
+  Link Right;   
+
+ protected:
+
+  /// the data in the node.
+  Etype Element;
+
+ public:
+
+  /// information used for balancing.
+  typename Layout::balance_type BalancingInfo;
+
+ protected:
+
+  /// number of links to the node besides the first one (see utlShareCount).
+  utlShareCount Shares;
+
+  /// copies balancing information from a given node.
+  void copyData ( const utlNodeFields& n ) {
+     this->BalancingInfo = n.BalancingInfo;
+  }
+};
+
+/** link of a node to its parent, according to its layout.
+ *  It comes after the other fields of the node.
+ */
+template <class Node, class Link, int HasParent>
+struct utlParentField
+{
+  /// empty constructor.
+  utlParentField( ) : Parent( NULL ) { }
+
+  /// returns a pointer to the parent, or the NullNode for the root.
+  Node* GetParent () const { return this->Parent; }
+
+  /// sets the parent.
+  void SetParent ( Node* P ) { this->Parent = P; }
+
+  /// Parent.
+  Link Parent;
+};
+
+/// no link to the parent: it takes no room in the node.
+template <class Node, class Link>
+struct utlParentField<Node,Link,0>
+{
+  /// returns NULL: the parent is not known.
+  Node* GetParent () const { return NULL; }
+
+  /// does nothing.
+  void SetParent ( Node* ) { }
+};
+
+/** aggregate of the items of the subtree of a node (see utlAugmented).
+ *  It comes after the other fields of the node.
+ */
+template <class Monoid>
+struct utlAggregateField
+{
+  /// type of the aggregates.
+  typedef typename Monoid::value_type aggregate_type;
+
+  /// empty constructor.
+  utlAggregateField( ) : Aggregate( Monoid::identity() ) { }
+
+  /// returns the aggregate of the items of the subtree.
+  const aggregate_type& GetAggregate () const { return this->Aggregate; }
+
+  /// Aggregate.
+  aggregate_type Aggregate;
+};
+
+/// no aggregate: it takes no room in the node.
+template <>
+struct utlAggregateField<void>
+{
+  /// there is no aggregate.
+  typedef void aggregate_type;
+};
 
 /** node class for a binary tree.
  *
  *  All fields are protected to hide them from dangerous users.
  *  All tree classes are friends, to access them directly.
+ *
+ *  Layout selects the fields stored in the node (see utlNodeLayout).
+ *  By default, all of them are present, but the link to the parent.
  *	
  *  @author <A HREF="mailto:roma@lcg.ufrj.br">Paulo Roma Cavalcanti</a> and
  *          <A HREF="mailto:weiss@fiu.edu">Mark Allen Weiss</a>
  *  @version $Revision: 1.1.1.1 $ $Date: 2003/10/31 23:10:11 $
  */
-template <class Etype, class Cmp=compare_to<Etype> >
-class BinNode
+template <class Etype, class Cmp=compare_to<Etype>, class Layout=utlFullLayout>
+class BinNode : public utlNodeFields<BinNode<Etype,Cmp,Layout>,Etype,Layout>,
+                public utlParentField<BinNode<Etype,Cmp,Layout>,
+                                      typename Layout::template link<BinNode<Etype,Cmp,Layout> >::type,
+                                      Layout::has_parent>,
+                public utlAggregateField<typename Layout::monoid_type>
 {
+  /// node fields.
+  typedef utlNodeFields<BinNode<Etype,Cmp,Layout>,Etype,Layout> Fields;
+
  public:
 
+  /// node layout.
+  typedef Layout layout_type;
+
+  /// type of the links to the children: a pointer or an index.
+  typedef typename Fields::Link link_type;
+
+  /// type of the aggregates of subtrees (see utlAugmented), or void.
+  typedef typename utlAggregateField<typename Layout::monoid_type>::aggregate_type aggregate_type;
+
   /** @name constructors  */ 
   //@{
 
 /// empty constructor.
-    BinNode( ) : Left( NULL ), Right( NULL ),
-        Size( 1 ), BalancingInfo( 1 ) { }
+    BinNode( ) { }
 
 /// contructor given data.
-    BinNode( const Etype& E ) : Element( E ), Left( NULL ),
-        Right( NULL ), Size( 1 ), BalancingInfo( 1 ) { }
+    BinNode( const Etype& E ) : Fields( E ) { }
 
 /// contructor given data, left child and right child.
-    BinNode( const Etype& E, BinNode* L, BinNode* R ) :
-        Element( E ), Left( L ), Right( R ), Size( 1 ),
-        BalancingInfo( 1 ) { }
+    BinNode( const Etype& E, BinNode* L, BinNode* R ) : Fields( E, L, R ) { }
 
 /// destructor.
     ~BinNode( ) { }
@@ -88,7 +425,7 @@ class BinNode
 /// returns node balance.
     int GetBalance () const { return this->BalancingInfo; }
 
-    /// retur*ns node size.
+    /// returns node size. Only available if the layout has a size.
     int GetSize () const { return this->Size; }
 
 /// operator <.  
@@ -111,34 +448,20 @@ class BinNode
        return this->Element > n.Element;
     }
 
-/// SearchTree is a friend.
-friend class SearchTree<Etype,Cmp>;
-/// OrderedSearchTree is a friend.
-friend class OrderedSearchTree<Etype,Cmp>;
-/// AVLTree is a friend.
-friend class AVLTree<Etype,Cmp>;
-/// AATree is a friend.
-friend class AATree<Etype,Cmp>;
-/// RedBlackTree is a friend.
-friend class RedBlackTree<Etype,Cmp>;
-/// SplayTree is a friend.
-friend class SplayTree<Etype,Cmp>;
-
-/// information used for balancing.
-int BalancingInfo;
-    
-    /// Left child.
-    BinNode* Left;
-    /// Right child.
-    BinNode* Right;   
-protected:
-
-/// the data in the node.
-    Etype Element;
+/// SearchTreeCore is a friend.
+template <class D, class E, class C, class A> friend class SearchTreeCore;
+/// OrderedSearchTreeCore is a friend.
+template <class D, class E, class C, class A> friend class OrderedSearchTreeCore;
+/// AVLTreeCore is a friend.
+template <class D, class E, class C, class A> friend class AVLTreeCore;
+/// AATreeCore is a friend.
+template <class D, class E, class C, class A> friend class AATreeCore;
+/// RedBlackTreeCore is a friend.
+template <class D, class E, class C, class A> friend class RedBlackTreeCore;
+/// SplayTreeCore is a friend.
+template <class D, class E, class C, class A> friend class SplayTreeCore;
 
-/// node's size  (used for order stats).
-    int Size;            
-   
+protected:
 
 /// sets node fields: balance and size.
     void setData ( int Balance, int Size ) {
@@ -149,14 +472,13 @@ protected:
 /// sets node element.
     void setElement ( const Etype& e ) {
        // Element = e;
-       new(&Element) Etype(e);
+       new(&this->Element) Etype(e);
     }
 
 /// copy operator. Does not copy Left and Right.
     const BinNode& operator = ( const BinNode& node ) {
        this->Element = node.Element;
-       this->Size = node.Size;
-       this->BalancingInfo = node.BalancingInfo;
+       this->copyData ( node );
        this->Left = this->Right = NULL;
        return *this;
     }
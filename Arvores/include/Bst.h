@@ -15,8 +15,13 @@
 #ifndef __BST
 #define __BST
 
+#include <type_traits>
+#include <vector>
+#include <atomic>
 #include "utlConfig.h"
+#include "utlThreadPool.h"
 #include "BinNode.h"
+#include "utlNodePool.h"
 #include "AbsBst.h"
 #include "Exception.h"
 
@@ -32,14 +37,43 @@
  *	
  *  Etype: must have zero-parameter and copy constructor,
  *     and must have operator< <br>
+ *  Alloc: node allocator. Nodes are taken from a utlNodePool
+ *     by default, which carves them out of large chunks.
+ *     Its value_type is the node type, whose layout 
+ *     (see utlNodeLayout) may be chosen to fit the tree. <br>
  *  CONSTRUCTION: with (a) no initializer; <br>
- *  Copy construction of SearchTree objects is DISALLOWED. <br>
- *  Deep copy is supported.
+ *  Copy construction and assignment are supported. Copies share
+ *  their nodes until one of them is changed (see Share). <br>
  *
  *  ******************PUBLIC OPERATIONS********************* <br>
  *  int Insert( const Etype& X)  --> Insert X <br>
+ *  int InsertP( const Etype& X) --> Insert X, unless its key is there <br>
  *  int Remove( const Etype& X)  --> Remove X <br>
+ *  int RemoveP( const Etype& X) --> Remove pair whose key matches X <br>
+ *  int Build( first, last )    --> Replace items by those of a range <br>
+ *  int BuildP( first, last )   --> Same, keeping the first pair of each key <br>
+ *  int BuildFromSorted( first, last ) --> Same as Build, for a sorted range <br>
+ *  int BuildFromSortedP( first, last ) --> Same as BuildP, for a sorted range <br>
  *  Etype Find( const Etype& X)	 --> Return item that matches X <br>
+ *  BinaryNode* Lookup( const Etype& X) --> Return node holding X, or NULL <br>
+ *  BinaryNode* LookupP( const Etype& X) --> Same, comparing pairs by key <br>
+ *  int FindBatch( keys, n, out ) --> Look up n items at once <br>
+ *  int FindBatchP( keys, n, out ) --> Same, comparing pairs by key <br>
+ *  BinaryNode* Predecessor( node ) --> Return node of the previous item <br>
+ *  BinaryNode* LowerBound( const Etype& X) --> Return node of first item not before X <br>
+ *  BinaryNode* UpperBound( const Etype& X) --> Return node of first item after X <br>
+ *  BinaryNode* LowerBoundP( X ), UpperBoundP( X ) --> Same, comparing pairs by key <br>
+ *  int CountRange( const Etype& A, const Etype& B) --> Number of items in [A, B) <br>
+ *  int CountRangeP( A, B ) --> Same, comparing pairs by key <br>
+ *  int CountP( const Etype& X)  --> Number of pairs whose key matches X <br>
+ *  aggregate_type RangeAggregate( A, B ) --> Aggregate of the items in [A, B] <br>
+ *  aggregate_type RangeAggregateP( A, B ) --> Same, comparing pairs by key <br>
+ *  BinaryNode* LookupKth( int K ) --> Return node of Kth smallest item, or NULL <br>
+ *  Etype FindKth( int K )       --> Return Kth smallest item <br>
+ *  int Rank( const Etype& X)    --> Number of items before X <br>
+ *  int RankP( const Etype& X)   --> Same, comparing pairs by key <br>
+ *  int RemoveKth( int K )       --> Remove Kth smallest item <br>
+ *  Etype Sample( double u )     --> Return item of rank u n, u in [0, 1) <br>
  *  int RemoveMin( )    	 --> Removes minimum item from tree <br>
  *  int WasFound( )     	 --> Return 1 if last Find succeeded <br>
  *  int IsFound( const Etype& X) --> Return 1 if X would be found <br>
@@ -49,38 +83,108 @@
  *  void MakeEmpty( )   	 --> Remove all items <br>
  *  BinayNode* GetRoot()         --> Return root node <br>
  *  void Merge()        	 --> Merge two binary trees <br>
+ *  int Union( T )               --> Move the items of T into this tree <br>
+ *  int Intersection( T )        --> Keep the items also in T, and empty T <br>
+ *  int Difference( T )          --> Remove the items in T, and empty T <br>
+ *  int UnionP( T ), IntersectionP( T ), DifferenceP( T ) --> Same, by key <br>
+ *  int InsertBatch( first, last ) --> Insert the items of a range <br>
+ *  int RemoveBatch( first, last ) --> Remove the items of a range <br>
+ *  int InsertBatchP( first, last ), RemoveBatchP( first, last ) --> Same, by key <br>
  *  int Height( const BinaryNode* T) --> Calculates the height of a node <br>
  *  int Size( const BinaryNode* T)   --> Calculates the size of a node <br>
+ *  void ShrinkToFit( )          --> Give unused node memory back <br>
+ *  void Unshare( )              --> Stop sharing the nodes with copies <br>
+ *  void Unshare( const Etype& X ) --> Same, for the nodes X may change <br>
  *  ******************ERRORS******************************** <br>
  *  Predefined exception is propagated if new fails <br>
  *  ItemNotFound returned on various degenerate conditions <br>
  *
- *  All routines are made virtual in case classes are derived <br>
- *  This includes trivial routines because we might want to <br>
- *  implement lazy deletion as a derived class. <br>
+ *  The trees are built on non-virtual cores, using the "curiously
+ *  recurring template pattern": Derived is the final tree class, and
+ *  the core calls the routines a tree may redefine (GetRoot, MakeEmpty,
+ *  SetTree, SetBalance) through it. No call is virtual, so searches and iterations are
+ *  inlined. <br>
+ *  A tree which can join and split subtrees in O(log n) (AVLTree, RedBlackTree)
+ *  sets Joinable, and defines JoinHeight, ChildHeights, JoinNodes and SplitNodes.
+ *  The core then implements Join and Split, and the set operations combine 
+ *  subtrees on several threads (see SetOperation). Other trees insert or
+ *  remove the items one by one. <br>
+ *  Each tree comes in two flavours: SearchTree, AVLTree, ... implement 
+ *  the virtual AbsBst interface, through AbsBstAdapter, so that they
+ *  may be used polymorphically, or derived from, as before.
+ *  StaticSearchTree, StaticAVLTree, ... have no virtual function at all. <br>
+ *  A copy of a Shareable tree takes O(1): it shares the nodes of the
+ *  original, each of them keeping the count of the links to it (see
+ *  utlShareCount). A change copies only the shared nodes it may write,
+ *  along the path of its item (see Unshare), and the nodes replaced are
+ *  kept for the iterators which may still hold them. A change to a tree
+ *  which was never copied only tests a flag. Splaying trees change on
+ *  reads, concurrent trees are read while written, and a node linking to
+ *  its parent (HasParents) cannot be linked from two trees, so these 
+ *  trees copy their nodes at once.
  */
 
-template <class Etype, class Cmp=compare_to<Etype> >
-class SearchTree : public AbsBst<Etype,Cmp>
+template <class Derived, class Etype, class Cmp, class Alloc>
+class SearchTreeCore
 {
   public:
 
   /// a binary node definition.
-  typedef BinNode<Etype,Cmp> BinaryNode;
+  typedef typename Alloc::value_type BinaryNode;
+
+  /// type of the items.
+  typedef Etype value_type;
+
+  /// node allocator type.
+  typedef Alloc allocator_type;
+
+  /// a link between nodes: a pointer, or an index (see utlIndexLink).
+  typedef typename BinaryNode::link_type Link;
+
+  /// whether nodes link to their parents (see utlParented and KeepsParents).
+  enum { HasParents = BinaryNode::layout_type::has_parent };
+
+  /// whether nodes keep the size of their subtrees (see utlCounted and KeepsSizes).
+  enum { HasSizes = BinaryNode::layout_type::keeps_size };
+
+  /// whether Size reads a kept size in O(1): HasSizes, or OrderedSearchTree.
+  enum { KnowsSizes = HasSizes };
+
+  /// whether nodes aggregate the items of their subtrees (see utlAugmented and KeepsAggregates).
+  enum { HasAggregates = BinaryNode::layout_type::has_aggregate };
+
+  /// monoid aggregating the items of a subtree, or void.
+  typedef typename BinaryNode::layout_type::monoid_type monoid_type;
+
+  /// type of the aggregates, or void.
+  typedef typename BinaryNode::aggregate_type aggregate_type;
+
+  /** whether copies of the tree share its nodes until one of them changes
+   *  (see Share). Nodes linking to their parents have a single parent.
+   */
+  enum { Shareable = !HasParents };
 
   /** @name constructors  */ 
   //@{
     /// empty constructor.
-    SearchTree( ) : Current( NULL ), Root( NULL ), NullNode ( NULL ), 
-                    ItemNotFound (Etype()), compare(Cmp()) { }
+    SearchTreeCore( ) : Current( NULL ), Root( NULL ), NullNode ( NULL ), 
+                        ItemNotFound (Etype()), compare(Cmp()),
+                        Private( true ), Generation( 0 ) { }
 
     /// empty constructor.
-    SearchTree( const Cmp& comp ) : 
+    SearchTreeCore( const Cmp& comp ) : 
             Current( NULL ), Root( NULL ), NullNode ( NULL ), 
-            ItemNotFound (Etype()), compare(comp) { }
+            ItemNotFound (Etype()), compare(comp),
+            Private( true ), Generation( 0 ) { }
 
-    /// destructor. Deletes the tree.
-    virtual ~SearchTree( ) { FreeTree( Root ); Root = NullNode; }
+    /// copy constructor. The nodes of Rhs are shared (see Share).
+    SearchTreeCore( const SearchTreeCore& Rhs ) : 
+            Current( NULL ), Root( NULL ), NullNode ( NULL ), 
+            ItemNotFound (Etype()), compare(Rhs.compare),
+            Private( true ), Generation( 0 ) { Clone ( Rhs ); }
+
+    /// destructor. Deletes the tree, unless a copy still uses its nodes.
+    ~SearchTreeCore( ) { ReleaseTree( Root ); Root = NullNode; }
 
   //@}
 
@@ -89,38 +193,195 @@ class SearchTree : public AbsBst<Etype,Cmp>
      *  @param X item to be inserted.
      *	@return 1 if successful.
      */
-    virtual int Insert( const Etype& X )
-        { return Insert( X, Root ); }
+    int Insert( const Etype& X )
+        { Unshare( X ); return Insert( X, Root ); }
+
+    /** adds X into the tree, unless there is a pair with the key of X.
+     *  Version specialized for pairs, since it uses operator neq.
+     *
+     *  @param X pair to be inserted.
+     *	@return 1 if successful.
+     */
+    int InsertP( const Etype& X ) {
+        if ( self().LookupP( X ) != NULL ) return 0;
+        return self().Insert( X );
+    }
 
     /** removes X from the tree. 
      *
      *  @param X item to be removed.
      *	@return true if successful.
      */
-    virtual int Remove( const Etype& X )
-        { return Remove( X, Root ); }
+    int Remove( const Etype& X )
+        { Unshare( X ); return Remove( X, Root ); }
+
+    /** removes the pair whose key matches the key of X.
+     *  Version specialized for pairs, since it uses operator neq.
+     *
+     *  @param X pair whose key is searched for.
+     *	@return true if successful.
+     */
+    int RemoveP( const Etype& X ) {
+        const BinaryNode* node = self().LookupP( X );
+        if ( node == NULL ) return 0;
+        const Etype Y ( node->GetElement() );
+        return self().Remove( Y );
+    }
+
+    /** replaces the items of the tree by those of a range.
+     *  The range is sorted by several threads, unless it is sorted
+     *  already, and a perfectly balanced tree is built from it in O(n)
+     *  (see MakeTree). Of equivalent items, the first one is kept,
+     *  as Insert would do.
+     *
+     *  @param first beginning of the range (forward iterator).
+     *  @param last end of the range.
+     *  @param threads number of threads used for sorting,
+     *         or 0 for one per hardware thread.
+     *	@return number of items in the tree.
+     */
+    template <class Iter>
+    int Build( Iter first, Iter last, int threads = 0 )
+        { return BuildTree( first, last, utlDerefLess<Etype,Cmp>( compare ), 1, threads ); }
+
+    /** replaces the items of the tree by the pairs of a range.
+     *  Version specialized for pairs, since it uses operator neq:
+     *  of the pairs with the same key, the first one is kept, as
+     *  InsertP would do.
+     *
+     *  @see Build().
+     */
+    template <class Iter>
+    int BuildP( Iter first, Iter last, int threads = 0 )
+        { return BuildTree( first, last, utlDerefLessP<Etype,Cmp>( compare ), 1, threads ); }
+
+    /** replaces the items of the tree by those of a sorted range, in O(n).
+     *  An exception is raised if the range is not sorted.
+     *
+     *  @see Build().
+     */
+    template <class Iter>
+    int BuildFromSorted( Iter first, Iter last )
+        { return BuildTree( first, last, utlDerefLess<Etype,Cmp>( compare ), 0, 1 ); }
+
+    /** replaces the items of the tree by the pairs of a range sorted by key, 
+     *  in O(n). An exception is raised if the range is not sorted.
+     *
+     *  @see BuildP().
+     */
+    template <class Iter>
+    int BuildFromSortedP( Iter first, Iter last )
+        { return BuildTree( first, last, utlDerefLessP<Etype,Cmp>( compare ), 0, 1 ); }
+
+    /** adds the items of T to this tree, and makes T empty.
+     *  Of equivalent items, the one of this tree is kept.
+     *  Joinable trees move the nodes of T, in O(m log(n/m + 1)) for trees 
+     *  of m and n >= m items, and work on independent subtrees in parallel.
+     *  Other trees insert the items of T.
+     *
+     *  @param T another tree.
+     *  @param threads number of threads, or 0 for one per hardware thread.
+     *	@return number of items of T which were already in this tree.
+     */
+    int Union( Derived& T, int threads = 0 )
+        { return Combine( T, SetUnion, threads, utlDerefLess<Etype,Cmp>( compare ) ); }
+
+    /** keeps the items which are also in T, and makes T empty.
+     *  Items are taken from this tree.
+     *
+     *  @see Union().
+     *	@return number of items kept.
+     */
+    int Intersection( Derived& T, int threads = 0 )
+        { return Combine( T, SetIntersection, threads, utlDerefLess<Etype,Cmp>( compare ) ); }
+
+    /** removes the items which are also in T, and makes T empty.
+     *
+     *  @see Union().
+     *	@return number of items removed.
+     */
+    int Difference( Derived& T, int threads = 0 )
+        { return Combine( T, SetDifference, threads, utlDerefLess<Etype,Cmp>( compare ) ); }
+
+    /** Union, for pairs: pairs whose keys match (operator neq) are equivalent.
+     *  Of two such pairs, the one of this tree is kept.
+     */
+    int UnionP( Derived& T, int threads = 0 )
+        { return Combine( T, SetUnion, threads, utlDerefLessP<Etype,Cmp>( compare ) ); }
+
+    /// Intersection, for pairs: pairs whose keys match (operator neq) are equivalent.
+    int IntersectionP( Derived& T, int threads = 0 )
+        { return Combine( T, SetIntersection, threads, utlDerefLessP<Etype,Cmp>( compare ) ); }
+
+    /// Difference, for pairs: pairs whose keys match (operator neq) are equivalent.
+    int DifferenceP( Derived& T, int threads = 0 )
+        { return Combine( T, SetDifference, threads, utlDerefLessP<Etype,Cmp>( compare ) ); }
+
+    /** inserts the items of a range, keeping those already in the tree.
+     *  The range is sorted by several threads, and duplicates are dropped,
+     *  as in Build. Joinable trees then make a tree of the range, in O(m),
+     *  and unite it with this one (see SetOperation): neighbouring items 
+     *  share their descents, and each subtree is rebalanced once, by the
+     *  joins. Other trees are rebuilt from both sorted sequences, in 
+     *  O(n + m), unless the range is smaller than the tree, whose items 
+     *  are then inserted one by one, in order.
+     *
+     *  @param first beginning of the range (forward iterator).
+     *  @param last end of the range.
+     *  @param threads number of threads, or 0 for one per hardware thread.
+     *	@return number of items inserted.
+     */
+    template <class Iter>
+    int InsertBatch( Iter first, Iter last, int threads = 0 )
+        { return Batch( first, last, SetUnion, threads, utlDerefLess<Etype,Cmp>( compare ) ); }
+
+    /** removes the items of a range.
+     *
+     *  @see InsertBatch().
+     *	@return number of items removed.
+     */
+    template <class Iter>
+    int RemoveBatch( Iter first, Iter last, int threads = 0 )
+        { return Batch( first, last, SetDifference, threads, utlDerefLess<Etype,Cmp>( compare ) ); }
+
+    /// InsertBatch, for pairs: a pair is not inserted if its key is there.
+    template <class Iter>
+    int InsertBatchP( Iter first, Iter last, int threads = 0 )
+        { return Batch( first, last, SetUnion, threads, utlDerefLessP<Etype,Cmp>( compare ) ); }
+
+    /// RemoveBatch, for pairs: the pairs whose keys match are removed.
+    template <class Iter>
+    int RemoveBatchP( Iter first, Iter last, int threads = 0 )
+        { return Batch( first, last, SetDifference, threads, utlDerefLessP<Etype,Cmp>( compare ) ); }
 
     /** removes minimum item from the tree. 
+     *  It is removed through the Remove of the tree, which keeps it
+     *  balanced and updates the sizes; the root of a RedBlackTree 
+     *  is also below its Header.
      *
      *	@return true if successful.
      */
-    virtual int RemoveMin( )
-        { return RemoveMin( Root ); }
+    int RemoveMin( ) {
+        const BinaryNode* P = FindMin( self().GetRoot() );
+        if ( P == NullNode ) return 0;
+        const Etype X ( P->Element );
+        return self().Remove ( X );
+    }
 
     /** returns minimum item in tree. 
      *
      *	@return ItemNotFound if tree is empty. 
      */
-    virtual const Etype& FindMin( ) const
-        { const BinaryNode* P = FindMin( GetRoot() );
+    const Etype& FindMin( ) const
+        { const BinaryNode* P = FindMin( self().GetRoot() );
               return ( P != NullNode ? P->GetElement() : ItemNotFound ); }
 
     /** returns maximum item in tree. 
      *
      *	@return ItemNotFound if tree is empty. 
      */
-    virtual const Etype& FindMax( ) const
-        { const BinaryNode* P = FindMax( GetRoot() );
+    const Etype& FindMax( ) const
+        { const BinaryNode* P = FindMax( self().GetRoot() );
               return ( P != NullNode ? P->GetElement() : ItemNotFound ); }
 
     /** returns item X in tree. 
@@ -129,13 +390,39 @@ class SearchTree : public AbsBst<Etype,Cmp>
      *  @param X item to be searched for.
      *	@return ItemNotFound if X is not found. 
      */
-    virtual const Etype& Find ( const Etype& X ) const { 
+    const Etype& Find ( const Etype& X ) const { 
         BinaryNode** tempCurrent = (BinaryNode**)&Current;
-        *tempCurrent = (BinaryNode*)Find( X, Root );
-        if ( Current != NullNode )
-             return Current->GetElement();
-        else
-             return ItemNotFound; 
+        const BinaryNode* node = Lookup ( X );
+        if ( node != NULL ) 
+           {
+            *tempCurrent = (BinaryNode*)node;
+            return node->GetElement();
+           }
+        *tempCurrent = NullNode;
+        return ItemNotFound; 
+    }
+
+    /** returns the node holding X, or NULL if X is not in the tree.
+     *  Nothing is written, neither in the tree nor in the NullNode,
+     *  and no item is copied. Thus, any number of threads may look up
+     *  the same tree at once, as long as no thread modifies it.
+     *  Splay trees are not splayed.
+     *
+     *  @param X item to be searched for.
+     *  @return node containing X or NULL.
+     */
+    const BinaryNode* Lookup ( const Etype& X ) const {
+        const BinaryNode* T = self().GetRoot();
+        const BinaryNode* Null = NullNode;
+    	while( T != Null )
+            if( compare(X, T->Element) )
+                T = T->Left;
+            else if( compare(T->Element, X) )
+                T = T->Right;
+            else
+                return T;   // Match
+
+    	return NULL;        // Not found
     }
 
     /** returns item X in tree. 
@@ -145,64 +432,375 @@ class SearchTree : public AbsBst<Etype,Cmp>
      *  @param X item to be searched for.
      *	@return ItemNotFound if X is not found. 
      */
-    virtual const Etype& FindP ( const Etype& X ) const { 
-	return Find ( X );
+    const Etype& FindP ( const Etype& X ) const { 
+        BinaryNode** tempCurrent = (BinaryNode**)&Current;
+        const BinaryNode* node = LookupP ( X );
+        if ( node != NULL ) 
+           {
+            *tempCurrent = (BinaryNode*)node;
+            return node->GetElement();
+           }
+        *tempCurrent = NullNode;
+        return ItemNotFound; 
+    }
+
+    /** returns the node holding X, or NULL if X is not in the tree.
+     *  Version specialized for pairs, since it uses operator neq.
+     *  As Lookup, it writes nothing.
+     *
+     *  @param X item to be searched for.
+     *  @return node containing X or NULL.
+     */
+    const BinaryNode* LookupP ( const Etype& X ) const {
+        const BinaryNode* T = self().GetRoot();
+        const BinaryNode* Null = NullNode;
+    	while( T != Null && compare.neq(X, T->Element) )
+            T = compare(X, T->Element) ? T->Left : T->Right;
+
+    	return T != Null ? T : NULL;
+    }
+
+    /** returns the node of the item before the one in a given node, in
+     *  O(height). The node is located from the root as an InOrder iterator
+     *  does, by its own item, and the previous one is the last node of its 
+     *  left subtree, or else the last ancestor whose right subtree holds it.
+     *  As Lookup, it writes nothing.
+     *
+     *  @param node given node, or NULL for the node of the largest item.
+     *  @return previous node, or NULL if there is none.
+     */
+    const BinaryNode* Predecessor ( const BinaryNode* node ) const {
+        const BinaryNode* T = self().GetRoot();
+        const BinaryNode* Null = NullNode;
+        const BinaryNode* Prev = Null;
+        if ( node == NULL )
+             node = Null;
+        else {
+             // node may have been replaced by a copy (see Unshare):
+             // the search then stops on its item, or below it.
+             const Etype& X = node->Element;
+             while ( T != node && T != Null )
+                if ( compare(X, T->Element) )
+                     T = T->Left;
+                else if ( compare(T->Element, X) ) {
+                     Prev = T;
+                     T = T->Right;
+                }
+                else
+                     break;
+             if ( T != Null ) T = T->Left;
+        }
+        for ( ; T != Null; T = T->Right ) Prev = T;
+        return Prev != Null ? Prev : NULL;
+    }
+
+    /** returns the node of the first item not before X: the node of X,
+     *  if X is in the tree. A single descent from the root, which keeps
+     *  the last node where it went left. As Lookup, it writes nothing.
+     *
+     *  @param X item to be searched for.
+     *  @return node found, or NULL if every item comes before X.
+     */
+    const BinaryNode* LowerBound ( const Etype& X ) const
+        { return Bound ( X, 0, utlDerefLess<Etype,Cmp>( compare ) ); }
+
+    /** returns the node of the first item after X (see LowerBound).
+     *
+     *  @param X item to be searched for.
+     *  @return node found, or NULL if no item comes after X.
+     */
+    const BinaryNode* UpperBound ( const Etype& X ) const
+        { return Bound ( X, 1, utlDerefLess<Etype,Cmp>( compare ) ); }
+
+    /** returns the node of the first pair whose key is not before the key of X.
+     *  Version specialized for pairs, since it uses operator neq.
+     */
+    const BinaryNode* LowerBoundP ( const Etype& X ) const
+        { return Bound ( X, 0, utlDerefLessP<Etype,Cmp>( compare ) ); }
+
+    /** returns the node of the first pair whose key is after the key of X.
+     *  Version specialized for pairs, since it uses operator neq.
+     */
+    const BinaryNode* UpperBoundP ( const Etype& X ) const
+        { return Bound ( X, 1, utlDerefLessP<Etype,Cmp>( compare ) ); }
+
+    /** returns the number of items in [A, B): not before A, and before B.
+     *  The search descends to the first node in the range, where the paths
+     *  to A and B part, and then once along each path, adding whole subtrees
+     *  by their Size, in O(log n). Only trees which keep the size of their
+     *  nodes (KnowsSizes: utlCounted nodes, OrderedSearchTree) count ranges:
+     *  on the others, counting the subtrees would take O(log n + count).
+     *
+     *  @param A first item of the range.
+     *  @param B item past the end of the range.
+     *  @return number of items, 0 if B is not after A.
+     */
+    int CountRange ( const Etype& A, const Etype& B ) const {
+        static_assert ( Derived::KnowsSizes, "CountRange needs a tree which keeps sizes (see utlCounted)" );
+        return CountBetween ( A, B, 0, utlDerefLess<Etype,Cmp>( compare ) ); 
     }
 
+    /** returns the number of pairs whose keys are in [key of A, key of B).
+     *  Version specialized for pairs, since it uses operator neq.
+     */
+    int CountRangeP ( const Etype& A, const Etype& B ) const {
+        static_assert ( Derived::KnowsSizes, "CountRangeP needs a tree which keeps sizes (see utlCounted)" );
+        return CountBetween ( A, B, 0, utlDerefLessP<Etype,Cmp>( compare ) ); 
+    }
+
+    /** returns the number of pairs whose key matches the key of X, 
+     *  which may be several in a multimap, as CountRange does: in O(log n)
+     *  on trees which keep sizes, and in O(log n + count) on the others.
+     *  Version specialized for pairs, since it uses operator neq.
+     */
+    int CountP ( const Etype& X ) const
+        { return CountBetween ( X, X, 1, utlDerefLessP<Etype,Cmp>( compare ) ); }
+
+    /** returns the aggregate of the items in [A, B]: not before A, and 
+     *  not after B, combined in order by the monoid of the nodes (see 
+     *  utlAugmented). As CountRange, it descends to the first node in the
+     *  range, and then once along each path, taking the aggregates of the
+     *  whole subtrees in between, in O(log n). As Lookup, it writes nothing.
+     *
+     *  @param A first item of the range.
+     *  @param B last item of the range.
+     *  @return aggregate, the identity of the monoid if the range is empty.
+     */
+    aggregate_type RangeAggregate ( const Etype& A, const Etype& B ) const
+        { return AggregateBetween ( A, B, utlDerefLess<Etype,Cmp>( compare ) ); }
+
+    /** returns the aggregate of the pairs whose keys are in [key of A, key of B].
+     *  Version specialized for pairs, since it uses operator neq.
+     */
+    aggregate_type RangeAggregateP ( const Etype& A, const Etype& B ) const
+        { return AggregateBetween ( A, B, utlDerefLessP<Etype,Cmp>( compare ) ); }
+
+    /** returns the node of the Kth smallest item, K from 1 to the number
+     *  of items. Subtrees are skipped by their Size: this is O(log n) on
+     *  trees that keep sizes (utlCounted nodes, OrderedSearchTree), and 
+     *  O(n) on the others. As Lookup, it writes nothing.
+     *
+     *  @param K rank of the item, from 1.
+     *  @return node found, or NULL if K is out of range.
+     */
+    const BinaryNode* LookupKth ( int K ) const {
+        const BinaryNode* T = self().GetRoot();
+        const BinaryNode* Null = NullNode;
+        while ( T != Null ) {
+            int l = self().Size ( T->Left );
+            if ( K <= l )
+                 T = T->Left;
+            else if ( K == l + 1 )
+                 return T;
+            else {
+                 K -= l + 1;
+                 T = T->Right;
+            }
+        }
+        return NULL;
+    }
+
+    /** returns the Kth smallest item, K from 1 (see LookupKth).
+     *
+     *  @return ItemNotFound, if K is out of range.
+     */
+    const Etype& FindKth ( int K ) const {
+        const BinaryNode* node = LookupKth ( K );
+        return node != NULL ? node->Element : ItemNotFound;
+    }
+
+    /** returns the number of items before X, which is the rank of X,
+     *  from 0, if X is in the tree: FindKth( Rank( X ) + 1 ) is then X.
+     *  O(log n) on trees that keep sizes (see LookupKth).
+     */
+    int Rank ( const Etype& X ) const
+        { return RankOf ( X, utlDerefLess<Etype,Cmp>( compare ) ); }
+
+    /** returns the number of pairs whose key comes before the key of X.
+     *  Version specialized for pairs, since it uses operator neq.
+     */
+    int RankP ( const Etype& X ) const
+        { return RankOf ( X, utlDerefLessP<Etype,Cmp>( compare ) ); }
+
+    /** removes the Kth smallest item, K from 1 (see LookupKth).
+     *
+     *	@return 1 if K was in range, and 0 otherwise.
+     */
+    int RemoveKth ( int K ) {
+        const BinaryNode* node = LookupKth ( K );
+        if ( node == NULL ) return 0;
+        const Etype X ( node->Element );
+        return self().Remove ( X );
+    }
+
+    /** returns the item of rank floor(u n), from 0, of the n items.
+     *  A uniform u in [0, 1), such as Random::RandomReal() draws, thus
+     *  samples the items uniformly. O(log n) on trees that keep sizes
+     *  (see LookupKth).
+     *
+     *  @return ItemNotFound, if the tree is empty.
+     */
+    const Etype& Sample ( double u ) const {
+        int n = self().Size ( self().GetRoot() );
+        int K = 1 + (int) ( u * n );
+        if ( K > n ) K = n;
+        if ( K < 1 ) K = 1;
+        return FindKth ( K );
+    }
+
+    /** looks up n items at once: out[i] gets the node holding keys[i], 
+     *  or NULL, as returned by Lookup. The searches advance in groups 
+     *  of FindGroup, one level at a time. The next node of each search
+     *  is prefetched, and the other searches of the group are advanced 
+     *  before it is read. Thus, on a tree much larger than the cache,
+     *  the misses of a group overlap, instead of being waited for one
+     *  after the other. As Lookup, it writes nothing in the tree.
+     *
+     *  @param keys items to be searched for.
+     *  @param n number of items.
+     *  @param out nodes found, or NULL.
+     *  @return number of items found.
+     */
+    int FindBatch ( const Etype* keys, int n, const BinaryNode** out ) const
+        { return FindGroups ( keys, n, out, utlDerefLess<Etype,Cmp>( compare ) ); }
+
+    /** looks up n pairs at once, by key.
+     *  Version specialized for pairs, since it uses operator neq.
+     *
+     *  @see FindBatch().
+     */
+    int FindBatchP ( const Etype* keys, int n, const BinaryNode** out ) const
+        { return FindGroups ( keys, n, out, utlDerefLessP<Etype,Cmp>( compare ) ); }
+
     /// returns true if X is in tree.
-    virtual int IsFound( const Etype& X ) const
-        { return Find( X, Root ) != NullNode; }
+    int IsFound( const Etype& X ) const
+        { return Lookup( X ) != NULL; }
 
     /// returns true if last call to Find() was successful.
-    virtual int WasFound( ) const
+    int WasFound( ) const
         { return Current != NullNode; }
 
     /// returns last node found in Find().
     const BinaryNode* GetCurrent() const { return Current; }
 
     /// returns whether this tree is full.
-    virtual int IsFull( ) const { return 0; } 
+    int IsFull( ) const { return 0; } 
 
     /// makes this tree empty. 
-    virtual void MakeEmpty( )
-        { FreeTree( Root ); Root = NullNode; }
+    void MakeEmpty( )
+        { ReleaseTree( Root ); Root = NullNode; }
+
+    /// gives the memory of removed nodes back to the system.
+    void ShrinkToFit( )
+        { Pool.shrink_to_fit( ); }
+
+    /** makes this tree stop sharing any node with its copies (see Share),
+     *  before changes which may write anywhere, such as Merge, Join and
+     *  Split. Every shared subtree is copied, in O(n) at most, and none
+     *  afterwards, until the tree is copied again.
+     */
+    void Unshare( ) {
+        if ( Private.load ( std::memory_order_relaxed ) ) return;
+        std::vector<Link*> W ( 1, &self().RootLink ( ) );
+        while ( !W.empty ( ) ) {
+            Link* L = W.back ( );
+            W.pop_back ( );
+            BinaryNode* T = *L;
+            if ( IsNullNode ( T ) ) continue;
+            if ( IsShared ( T ) ) {
+                 // nodes below a shared node are reached through it
+                 *L = Copy ( T );
+                 Ghosts.push_back ( T );
+                 ++Generation;
+                 continue;
+            }
+            W.push_back ( &T->Left );
+            W.push_back ( &T->Right );
+        }
+        Private.store ( true, std::memory_order_relaxed );
+    }
+
+    /** makes the nodes which a change of X may write belong to this tree
+     *  only, before Insert or Remove. They are the nodes on the path of X, 
+     *  on to its successor if X is there, and those within WriteReach of 
+     *  that path. Each shared one is replaced by a copy linking to the same
+     *  children, in O(log n) in all, and GetGeneration changes: iterators
+     *  then find their item again by key (see InOrder). Every routine
+     *  changing the tree calls it, and so should those writing into its
+     *  nodes, such as the mutable iterators of utlMap.
+     *
+     *  @param X item to be changed.
+     */
+    void Unshare( const Etype& X ) {
+        if ( Private.load ( std::memory_order_relaxed ) ) return;
+        const int R = Derived::WriteReach;
+        Link* L = &self().RootLink ( );
+        BinaryNode* T;
+        while ( !IsNullNode ( T = Own ( *L ) ) ) {
+            if ( compare ( X, T->Element ) ) {
+                 OwnBelow ( T->Right, R );
+                 L = &T->Left;
+            }
+            else if ( compare ( T->Element, X ) ) {
+                 OwnBelow ( T->Left, R );
+                 L = &T->Right;
+            }
+            else {                                      // on to the successor
+                 OwnBelow ( T->Left, R );
+                 for ( L = &T->Right; !IsNullNode ( T = Own ( *L ) ); L = &T->Left )
+                      OwnBelow ( T->Right, R );
+                 break;
+            }
+        }
+    }
+
+    /** returns whether the tree shares no node with its copies, and holds
+     *  no node replaced by a copy (see Unshare), to which an iterator may
+     *  still point. Nodes found are then written in place.
+     */
+    bool IsPrivate( ) const 
+        { return Private.load ( std::memory_order_relaxed ) && Ghosts.empty ( ); }
+
+    /** returns the number of nodes replaced by copies so far (see Unshare).
+     *  While it is unchanged, nodes found before are still in the tree.
+     */
+    unsigned GetGeneration( ) const { return Generation; }
 
     /// returns root.
-    virtual BinaryNode* GetRoot( ) const { return Root; }
+    BinaryNode* GetRoot( ) const { return Root; }
 
     /// returns NullNode.
-    virtual const BinaryNode* GetNullNode( ) const { return NullNode; }
+    const BinaryNode* GetNullNode( ) const { return NullNode; }
 
     /** computes the height of a node.
      *  The height is the length of the longest path from 
      *  a node to a leaf. All leaves have height 0.
      */
-    virtual int Height ( const BinaryNode* T ) const {
+    int Height ( const BinaryNode* T ) const {
     	if ( T == NullNode )
              return -1;
-        else
-    	     return 1 + max ( Height (T->Left), Height (T->Right) );
+        int hl = Height (T->Left), hr = Height (T->Right);
+        return 1 + max ( hl, hr );
     }
 
     /** computes the size of a node.
      *  The size is the number of descendents of a node
-     *  (including itself).
+     *  (including itself). It is read from the node if the
+     *  tree keeps sizes (HasSizes), and counted otherwise.
      */
-    virtual int Size ( const BinaryNode* T ) const {
+    int Size ( const BinaryNode* T ) const {
     	if ( T == NullNode )
              return 0;
         else
-    	     return 1 + Size (T->Left) + Size (T->Right);
+    	     return SizeOf ( T, std::integral_constant<bool,HasSizes>() );
     }
 
-    /// copy operator.
-    virtual const SearchTree& operator=( const SearchTree& Rhs ) {
+    /// copy operator. The nodes of Rhs are shared (see Share).
+    const SearchTreeCore& operator=( const SearchTreeCore& Rhs ) {
       	if ( this != &Rhs )
            {
-            MakeEmpty ( ); 
-            compare = Rhs.compare;
-            if ( Rhs.Root != Rhs.NullNode )
-                 this->Root = Duplicate ( Rhs, Rhs.Root );
+            self().MakeEmpty ( ); 
+            Clone ( Rhs );
            }
      return *this;
     }
@@ -217,17 +815,22 @@ class SearchTree : public AbsBst<Etype,Cmp>
      *  @param T1 first subtree.
      *  @param T2 second subtree.
      */
-    virtual void Merge ( const Etype& RootItem, 
-                         SearchTree& T1,
-                         SearchTree& T2 ) {
+    void Merge ( const Etype& RootItem, Derived& T1, Derived& T2 ) {
+	// nodes are moved, and not copied
+	Unshare ( ); T1.Unshare ( ); T2.Unshare ( );
+
  	EXCEPTION ( T1.Root == T2.Root && T1.Root != T1.NullNode, 
 		    "Left Tree == Right Tree; Merge aborted" );	    
 
 	// save old root
 	BinaryNode* OldRoot = this->Root;
 
+	// nodes of T1 and T2 now belong to this tree.
+	if ( this != &T1 ) Pool.adopt ( T1.Pool );
+	if ( this != &T2 ) Pool.adopt ( T2.Pool );
+
 	// allocate a new node.
-	this->Root = new BinaryNode ( RootItem, T1.Root, T2.Root );
+	this->Root = MakeNode ( RootItem, T1.Root, T2.Root );
 
 	// deallocates nodes in the original tree.
   	if ( this != &T1 && this != &T2 )
@@ -244,19 +847,20 @@ class SearchTree : public AbsBst<Etype,Cmp>
             fixNullNode ( T2.Root, T2 );
             T2.Root = T2.NullNode;
            }
+        Resize ( this->Root );
     }
 
     /// returns whether this tree is empty.
-    virtual int IsEmpty( ) const
+    int IsEmpty( ) const
         { return Root == NullNode; }
 
     /// returns whether the given node has a right child.
-    virtual int hasRightChild ( const BinaryNode* node ) const { 
+    int hasRightChild ( const BinaryNode* node ) const { 
 	return node->Right != NullNode; 
     }
 
     /// returns whether the given node has a left child.
-    virtual int hasLeftChild ( const BinaryNode* node ) const { 
+    int hasLeftChild ( const BinaryNode* node ) const { 
 	return node->Left != NullNode; 
     }
 
@@ -264,20 +868,27 @@ class SearchTree : public AbsBst<Etype,Cmp>
     Cmp key_comp() const { return compare; }
 
     /// swaps the contents of this and a given SearchTree.
-    virtual void swap(SearchTree& s) {
-      BinaryNode* temp;
+    void swap(SearchTreeCore& s) {
+      Link temp;
       temp   = Root;
       Root   = s.Root;
       s.Root = temp;
       temp       = NullNode;
       NullNode   = s.NullNode;
       s.NullNode = temp;
-      temp      = Current;
+      BinaryNode* ctemp = Current;
       Current   = s.Current;
-      s.Current = temp;
-      Cmp ctemp = compare;
+      s.Current = ctemp;
+      Cmp comptemp = compare;
       compare   = s.compare;
-      s.compare = ctemp;
+      s.compare = comptemp;
+      bool ptemp = Private.load ( std::memory_order_relaxed );
+      Private.store ( s.Private.load ( std::memory_order_relaxed ), std::memory_order_relaxed );
+      s.Private.store ( ptemp, std::memory_order_relaxed );
+      Ghosts.swap ( s.Ghosts );
+      ++Generation;
+      ++s.Generation;
+      Pool.swap ( s.Pool );
     }
 
   protected:
@@ -286,13 +897,13 @@ class SearchTree : public AbsBst<Etype,Cmp>
     BinaryNode* Current;
 
     /// tree root.
-    BinaryNode* Root;
+    Link Root;
 
     /** a node representing a NULL node. 
      *  When a node does not have a child, its corresponding child 
      *	pointer points to the NullNode.
      */
-    BinaryNode* NullNode;
+    Link NullNode;
 
     /// used for returns of not found.
     const Etype ItemNotFound;  
@@ -300,42 +911,1033 @@ class SearchTree : public AbsBst<Etype,Cmp>
     /// function object for comparing two keys.
     Cmp compare;
 
-    /// disable copy constructor.
-    SearchTree( const SearchTree& Rsh ) {
-      *this = Rsh;
+    /// where the nodes of this tree come from.
+    mutable Alloc Pool;
+
+    /** whether no node of the tree is shared (see Unshare): the tree was
+     *  neither copied nor a copy since it was made empty, or unshared.
+     *  Copies of a tree may be made by several threads at once, which
+     *  clear it on the original.
+     */
+    mutable std::atomic<bool> Private;
+
+    /// number of nodes replaced by copies (see GetGeneration).
+    unsigned Generation;
+
+    /** nodes replaced by copies (see Unshare), whose links the tree keeps,
+     *  for its iterators may still hold them. There is one per shared node
+     *  the tree wrote, and they go when the tree is made empty or destroyed.
+     */
+    std::vector<BinaryNode*> Ghosts;
+
+    /// returns the final tree object.
+    Derived& self ( ) { return static_cast<Derived&> ( *this ); }
+
+    /// returns the final tree object.
+    const Derived& self ( ) const { return static_cast<const Derived&> ( *this ); }
+
+    /** copies the comparison object and the nodes of Rhs into this tree,
+     *  which must be empty. The nodes are shared, if the tree is Shareable.
+     */
+    void Clone ( const SearchTreeCore& Rhs ) {
+        compare = Rhs.compare;
+        BinaryNode* root = Rhs.Root;
+        const BinaryNode* Null = Rhs.NullNode;
+        if ( root != Null )
+             Root = Derived::Shareable ? Share ( Rhs, root ) : Duplicate ( Rhs, root );
     }
 
-    /// deletes tree rooted at "T".
-    virtual void FreeTree( BinaryNode* T ) {
-    	if( T != NullNode )
+    /** makes this tree, which must be empty, share the nodes of Rhs, in O(1),
+     *  and returns root, the root of Rhs, for the caller to set. The root
+     *  gets one more link (see Hold). Copying only reads Rhs, which may be
+     *  copied by several threads at once. The pool of this tree adopts the
+     *  arenas of Rhs, and its NullNode is shared, as in Merge, so that any
+     *  tree may be the last one to use a node, and free it.
+     */
+    BinaryNode* Share ( const SearchTreeCore& Rhs, BinaryNode* root ) {
+        ShareNullNode ( Rhs );
+        BinaryNode* T = Hold ( root );
+        if ( T == root ) {
+             Rhs.Private.store ( false, std::memory_order_relaxed );
+             Private.store ( false, std::memory_order_relaxed );
+        }
+        return T;
+    }
+
+    /// drops the links of the Ghosts (see Drop).
+    void ReleaseGhosts ( ) {
+        if ( Ghosts.empty ( ) ) return;
+        for ( size_t i = 0; i < Ghosts.size ( ); ++i ) Drop ( Ghosts[i] );
+        Ghosts.clear ( );
+        Current = NullNode;                             // it may be gone
+    }
+
+    /** returns whether T is a NullNode: the one of this tree, or another
+     *  one, below nodes shared with a tree which has taken a new one since
+     *  (see Merge). A NullNode is its own child.
+     */
+    bool IsNullNode ( const BinaryNode* T ) const
+        { return T == NullNode || T->Left == T; }
+
+    /// returns whether T is linked more than once (see utlShareCount).
+    static bool IsShared ( const BinaryNode* T )
+        { return T->Shares.Count.load ( std::memory_order_acquire ) != 0; }
+
+    /** adds a link to T, and returns T, unless T is a NullNode. A node 
+     *  linked too many times already (see utlShareCount) is not linked
+     *  again: a copy of its subtree is returned instead.
+     */
+    BinaryNode* Hold ( BinaryNode* T ) const {
+        if ( IsNullNode ( T ) ) return T;
+        unsigned short n = T->Shares.Count.load ( std::memory_order_relaxed );
+        do {
+            if ( n == utlShareCount::Most ) return Copy ( T );
+        } while ( !T->Shares.Count.compare_exchange_weak ( n, (unsigned short) ( n + 1 ),
+                                                           std::memory_order_relaxed ) );
+        return T;
+    }
+
+    /** removes a link to T, and returns whether T is still linked. Of two
+     *  trees dropping their links at once, the one which finds no link
+     *  left is the last one: the count of T may then wrap, but T is deleted.
+     */
+    static bool Unlink ( BinaryNode* T ) {
+        return IsShared ( T ) &&
+               T->Shares.Count.fetch_sub ( 1, std::memory_order_acq_rel ) != 0;
+    }
+
+    /** removes a link to T, and deletes T if it was the last one,
+     *  removing its links to its children in turn.
+     */
+    void Drop ( BinaryNode* T ) {
+        std::vector<BinaryNode*> W ( 1, T );
+        while ( !W.empty ( ) ) {
+            T = W.back ( );
+            W.pop_back ( );
+            if ( IsNullNode ( T ) || Unlink ( T ) ) continue;
+            W.push_back ( T->Left );
+            W.push_back ( T->Right );
+            FreeNode ( T );
+        }
+    }
+
+    /** returns the node L links to, after replacing it by a copy if it is
+     *  shared. The node holding L must belong to this tree only. The link
+     *  of this tree to the shared node moves to the Ghosts, and the copy
+     *  adds a link to each of its children.
+     */
+    BinaryNode* Own ( Link& L ) {
+        BinaryNode* T = L;
+        if ( IsNullNode ( T ) || !IsShared ( T ) ) return T;
+        BinaryNode* C = MakeNode ( T->Element, Hold ( T->Left ), Hold ( T->Right ) );
+        CopyData ( C, T );
+        Ghosts.push_back ( T );
+        L = C;
+        ++Generation;
+        return C;
+    }
+
+    /// makes the nodes less than depth levels below L belong to this tree (see Own).
+    void OwnBelow ( Link& L, int depth ) {
+        if ( depth <= 0 ) return;
+        BinaryNode* T = Own ( L );
+        if ( IsNullNode ( T ) ) return;
+        OwnBelow ( T->Left, depth - 1 );
+        OwnBelow ( T->Right, depth - 1 );
+    }
+
+    /** how far from the path of an item (see Unshare) Insert and Remove
+     *  may write: on the children of its nodes (1), on their grandchildren
+     *  (2), and so on. The search tree writes on the path only.
+     */
+    enum { WriteReach = 0 };
+
+    /// returns the link to the root. A tree keeping its root elsewhere redefines it.
+    Link& RootLink( ) { return Root; }
+
+    /** replaces the items of the tree by those of a range.
+     *
+     *  @param L orders pointers to items.
+     *  @param sort whether the range may be out of order.
+     *  @see utlSortUnique().
+     */
+    template <class Iter, class Less>
+    int BuildTree( Iter first, Iter last, const Less& L, int sort, int threads ) {
+        const Etype** P;
+        int n = utlSortUnique ( first, last, L, sort, threads, P );
+        self().SetTree ( P, n );
+        delete [] P;
+        return n;
+    }
+
+    /** replaces the items of the tree by *P[0], ..., *P[n-1],
+     *  which are sorted and distinct. A tree keeping its root 
+     *  elsewhere redefines it.
+     */
+    void SetTree( const Etype* const* P, int n ) {
+        self().MakeEmpty ( );
+        Root = MakeTree ( P, n );
+    }
+
+    /** builds a perfectly balanced tree holding *P[0], ..., *P[n-1],
+     *  which are sorted, and returns its root. The left subtree of a node
+     *  has (n-1)/2 nodes, and is never larger than the right one: 
+     *  a subtree of n nodes has height floor(log2(n)), and its shortest
+     *  path down to the NullNode has floor(log2(n+1)) nodes.
+     *  Nodes are made bottom up, and the final tree sets the
+     *  balancing information of each one (SetBalance).
+     */
+    BinaryNode* MakeTree( const Etype* const* P, int n ) {
+        if ( n == 0 ) return NullNode;
+        int m = ( n - 1 ) / 2;
+        BinaryNode* L = MakeTree ( P, m );
+        BinaryNode* R = MakeTree ( P + m + 1, n - m - 1 );
+        BinaryNode* T = MakeNode ( *P[m], L, R );
+        self().SetBalance ( T, n );
+        return T;
+    }
+
+    /** sets the balancing information of a node made by MakeTree,
+     *  whose subtree has n nodes. Nothing to set here.
+     */
+    void SetBalance( BinaryNode* T, int n ) { }
+
+    /// returns floor(log2(n)), for n > 0.
+    static int Log2( int n ) {
+        int k = 0;
+        while ( n >>= 1 ) ++k;
+        return k;
+    }
+
+    /** returns a new node holding X, with children L and R.
+     *  If nodes link to their parents, it is the parent of L and R, 
+     *  and its own parent is the NullNode.
+     */
+    BinaryNode* MakeNode ( const Etype& X, BinaryNode* L = NULL,
+                                           BinaryNode* R = NULL ) const {
+        static_assert ( !HasParents || Derived::KeepsParents,
+                        "this tree does not keep the links of nodes to their parents" );
+        static_assert ( !HasSizes || Derived::KeepsSizes,
+                        "this tree does not keep the sizes of its nodes" );
+        static_assert ( !HasAggregates || Derived::KeepsAggregates,
+                        "this tree does not keep the aggregates of its nodes" );
+        BinaryNode* T = new ( Pool.allocate ( ) ) BinaryNode ( X, L, R );
+        if ( HasParents ) {
+             T->SetParent ( NullNode );
+             if ( L != NULL ) SetParent ( L, T );
+             if ( R != NULL ) SetParent ( R, T );
+        }
+        if ( L != NULL && R != NULL ) Resize ( T );
+        return T;
+    }
+
+    /** whether the tree keeps the links of its nodes to their parents,
+     *  for a layout which has them (HasParents). Then, the tree calls
+     *  SetParent for every node it links elsewhere.
+     */
+    enum { KeepsParents = 0 };
+
+    /** makes P the parent of C, unless C is the NullNode, which 
+     *  trees may share. Does nothing unless nodes link to their parents.
+     */
+    void SetParent ( BinaryNode* C, BinaryNode* P ) const {
+        if ( HasParents && C != NullNode ) C->SetParent ( P );
+    }
+
+    /// makes T the parent of its children (see SetParent).
+    void Adopt ( BinaryNode* T ) const {
+        SetParent ( T->Left, T );
+        SetParent ( T->Right, T );
+    }
+
+    /** whether the tree keeps the sizes of its nodes, for a layout which
+     *  has them (HasSizes). Then, the tree calls Resize for every node
+     *  whose children change, from the bottom up, or Refresh.
+     */
+    enum { KeepsSizes = 0 };
+
+    /** whether the tree keeps the aggregates of its nodes, for a layout
+     *  which has them (HasAggregates). They are recomputed by Resize too,
+     *  so the tree must also keep sizes, without updating them otherwise.
+     */
+    enum { KeepsAggregates = 0 };
+
+    /** sets the size of T from those of its children, if the tree 
+     *  keeps sizes (HasSizes), and its aggregate too (HasAggregates).
+     */
+    void Resize ( BinaryNode* T ) const {
+        if ( HasSizes ) SetSize ( T, 1 + Size (T->Left) + Size (T->Right) );
+        SetAggregate ( T, std::integral_constant<bool,HasAggregates>() );
+    }
+
+    /** recomputes (Resize), from the bottom up, the nodes on the way down
+     *  to X, and, past the node of X, on the way down to the next item, if
+     *  the tree keeps sizes (HasSizes). Called once a node was linked at 
+     *  the bottom of that path, or unlinked from it, and the path rebalanced.
+     */
+    void Refresh ( const Etype& X ) {
+        if ( HasSizes ) Refresh ( self().GetRoot(), X, 0 );
+    }
+
+    /// recomputes the nodes of the subtree T on the way down to X (see Refresh).
+    void Refresh ( BinaryNode* T, const Etype& X, int past ) {
+        if ( T == NullNode ) return;
+        if ( past || compare ( X, T->Element ) )
+             Refresh ( T->Left, X, past );
+        else 
+             Refresh ( T->Right, X, !compare ( T->Element, X ) );
+        Resize ( T );
+    }
+
+    /// returns the aggregate of the subtree T, the identity if T is the NullNode.
+    aggregate_type AggregateOf ( const BinaryNode* T ) const {
+        return T == NullNode ? monoid_type::identity() : T->Aggregate;
+    }
+
+    /// sets the aggregate of T from those of its children.
+    void SetAggregate ( BinaryNode* T, std::true_type ) const {
+        T->Aggregate = monoid_type::combine ( 
+                       monoid_type::combine ( AggregateOf ( T->Left ), monoid_type::value ( T->Element ) ),
+                       AggregateOf ( T->Right ) );
+    }
+
+    /// no aggregate to set.
+    void SetAggregate ( BinaryNode*, std::false_type ) const { }
+
+    /// sets the size of T to n, if the tree keeps sizes (HasSizes).
+    void SetSize ( BinaryNode* T, int n ) const 
+        { SetSize ( T, n, std::integral_constant<bool,HasSizes>() ); }
+
+    /// size kept in a node.
+    int SizeOf ( const BinaryNode* T, std::true_type ) const { return T->Size; }
+
+    /// size of a node, counted.
+    int SizeOf ( const BinaryNode* T, std::false_type ) const 
+        { return 1 + Size (T->Left) + Size (T->Right); }
+
+    /// sets the size kept in a node.
+    void SetSize ( BinaryNode* T, int n, std::true_type ) const { T->Size = n; }
+
+    /// no size to set.
+    void SetSize ( BinaryNode*, int, std::false_type ) const { }
+
+    /// destroys node T and gives it back to the pool.
+    void FreeNode ( BinaryNode* T ) const {
+        T->~BinaryNode ( );
+        Pool.deallocate ( T );
+    }
+
+    /** creates the NullNode, with both children pointing to itself,
+     *  and the balancing information of an empty subtree.
+     *  The NullNode shared by all trees (indexed pools) is never written,
+     *  so that trees may be used by several threads: the pool made it so.
+     *
+     *  @param Balance balancing information of an empty subtree.
+     */
+    void MakeNullNode ( int Balance = 1 ) {
+        NullNode = Pool.null_node ( );
+        if ( Alloc::shares_null_node ) {
+             EXCEPTION ( NullNode->BalancingInfo != Balance, 
+                         "MakeNullNode: the node layout has another null_balance" );
+             return;
+        }
+        NullNode->Left = NullNode->Right = NullNode;
+        NullNode->BalancingInfo = Balance;
+    }
+
+    /// deletes the NullNode.
+    void FreeNullNode ( ) {
+        Pool.free_null_node ( NullNode ); 
+        NullNode = NULL;
+    }
+
+    /** makes this tree, which must be empty, use the NullNode of T,
+     *  and share the arenas of its pool. Then, nodes may move between
+     *  both trees in O(1), without being relinked. The root is left
+     *  for the caller to set.
+     */
+    void ShareNullNode ( const SearchTreeCore& T ) {
+        if ( this == &T ) return;
+        Pool.adopt ( T.Pool );
+        if ( NullNode != T.NullNode ) {
+             Pool.free_null_node ( NullNode );
+             NullNode = Pool.share_null_node ( T.NullNode );
+        }
+        Current = NullNode;
+    }
+
+    /// whether the tree joins and splits subtrees (see SetOperation).
+    enum { Joinable = 0 };
+
+    /// set operations.
+    enum { SetUnion, SetIntersection, SetDifference };
+
+    /** subtrees whose JoinHeight is smaller are not forked (see SetOperation).
+     *  Below it, combining both sides costs about as much as a fork.
+     */
+    enum { ForkHeight = 8 };
+
+    /** sets the root of the tree, after its nodes or its NullNode
+     *  changed. A tree keeping its root elsewhere redefines it.
+     */
+    void SetRoot( BinaryNode* T ) { 
+        Root = T;
+        SetParent ( T, NullNode );
+    }
+
+    /** takes the nodes of T1 and T2 out of them, for moving them into this
+     *  tree, which is made empty. This tree takes the NullNode of T1 if 
+     *  first, and of T2 otherwise: the nodes of the other one are relinked
+     *  to it, unless it is the same. Any of the trees may be the same.
+     *
+     *	@param L returns the root of T1.
+     *	@param R returns the root of T2.
+     */
+    void Gather( Derived& T1, Derived& T2, int first, BinaryNode*& L, BinaryNode*& R ) {
+        T1.Unshare( );
+        T2.Unshare( );
+        L = T1.GetRoot( );
+        R = T2.GetRoot( );
+        Derived& Keep  = first ? T1 : T2;
+        Derived& Other = first ? T2 : T1;
+        BinaryNode*& Low = first ? R : L;
+        T1.SetRoot( T1.NullNode );
+        T2.SetRoot( T2.NullNode );
+        self().MakeEmpty( );
+
+        if ( Other.NullNode != Keep.NullNode ) {
+             if ( Low != Other.NullNode )
+                  fixNullNode ( Low, Other.NullNode, Keep.NullNode );
+             else
+                  Low = Keep.NullNode;
+        }
+        if ( this != &Other ) Pool.adopt ( Other.Pool );
+        ShareNullNode ( Keep );
+    }
+
+    /** makes this tree hold the items of T1, X and the items of T2, in
+     *  O(log n), for a Joinable tree. Only the trees are checked to be in
+     *  order, and T1 and T2 are left empty. If T1 and T2 do not share their 
+     *  NullNode, the nodes of the lower one are relinked, though.
+     */
+    void JoinTrees( Derived& T1, const Etype& X, Derived& T2 ) {
+        EXCEPTION ( &T1 == &T2 && !T1.IsEmpty(), "Join: T1 == T2; Join aborted" );
+        EXCEPTION ( ( !T1.IsEmpty() && !compare ( T1.FindMax(), X ) ) ||
+                    ( !T2.IsEmpty() && !compare ( X, T2.FindMin() ) ),
+                    "Join: items are not in order; Join aborted" );
+        int hl = T1.JoinHeight ( T1.GetRoot() );
+        int hr = T2.JoinHeight ( T2.GetRoot() );
+        BinaryNode *L, *R;
+        Gather ( T1, T2, hl >= hr, L, R );
+        int h;
+        self().SetRoot ( self().JoinNodes ( L, hl, MakeNode( X, NullNode, NullNode ), R, hr, h ) );
+    }
+
+    /** moves the items smaller than X into Less, and the items greater than X
+     *  into Greater, in O(log n), for a Joinable tree. X itself, if present, 
+     *  is removed. This tree is left empty, unless it is Less or Greater.
+     *  The three trees then share their NullNode.
+     *
+     *	@return 1 if X was found, and 0 otherwise.
+     */
+    int SplitTree( const Etype& X, Derived& Less, Derived& Greater ) {
+        EXCEPTION ( &Less == &Greater, "Split: Less == Greater; Split aborted" );
+        Unshare( );
+        BinaryNode* T = self().GetRoot( );
+        int h = self().JoinHeight ( T );
+        self().SetRoot ( NullNode );
+        Less.MakeEmpty( );
+        Greater.MakeEmpty( );
+        Less.ShareNullNode ( *this );
+        Greater.ShareNullNode ( *this );
+
+        BinaryNode *L, *R;
+        int hl, hr;
+        BinaryNode* F = self().SplitNodes ( T, h, X, L, hl, R, hr, utlDerefLess<Etype,Cmp>( compare ) );
+        if ( F != NULL ) FreeNode ( F );
+        Less.SetRoot ( L );
+        Greater.SetRoot ( R );
+        return F != NULL;
+    }
+
+    /** joins the subtrees L and R, of JoinHeight hl and hr, whose items
+     *  are all smaller in L, in O(log n): the largest node of L is split off,
+     *  and joins them.
+     *
+     *	@param h returns the JoinHeight of the new subtree.
+     *	@return root node.
+     */
+    BinaryNode* JoinNodes2( BinaryNode* L, int hl, BinaryNode* R, int hr, int& h ) {
+        if ( L == NullNode ) {
+             h = hr;
+             return R;
+        }
+        BinaryNode* M = L;
+        while ( M->Right != NullNode ) M = M->Right;
+        BinaryNode *A, *B;
+        int ha, hb;
+        BinaryNode* K = self().SplitNodes ( L, hl, M->Element, A, ha, B, hb,
+                                            utlDerefLess<Etype,Cmp>( compare ) );
+        return self().JoinNodes ( A, ha, K, R, hr, h );
+    }
+
+    /** combines this tree with T by a set operation, and makes T empty.
+     *  Of equivalent items (as ordered by less), the one of this tree is kept.
+     *
+     *	@param op SetUnion, SetIntersection or SetDifference.
+     *  @param threads number of threads, or 0 for one per hardware thread.
+     *	@param less orders pointers to items (utlDerefLess, utlDerefLessP).
+     *	@return number of items in both trees.
+     */
+    template <class Less>
+    int Combine( Derived& T, int op, int threads, const Less& less ) {
+        EXCEPTION ( this == &T, "Set operation on the same tree; aborted" );
+        return Combine ( T, op, threads, less, std::integral_constant<bool,Derived::Joinable>() );
+    }
+
+    /// combines the trees by joining subtrees (see SetOperation).
+    template <class Less>
+    int Combine( Derived& T, int op, int threads, const Less& less, std::true_type ) 
+        { return SetOperation ( T, op, threads, less ); }
+
+    /** combines the trees item by item: items of T are inserted or 
+     *  removed, or the items of this tree not in T are removed.
+     */
+    template <class Less>
+    int Combine( Derived& T, int op, int, const Less& less, std::false_type ) {
+        int n = 0;
+        if ( op == SetIntersection ) {
+             std::vector<Etype> Out;
+             int m = Unmatched ( self().GetRoot(), T, less, Out );
+             for ( size_t i = 0; i < Out.size(); ++i ) self().Remove ( Out[i] );
+             n = m - (int) Out.size();
+        }
+        else
+             n = Apply ( T, T.GetRoot(), op, less );
+        T.MakeEmpty( );
+        return n;
+    }
+
+    /** inserts (SetUnion) or removes (SetDifference) the items of
+     *  the subtree P of T, unless this tree has no equivalent item,
+     *  or has one, respectively.
+     *
+     *	@return number of items of P with an equivalent in this tree.
+     */
+    template <class Less>
+    int Apply( const Derived& T, const BinaryNode* P, int op, const Less& less ) {
+        if ( P == T.NullNode ) return 0;
+        int n = Apply ( T, P->Left, op, less ) + Apply ( T, P->Right, op, less );
+        return n + Apply ( P->Element, op, less );
+    }
+
+    /** inserts (SetUnion) or removes (SetDifference) X, unless this
+     *  tree has no equivalent item, or has one, respectively.
+     *
+     *	@return 1 if this tree had an item equivalent to X, and 0 otherwise.
+     */
+    template <class Less>
+    int Apply( const Etype& X, int op, const Less& less ) {
+        const BinaryNode* node = Search ( X, less );
+        if ( node == NULL ) {
+             if ( op == SetUnion ) self().Insert ( X );
+             return 0;
+        }
+        if ( op == SetDifference ) {
+             const Etype Y ( node->GetElement() );
+             self().Remove ( Y );
+        }
+        return 1;
+    }
+
+    /** gathers the items of the subtree P of this tree which have no 
+     *  equivalent in T.
+     *
+     *	@return number of items of P.
+     */
+    template <class Less>
+    int Unmatched( const BinaryNode* P, const Derived& T, const Less& less, std::vector<Etype>& Out ) const {
+        if ( P == NullNode ) return 0;
+        int n = 1 + Unmatched ( P->Left, T, less, Out ) + Unmatched ( P->Right, T, less, Out );
+        if ( T.Search ( P->Element, less ) == NULL ) Out.push_back ( P->Element );
+        return n;
+    }
+
+    /// number of searches advanced together by FindBatch.
+    enum { FindGroup = 16 };
+
+    /** looks up n items, FindGroup at a time (see FindBatch).
+     *  A search which is over has a NULL node.
+     *
+     *	@param less orders pointers to items (utlDerefLess, utlDerefLessP).
+     */
+    template <class Less>
+    int FindGroups( const Etype* keys, int n, const BinaryNode** out, const Less& less ) const {
+        const BinaryNode* Top = self().GetRoot();
+        const BinaryNode* Null = NullNode;
+        const BinaryNode* T[FindGroup];
+        int found = 0;
+        for ( int g = 0; g < n; g += FindGroup ) {
+             int m = ( n - g < FindGroup ) ? n - g : FindGroup;
+             for ( int i = 0; i < m; ++i ) T[i] = Top;
+             for ( int active = m; active > 0; ) {
+                  active = 0;
+                  for ( int i = 0; i < m; ++i ) {
+                       const BinaryNode* P = T[i];
+                       if ( P == NULL ) continue;
+                       const Etype* X = keys + g + i;
+                       if ( P == Null ) {
+                            out[g+i] = T[i] = NULL;
+                            continue;
+                       }
+                       if ( less ( X, &P->Element ) )
+                            P = P->Left;
+                       else if ( less ( &P->Element, X ) )
+                            P = P->Right;
+                       else {
+                            out[g+i] = P; T[i] = NULL;
+                            ++found;
+                            continue;
+                       }
+                       UTL_PREFETCH ( P );
+                       T[i] = P;
+                       ++active;
+                  }
+             }
+        }
+        return found;
+    }
+
+    /** returns the first node whose item is not before X, or, if upper
+     *  is set, after X, as ordered by less; NULL if there is none.
+     */
+    template <class Less>
+    const BinaryNode* Bound( const Etype& X, int upper, const Less& less ) const {
+        const BinaryNode* T = self().GetRoot( );
+        const BinaryNode* Null = NullNode;
+        const BinaryNode* Found = NULL;
+        while ( T != Null )
+            if ( upper ? less ( &X, &T->Element ) : !less ( &T->Element, &X ) ) {
+                 Found = T;
+                 T = T->Left;
+            }
+            else
+                 T = T->Right;
+        return Found;
+    }
+
+    /// counts the items before X, as ordered by less (see Rank).
+    template <class Less>
+    int RankOf( const Etype& X, const Less& less ) const {
+        const BinaryNode* T = self().GetRoot( );
+        const BinaryNode* Null = NullNode;
+        int r = 0;
+        while ( T != Null )
+            if ( less ( &T->Element, &X ) ) {
+                 r += 1 + self().Size ( T->Left );
+                 T = T->Right;
+            }
+            else
+                 T = T->Left;
+        return r;
+    }
+
+    /** counts the items not before A and before B, as ordered by less,
+     *  or, if closed is set, not after B (see CountRange).
+     */
+    template <class Less>
+    int CountBetween( const Etype& A, const Etype& B, int closed, const Less& less ) const {
+        const BinaryNode* T = self().GetRoot( );
+        const BinaryNode* Null = NullNode;
+        while ( T != Null )
+            if ( less ( &T->Element, &A ) )
+                 T = T->Right;
+            else if ( closed ? less ( &B, &T->Element ) : !less ( &T->Element, &B ) )
+                 T = T->Left;
+            else
+                 break;
+        if ( T == Null ) return 0;
+
+        // T is in the range: count its left descendants not before A,
+        // and its right descendants before B.
+        int n = 1;
+        for ( const BinaryNode* L = T->Left; L != Null; )
+            if ( less ( &L->Element, &A ) )
+                 L = L->Right;
+            else {
+                 n += 1 + self().Size ( L->Right );
+                 L = L->Left;
+            }
+        for ( const BinaryNode* R = T->Right; R != Null; )
+            if ( closed ? less ( &B, &R->Element ) : !less ( &R->Element, &B ) )
+                 R = R->Left;
+            else {
+                 n += 1 + self().Size ( R->Left );
+                 R = R->Right;
+            }
+        return n;
+    }
+
+    /** combines the items not before A and not after B, as ordered by
+     *  less (see RangeAggregate). The chunks found along the path to A come
+     *  before those found earlier, and the ones along the path to B after.
+     */
+    template <class Less>
+    aggregate_type AggregateBetween( const Etype& A, const Etype& B, const Less& less ) const {
+        const BinaryNode* T = self().GetRoot( );
+        const BinaryNode* Null = NullNode;
+        while ( T != Null )
+            if ( less ( &T->Element, &A ) )
+                 T = T->Right;
+            else if ( less ( &B, &T->Element ) )
+                 T = T->Left;
+            else
+                 break;
+        if ( T == Null ) return monoid_type::identity ( );
+
+        aggregate_type Low = monoid_type::identity ( );
+        aggregate_type High = monoid_type::identity ( );
+        for ( const BinaryNode* L = T->Left; L != Null; )
+            if ( less ( &L->Element, &A ) )
+                 L = L->Right;
+            else {
+                 Low = monoid_type::combine ( monoid_type::combine ( 
+                       monoid_type::value ( L->Element ), AggregateOf ( L->Right ) ), Low );
+                 L = L->Left;
+            }
+        for ( const BinaryNode* R = T->Right; R != Null; )
+            if ( less ( &B, &R->Element ) )
+                 R = R->Left;
+            else {
+                 High = monoid_type::combine ( High, monoid_type::combine ( 
+                        AggregateOf ( R->Left ), monoid_type::value ( R->Element ) ) );
+                 R = R->Right;
+            }
+        return monoid_type::combine ( monoid_type::combine ( Low, monoid_type::value ( T->Element ) ), High );
+    }
+
+    /** returns the node holding an item equivalent to X, as ordered by less,
+     *  or NULL. Nothing is written in the tree.
+     */
+    template <class Less>
+    const BinaryNode* Search( const Etype& X, const Less& less ) const {
+        const BinaryNode* T = self().GetRoot( );
+        while ( T != NullNode )
+            if ( less ( &X, &T->Element ) )
+                T = T->Left;
+            else if ( less ( &T->Element, &X ) )
+                T = T->Right;
+            else
+                return T;
+        return NULL;
+    }
+
+    /** combines this tree with T, in a Joinable tree. Following Blelloch, 
+     *  Ferizovic and Sun ("Just join for parallel ordered sets"), the root 
+     *  of this tree splits T, and each side is combined with the subtree
+     *  of the root on that side, the root joining both results back, 
+     *  unless it is dropped. For trees of m and n >= m items, this takes
+     *  O(m log(n/m + 1)). Both sides are independent: the left one is forked
+     *  as a task of the shared utlThreadPool, while the right one is done by
+     *  the same thread. A side is only forked if its subtree of this tree has
+     *  a JoinHeight of at least ForkHeight, and while threads are left: each
+     *  fork halves the threads given to both sides, so that at most threads
+     *  tasks run at once, and threads is capped at the size of the pool, the
+     *  number of hardware threads. Nodes dropped by the tasks are deleted at
+     *  the end, since the node pool is not shared among them.
+     *
+     *  @see Combine().
+     */
+    template <class Less>
+    int SetOperation( Derived& T, int op, int threads, const Less& less ) {
+        threads = ForkThreads ( threads );
+        int ha = self().JoinHeight ( self().GetRoot() );
+        int hb = T.JoinHeight ( T.GetRoot() );
+        BinaryNode *A, *B;
+        Gather ( self(), T, ha >= hb, A, B );
+
+        std::vector<BinaryNode*> Garbage;
+        BinaryNode* C;
+        int hc;
+        int n = SetNodes ( op, A, ha, B, hb, C, hc, Garbage, threads, less );
+        self().SetRoot ( C );
+        for ( size_t i = 0; i < Garbage.size(); ++i ) FreeTree ( Garbage[i] );
+        return n;
+    }
+
+    /** returns the number of threads a set operation may use: the given
+     *  one, or one per hardware thread if 0, up to the size of the pool.
+     */
+    static int ForkThreads( int threads ) {
+        int most = utlThreadPool::shared ( ).size ( );
+        return ( threads <= 0 || threads > most ) ? most : threads;
+    }
+
+    /** combines the subtrees A and B, of JoinHeight ha and hb.
+     *
+     *	@param C returns the root of the result.
+     *	@param hc returns the JoinHeight of C.
+     *	@param Garbage gets the subtrees to be deleted.
+     *	@param threads number of threads to be used.
+     *	@return number of items in both subtrees.
+     *  @see SetOperation().
+     */
+    template <class Less>
+    int SetNodes( int op, BinaryNode* A, int ha, BinaryNode* B, int hb,
+                  BinaryNode*& C, int& hc, std::vector<BinaryNode*>& Garbage,
+                  int threads, const Less& less ) {
+        if ( A == NullNode || B == NullNode ) {
+             BinaryNode* Drop = NullNode;
+             if ( op == SetUnion && A == NullNode ) {
+                  C = B; hc = hb;
+             }
+             else if ( op == SetIntersection ) {
+                  C = NullNode; hc = self().JoinHeight ( NullNode );
+                  Drop = ( A == NullNode ) ? B : A;
+             }
+             else {
+                  C = A; hc = ha;
+                  Drop = B;
+             }
+             if ( Drop != NullNode ) Garbage.push_back ( Drop );
+             return 0;
+        }
+
+        BinaryNode* AL = A->Left;
+        BinaryNode* AR = A->Right;
+        int hal, har;
+        self().ChildHeights ( A, ha, hal, har );
+        BinaryNode *BL, *BR;
+        int hbl, hbr;
+        BinaryNode* F = self().SplitNodes ( B, hb, A->Element, BL, hbl, BR, hbr, less );
+        if ( F != NULL ) {
+             F->Left = F->Right = NullNode;
+             Garbage.push_back ( F );
+        }
+
+        BinaryNode *CL, *CR;
+        int hcl, hcr;
+        int n = ( F != NULL );
+        if ( threads > 1 && ha >= ForkHeight ) {
+             std::vector<BinaryNode*> G;
+             int nl = 0;
+             utlThreadPool& pool = utlThreadPool::shared ( );
+             utlThreadPool::Task left ( [&] { 
+                  nl = SetNodes ( op, AL, hal, BL, hbl, CL, hcl, G, threads / 2, less ); 
+             } );
+             pool.fork ( left );
+             n += SetNodes ( op, AR, har, BR, hbr, CR, hcr, Garbage, threads - threads / 2, less );
+             pool.join ( left );
+             n += nl;
+             Garbage.insert ( Garbage.end(), G.begin(), G.end() );
+        }
+        else {
+             n += SetNodes ( op, AL, hal, BL, hbl, CL, hcl, Garbage, 1, less );
+             n += SetNodes ( op, AR, har, BR, hbr, CR, hcr, Garbage, 1, less );
+        }
+
+        if ( op == SetUnion || ( op == SetIntersection ) == ( F != NULL ) )
+             C = self().JoinNodes ( CL, hcl, A, CR, hcr, hc );
+        else {
+             A->Left = A->Right = NullNode;
+             Garbage.push_back ( A );
+             C = JoinNodes2 ( CL, hcl, CR, hcr, hc );
+        }
+        return n;
+    }
+
+    /** inserts (SetUnion) or removes (SetDifference) the items of a range.
+     *
+     *	@param less orders pointers to items (utlDerefLess, utlDerefLessP).
+     *	@return number of items inserted or removed.
+     *  @see InsertBatch().
+     */
+    template <class Iter, class Less>
+    int Batch( Iter first, Iter last, int op, int threads, const Less& less ) {
+        const Etype** P;
+        int n = utlSortUnique ( first, last, less, 1, threads, P );
+        int m = Batch ( P, n, op, threads, less, std::integral_constant<bool,Derived::Joinable>() );
+        delete [] P;
+        return m;
+    }
+
+    /** applies the sorted and distinct items *P[0], ..., *P[n-1] to a 
+     *  Joinable tree: a perfectly balanced tree is made of them, and
+     *  combined with this one, as by SetOperation.
+     */
+    template <class Less>
+    int Batch( const Etype* const* P, int n, int op, int threads, const Less& less, std::true_type ) {
+        threads = ForkThreads ( threads );
+        Unshare ( );
+        BinaryNode* A = self().GetRoot ( );
+        BinaryNode* B = MakeTree ( P, n );
+
+        std::vector<BinaryNode*> Garbage;
+        BinaryNode* C;
+        int hc;
+        int k = SetNodes ( op, A, self().JoinHeight ( A ), B, self().JoinHeight ( B ), 
+                           C, hc, Garbage, threads, less );
+        self().SetRoot ( C );
+        Current = NullNode;
+        for ( size_t i = 0; i < Garbage.size(); ++i ) FreeTree ( Garbage[i] );
+        return op == SetUnion ? n - k : k;
+    }
+
+    /** applies the sorted and distinct items *P[0], ..., *P[n-1] to a
+     *  tree which does not join subtrees. Unless the tree has more items
+     *  than the range, the items of both are merged, and the tree is 
+     *  rebuilt from them (see SetTree). Otherwise, the items of the range
+     *  are inserted or removed one by one.
+     */
+    template <class Less>
+    int Batch( const Etype* const* P, int n, int op, int, const Less& less, std::false_type ) {
+        int k = 0;
+        int size = SizeUpTo ( self().GetRoot(), n );
+        if ( size > n ) {
+             for ( int j = 0; j < n; ++j ) k += Apply ( *P[j], op, less );
+             return op == SetUnion ? n - k : k;
+        }
+
+        std::vector<const Etype*> Q;
+        InOrder ( self().GetRoot(), Q );
+        std::vector<Etype> Items;
+        Items.reserve ( op == SetUnion ? size + n : size );
+        int i = 0, j = 0;
+        while ( i < size || j < n ) {
+             if ( j == n || ( i < size && less ( Q[i], P[j] ) ) )
+                  Items.push_back ( *Q[i++] );
+             else if ( i == size || less ( P[j], Q[i] ) ) {
+                  if ( op == SetUnion ) Items.push_back ( *P[j] );
+                  ++j;
+             }
+             else {
+                  if ( op == SetUnion ) Items.push_back ( *Q[i] );
+                  ++i; ++j; ++k;
+             }
+        }
+        Q.resize ( Items.size() );
+        for ( size_t t = 0; t < Items.size(); ++t ) Q[t] = &Items[t];
+        self().SetTree ( Q.data(), (int) Items.size() );
+        Current = NullNode;
+        return op == SetUnion ? n - k : k;
+    }
+
+    /// returns the number of nodes of T, or n + 1 if it has more than n.
+    int SizeUpTo( const BinaryNode* T, int n ) const {
+        if ( T == NullNode ) return 0;
+        if ( n == 0 ) return 1;
+        int l = SizeUpTo ( T->Left, n - 1 );
+        if ( l == n ) return n + 1;
+        return 1 + l + SizeUpTo ( T->Right, n - 1 - l );
+    }
+
+    /// appends pointers to the items of T, in order, to Q.
+    void InOrder( const BinaryNode* T, std::vector<const Etype*>& Q ) const {
+        if ( T == NullNode ) return;
+        InOrder ( T->Left, Q );
+        Q.push_back ( &T->Element );
+        InOrder ( T->Right, Q );
+    }
+
+    /** deletes tree rooted at "T".
+     *  Left children are rotated up until T has none, 
+     *  and then T is deleted. Thus, no stack is used,
+     *  even on degenerate trees.
+     */
+    void FreeTree( BinaryNode* T ) {
+        BinaryNode* Tmp;
+    	while( T != NullNode )
     	  {
-           FreeTree( T->Left );
-           FreeTree( T->Right );
-           delete T;
+           if( T->Left != NullNode )
+             {
+              Tmp = T->Left;
+              T->Left = Tmp->Right;
+              Tmp->Right = T;
+              T = Tmp;
+             }
+           else
+             {
+              Tmp = T->Right;
+              FreeNode( T );
+              T = Tmp;
+             }
           }
     }
 
+    /** deletes the whole tree rooted at "T", the root of this tree,
+     *  and the Ghosts. Nodes still linked from a copy are only left to it
+     *  (see Drop). If Etype has a trivial destructor, and the pool does not
+     *  share its memory with other trees, the nodes are not visited:
+     *  the pool releases all of its chunks at once.
+     *  Otherwise, FreeTree is called.
+     */
+    void ReleaseTree( BinaryNode* T ) {
+        ReleaseGhosts ( );
+        if ( !Private.load ( std::memory_order_relaxed ) ) {
+             Private.store ( true, std::memory_order_relaxed );
+             Drop ( T );
+        }
+        else if ( T != NullNode &&
+                  !ReleasePool ( std::is_trivially_destructible<Etype>() ) )
+             FreeTree( T );
+    }
+
+    /// releases the pool of a tree holding trivially destructible items.
+    bool ReleasePool ( std::true_type ) { return Pool.release ( ); }
+
+    /// nodes holding items with a destructor must be visited.
+    bool ReleasePool ( std::false_type ) { return false; }
+
+    /// copies balancing information and size of a node.
+    static void CopyData ( BinaryNode* to, const BinaryNode* from ) {
+        to->copyData ( *from );
+    }
+
+    /// copies the balancing information of a node of another type.
+    template <class Node>
+    static void CopyData ( BinaryNode* to, const Node* from ) {
+        to->BalancingInfo = from->GetBalance();
+    }
+
     /** returns a pointer to a node that is the root of
      *  a duplicate of the tree rooted at the given node.
+     *  The tree may have another node type, in which case
+     *  only elements and balancing information are copied.
      *
      *  @param T tree to be cloned.
      *  @param node given node.
      *  @return root node.
      */
-    virtual BinaryNode* Duplicate ( const SearchTree& T,
-                                    const BinaryNode* node ) const {
+    template <class Tree, class Node>
+    BinaryNode* Duplicate ( const Tree& T, const Node* node ) const {
         BinaryNode* root = 
-              new BinaryNode ( node->GetElement(), this->NullNode, this->NullNode ); 
-        root->setData ( node->BalancingInfo, node->Size );
+              MakeNode ( node->GetElement(), this->NullNode, this->NullNode ); 
+        CopyData ( root, node );
 
     	if ( T.hasLeftChild ( node ) )
              root->Left = Duplicate ( T, node->GetLeft() );  
     	if ( T.hasRightChild ( node ) )
              root->Right = Duplicate ( T, node->GetRight() );  
+        Adopt ( root );
+        Resize ( root );
     
     	return root;
     }
 
+    /** returns the root of a copy, made of nodes of this tree, of the
+     *  subtree rooted at node.
+     */
+    BinaryNode* Copy ( const BinaryNode* node ) const {
+        if ( IsNullNode ( node ) ) return NullNode;
+        BinaryNode* root = MakeNode ( node->GetElement(), NullNode, NullNode );
+        CopyData ( root, node );
+        root->Left = Copy ( node->GetLeft() );
+        root->Right = Copy ( node->GetRight() );
+        Adopt ( root );
+        Resize ( root );
+        return root;
+    }
+
     /** internal Insert routine for SearchTree.
      * 	Add X into subtree rooted at T.
      *
@@ -343,10 +1945,10 @@ class SearchTree : public AbsBst<Etype,Cmp>
      *  @param T root node.
      *	@return true if insert succeeds and false if X is a duplicate
      */
-    virtual int Insert( const Etype& X, BinaryNode*& T ) {
+    int Insert( const Etype& X, Link& T ) {
     	if( T == NullNode )
           {
-           T = new BinaryNode( X );
+           T = MakeNode( X );
            return 1;
           }
     	else if( compare(X, T->Element) )
@@ -364,7 +1966,7 @@ class SearchTree : public AbsBst<Etype,Cmp>
      *  @param T root node.
      *	@return false only if X was not found
      */
-    virtual int Remove( const Etype& X, BinaryNode*& T ) {
+    int Remove( const Etype& X, Link& T ) {
     	BinaryNode* Tmp;
 
     	if( T == NullNode )
@@ -383,7 +1985,7 @@ class SearchTree : public AbsBst<Etype,Cmp>
     	// One or zero children
     	Tmp = T;
     	T = ( T->Left != NullNode ) ? T->Left : T->Right;  // Reroot T
-    	delete Tmp;                                    // Delete old root
+    	FreeNode( Tmp );                               // Delete old root
     	return 1;
     }
 
@@ -393,7 +1995,7 @@ class SearchTree : public AbsBst<Etype,Cmp>
      *  @param T root node.
      *	@return false only if tree is empty
      */
-    virtual int RemoveMin( BinaryNode*& T ) {
+    int RemoveMin( Link& T ) {
     	if( T == NullNode )
             return 0;
     	else if( T->Left != NullNode )
@@ -401,7 +2003,7 @@ class SearchTree : public AbsBst<Etype,Cmp>
 
     	BinaryNode* Tmp = T;
     	T = T->Right;
-    	delete Tmp;
+    	FreeNode( Tmp );
     	return 1;
     }
 
@@ -411,7 +2013,7 @@ class SearchTree : public AbsBst<Etype,Cmp>
      *	@return pointer to node containing minimum
      *	        or NullNode, if tree is empty.
      */
-    virtual const BinaryNode* FindMin( const BinaryNode* T ) const {
+    const BinaryNode* FindMin( const BinaryNode* T ) const {
     	if( T != NullNode )
             while( hasLeftChild ( T ) )
                 T = T->Left;
@@ -425,7 +2027,7 @@ class SearchTree : public AbsBst<Etype,Cmp>
      * 	@return pointer to node containing maximum
      *	        or NullNode, if tree is empty.
      */
-    virtual const BinaryNode* FindMax( const BinaryNode* T ) const {
+    const BinaryNode* FindMax( const BinaryNode* T ) const {
     	if( T != NullNode )
             while( hasRightChild ( T ) )
                T = T->Right;
@@ -439,7 +2041,7 @@ class SearchTree : public AbsBst<Etype,Cmp>
      *  @param T root node.
      *	@return pointer to node containing X or NullNode if X is not found.
      */
-    virtual const BinaryNode* Find( const Etype& X,
+    const BinaryNode* Find( const Etype& X,
                                     const BinaryNode* T ) const {
     	while( T != NullNode )
             if( compare(X, T->Element) )
@@ -458,16 +2060,54 @@ class SearchTree : public AbsBst<Etype,Cmp>
      *	@param ptr root node.
      *	@param T given tree.
      */
-    void fixNullNode ( BinaryNode* ptr, SearchTree& T ) {
-        if ( ptr->Left != T.NullNode ) 
-             fixNullNode ( ptr->Left, T );
+    void fixNullNode ( BinaryNode* ptr, SearchTreeCore& T ) 
+        { fixNullNode ( ptr, T.NullNode, this->NullNode ); }
+
+    /** sets all links of the tree rooted at "ptr" pointing to From,
+     *  to point to To.
+     *
+     *	@param ptr root node.
+     *	@param From NullNode of the tree.
+     *	@param To new NullNode.
+     */
+    static void fixNullNode ( BinaryNode* ptr, const BinaryNode* From, BinaryNode* To ) {
+        if ( ptr->Left != From ) 
+             fixNullNode ( ptr->Left, From, To );
         else 
-             ptr->Left = this->NullNode;
-        if ( ptr->Right != T.NullNode ) 
-             fixNullNode ( ptr->Right, T );
+             ptr->Left = To;
+        if ( ptr->Right != From ) 
+             fixNullNode ( ptr->Right, From, To );
         else 
-             ptr->Right = this->NullNode;
+             ptr->Right = To;
     }
 
 };
+
+/** SearchTree class: unbalanced binary search tree, 
+ *  with the virtual AbsBst interface.
+ */
+template <class Etype, class Cmp=compare_to<Etype>,
+          class Alloc=utlNodePool<BinNode<Etype,Cmp> > >
+class SearchTree : 
+   public AbsBstAdapter<SearchTreeCore<SearchTree<Etype,Cmp,Alloc>,Etype,Cmp,Alloc>,Etype,Cmp>
+{
+  public:
+
+    /// empty constructor.
+    SearchTree( const Cmp& comp = Cmp() ) : 
+        AbsBstAdapter<SearchTreeCore<SearchTree,Etype,Cmp,Alloc>,Etype,Cmp>( comp ) { }
+};
+
+/// unbalanced binary search tree, without virtual functions.
+template <class Etype, class Cmp=compare_to<Etype>,
+          class Alloc=utlNodePool<BinNode<Etype,Cmp> > >
+class StaticSearchTree : 
+   public SearchTreeCore<StaticSearchTree<Etype,Cmp,Alloc>,Etype,Cmp,Alloc>
+{
+  public:
+
+    /// empty constructor.
+    StaticSearchTree( const Cmp& comp = Cmp() ) : 
+        SearchTreeCore<StaticSearchTree,Etype,Cmp,Alloc>( comp ) { }
+};
 #endif
@@ -0,0 +1,565 @@
+/*
+   ConcurrentAVLTree.h
+
+   AVL trees read without locks.
+*/
+#ifndef __ConcurrentAVLTree
+#define __ConcurrentAVLTree
+
+#include "utlSharedLock.h"
+#include "utlVector.h"
+#include "AVLTree.h"
+
+/** ConcurrentAVLTree class interface.
+ *
+ *  An AVL tree which any number of threads may search while another
+ *  one changes it. Readers take no lock, and write nothing shared but
+ *  a per-thread counter.
+ *
+ *  Readers are optimistic. Every node has a version number, which is odd
+ *  while a writer is changing its links, and grows when it is done.
+ *  A reader going from a node to a child reads the version of the child,
+ *  and checks that the version of the node did not change meanwhile: the
+ *  child was really its child, and the item searched for, if present, is
+ *  below it. When a version is odd or has changed, the search starts over.
+ *  Writers mark the nodes whose subtrees lose items: the node going down
+ *  in a rotation (through AVLTreeCore::Rotating), and the nodes on the
+ *  way to a successor which moves up. Marks are released when the whole
+ *  change is done. A removed node stays marked.
+ *
+ *  Items are never changed in place: removing a node with two children
+ *  moves its successor node into its place, instead of copying the item.
+ *  Removed nodes are kept until no reader may still be looking at them
+ *  (see utlEpoch), and freed RetireBatch at a time.
+ *
+ *  Writers are serialized by a mutex. Insertion and rebalancing are
+ *  those of AVLTreeCore.
+ *
+ *  Etype: must have zero-parameter and copy constructor,
+ *     and must have operator< <br>
+ *  CONSTRUCTION: with (a) no initializer <br>
+ *  Deep copy is supported, if no thread changes the trees meanwhile.
+ *
+ *  ******************PUBLIC OPERATIONS********************* <br>
+ *  int Insert( const Etype& X )  --> Insert X <br>
+ *  int InsertP( const Etype& X ) --> Insert X, unless its key is there <br>
+ *  int Remove( const Etype& X )  --> Remove X <br>
+ *  int RemoveP( const Etype& X ) --> Remove pair whose key matches X <br>
+ *  int InsertBatch( first, last ) --> Insert the items of a range <br>
+ *  int RemoveBatch( first, last ) --> Remove the items of a range <br>
+ *  int InsertBatchP( first, last ), RemoveBatchP( first, last ) --> Same, by key <br>
+ *  int IsFound( const Etype& X ) --> Return 1 if X is found <br>
+ *  BinaryNode* Lookup( const Etype& X ) --> Return node holding X, or NULL <br>
+ *  BinaryNode* LookupP( const Etype& X ) --> Same, comparing pairs by key <br>
+ *  int FindBatch( keys, n, out )  --> Look up n items at once <br>
+ *  int Visit( const Etype& X, F f ) --> Call f on item that matches X <br>
+ *  int VisitP( const Etype& X, F f ) --> Same, comparing pairs by key <br>
+ *  Etype FindMin( )              --> Return smallest item <br>
+ *  Etype FindMax( )              --> Return largest item <br>
+ *  void MakeEmpty( )             --> Remove all items <br>
+ *  ------------- Inherited ----------------------------- <br>
+ *  int Build( first, last )      --> Replace items by those of a range <br>
+ *  int IsEmpty( )                --> Return 1 if empty; else return 0  <br>
+ *  Etype Find( const Etype& X )  --> Return item that matches X <br>
+ *  int WasFound( )               --> Return 1 if last Find succeeded <br>
+ *  BinayNode<Etype>* GetRoot()   --> Return root node <br>
+ *  ******************ERRORS********************************  <br>
+ *  Predefined exception is propagated if new fails. <br>
+ *
+ *  All of the above may be called concurrently, except Find and WasFound,
+ *  which share the last node found. Iterations, and the inherited 
+ *  LowerBound and UpperBound, need the tree not to change.
+ *  A node returned by Lookup, LookupP, FindMin or FindMax stays valid
+ *  until its item is removed; Visit is safe even then. <br>
+ *  The tree may be used as the Tree of utlSet and utlMap: find, insert
+ *  and erase may then be called from several threads.
+ */
+
+template <class Etype, class Cmp=compare_to<Etype>,
+          class Alloc=utlNodePool<BinNode<Etype,Cmp,utlConcurrentAVLLayout> > >
+class ConcurrentAVLTree:
+   public AVLTreeCore<ConcurrentAVLTree<Etype,Cmp,Alloc>,Etype,Cmp,Alloc>
+{
+  /// the core.
+  typedef AVLTreeCore<ConcurrentAVLTree,Etype,Cmp,Alloc> Core;
+
+  /// the core calls Rotating.
+  friend class AVLTreeCore<ConcurrentAVLTree,Etype,Cmp,Alloc>;
+
+  /// the core builds trees through SetTree.
+  friend class SearchTreeCore<ConcurrentAVLTree,Etype,Cmp,Alloc>;
+
+  public:
+
+  /// a binary node definition.
+  typedef typename Core::BinaryNode BinaryNode;
+
+  /// a link between nodes.
+  typedef typename Core::Link Link;
+
+  /// number of removed nodes freed at once.
+  enum { RetireBatch = 256 };
+
+  /// the tree is read while written, so copies do not share its nodes.
+  enum { Shareable = 0 };
+
+  /** @name constructors  */
+  //@{
+
+    /// empty constructor.
+    ConcurrentAVLTree( const Cmp& comp = Cmp() ) : Core( comp ) { }
+
+    /// copy constructor.
+    ConcurrentAVLTree( const ConcurrentAVLTree& Rhs ) : Core( Rhs ) { }
+
+    /// destructor. Frees the removed nodes.
+    ~ConcurrentAVLTree( ) { FreeRetired( ); }
+
+  //@}
+
+    /// assignment operator.
+    const ConcurrentAVLTree& operator = ( const ConcurrentAVLTree& Rhs ) {
+        Core::operator = ( Rhs );
+        return *this;
+    }
+
+    /** adds X into the tree. If X already present, do nothing.
+     *
+     *  @param X item to be inserted.
+     *	@return true if insertion was successful.
+     */
+    int Insert( const Etype& X ) {
+        std::lock_guard<std::mutex> guard( WriteLock );
+        int resp = Core::Insert( X );
+        Unmark( );
+        return resp;
+    }
+
+    /** adds X into the tree, unless there is a pair with the key of X.
+     *  Version specialized for pairs, since it uses operator neq.
+     *
+     *  @param X pair to be inserted.
+     *	@return true if insertion was successful.
+     */
+    int InsertP( const Etype& X ) {
+        std::lock_guard<std::mutex> guard( WriteLock );
+        if ( Search( X, 1 ) != NULL ) return 0;
+        int resp = Core::Insert( X );
+        Unmark( );
+        return resp;
+    }
+
+    /** removes X from tree.
+     *  If X has two children, its successor node takes its place.
+     *
+     *  @param X item to be removed.
+     *	@return 1 if X was found, and 0 otherwise.
+     */
+    int Remove( const Etype& X ) {
+        std::lock_guard<std::mutex> guard( WriteLock );
+        return RemoveNode( X );
+    }
+
+    /** removes the pair whose key matches the key of X.
+     *  Version specialized for pairs, since it uses operator neq.
+     *
+     *  @param X pair whose key is searched for.
+     *	@return 1 if X was found, and 0 otherwise.
+     */
+    int RemoveP( const Etype& X ) {
+        std::lock_guard<std::mutex> guard( WriteLock );
+        const BinaryNode* node = Search( X, 1 );
+        if ( node == NULL ) return 0;
+        const Etype Y ( node->GetElement() );
+        return RemoveNode( Y );
+    }
+
+    /** inserts the items of a range. The range is sorted without the
+     *  lock, and its items are inserted in order, one at a time, so
+     *  that readers are never held up for the whole batch.
+     *
+     *  @param first beginning of the range (forward iterator).
+     *  @param last end of the range.
+     *  @param threads number of threads used for sorting,
+     *         or 0 for one per hardware thread.
+     *	@return number of items inserted.
+     */
+    template <class Iter>
+    int InsertBatch( Iter first, Iter last, int threads = 0 )
+        { return Batch( first, last, utlDerefLess<Etype,Cmp>( this->compare ), &ConcurrentAVLTree::Insert, threads ); }
+
+    /** removes the items of a range.
+     *
+     *  @see InsertBatch().
+     *	@return number of items removed.
+     */
+    template <class Iter>
+    int RemoveBatch( Iter first, Iter last, int threads = 0 )
+        { return Batch( first, last, utlDerefLess<Etype,Cmp>( this->compare ), &ConcurrentAVLTree::Remove, threads ); }
+
+    /// InsertBatch, for pairs: a pair is not inserted if its key is there.
+    template <class Iter>
+    int InsertBatchP( Iter first, Iter last, int threads = 0 )
+        { return Batch( first, last, utlDerefLessP<Etype,Cmp>( this->compare ), &ConcurrentAVLTree::InsertP, threads ); }
+
+    /// RemoveBatch, for pairs: the pairs whose keys match are removed.
+    template <class Iter>
+    int RemoveBatchP( Iter first, Iter last, int threads = 0 )
+        { return Batch( first, last, utlDerefLessP<Etype,Cmp>( this->compare ), &ConcurrentAVLTree::RemoveP, threads ); }
+
+    /// makes this tree empty.
+    void MakeEmpty( ) {
+        std::lock_guard<std::mutex> guard( WriteLock );
+        BinaryNode* Old = this->Root;
+        this->Root = this->NullNode;
+        Epoch.synchronize( );
+        FreeRetired( );
+        this->ReleaseTree( Old );
+    }
+
+    /// swaps the contents of this and a given tree.
+    void swap( ConcurrentAVLTree& s ) {
+        std::lock( WriteLock, s.WriteLock );
+        std::lock_guard<std::mutex> g1( WriteLock, std::adopt_lock );
+        std::lock_guard<std::mutex> g2( s.WriteLock, std::adopt_lock );
+        Epoch.synchronize( );   FreeRetired( );
+        s.Epoch.synchronize( ); s.FreeRetired( );
+        Core::swap( s );
+    }
+
+    /// returns true if X is in tree.
+    int IsFound( const Etype& X ) const {
+        utlEpoch::Guard g( Epoch );
+        return Search( X, 0 ) != NULL;
+    }
+
+    /** returns the node holding X, or NULL if X is not in the tree.
+     *
+     *  @param X item to be searched for.
+     *  @return node containing X or NULL.
+     */
+    const BinaryNode* Lookup( const Etype& X ) const {
+        utlEpoch::Guard g( Epoch );
+        return Search( X, 0 );
+    }
+
+    /** returns the node holding X, or NULL if X is not in the tree.
+     *  Version specialized for pairs, since it uses operator neq.
+     *
+     *  @param X item to be searched for.
+     *  @return node containing X or NULL.
+     */
+    const BinaryNode* LookupP( const Etype& X ) const {
+        utlEpoch::Guard g( Epoch );
+        return Search( X, 1 );
+    }
+
+    /** looks up n items: out[i] gets the node holding keys[i], or NULL.
+     *  Readers are validated node by node, so the searches are not
+     *  interleaved, as in SearchTreeCore::FindBatch, but they share a
+     *  single critical section.
+     *
+     *  @return number of items found.
+     */
+    int FindBatch( const Etype* keys, int n, const BinaryNode** out ) const {
+        utlEpoch::Guard g( Epoch );
+        int found = 0;
+        for ( int i = 0; i < n; ++i ) found += ( out[i] = Search( keys[i], 0 ) ) != NULL;
+        return found;
+    }
+
+    /// FindBatch, for pairs: pairs are compared by key.
+    int FindBatchP( const Etype* keys, int n, const BinaryNode** out ) const {
+        utlEpoch::Guard g( Epoch );
+        int found = 0;
+        for ( int i = 0; i < n; ++i ) found += ( out[i] = Search( keys[i], 1 ) ) != NULL;
+        return found;
+    }
+
+    /** calls f on the item that matches X. The node cannot be
+     *  freed before f returns, even if X is removed meanwhile.
+     *
+     *  @param X item to be searched for.
+     *  @param f function taking a const Etype&.
+     *  @return true if found.
+     */
+    template <class F>
+    int Visit( const Etype& X, F f ) const {
+        utlEpoch::Guard g( Epoch );
+        const BinaryNode* P = Search( X, 0 );
+        if ( P == NULL ) return 0;
+        f( P->GetElement( ) );
+        return 1;
+    }
+
+    /** calls f on the pair whose key matches the key of X.
+     *  Version specialized for pairs, since it uses operator neq.
+     *
+     *  @param X pair to be searched for.
+     *  @param f function taking a const Etype&.
+     *  @return true if found.
+     */
+    template <class F>
+    int VisitP( const Etype& X, F f ) const {
+        utlEpoch::Guard g( Epoch );
+        const BinaryNode* P = Search( X, 1 );
+        if ( P == NULL ) return 0;
+        f( P->GetElement( ) );
+        return 1;
+    }
+
+    /** returns item X in tree.
+     *	Result can be checked by calling WasFound.
+     */
+    const Etype& Find( const Etype& X ) const {
+        BinaryNode** tempCurrent = (BinaryNode**)& this->Current;
+        const BinaryNode* node = Lookup( X );
+        *tempCurrent = node != NULL ? (BinaryNode*) node : (BinaryNode*) this->NullNode;
+        return node != NULL ? node->GetElement() : this->ItemNotFound;
+    }
+
+    /** returns item X in tree.
+     *  Version specialized for pairs, since it uses operator neq.
+     */
+    const Etype& FindP( const Etype& X ) const {
+        BinaryNode** tempCurrent = (BinaryNode**)& this->Current;
+        const BinaryNode* node = LookupP( X );
+        *tempCurrent = node != NULL ? (BinaryNode*) node : (BinaryNode*) this->NullNode;
+        return node != NULL ? node->GetElement() : this->ItemNotFound;
+    }
+
+    /** returns minimum item in tree.
+     *
+     *	@return ItemNotFound if tree is empty.
+     */
+    const Etype& FindMin( ) const {
+        utlEpoch::Guard g( Epoch );
+        const BinaryNode* P = Extreme( 0 );
+        return P != NULL ? P->GetElement() : this->ItemNotFound;
+    }
+
+    /** returns maximum item in tree.
+     *
+     *	@return ItemNotFound if tree is empty.
+     */
+    const Etype& FindMax( ) const {
+        utlEpoch::Guard g( Epoch );
+        const BinaryNode* P = Extreme( 1 );
+        return P != NULL ? P->GetElement() : this->ItemNotFound;
+    }
+
+  private:
+
+    /// applies op to the sorted and distinct items of a range (see utlSortUnique).
+    template <class Iter, class Less>
+    int Batch( Iter first, Iter last, const Less& L, int (ConcurrentAVLTree::*op)( const Etype& ), int threads ) {
+        const Etype** P;
+        int n = utlSortUnique( first, last, L, 1, threads, P );
+        int k = 0;
+        for ( int i = 0; i < n; ++i ) k += (this->*op)( *P[i] );
+        delete [] P;
+        return k;
+    }
+
+    /** replaces the items of the tree by *P[0], ..., *P[n-1], sorted and
+     *  distinct. The range was sorted without the lock. Readers see either
+     *  the old tree or the new one. Both share the pool, so the old nodes
+     *  are freed one by one.
+     */
+    void SetTree( const Etype* const* P, int n ) {
+        std::lock_guard<std::mutex> guard( WriteLock );
+        BinaryNode* Old = this->Root;
+        this->Root = this->MakeTree( P, n );
+        Epoch.synchronize( );
+        FreeRetired( );
+        this->FreeTree( Old );
+    }
+
+    /// serializes the writers.
+    std::mutex WriteLock;
+
+    /// readers, waited for before freeing removed nodes.
+    mutable utlEpoch Epoch;
+
+    /// nodes marked by the current writer.
+    utlVector<BinaryNode*> Marked;
+
+    /// removed nodes, not freed yet.
+    utlVector<BinaryNode*> Retired;
+
+    /** removes X from tree. The writer lock must be held.
+     *  If X has two children, its successor node takes its place.
+     */
+    int RemoveNode( const Etype& X ) {
+        BinaryNode* Null = this->NullNode;
+        Link* Path[Core::MaxHeight];  // the tree is rebalanced up this path
+        int n = 0;
+        Link* L = &this->Root;
+        BinaryNode* T = *L;
+
+        while ( T != Null ) {
+            Link* P = L;
+            if ( this->compare( X, T->GetElement() ) )
+                 L = &T->Left;
+            else if ( this->compare( T->GetElement(), X ) )
+                 L = &T->Right;
+            else
+                 break;
+            Path[n++] = P;
+            T = *L;
+        }
+        if ( T == Null ) return 0;
+
+        Unlinking( T );
+        if ( T->Left != Null && T->Right != Null ) {
+             // the successor S leaves its parent, and replaces T.
+             // Every node on the way to S loses it.
+             int k = n;
+             Path[n++] = L;
+             Link* SL = &T->Right;
+             BinaryNode* S = *SL;
+             while ( S->Left != Null ) {
+                 Mark( S );
+                 Path[n++] = SL;
+                 SL = &S->Left;
+                 S = *SL;
+             }
+             Mark( S );
+             *SL = S->Right;
+             S->Left = T->Left;
+             S->Right = T->Right;
+             S->Level = T->Level;
+             *L = S;
+             if ( n > k + 1 ) Path[k+1] = &S->Right;    // it was &T->Right
+        }
+        else
+             *L = ( T->Left != Null ) ? T->Left : T->Right;
+        this->Retrace( Path, n );
+        Unmark( );
+        Retire( T );
+        return 1;
+    }
+
+    /// returns the version of a node.
+    static unsigned Version( const BinaryNode* T ) {
+        return T->BalancingInfo.Version.load( std::memory_order_acquire );
+    }
+
+    /// marks a node, whose links are going to change.
+    void Mark( BinaryNode* T ) {
+        unsigned v = Version( T );
+        if ( v & 1 ) return;
+        T->BalancingInfo.Version.store( v + 1, std::memory_order_release );
+        Marked.push_back( T );
+    }
+
+    /// marks a node for good: it is being removed.
+    void Unlinking( BinaryNode* T ) {
+        T->BalancingInfo.Version.store( Version( T ) | 1, std::memory_order_release );
+    }
+
+    /// releases the marks, once the tree is consistent again.
+    void Unmark( ) {
+        for ( size_t i = 0; i < Marked.size(); ++i )
+              Marked[i]->BalancingInfo.Version.store( Version( Marked[i] ) + 1,
+                                                      std::memory_order_release );
+        Marked.clear( );
+    }
+
+    /// called by the rotations of AVLTreeCore: K goes down.
+    void Rotating( BinaryNode* K ) { Mark( K ); }
+
+    /// keeps a removed node, until no reader may see it.
+    void Retire( BinaryNode* T ) {
+        Retired.push_back( T );
+        if ( Retired.size() >= (size_t) RetireBatch ) {
+             Epoch.synchronize( );
+             FreeRetired( );
+        }
+    }
+
+    /// frees the removed nodes. No reader may see them.
+    void FreeRetired( ) {
+        for ( size_t i = 0; i < Retired.size(); ++i )
+              this->FreeNode( Retired[i] );
+        Retired.clear( );
+    }
+
+    /** returns the root and its version, unless it is being changed.
+     *
+     *  @return false if the search must start over.
+     */
+    int ReadRoot( const BinaryNode*& T, unsigned& v ) const {
+        T = this->Root;
+        v = Version( T );
+        if ( ( v & 1 ) || T != (const BinaryNode*) this->Root ) {
+             std::this_thread::yield( );
+             return 0;
+        }
+        return 1;
+    }
+
+    /** goes from T, of version v, to its child C.
+     *
+     *  @return false if the search must start over.
+     */
+    int Descend( const BinaryNode*& T, unsigned& v, const BinaryNode* C ) const {
+        unsigned vc = ( C != this->NullNode ) ? Version( C ) : 0;
+        if ( ( vc & 1 ) || Version( T ) != v ) {
+             std::this_thread::yield( );
+             return 0;
+        }
+        T = C; v = vc;
+        return 1;
+    }
+
+    /** searches for X, validating each step.
+     *  Must be called by a reader inside the epoch.
+     *
+     *  @param X item to be searched for.
+     *  @param Pairs whether pairs are compared with operator neq.
+     *  @return node containing X or NULL.
+     */
+    const BinaryNode* Search( const Etype& X, int Pairs ) const {
+        const BinaryNode* Null = this->NullNode;
+        const BinaryNode* T;
+        unsigned v;
+
+        for ( ; ; ) {
+            if ( !ReadRoot( T, v ) ) continue;
+            for ( ; ; ) {
+                if ( T == Null ) return NULL;
+                const Etype& E = T->GetElement();
+                int Less = this->compare( X, E );
+                if ( Pairs ? !this->compare.neq( X, E ) : !Less && !this->compare( E, X ) )
+                     return T;
+                if ( !Descend( T, v, Less ? T->Left : T->Right ) ) break;
+            }
+        }
+    }
+
+    /** returns the leftmost (Right false) or rightmost node,
+     *  validating each step, or NULL if the tree is empty.
+     *  Must be called by a reader inside the epoch.
+     */
+    const BinaryNode* Extreme( int Right ) const {
+        const BinaryNode* Null = this->NullNode;
+        const BinaryNode* T;
+        unsigned v;
+
+        for ( ; ; ) {
+            if ( !ReadRoot( T, v ) ) continue;
+            if ( T == Null ) return NULL;
+            for ( ; ; ) {
+                const BinaryNode* C = Right ? T->Right : T->Left;
+                if ( C == Null ) {
+                     if ( Version( T ) == v ) return T;
+                     break;
+                }
+                if ( !Descend( T, v, C ) ) break;
+            }
+        }
+    }
+};
+
+#endif
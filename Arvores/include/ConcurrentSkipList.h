@@ -0,0 +1,901 @@
+/*
+   ConcurrentSkipList.h
+
+   Lock-free skip lists, as an ordered set shared by several threads.
+*/
+#ifndef __ConcurrentSkipList
+#define __ConcurrentSkipList
+
+#include <new>
+#include <cstdint>
+#include "utlSharedLock.h"
+#include "utlIterate.h"
+
+template <class Etype, class Cmp> class ConcurrentSkipList;
+
+/** SkipNode class interface: a node of a ConcurrentSkipList.
+ *
+ *  A node of height h has h forward links, one for each level of the list.
+ *  The links are allocated with the node, right after it. The lowest bit
+ *  of a link marks the node as removed from that level: a marked link
+ *  never changes again. A node is removed from the set once its level 0
+ *  link is marked.
+ *
+ *  As a BinaryNode, a node has no left child, and its right child is the
+ *  next item in the set, so that the in order iterators of utlIterate.h,
+ *  and thus utlSet and utlMap, walk the list.
+ */
+template <class Etype, class Cmp>
+class SkipNode
+{
+    friend class ConcurrentSkipList<Etype,Cmp>;
+
+  public:
+
+    /// returns the item.
+    const Etype& GetElement( ) const { return Element; }
+
+    /// returns the number of levels of this node.
+    int GetHeight( ) const { return Height; }
+
+    /// returns the left child: there is none.
+    const SkipNode* GetLeft( ) const { return NULL; }
+
+    /// returns the right child: the next item in the set, or NULL.
+    const SkipNode* GetRight( ) const {
+        const SkipNode* N = Ptr( Next( 0 ).load( ) );
+        while ( N != NULL && Marked( N->Next( 0 ).load( ) ) )
+                N = Ptr( N->Next( 0 ).load( ) );
+        return N;
+    }
+
+  private:
+
+    /// the item.
+    Etype Element;
+
+    /// number of levels.
+    int Height;
+
+    /// number of levels this node is linked into, or still to be linked into.
+    std::atomic<int> Links;
+
+    /// next removed node, waiting to be freed.
+    SkipNode* RetiredNext;
+
+    /// constructor.
+    SkipNode( const Etype& E, int h ) : Element( E ), Height( h ), Links( h ), RetiredNext( NULL ) {
+        for ( int i = 0; i < h; ++i ) new( &Next( i ) ) std::atomic<uintptr_t>( 0 );
+    }
+
+    /// returns the link of level i.
+    std::atomic<uintptr_t>& Next( int i ) const {
+        return ( (std::atomic<uintptr_t>*) ( const_cast<SkipNode*>( this ) + 1 ) )[i];
+    }
+
+    /// returns whether a link is marked.
+    static int Marked( uintptr_t L ) { return L & 1; }
+
+    /// returns the node a link points to.
+    static SkipNode* Ptr( uintptr_t L ) { return (SkipNode*) ( L & ~(uintptr_t) 1 ); }
+
+    /// creates a node of height h.
+    static SkipNode* Make( const Etype& E, int h ) {
+        void* p = ::operator new( sizeof(SkipNode) + h * sizeof(std::atomic<uintptr_t>) );
+        try { return new( p ) SkipNode( E, h ); }
+        catch ( ... ) { ::operator delete( p ); throw; }
+    }
+
+    /// destroys a node.
+    static void Free( SkipNode* N ) {
+        N->~SkipNode( );
+        ::operator delete( N );
+    }
+};
+
+/** ConcurrentSkipList class interface.
+ *
+ *  An ordered set which any number of threads may search and change at
+ *  the same time, without locks: a skip list, after Herlihy and Shavit,
+ *  "The Art of Multiprocessor Programming", chapter 14.
+ *
+ *  Every item is in a sorted list, level 0, and in a few more sparse ones:
+ *  a node goes up one more level with probability 1/4, drawn by a fast
+ *  per-thread generator. Searches go down the levels, as in a tree, in
+ *  expected logarithmic time. Insertion links a node at level 0, which
+ *  adds the item to the set, and then at the levels above. Removal marks
+ *  the links of a node, from the top down; marking level 0 removes the
+ *  item. Marked nodes are unlinked by the insertions and removals that
+ *  go by them. Searches (IsFound, Lookup, Visit, FindMin, FindMax and
+ *  the bounds) write nothing shared but a per-thread counter (see 
+ *  utlEpoch). Find and FindP also record the node found.
+ *
+ *  A node is retired once unlinked from every level, and freed when no
+ *  reader may still be looking at it (see utlEpoch), RetireBatch at a time.
+ *
+ *  Etype: must have zero-parameter and copy constructor,
+ *     and must have operator< <br>
+ *  CONSTRUCTION: with (a) no initializer <br>
+ *  Deep copy is supported, if no thread changes the lists meanwhile.
+ *
+ *  ******************PUBLIC OPERATIONS********************* <br>
+ *  int Insert( const Etype& X )  --> Insert X <br>
+ *  int InsertP( const Etype& X ) --> Insert X, unless its key is there <br>
+ *  int Remove( const Etype& X )  --> Remove X <br>
+ *  int RemoveP( const Etype& X ) --> Remove pair whose key matches X <br>
+ *  int IsFound( const Etype& X ) --> Return 1 if X is found <br>
+ *  BinaryNode* Lookup( const Etype& X ) --> Return node holding X, or NULL <br>
+ *  BinaryNode* LookupP( const Etype& X ) --> Same, comparing pairs by key <br>
+ *  int Visit( const Etype& X, F f ) --> Call f on item that matches X <br>
+ *  int VisitP( const Etype& X, F f ) --> Same, comparing pairs by key <br>
+ *  Etype Find( const Etype& X )  --> Return item that matches X <br>
+ *  int WasFound( )               --> Return 1 if last Find succeeded <br>
+ *  Etype FindMin( )              --> Return smallest item <br>
+ *  Etype FindMax( )              --> Return largest item <br>
+ *  int IsEmpty( )                --> Return 1 if empty; else return 0 <br>
+ *  void MakeEmpty( )             --> Remove all items <br>
+ *  int Build( first, last )      --> Replace items by those of a range <br>
+ *  int BuildP( first, last )     --> Same, keeping the first pair of each key <br>
+ *  int InsertBatch( first, last ) --> Insert the items of a range <br>
+ *  int RemoveBatch( first, last ) --> Remove the items of a range <br>
+ *  int InsertBatchP( first, last ), RemoveBatchP( first, last ) --> Same, by key <br>
+ *  BinaryNode* GetRoot( )        --> Return node of the smallest item <br>
+ *  BinaryNode* Predecessor( node ) --> Return node of the previous item <br>
+ *  BinaryNode* LowerBound( const Etype& X ) --> Return node of first item not before X <br>
+ *  BinaryNode* UpperBound( const Etype& X ) --> Return node of first item after X <br>
+ *  BinaryNode* LowerBoundP( X ), UpperBoundP( X ) --> Same, comparing pairs by key <br>
+ *  int CountP( const Etype& X )  --> Number of pairs whose key matches X <br>
+ *  ******************ERRORS********************************  <br>
+ *  Predefined exception is propagated if new fails. <br>
+ *
+ *  Insert, Remove, IsFound, Lookup, LookupP, Visit, VisitP, FindMin,
+ *  FindMax, IsEmpty and the bounds may be called concurrently. Find and 
+ *  WasFound share the last node found. MakeEmpty, Build, swap, copies 
+ *  and iterations need the list not to change. A node returned by Lookup,
+ *  LookupP, FindMin or FindMax stays valid until its item is removed;
+ *  Visit is safe even then. <br>
+ *  The list may be used as the Tree of utlSet and utlMap: find, insert
+ *  and erase may then be called from several threads.
+ */
+template <class Etype, class Cmp=compare_to<Etype> >
+class ConcurrentSkipList
+{
+  public:
+
+  /// type of the items.
+  typedef Etype value_type;
+
+  /// a node definition, for the iterators.
+  typedef SkipNode<Etype,Cmp> BinaryNode;
+
+  /// maximum number of levels.
+  enum { MaxLevel = 32 };
+
+  /// number of removed nodes freed at once.
+  enum { RetireBatch = 256 };
+
+  /** @name constructors  */
+  //@{
+
+    /// empty constructor.
+    ConcurrentSkipList( const Cmp& comp = Cmp() ) :
+        compare( comp ), Head( BinaryNode::Make( Etype(), MaxLevel ) ), Top( 1 ),
+        Retired( NULL ), RetiredCount( 0 ), Current( NULL ) { }
+
+    /// copy constructor.
+    ConcurrentSkipList( const ConcurrentSkipList& Rhs ) :
+        compare( Rhs.compare ), Head( BinaryNode::Make( Etype(), MaxLevel ) ), Top( 1 ),
+        Retired( NULL ), RetiredCount( 0 ), Current( NULL ) { Append( Rhs ); }
+
+    /// destructor.
+    ~ConcurrentSkipList( ) {
+        MakeEmpty( );
+        BinaryNode::Free( Head );
+    }
+
+  //@}
+
+    /// assignment operator.
+    const ConcurrentSkipList& operator = ( const ConcurrentSkipList& Rhs ) {
+        if ( this != &Rhs ) {
+             MakeEmpty( );
+             compare = Rhs.compare;
+             Append( Rhs );
+        }
+        return *this;
+    }
+
+    /** adds X into the list. If X already present, do nothing.
+     *
+     *  @param X item to be inserted.
+     *	@return true if insertion was successful.
+     */
+    int Insert( const Etype& X ) {
+        int resp;
+        {
+          utlEpoch::Guard g( Epoch );
+          resp = InsertNode( X, 0 );
+        }
+        Collect( );
+        return resp;
+    }
+
+    /** adds X into the list, unless there is a pair with the key of X.
+     *  Version specialized for pairs, since it uses operator neq.
+     *
+     *  @param X pair to be inserted.
+     *	@return true if insertion was successful.
+     */
+    int InsertP( const Etype& X ) {
+        int resp;
+        {
+          utlEpoch::Guard g( Epoch );
+          resp = InsertNode( X, 1 );
+        }
+        Collect( );
+        return resp;
+    }
+
+    /** removes X from the list.
+     *
+     *  @param X item to be removed.
+     *	@return 1 if X was found, and 0 otherwise.
+     */
+    int Remove( const Etype& X ) {
+        int resp;
+        {
+          utlEpoch::Guard g( Epoch );
+          resp = RemoveNode( X );
+        }
+        Collect( );
+        return resp;
+    }
+
+    /** removes the pair whose key matches the key of X.
+     *  Version specialized for pairs, since it uses operator neq.
+     *
+     *  @param X pair whose key is searched for.
+     *	@return 1 if X was found, and 0 otherwise.
+     */
+    int RemoveP( const Etype& X ) {
+        int resp = 0;
+        {
+          utlEpoch::Guard g( Epoch );
+          const BinaryNode* node = Search( X, 1 );
+          if ( node != NULL ) {
+               const Etype Y ( node->Element );
+               resp = RemoveNode( Y );
+          }
+        }
+        Collect( );
+        return resp;
+    }
+
+    /// returns true if X is in the list.
+    int IsFound( const Etype& X ) const {
+        utlEpoch::Guard g( Epoch );
+        return Search( X, 0 ) != NULL;
+    }
+
+    /** returns the node holding X, or NULL if X is not in the list.
+     *
+     *  @param X item to be searched for.
+     *  @return node containing X or NULL.
+     */
+    const BinaryNode* Lookup( const Etype& X ) const {
+        utlEpoch::Guard g( Epoch );
+        return Search( X, 0 );
+    }
+
+    /** returns the node holding X, or NULL if X is not in the list.
+     *  Version specialized for pairs, since it uses operator neq.
+     *
+     *  @param X item to be searched for.
+     *  @return node containing X or NULL.
+     */
+    const BinaryNode* LookupP( const Etype& X ) const {
+        utlEpoch::Guard g( Epoch );
+        return Search( X, 1 );
+    }
+
+    /** calls f on the item that matches X. The node cannot be
+     *  freed before f returns, even if X is removed meanwhile.
+     *
+     *  @param X item to be searched for.
+     *  @param f function taking a const Etype&.
+     *  @return true if found.
+     */
+    template <class F>
+    int Visit( const Etype& X, F f ) const {
+        utlEpoch::Guard g( Epoch );
+        const BinaryNode* P = Search( X, 0 );
+        if ( P == NULL ) return 0;
+        f( P->GetElement( ) );
+        return 1;
+    }
+
+    /** calls f on the pair whose key matches the key of X.
+     *  Version specialized for pairs, since it uses operator neq.
+     *
+     *  @param X pair to be searched for.
+     *  @param f function taking a const Etype&.
+     *  @return true if found.
+     */
+    template <class F>
+    int VisitP( const Etype& X, F f ) const {
+        utlEpoch::Guard g( Epoch );
+        const BinaryNode* P = Search( X, 1 );
+        if ( P == NULL ) return 0;
+        f( P->GetElement( ) );
+        return 1;
+    }
+
+    /** returns item X in the list.
+     *	Result can be checked by calling WasFound.
+     */
+    const Etype& Find( const Etype& X ) const {
+        Current = Lookup( X );
+        return Current != NULL ? Current->GetElement() : ItemNotFound;
+    }
+
+    /** returns item X in the list.
+     *  Version specialized for pairs, since it uses operator neq.
+     */
+    const Etype& FindP( const Etype& X ) const {
+        Current = LookupP( X );
+        return Current != NULL ? Current->GetElement() : ItemNotFound;
+    }
+
+    /// returns whether the last Find succeeded.
+    int WasFound( ) const { return Current != NULL; }
+
+    /** returns minimum item in the list.
+     *
+     *	@return ItemNotFound if the list is empty.
+     */
+    const Etype& FindMin( ) const {
+        utlEpoch::Guard g( Epoch );
+        const BinaryNode* P = Head->GetRight( );
+        return P != NULL ? P->GetElement() : ItemNotFound;
+    }
+
+    /** returns maximum item in the list.
+     *
+     *	@return ItemNotFound if the list is empty.
+     */
+    const Etype& FindMax( ) const {
+        utlEpoch::Guard g( Epoch );
+        const BinaryNode* P = Last( );
+        return P != NULL ? P->GetElement() : ItemNotFound;
+    }
+
+    /** returns the node of the item before the one in a given node,
+     *  in O(log n) expected, searching from the top level.
+     *
+     *  @param node given node, or NULL for the node of the largest item.
+     *  @return previous node, or NULL if there is none.
+     */
+    const BinaryNode* Predecessor( const BinaryNode* node ) const {
+        utlEpoch::Guard g( Epoch );
+        if ( node == NULL ) return Last( );
+        const BinaryNode* Pred = Head;
+        for ( int i = Top.load( ) - 1; i >= 0; --i ) {
+            const BinaryNode* Curr = BinaryNode::Ptr( Pred->Next( i ).load( ) );
+            while ( Curr != NULL ) {
+                uintptr_t Succ = Curr->Next( i ).load( );
+                if ( !BinaryNode::Marked( Succ ) ) {
+                     if ( !this->compare( Curr->Element, node->Element ) ) break;
+                     Pred = Curr;
+                }
+                Curr = BinaryNode::Ptr( Succ );
+            }
+        }
+        return Pred != Head ? Pred : NULL;
+    }
+
+    /** returns the node of the first item not before X: the node of X,
+     *  if X is in the list. O(log n) expected, searching from the top level.
+     *
+     *  @param X item to be searched for.
+     *  @return node found, or NULL if every item comes before X.
+     */
+    const BinaryNode* LowerBound( const Etype& X ) const {
+        utlEpoch::Guard g( Epoch );
+        return Bound( X, 0, 0 );
+    }
+
+    /// returns the node of the first item after X, or NULL (see LowerBound).
+    const BinaryNode* UpperBound( const Etype& X ) const {
+        utlEpoch::Guard g( Epoch );
+        return Bound( X, 1, 0 );
+    }
+
+    /// LowerBound, for pairs: pairs are compared by key.
+    const BinaryNode* LowerBoundP( const Etype& X ) const {
+        utlEpoch::Guard g( Epoch );
+        return Bound( X, 0, 1 );
+    }
+
+    /// UpperBound, for pairs: pairs are compared by key.
+    const BinaryNode* UpperBoundP( const Etype& X ) const {
+        utlEpoch::Guard g( Epoch );
+        return Bound( X, 1, 1 );
+    }
+
+    /** returns the number of pairs whose key matches the key of X.
+     *  They are counted one by one at level 0, from LowerBoundP( X ),
+     *  so this is O(log n + count) expected. There is no CountRange:
+     *  the nodes keep no sizes, to count a range in O(log n).
+     */
+    int CountP( const Etype& X ) const {
+        utlEpoch::Guard g( Epoch );
+        return CountBetween( X, X, 1, 1 );
+    }
+
+    /// returns whether the list is empty.
+    int IsEmpty( ) const {
+        utlEpoch::Guard g( Epoch );
+        return Head->GetRight( ) == NULL;
+    }
+
+    /// makes this list empty.
+    void MakeEmpty( ) {
+        Unlink( );
+        FreeRetired( );
+        BinaryNode* N = BinaryNode::Ptr( Head->Next( 0 ).load( ) );
+        while ( N != NULL ) {
+            BinaryNode* Next = BinaryNode::Ptr( N->Next( 0 ).load( ) );
+            BinaryNode::Free( N );
+            N = Next;
+        }
+        for ( int i = 0; i < MaxLevel; ++i ) Head->Next( i ).store( 0 );
+        Top.store( 1 );
+        Current = NULL;
+    }
+
+    /** replaces the items of the list by those of a range.
+     *  The range is sorted by several threads, unless it is sorted 
+     *  already, and the nodes are then appended in O(n). Of equivalent
+     *  items, the first one is kept.
+     *
+     *  @param first beginning of the range (forward iterator).
+     *  @param last end of the range.
+     *  @param threads number of threads used for sorting,
+     *         or 0 for one per hardware thread.
+     *	@return number of items in the list.
+     */
+    template <class Iter>
+    int Build( Iter first, Iter last, int threads = 0 )
+        { return BuildList( first, last, utlDerefLess<Etype,Cmp>( compare ), 1, threads ); }
+
+    /** replaces the items of the list by the pairs of a range, keeping
+     *  the first pair of each key, as InsertP would do.
+     *
+     *  @see Build().
+     */
+    template <class Iter>
+    int BuildP( Iter first, Iter last, int threads = 0 )
+        { return BuildList( first, last, utlDerefLessP<Etype,Cmp>( compare ), 1, threads ); }
+
+    /** replaces the items of the list by those of a sorted range, in O(n).
+     *  An exception is raised if the range is not sorted.
+     */
+    template <class Iter>
+    int BuildFromSorted( Iter first, Iter last )
+        { return BuildList( first, last, utlDerefLess<Etype,Cmp>( compare ), 0, 1 ); }
+
+    /** replaces the items of the list by the pairs of a range sorted by key,
+     *  in O(n). An exception is raised if the range is not sorted.
+     */
+    template <class Iter>
+    int BuildFromSortedP( Iter first, Iter last )
+        { return BuildList( first, last, utlDerefLessP<Etype,Cmp>( compare ), 0, 1 ); }
+
+    /** inserts the items of a range. The range is sorted, and its items
+     *  are inserted in order, one at a time, as by Insert.
+     *
+     *  @param first beginning of the range (forward iterator).
+     *  @param last end of the range.
+     *  @param threads number of threads used for sorting,
+     *         or 0 for one per hardware thread.
+     *	@return number of items inserted.
+     */
+    template <class Iter>
+    int InsertBatch( Iter first, Iter last, int threads = 0 )
+        { return Batch( first, last, utlDerefLess<Etype,Cmp>( compare ), &ConcurrentSkipList::Insert, threads ); }
+
+    /** removes the items of a range.
+     *
+     *  @see InsertBatch().
+     *	@return number of items removed.
+     */
+    template <class Iter>
+    int RemoveBatch( Iter first, Iter last, int threads = 0 )
+        { return Batch( first, last, utlDerefLess<Etype,Cmp>( compare ), &ConcurrentSkipList::Remove, threads ); }
+
+    /// InsertBatch, for pairs: a pair is not inserted if its key is there.
+    template <class Iter>
+    int InsertBatchP( Iter first, Iter last, int threads = 0 )
+        { return Batch( first, last, utlDerefLessP<Etype,Cmp>( compare ), &ConcurrentSkipList::InsertP, threads ); }
+
+    /// RemoveBatch, for pairs: the pairs whose keys match are removed.
+    template <class Iter>
+    int RemoveBatchP( Iter first, Iter last, int threads = 0 )
+        { return Batch( first, last, utlDerefLessP<Etype,Cmp>( compare ), &ConcurrentSkipList::RemoveP, threads ); }
+
+    /// swaps the contents of this and a given list.
+    void swap( ConcurrentSkipList& s ) {
+        FreeRetired( ); s.FreeRetired( );
+        std::swap( compare, s.compare );
+        std::swap( Head, s.Head );
+        int t = Top.load( ); Top.store( s.Top.load( ) ); s.Top.store( t );
+        Current = s.Current = NULL;
+    }
+
+    /// returns the node of the smallest item, or NULL if the list is empty.
+    const BinaryNode* GetRoot( ) const { return Head->GetRight( ); }
+
+    /// returns the node ending the list.
+    const BinaryNode* GetNullNode( ) const { return NULL; }
+
+    /// returns whether a given node has a left child: never.
+    int hasLeftChild( const BinaryNode* ) const { return 0; }
+
+    /// returns whether a given node has a right child: a next item.
+    int hasRightChild( const BinaryNode* T ) const { return T->GetRight( ) != NULL; }
+
+    /// returns the comparison object.
+    Cmp key_comp( ) const { return compare; }
+
+  private:
+
+    /// the comparison object.
+    Cmp compare;
+
+    /// first node, of height MaxLevel, holding no item.
+    BinaryNode* Head;
+
+    /// number of levels in use.
+    std::atomic<int> Top;
+
+    /// readers, waited for before freeing removed nodes.
+    mutable utlEpoch Epoch;
+
+    /// removed nodes, not freed yet, linked through RetiredNext.
+    std::atomic<BinaryNode*> Retired;
+
+    /// number of removed nodes, not freed yet.
+    std::atomic<int> RetiredCount;
+
+    /// serializes the threads freeing removed nodes.
+    std::mutex ReclaimLock;
+
+    /// last node found by Find.
+    mutable const BinaryNode* Current;
+
+    /// returned when an item is not found.
+    Etype ItemNotFound;
+
+    /// returns the height of a new node: 1 + i with probability 3/4^(i+1).
+    static int RandomLevel( ) {
+        static std::atomic<unsigned long long> Seeds( 0 );
+        static thread_local unsigned long long S =
+               0x9E3779B97F4A7C15ULL * ( Seeds.fetch_add( 1, std::memory_order_relaxed ) + 1 );
+        S ^= S << 13; S ^= S >> 7; S ^= S << 17;   // xorshift64
+        unsigned long long R = S;
+        int h = 1;
+        while ( h < MaxLevel && ( R & 3 ) == 0 ) { ++h; R >>= 2; }
+        return h;
+    }
+
+    /// returns whether item E comes before X, comparing pairs by key if Pairs.
+    int Before( const Etype& E, const Etype& X, int Pairs ) const {
+        return Pairs ? this->compare.neq( E, X ) && this->compare( E, X )
+                     : this->compare( E, X );
+    }
+
+    /** searches for X, and returns the last node before X, and the next
+     *  one, at each level. Marked nodes on the way are unlinked.
+     *  Must be called inside the epoch.
+     *
+     *  @param Pairs whether pairs are compared with operator neq.
+     *  @return true if the node after X at level 0 holds X.
+     */
+    int Search( const Etype& X, BinaryNode** Preds, BinaryNode** Succs, int Pairs = 0 ) {
+    retry:
+        BinaryNode* Pred = Head;
+        for ( int i = Top.load( ) - 1; i >= 0; --i ) {
+            BinaryNode* Curr = BinaryNode::Ptr( Pred->Next( i ).load( ) );
+            while ( Curr != NULL ) {
+                uintptr_t Succ = Curr->Next( i ).load( );
+                if ( BinaryNode::Marked( Succ ) ) {
+                     uintptr_t Expected = (uintptr_t) Curr;
+                     if ( !Pred->Next( i ).compare_exchange_strong( Expected, Succ & ~(uintptr_t) 1 ) )
+                          goto retry;
+                     Unlinked( Curr, 1 );
+                     Curr = BinaryNode::Ptr( Succ );
+                     continue;
+                }
+                if ( !Before( Curr->Element, X, Pairs ) ) break;
+                Pred = Curr;
+                Curr = BinaryNode::Ptr( Succ );
+            }
+            Preds[i] = Pred;
+            Succs[i] = Curr;
+        }
+        if ( Succs[0] == NULL ) return 0;
+        const Etype& E = Succs[0]->Element;
+        return Pairs ? !this->compare.neq( X, E ) : !this->compare( X, E );
+    }
+
+    /** searches for X, writing nothing. Marked nodes are stepped over:
+     *  their links are frozen, and the nodes after them cannot be freed
+     *  before this reader leaves the epoch.
+     *
+     *  @param X item to be searched for.
+     *  @param Pairs whether pairs are compared with operator neq.
+     *  @return node containing X or NULL.
+     */
+    const BinaryNode* Search( const Etype& X, int Pairs ) const {
+        const BinaryNode* Pred = Head;
+        const BinaryNode* Curr = NULL;
+        for ( int i = Top.load( ) - 1; i >= 0; --i ) {
+            Curr = BinaryNode::Ptr( Pred->Next( i ).load( ) );
+            while ( Curr != NULL ) {
+                uintptr_t Succ = Curr->Next( i ).load( );
+                if ( !BinaryNode::Marked( Succ ) ) {
+                     if ( !Before( Curr->Element, X, Pairs ) ) break;
+                     Pred = Curr;
+                }
+                Curr = BinaryNode::Ptr( Succ );
+            }
+        }
+        if ( Curr == NULL ) return NULL;
+        const Etype& E = Curr->Element;
+        return ( Pairs ? !this->compare.neq( X, E ) : !this->compare( X, E ) ) ? Curr : NULL;
+    }
+
+    /** returns the first node whose item is not before X, or, if upper
+     *  is set, after X; NULL if there is none. Marked nodes are stepped
+     *  over, as in Search. Must be called inside the epoch.
+     */
+    const BinaryNode* Bound( const Etype& X, int upper, int Pairs ) const {
+        const BinaryNode* Pred = Head;
+        const BinaryNode* Curr = NULL;
+        for ( int i = Top.load( ) - 1; i >= 0; --i ) {
+            Curr = BinaryNode::Ptr( Pred->Next( i ).load( ) );
+            while ( Curr != NULL ) {
+                uintptr_t Succ = Curr->Next( i ).load( );
+                if ( !BinaryNode::Marked( Succ ) ) {
+                     if ( upper ? Before( X, Curr->Element, Pairs ) 
+                                : !Before( Curr->Element, X, Pairs ) ) break;
+                     Pred = Curr;
+                }
+                Curr = BinaryNode::Ptr( Succ );
+            }
+        }
+        return Curr;
+    }
+
+    /** counts the unmarked items not before A and before B, or, if closed
+     *  is set, not after B. Must be called inside the epoch.
+     */
+    int CountBetween( const Etype& A, const Etype& B, int closed, int Pairs ) const {
+        int n = 0;
+        for ( const BinaryNode* Curr = Bound( A, 0, Pairs ); Curr != NULL; ) {
+            uintptr_t Succ = Curr->Next( 0 ).load( );
+            if ( !BinaryNode::Marked( Succ ) ) {
+                 if ( closed ? Before( B, Curr->Element, Pairs ) 
+                             : !Before( Curr->Element, B, Pairs ) ) break;
+                 ++n;
+            }
+            Curr = BinaryNode::Ptr( Succ );
+        }
+        return n;
+    }
+
+    /// returns the node of the largest item, or NULL. Must be called inside the epoch.
+    const BinaryNode* Last( ) const {
+        const BinaryNode* Pred = Head;
+        for ( int i = Top.load( ) - 1; i >= 0; --i ) {
+            const BinaryNode* Curr = BinaryNode::Ptr( Pred->Next( i ).load( ) );
+            while ( Curr != NULL ) {
+                uintptr_t Succ = Curr->Next( i ).load( );
+                if ( !BinaryNode::Marked( Succ ) ) Pred = Curr;
+                Curr = BinaryNode::Ptr( Succ );
+            }
+        }
+        return Pred != Head ? Pred : NULL;
+    }
+
+    /** inserts X, unless X, or a pair with its key if Pairs, is there.
+     *  Must be called inside the epoch.
+     */
+    int InsertNode( const Etype& X, int Pairs ) {
+        BinaryNode* Preds[MaxLevel];
+        BinaryNode* Succs[MaxLevel];
+        BinaryNode* N = NULL;
+        int H = RandomLevel( );
+
+        // searches must see the levels of N, before it is linked.
+        int t = Top.load( );
+        while ( t < H && !Top.compare_exchange_weak( t, H ) ) { }
+
+        for ( ; ; ) {
+            if ( Search( X, Preds, Succs, Pairs ) ) {
+                 if ( N != NULL ) BinaryNode::Free( N );
+                 return 0;
+            }
+            if ( N == NULL ) N = BinaryNode::Make( X, H );
+            for ( int i = 0; i < H; ++i )
+                  N->Next( i ).store( (uintptr_t) Succs[i], std::memory_order_relaxed );
+            uintptr_t Expected = (uintptr_t) Succs[0];
+            if ( Preds[0]->Next( 0 ).compare_exchange_strong( Expected, (uintptr_t) N ) )
+                 break;
+        }
+
+        // X is in the set: link the levels above, unless it is removed meanwhile.
+        for ( int i = 1; i < H; ++i ) {
+            if ( !LinkLevel( N, i, Preds, Succs ) ) {
+                 Unlinked( N, H - i );
+                 break;
+            }
+        }
+        if ( BinaryNode::Marked( N->Next( 0 ).load( ) ) )
+             Search( X, Preds, Succs );
+        return 1;
+    }
+
+    /** links N at level i, between Preds[i] and Succs[i], searching again
+     *  while they change.
+     *
+     *  @return false if N was removed meanwhile.
+     */
+    int LinkLevel( BinaryNode* N, int i, BinaryNode** Preds, BinaryNode** Succs ) {
+        for ( ; ; ) {
+            uintptr_t L = N->Next( i ).load( );
+            if ( BinaryNode::Marked( L ) ) return 0;
+            if ( L != (uintptr_t) Succs[i] &&
+                 !N->Next( i ).compare_exchange_strong( L, (uintptr_t) Succs[i] ) )
+                 return 0;
+            uintptr_t Expected = (uintptr_t) Succs[i];
+            if ( Preds[i]->Next( i ).compare_exchange_strong( Expected, (uintptr_t) N ) )
+                 return 1;
+            Search( N->Element, Preds, Succs );
+            if ( Succs[0] != N ) return 0;
+        }
+    }
+
+    /// removes X. Must be called inside the epoch.
+    int RemoveNode( const Etype& X ) {
+        BinaryNode* Preds[MaxLevel];
+        BinaryNode* Succs[MaxLevel];
+        if ( !Search( X, Preds, Succs ) ) return 0;
+
+        BinaryNode* N = Succs[0];
+        for ( int i = N->Height - 1; i > 0; --i ) {
+            uintptr_t L = N->Next( i ).load( );
+            while ( !BinaryNode::Marked( L ) )
+                    N->Next( i ).compare_exchange_weak( L, L | 1 );
+        }
+        uintptr_t L = N->Next( 0 ).load( );
+        while ( !BinaryNode::Marked( L ) ) {
+            if ( N->Next( 0 ).compare_exchange_weak( L, L | 1 ) ) {
+                 Search( X, Preds, Succs );   // unlinks N
+                 return 1;
+            }
+        }
+        return 0;   // removed by another thread
+    }
+
+    /// N left n levels: it is retired when it left all of them.
+    void Unlinked( BinaryNode* N, int n ) {
+        if ( N->Links.fetch_sub( n ) != n ) return;
+        BinaryNode* R = Retired.load( std::memory_order_relaxed );
+        do N->RetiredNext = R;
+        while ( !Retired.compare_exchange_weak( R, N ) );
+        RetiredCount.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    /** frees the removed nodes, if there are enough of them and no other
+     *  thread is doing it. Must be called outside the epoch.
+     */
+    void Collect( ) {
+        if ( RetiredCount.load( std::memory_order_relaxed ) < RetireBatch ) return;
+        std::unique_lock<std::mutex> lock( ReclaimLock, std::try_to_lock );
+        if ( !lock.owns_lock( ) ) return;
+        BinaryNode* N = Retired.exchange( NULL );
+        if ( N == NULL ) return;
+        Epoch.synchronize( );
+        RetiredCount.fetch_sub( Release( N ), std::memory_order_relaxed );
+    }
+
+    /// frees the removed nodes. No reader may see them.
+    void FreeRetired( ) {
+        RetiredCount.fetch_sub( Release( Retired.exchange( NULL ) ), std::memory_order_relaxed );
+    }
+
+    /// frees a list of removed nodes, and returns their number.
+    static int Release( BinaryNode* N ) {
+        int n = 0;
+        for ( ; N != NULL; ++n ) {
+            BinaryNode* Next = N->RetiredNext;
+            BinaryNode::Free( N );
+            N = Next;
+        }
+        return n;
+    }
+
+    /// unlinks every marked node. No other thread may use the list.
+    void Unlink( ) {
+        for ( int i = Top.load( ) - 1; i >= 0; --i ) {
+            BinaryNode* Pred = Head;
+            BinaryNode* Curr = BinaryNode::Ptr( Pred->Next( i ).load( ) );
+            while ( Curr != NULL ) {
+                uintptr_t Succ = Curr->Next( i ).load( );
+                if ( BinaryNode::Marked( Succ ) ) {
+                     Pred->Next( i ).store( Succ & ~(uintptr_t) 1 );
+                     Unlinked( Curr, 1 );
+                }
+                else
+                     Pred = Curr;
+                Curr = BinaryNode::Ptr( Succ );
+            }
+        }
+    }
+
+    /// replaces the items of the list by those of a range (see utlSortUnique).
+    template <class Iter, class Less>
+    int BuildList( Iter first, Iter last, const Less& L, int sort, int threads ) {
+        const Etype** P;
+        int n = utlSortUnique( first, last, L, sort, threads, P );
+        MakeEmpty( );
+        BinaryNode* Tails[MaxLevel];
+        for ( int i = 0; i < MaxLevel; ++i ) Tails[i] = Head;
+        int t = 1;
+        for ( int k = 0; k < n; ++k ) Append( *P[k], Tails, t );
+        Top.store( t );
+        delete [] P;
+        return n;
+    }
+
+    /// applies op to the sorted and distinct items of a range (see utlSortUnique).
+    template <class Iter, class Less>
+    int Batch( Iter first, Iter last, const Less& L, int (ConcurrentSkipList::*op)( const Etype& ), int threads ) {
+        const Etype** P;
+        int n = utlSortUnique( first, last, L, 1, threads, P );
+        int k = 0;
+        for ( int i = 0; i < n; ++i ) k += (this->*op)( *P[i] );
+        delete [] P;
+        return k;
+    }
+
+    /// appends the items of Rhs, in order, to this list, which must be empty.
+    void Append( const ConcurrentSkipList& Rhs ) {
+        BinaryNode* Tails[MaxLevel];
+        for ( int i = 0; i < MaxLevel; ++i ) Tails[i] = Head;
+        int t = 1;
+        for ( const BinaryNode* P = Rhs.GetRoot( ); P != NULL; P = P->GetRight( ) )
+            Append( P->Element, Tails, t );
+        Top.store( t );
+    }
+
+    /** appends X after the last nodes of each level, Tails, which are
+     *  updated, and raises t to the height of the new node.
+     */
+    void Append( const Etype& X, BinaryNode** Tails, int& t ) {
+        int H = RandomLevel( );
+        BinaryNode* N = BinaryNode::Make( X, H );
+        for ( int i = 0; i < H; ++i ) {
+              Tails[i]->Next( i ).store( (uintptr_t) N, std::memory_order_relaxed );
+              Tails[i] = N;
+        }
+        if ( H > t ) t = H;
+    }
+};
+
+/// the nodes of a skip list are chained in order.
+template <class Etype, class Cmp>
+struct utlLinearTree< ConcurrentSkipList<Etype,Cmp> > { enum { value = 1 }; };
+
+#endif
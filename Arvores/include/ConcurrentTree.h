@@ -0,0 +1,283 @@
+/*
+   ConcurrentTree.h
+
+   Search trees shared by several threads.
+*/
+#ifndef __ConcurrentTree
+#define __ConcurrentTree
+
+#include <new>
+#include "utlSharedLock.h"
+#include "Bst.h"
+
+/** ConcurrentTree class interface.
+ *
+ *  A search tree which may be used by several threads at the same time.
+ *  Reads share the tree, and writes have it for themselves, through a
+ *  utlSharedLock, which lets readers scale with the number of cores.
+ *
+ *  Reads use Lookup and LookupP, which write nothing into the tree:
+ *  neither Current, nor the NullNode, nor the shape of a SplayTree.
+ *  Since a node may go away as soon as the lock is released, items are
+ *  copied out, or handed to a function while the lock is held (Visit).
+ *
+ *  Several writes may be done under a single lock, through a WriteSection,
+ *  and several reads, or an iteration, through a ReadSection: <br>
+ *  { ConcurrentTree<T>::WriteSection W ( ct ); W->Insert( a ); W->Insert( b ); }
+ *
+ *  Tree: any search tree (SearchTree, AVLTree, StaticRedBlackTree, ...).
+ *  For a map, Tree holds utlPair<const Key,T> compared with compare_pair,
+ *  and items are searched by key with FindP and VisitP, as in utlMap::find. <br>
+ *  CONSTRUCTION: with (a) no initializer, or (b) a tree to be copied. <br>
+ *  Copying is not supported.
+ *
+ *  ******************PUBLIC OPERATIONS********************* <br>
+ *  int Insert( const Etype& X)  --> Insert X <br>
+ *  int Remove( const Etype& X)  --> Remove X <br>
+ *  int InsertBatch( first, last ) --> Insert the items of a range <br>
+ *  int RemoveBatch( first, last ) --> Remove the items of a range <br>
+ *  void MakeEmpty( )            --> Remove all items <br>
+ *  int IsFound( const Etype& X) --> Return 1 if X is found <br>
+ *  int Find( const Etype& X, Etype& R ) --> Copy item that matches X into R <br>
+ *  int FindP( const Etype& X, Etype& R ) --> Same, comparing pairs by key <br>
+ *  int Visit( const Etype& X, F f ) --> Call f on item that matches X <br>
+ *  int VisitP( const Etype& X, F f ) --> Same, comparing pairs by key <br>
+ *  int FindMin( Etype& R )      --> Copy smallest item into R <br>
+ *  int FindMax( Etype& R )      --> Copy largest item into R <br>
+ *  int IsEmpty( )               --> Return 1 if empty; else return 0 <br>
+ *  unsigned long long Contentions( ) --> Number of waits for the lock <br>
+ *  unsigned long long WaitTime( )    --> Time spent waiting, in ns <br>
+ *  ******************ERRORS******************************** <br>
+ *  Predefined exception is propagated if new fails. <br>
+ *
+ *  Indexed trees of the same node type share their NullNode, which is
+ *  never written: trees given to different threads, or shards, need
+ *  no lock but their own.
+ */
+template <class Tree>
+class ConcurrentTree
+{
+  public:
+
+  /// the tree type.
+  typedef Tree tree_type;
+
+  /// type of the items.
+  typedef typename Tree::value_type Etype;
+
+  /// a binary node definition.
+  typedef typename Tree::BinaryNode BinaryNode;
+
+  /// a shared lock on a tree, giving read access to it.
+  class ReadSection {
+    public:
+     /// acquires the lock for reading.
+     explicit ReadSection( const ConcurrentTree& C ) : CT( C ) { CT.Lock.lock_shared( ); }
+     /// releases the lock.
+     ~ReadSection( ) { CT.Lock.unlock_shared( ); }
+     /// returns the tree.
+     const Tree& operator * ( ) const { return CT.T; }
+     /// returns the tree.
+     const Tree* operator -> ( ) const { return &CT.T; }
+    private:
+     /// the locked tree.
+     const ConcurrentTree& CT;
+     /// not copyable.
+     ReadSection( const ReadSection& );
+     /// not assignable.
+     ReadSection& operator = ( const ReadSection& );
+  };
+
+  /// an exclusive lock on a tree, giving write access to it.
+  class WriteSection {
+    public:
+     /// acquires the lock for writing.
+     explicit WriteSection( ConcurrentTree& C ) : CT( C ) { CT.Lock.lock( ); }
+     /// releases the lock.
+     ~WriteSection( ) { CT.Lock.unlock( ); }
+     /// returns the tree.
+     Tree& operator * ( ) const { return CT.T; }
+     /// returns the tree.
+     Tree* operator -> ( ) const { return &CT.T; }
+    private:
+     /// the locked tree.
+     ConcurrentTree& CT;
+     /// not copyable.
+     WriteSection( const WriteSection& );
+     /// not assignable.
+     WriteSection& operator = ( const WriteSection& );
+  };
+
+  /** @name constructors  */
+  //@{
+
+    /// empty constructor.
+    ConcurrentTree( ) { }
+
+    /// constructor from a tree, which is copied.
+    explicit ConcurrentTree( const Tree& Rhs ) : T( Rhs ) { }
+
+  //@}
+
+    /** adds X into the tree. If X already present, do nothing.
+     *
+     *  @param X item to be inserted.
+     *	@return true if successful.
+     */
+    int Insert( const Etype& X )
+        { WriteSection W( *this ); return T.Insert( X ); }
+
+    /** removes X from the tree.
+     *
+     *  @param X item to be removed.
+     *	@return true if successful.
+     */
+    int Remove( const Etype& X )
+        { WriteSection W( *this ); return T.Remove( X ); }
+
+    /** inserts the items of a range, with the tree locked once
+     *  (see SearchTreeCore::InsertBatch).
+     *
+     *  @return number of items inserted.
+     */
+    template <class Iter>
+    int InsertBatch( Iter first, Iter last, int threads = 0 )
+        { WriteSection W( *this ); return T.InsertBatch( first, last, threads ); }
+
+    /** removes the items of a range, with the tree locked once
+     *  (see SearchTreeCore::RemoveBatch).
+     *
+     *  @return number of items removed.
+     */
+    template <class Iter>
+    int RemoveBatch( Iter first, Iter last, int threads = 0 )
+        { WriteSection W( *this ); return T.RemoveBatch( first, last, threads ); }
+
+    /// removes all items.
+    void MakeEmpty( )
+        { WriteSection W( *this ); T.MakeEmpty( ); }
+
+    /// returns whether X is into the tree.
+    int IsFound( const Etype& X ) const
+        { ReadSection R( *this ); return T.Lookup( X ) != NULL; }
+
+    /** copies the item that matches X.
+     *
+     *  @param X item to be searched for.
+     *  @param Result item found, unchanged if X is not found.
+     *  @return true if found.
+     */
+    int Find( const Etype& X, Etype& Result ) const
+        { return Visit( X, Assigner( Result ) ); }
+
+    /** copies the pair whose key matches the key of X.
+     *
+     *  @param X pair to be searched for.
+     *  @param Result pair found, unchanged if X is not found.
+     *  @return true if found.
+     */
+    int FindP( const Etype& X, Etype& Result ) const
+        { return VisitP( X, Assigner( Result ) ); }
+
+    /** calls f on the item that matches X, while the tree is locked.
+     *  f must not modify the tree.
+     *
+     *  @param X item to be searched for.
+     *  @param f function taking a const Etype&.
+     *  @return true if found.
+     */
+    template <class F>
+    int Visit( const Etype& X, F f ) const {
+        ReadSection R( *this );
+        const BinaryNode* P = T.Lookup( X );
+        if ( P == NULL ) return 0;
+        f( P->GetElement( ) );
+        return 1;
+    }
+
+    /** calls f on the pair whose key matches the key of X,
+     *  while the tree is locked. f must not modify the tree.
+     *
+     *  @param X pair to be searched for.
+     *  @param f function taking a const Etype&.
+     *  @return true if found.
+     */
+    template <class F>
+    int VisitP( const Etype& X, F f ) const {
+        ReadSection R( *this );
+        const BinaryNode* P = T.LookupP( X );
+        if ( P == NULL ) return 0;
+        f( P->GetElement( ) );
+        return 1;
+    }
+
+    /** copies the smallest item.
+     *
+     *  @return false if the tree is empty.
+     */
+    int FindMin( Etype& Result ) const {
+        ReadSection R( *this );
+        if ( T.IsEmpty( ) ) return 0;
+        Assigner A( Result ); A( T.FindMin( ) );
+        return 1;
+    }
+
+    /** copies the largest item.
+     *
+     *  @return false if the tree is empty.
+     */
+    int FindMax( Etype& Result ) const {
+        ReadSection R( *this );
+        if ( T.IsEmpty( ) ) return 0;
+        Assigner A( Result ); A( T.FindMax( ) );
+        return 1;
+    }
+
+    /// returns whether the tree is empty.
+    int IsEmpty( ) const
+        { ReadSection R( *this ); return T.IsEmpty( ); }
+
+    /// returns the number of times a thread had to wait for the tree.
+    unsigned long long Contentions( ) const { return Lock.contentions( ); }
+
+    /// returns the total time threads spent waiting for the tree, in nanoseconds.
+    unsigned long long WaitTime( ) const { return Lock.wait_time( ); }
+
+    /// sets the contention counters to zero.
+    void ResetCounters( ) { Lock.reset_counters( ); }
+
+  private:
+
+    /** copies an item into another one.
+     *  Items may have const members (utlPair<const Key,T>), so
+     *  they are copy constructed in place, as in BinNode::setElement.
+     */
+    class Assigner {
+      public:
+       /// constructor given the destination.
+       explicit Assigner( Etype& R ) : Result( R ) { }
+       /// copies E into the destination.
+       void operator ( ) ( const Etype& E ) const {
+           if ( &E == &Result ) return;
+           Result.~Etype( );
+           new(&Result) Etype( E );
+       }
+      private:
+       /// destination.
+       Etype& Result;
+    };
+
+    /// the tree.
+    Tree T;
+
+    /// the lock.
+    mutable utlSharedLock Lock;
+
+    /// not copyable.
+    ConcurrentTree( const ConcurrentTree& );
+
+    /// not assignable.
+    ConcurrentTree& operator = ( const ConcurrentTree& );
+};
+
+#endif
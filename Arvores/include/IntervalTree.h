@@ -0,0 +1,241 @@
+/*
+   IntervalTree.h
+
+   Interval trees, built on Red-Black trees.
+*/
+#ifndef __IntervalTree
+#define __IntervalTree
+
+#include <limits>
+#include "RedBlack.h"
+#include "utlIterate.h"
+
+/** a closed interval [low, high], low not after high.
+ *  Intervals are ordered by low, and then by high.
+ */
+template <class T>
+struct utlInterval {
+  /// type of the end points.
+  typedef T value_type;
+
+  /// empty constructor.
+  utlInterval ( ) : low ( T() ), high ( T() ) { }
+
+  /// constructor from the end points.
+  utlInterval ( const T& a, const T& b ) : low ( a ), high ( b ) { }
+
+  /// returns whether this interval and [a, b] have a point in common.
+  bool Overlaps ( const T& a, const T& b ) const { return !( b < low ) && !( high < a ); }
+
+  /// returns whether this interval comes before i.
+  bool operator < ( const utlInterval& i ) const
+     { return low < i.low || ( !( i.low < low ) && high < i.high ); }
+
+  /// returns whether this interval is the same as i.
+  bool operator == ( const utlInterval& i ) const
+     { return !( low < i.low ) && !( i.low < low ) && !( high < i.high ) && !( i.high < high ); }
+
+  /// first point.
+  T low;
+
+  /// last point.
+  T high;
+};
+
+/// the value aggregated for an interval: its last point (see utlMaxMonoid).
+template <class T>
+struct utlItemValue< utlInterval<T> > {
+  /// type of the value.
+  typedef T type;
+  /// returns the value of an interval.
+  static const type& get ( const utlInterval<T>& e ) { return e.high; }
+};
+
+/** IntervalIterator class interface: visits, in order, the intervals
+ *  of an IntervalTree which overlap a given interval [a, b].
+ *
+ *  Nothing is collected beforehand: the stack holds the nodes whose left
+ *  subtree is being visited, as for InOrder, and the subtrees whose last
+ *  point (their aggregate) comes before a are never entered, nor the
+ *  right subtrees of nodes starting after b.
+ *
+ * ******************PUBLIC OPERATIONS********************** <br>
+ * int operator+( )     	    --> True if at valid position in tree <br>
+ * const Etype& operator()( ) const --> Return interval in current position <br>
+ * void First( )        	    --> Set current position to first <br>
+ * void operator++( )   	    --> Advance (prefix) <br>
+ * ******************ERRORS********************************* <br>
+ * EXCEPTION is called for illegal access or advance. <br>
+ */
+template <class T, class Tree>
+class IntervalIterator : public TreeIterator<utlInterval<T>,compare_to<utlInterval<T> >,Tree>
+{
+  public:
+
+  /// base iterator.
+  typedef TreeIterator<utlInterval<T>,compare_to<utlInterval<T> >,Tree> Base;
+
+  /// a binary node definition.
+  typedef typename Base::BinaryNode BinaryNode;
+
+  /** @name constructors  */
+  //@{
+    /// constructor from a tree, and the interval [a, b] to be overlapped.
+    IntervalIterator( const Tree* TheTree, const T& a, const T& b ) :
+        Base( TheTree ), Low( a ), High( b ) { }
+
+    /// copy constructor.
+    IntervalIterator( const IntervalIterator& rhs ) :
+        Base( rhs ), Low( rhs.Low ), High( rhs.High ) {
+        S = rhs.S;
+    }
+
+    /// destructor.
+    ~IntervalIterator( ) { }
+  //@}
+
+    /// sets current position to the first overlapping interval.
+    virtual void First( ) {
+        if ( this->T == NULL ) return;
+    	while ( !S.empty() ) S.pop( );
+        this->Current = NULL;
+        PushLeft( this->T->GetRoot() );
+        Next( );
+    }
+
+    /// increment operator (prefix).
+    virtual void operator++( ) {
+        EXCEPTION( this->Current == NULL, "Advanced past end" );
+        Next( );
+    }
+
+    /// assignment operator.
+    IntervalIterator& operator = ( const IntervalIterator& rhs ) {
+        Base::operator = ( rhs );
+        Low = rhs.Low; High = rhs.High;
+        S = rhs.S;
+        return *this;
+    }
+
+  protected:
+
+    /// first point of the interval to be overlapped.
+    T Low;
+
+    /// last point of the interval to be overlapped.
+    T High;
+
+    /// stack holding the nodes starting not after High, whose left subtree is being visited.
+    utlStack< const BinaryNode* > S;
+
+    /// moves to the next popped node ending not before Low, or to NULL.
+    void Next( ) {
+        while ( !S.empty( ) ) {
+            const BinaryNode* node = S.top( );
+            S.pop( );
+            PushLeft( node->GetRight() );
+            if ( !( node->GetElement().high < Low ) ) {
+                 this->Current = node;
+                 return;
+            }
+        }
+        this->Current = NULL;
+    }
+
+    /** pushes node and its left descendants which start not after High,
+     *  while their subtrees have an interval ending not before Low.
+     */
+    void PushLeft( const BinaryNode* node ) {
+        const BinaryNode* Null = this->T->GetNullNode();
+        while ( node != Null && !( node->GetAggregate() < Low ) ) {
+            if ( !( High < node->GetElement().low ) )
+                 S.push( node );
+            node = node->GetLeft();
+        }
+    }
+};
+
+/** IntervalTree class interface: a set of closed intervals (see utlInterval),
+ *  answering which of them overlap a point, or another interval.
+ *
+ *  It is a RedBlackTree of intervals, ordered by their first points,
+ *  whose nodes also keep the largest last point of their subtree
+ *  (utlAugmented with utlMaxMonoid). The rotations, and every change of
+ *  the tree, recompute it from the children (see SearchTreeCore::Resize),
+ *  so the updates still take O(log n).
+ *
+ *  LookupOverlap finds one overlapping interval in O(log n). Overlapping
+ *  and Stabbing return an iterator over all of them, which only walks the
+ *  paths leading to the k intervals found: O(log n) for the first one,
+ *  and O(log n + k log(n/k)) for all of them, against O(n) for a scan.
+ *  This is the bound of an augmented search tree. O(log n + k) would
+ *  need the lists of intervals of a centered interval tree, which
+ *  could not be a RedBlackTree.
+ *
+ *  T: end points, with operator < and std::numeric_limits. <br>
+ *  Equal intervals are kept once, as in a set. The interval
+ *  [lowest, lowest] is the sentinel of the Red-Black tree, and cannot
+ *  be inserted (see RedBlackTree).
+ *
+ *  CONSTRUCTION: with no parameters. <br>
+ *
+ *  ******************PUBLIC OPERATIONS********************** <br>
+ *  Those of RedBlackTree, for intervals, and: <br>
+ *  LookupOverlap( a, b )    --> Return a node overlapping [a, b], or NULL <br>
+ *  iterator Overlapping( a, b ) --> Iterate over the intervals overlapping [a, b] <br>
+ *  iterator Stabbing( t )   --> Iterate over the intervals containing t <br>
+ */
+template <class T,
+          class Alloc=utlNodePool<BinNode<utlInterval<T>,compare_to<utlInterval<T> >,
+                                          utlAugmented<utlRBLayout,utlMaxMonoid<utlInterval<T>,T> > > > >
+class IntervalTree :
+   public StaticRedBlackTree<utlInterval<T>,compare_to<utlInterval<T> >,Alloc>
+{
+  public:
+
+  /// base Red-Black tree.
+  typedef StaticRedBlackTree<utlInterval<T>,compare_to<utlInterval<T> >,Alloc> Base;
+
+  /// a binary node definition.
+  typedef typename Base::BinaryNode BinaryNode;
+
+  /// type of the intervals.
+  typedef utlInterval<T> interval_type;
+
+  /// iterator over overlapping intervals.
+  typedef IntervalIterator<T,IntervalTree> iterator;
+
+    /// empty constructor.
+    IntervalTree( ) :
+       Base( interval_type( (std::numeric_limits<T>::lowest)(), (std::numeric_limits<T>::lowest)() ) ) { }
+
+    /** returns the node of an interval overlapping [a, b], or NULL.
+     *  A left subtree which ends before a holds no such interval; one which
+     *  does not holds one, if any, since no interval to the right starts earlier.
+     */
+    const BinaryNode* LookupOverlap( const T& a, const T& b ) const {
+        const BinaryNode* node = this->GetRoot();
+        const BinaryNode* Null = this->GetNullNode();
+        while ( node != Null ) {
+            if ( node->GetElement().Overlaps( a, b ) ) return node;
+            const BinaryNode* L = node->GetLeft();
+            node = ( L != Null && !( L->GetAggregate() < a ) ) ? L : node->GetRight();
+        }
+        return NULL;
+    }
+
+    /** returns an iterator positioned on the first interval overlapping [a, b].
+     *  It is not valid (operator+) if there is none. The tree must not
+     *  change while the iterator is in use.
+     */
+    iterator Overlapping( const T& a, const T& b ) const {
+        iterator itr( this, a, b );
+        itr.First( );
+        return itr;
+    }
+
+    /// returns an iterator on the intervals containing point t (see Overlapping).
+    iterator Stabbing( const T& t ) const { return Overlapping( t, t ); }
+};
+
+#endif
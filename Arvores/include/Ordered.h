@@ -30,8 +30,8 @@
  *  Etype: must have zero-parameter and copy constructor,
  *     and must have operator. <br>
  *  CONSTRUCTION: with (a) no initializer; <br>
- *  Copy construction of OrderedSearchTree objects is DISALLOWED. <br>
- *  Deep copy is supported.
+ *  Copy construction and assignment are supported. Copies share
+ *  their nodes until one of them is changed (see SearchTreeCore::Share).
  *
  *  ******************PUBLIC OPERATIONS********************* <br>
  *  int Insert( const Etype& X )  --> Insert X <br>
@@ -53,24 +53,32 @@
  *  ******************ERRORS******************************** <br>
  *  Predefined exception is propagated if new fails. <br>
  *  ItemNotFound returned on various degenerate conditions. <br>
+ *
+ *  OrderedSearchTreeCore has no virtual function. OrderedSearchTree adds
+ *  the AbsBst interface to it, and StaticOrderedSearchTree does not 
+ *  (see SearchTreeCore).
  */
 
-template <class Etype, class Cmp=compare_to<Etype> >
-class OrderedSearchTree : public SearchTree<Etype,Cmp>
+template <class Derived, class Etype, class Cmp, class Alloc>
+class OrderedSearchTreeCore : public SearchTreeCore<Derived,Etype,Cmp,Alloc>
 {
+  /// the core builds trees through SetBalance.
+  friend class SearchTreeCore<Derived,Etype,Cmp,Alloc>;
+
   public:
 
   /// a binary node definition.
-  typedef typename SearchTree<Etype,Cmp>::BinaryNode BinaryNode;
+  typedef typename SearchTreeCore<Derived,Etype,Cmp,Alloc>::BinaryNode BinaryNode;
+
+  /// a link between nodes.
+  typedef typename SearchTreeCore<Derived,Etype,Cmp,Alloc>::Link Link;
 
   /** @name constructors  */ 
   //@{
 
     /// empty constructor.
-    OrderedSearchTree( ) { }
-
-    /// destructor.
-    virtual ~OrderedSearchTree () { }
+    OrderedSearchTreeCore( const Cmp& comp = Cmp() ) : 
+        SearchTreeCore<Derived,Etype,Cmp,Alloc>( comp ) { }
   //@}
 
     /** returns kth smallest item in tree.
@@ -91,8 +99,8 @@ class OrderedSearchTree : public SearchTree<Etype,Cmp>
      *
      * 	@return true if insertion was successful.
      */
-    virtual int Insert( const Etype& X )
-        { return Insert( X, this->Root ); }
+    int Insert( const Etype& X )
+        { this->Unshare( X ); return Insert( X, this->Root ); }
 
     /** removes X from the tree. 
      *  If we attempt to inherit the public Remove from SearchTree,
@@ -101,8 +109,8 @@ class OrderedSearchTree : public SearchTree<Etype,Cmp>
      *
      *	@return true if successful.
      */
-    virtual int Remove( const Etype& X )
-        { return Remove( X, this->Root ); }
+    int Remove( const Etype& X )
+        { this->Unshare( X ); return Remove( X, this->Root ); }
 
     /** removes minimum item from the tree. 
      *  If we attempt to inherit the public RemoveMin from SearchTree,
@@ -111,33 +119,39 @@ class OrderedSearchTree : public SearchTree<Etype,Cmp>
      *
      *  @return true if successful.
      */
-    virtual int RemoveMin( )
-        { return RemoveMin( this->Root ); }
+    int RemoveMin( )
+        { this->Unshare( this->FindMin( ) ); return RemoveMin( this->Root ); }
 
     /** computes the size of a node.
      *  The size is the number of descendents of a node
      *  (including itself).
      */
-    virtual int Size ( const BinaryNode* T ) const {
+    int Size ( const BinaryNode* T ) const {
     	if ( T == this->NullNode )
              return 0;
         else
     	     return T->Size;
     }
 
+    /// Size reads the Size field, which the tree keeps (see SearchTreeCore::CountRange).
+    enum { KnowsSizes = 1 };
+
     /// returns tree size.
     int TreeSize( ) const { return (this->Root != this->NullNode ? this->Root->Size : 0); }
 
   private:
+
+    /// sets the size of a node made by SearchTreeCore::MakeTree.
+    void SetBalance( BinaryNode* T, int n ) { T->Size = n; }
     
     /** Internal Insert routine for OrderedSearchTree.
      *  Add X into tree rooted at T.
      *
      *  @return true unless X is a duplicate.
      */
-    virtual int Insert( const Etype& X, BinaryNode*& T ) {
+    int Insert( const Etype& X, Link& T ) {
     	if( T == this->NullNode )
-            return ( T = new BinaryNode( X ) ) != this->NullNode;
+            return ( T = this->MakeNode( X ) ) != this->NullNode;
     	else if( this->compare (X, T->Element) )
             return Insert( X, T->Left ) ? ++T->Size : 0;
     	else if( this->compare (T->Element, X) )
@@ -151,7 +165,7 @@ class OrderedSearchTree : public SearchTree<Etype,Cmp>
      *
      *  @return true if X was found and false otherwise.
      */
-    virtual int Remove( const Etype& X, BinaryNode*& T ) {
+    int Remove( const Etype& X, Link& T ) {
     	BinaryNode* Tmp = this->NullNode;
 
     	if ( T == this->NullNode )
@@ -171,7 +185,7 @@ class OrderedSearchTree : public SearchTree<Etype,Cmp>
         // One or zero children
     	Tmp = T;
     	T = ( T->Left != this->NullNode ) ? T->Left : T->Right;
-    	delete Tmp;
+    	this->FreeNode( Tmp );
     	return 1;
     }
 
@@ -180,7 +194,7 @@ class OrderedSearchTree : public SearchTree<Etype,Cmp>
      *
      *  @return true if tree was not empty prior to removal.
      */
-    virtual int RemoveMin( BinaryNode*& T ) {
+    int RemoveMin( Link& T ) {
     	if( T == this->NullNode )
             return 0;
     	else if( T->Left != NULL )
@@ -188,7 +202,7 @@ class OrderedSearchTree : public SearchTree<Etype,Cmp>
 
     	BinaryNode* Tmp = T;
     	T = T->Right;
-    	delete Tmp;
+    	this->FreeNode( Tmp );
     	return 1;
     }
 
@@ -211,4 +225,32 @@ class OrderedSearchTree : public SearchTree<Etype,Cmp>
     }
 };
 
+/// ordered search tree with the virtual AbsBst interface.
+template <class Etype, class Cmp=compare_to<Etype>,
+          class Alloc=utlNodePool<BinNode<Etype,Cmp> > >
+class OrderedSearchTree : 
+   public AbsBstAdapter<OrderedSearchTreeCore<OrderedSearchTree<Etype,Cmp,Alloc>,
+                                              Etype,Cmp,Alloc>,Etype,Cmp>
+{
+  public:
+
+    /// empty constructor.
+    OrderedSearchTree( const Cmp& comp = Cmp() ) : 
+        AbsBstAdapter<OrderedSearchTreeCore<OrderedSearchTree,Etype,Cmp,Alloc>,
+                      Etype,Cmp>( comp ) { }
+};
+
+/// ordered search tree without virtual functions.
+template <class Etype, class Cmp=compare_to<Etype>,
+          class Alloc=utlNodePool<BinNode<Etype,Cmp> > >
+class StaticOrderedSearchTree : 
+   public OrderedSearchTreeCore<StaticOrderedSearchTree<Etype,Cmp,Alloc>,Etype,Cmp,Alloc>
+{
+  public:
+
+    /// empty constructor.
+    StaticOrderedSearchTree( const Cmp& comp = Cmp() ) : 
+        OrderedSearchTreeCore<StaticOrderedSearchTree,Etype,Cmp,Alloc>( comp ) { }
+};
+
 #endif
@@ -0,0 +1,494 @@
+/*
+   PersistentAVLTree.h
+
+   Persistent AVL trees, whose versions share their nodes.
+*/
+#ifndef __PersistentAVLTree
+#define __PersistentAVLTree
+
+#include <atomic>
+#include <mutex>
+#include "utlSorter.h"
+
+template <class Etype, class Cmp> class PersistentSnapshot;
+template <class Etype, class Cmp> class PersistentAVLTree;
+
+/** PersistentNode class interface: a node of a PersistentAVLTree.
+ *
+ *  A node never changes once made, and may belong to several versions
+ *  of the tree. It counts the references to it: from its parents in
+ *  every version, and from the snapshots whose root it is. The last
+ *  one to go frees it, and releases its children.
+ *
+ *  Nodes are allocated with new, and not from a utlNodePool, since the
+ *  last reference may be dropped by any thread.
+ */
+template <class Etype>
+class PersistentNode
+{
+    template <class E, class C> friend class PersistentSnapshot;
+    template <class E, class C> friend class PersistentAVLTree;
+
+  public:
+
+    /// returns the item.
+    const Etype& GetElement( ) const { return Element; }
+
+    /// returns the left child, or NULL.
+    const PersistentNode* GetLeft( ) const { return Left; }
+
+    /// returns the right child, or NULL.
+    const PersistentNode* GetRight( ) const { return Right; }
+
+    /// returns the height of the subtree: 1 for a leaf.
+    int GetHeight( ) const { return Height; }
+
+    /// returns the number of nodes of the subtree.
+    int GetSize( ) const { return Size; }
+
+  private:
+
+    /// the item.
+    const Etype Element;
+
+    /// left child.
+    const PersistentNode* const Left;
+
+    /// right child.
+    const PersistentNode* const Right;
+
+    /// height of the subtree.
+    const int Height;
+
+    /// number of nodes of the subtree.
+    const int Size;
+
+    /// number of references to this node.
+    mutable std::atomic<int> Refs;
+
+    /// constructor. The references to L and R are taken over by the node.
+    PersistentNode( const Etype& E, const PersistentNode* L, const PersistentNode* R ) :
+        Element( E ), Left( L ), Right( R ),
+        Height( 1 + ( HeightOf( L ) > HeightOf( R ) ? HeightOf( L ) : HeightOf( R ) ) ),
+        Size( 1 + SizeOf( L ) + SizeOf( R ) ), Refs( 1 ) { }
+
+    /// returns the height of T, 0 if T is NULL.
+    static int HeightOf( const PersistentNode* T ) { return T != NULL ? T->Height : 0; }
+
+    /// returns the size of T, 0 if T is NULL.
+    static int SizeOf( const PersistentNode* T ) { return T != NULL ? T->Size : 0; }
+
+    /// adds a reference to T, and returns it.
+    static const PersistentNode* Ref( const PersistentNode* T ) {
+        if ( T != NULL ) T->Refs.fetch_add( 1, std::memory_order_relaxed );
+        return T;
+    }
+
+    /** drops a reference to T. The nodes left without any are freed,
+     *  going down the right spine in a loop, and the left ones recursively.
+     */
+    static void Release( const PersistentNode* T ) {
+        while ( T != NULL && T->Refs.fetch_sub( 1, std::memory_order_acq_rel ) == 1 ) {
+            const PersistentNode* R = T->Right;
+            Release( T->Left );
+            delete T;
+            T = R;
+        }
+    }
+
+    /// not copyable.
+    PersistentNode( const PersistentNode& );
+
+    /// not assignable.
+    PersistentNode& operator = ( const PersistentNode& );
+};
+
+/** PersistentSnapshot class interface: a version of a PersistentAVLTree.
+ *
+ *  A snapshot holds a reference to the root of the version, and thus
+ *  to all of its nodes, which never change. Taking, copying and dropping
+ *  a snapshot take O(1), whatever the size of the tree, and it may be
+ *  read by any number of threads, while the tree keeps changing.
+ *
+ *  ******************PUBLIC OPERATIONS********************* <br>
+ *  int IsFound( const Etype& X ) --> Return 1 if X is found <br>
+ *  int IsFoundP( const Etype& X ) --> Same, comparing pairs by key <br>
+ *  BinaryNode* Lookup( const Etype& X ) --> Return node holding X, or NULL <br>
+ *  BinaryNode* LookupP( const Etype& X ) --> Same, comparing pairs by key <br>
+ *  BinaryNode* LowerBound( const Etype& X ) --> Return first node not before X, or NULL <br>
+ *  Etype FindMin( )              --> Return smallest item <br>
+ *  Etype FindMax( )              --> Return largest item <br>
+ *  int IsEmpty( )                --> Return 1 if empty; else return 0 <br>
+ *  int Size( )                   --> Return the number of items <br>
+ *  void ForEach( F f )           --> Call f on every item, in order <br>
+ *  BinaryNode* GetRoot( )        --> Return root node, or NULL <br>
+ */
+template <class Etype, class Cmp=compare_to<Etype> >
+class PersistentSnapshot
+{
+    friend class PersistentAVLTree<Etype,Cmp>;
+
+  public:
+
+  /// a binary node definition.
+  typedef PersistentNode<Etype> BinaryNode;
+
+  /** @name constructors  */
+  //@{
+
+    /// empty constructor: a version without items.
+    PersistentSnapshot( const Cmp& comp = Cmp() ) :
+        Root( NULL ), ItemNotFound( Etype() ), compare( comp ) { }
+
+    /// copy constructor. Nothing is copied but the root.
+    PersistentSnapshot( const PersistentSnapshot& Rhs ) :
+        Root( BinaryNode::Ref( Rhs.Root ) ), ItemNotFound( Rhs.ItemNotFound ), compare( Rhs.compare ) { }
+
+    /// destructor. Frees the nodes which no other version shares.
+    ~PersistentSnapshot( ) { BinaryNode::Release( Root ); }
+
+  //@}
+
+    /// assignment operator.
+    PersistentSnapshot& operator = ( const PersistentSnapshot& Rhs ) {
+        const BinaryNode* Old = Root;
+        Root = BinaryNode::Ref( Rhs.Root );
+        compare = Rhs.compare;
+        BinaryNode::Release( Old );
+        return *this;
+    }
+
+    /// returns true if X is in this version.
+    int IsFound( const Etype& X ) const { return Lookup( X ) != NULL; }
+
+    /// returns true if a pair whose key matches the key of X is in this version.
+    int IsFoundP( const Etype& X ) const { return LookupP( X ) != NULL; }
+
+    /** returns the node holding X, or NULL if X is not in this version.
+     *  It stays valid as long as this snapshot.
+     */
+    const BinaryNode* Lookup( const Etype& X ) const
+        { return Search( X, utlDerefLess<Etype,Cmp>( compare ) ); }
+
+    /** returns the node holding the pair whose key matches the key of X, or NULL.
+     *  Version specialized for pairs, since it uses operator neq.
+     */
+    const BinaryNode* LookupP( const Etype& X ) const
+        { return Search( X, utlDerefLessP<Etype,Cmp>( compare ) ); }
+
+    /// returns the node of the first item not before X, or NULL.
+    const BinaryNode* LowerBound( const Etype& X ) const {
+        const BinaryNode* Bound = NULL;
+        for ( const BinaryNode* T = Root; T != NULL; )
+            if ( compare( T->Element, X ) )
+                 T = T->Right;
+            else {
+                 Bound = T;
+                 T = T->Left;
+            }
+        return Bound;
+    }
+
+    /** returns minimum item.
+     *
+     *	@return ItemNotFound if this version is empty.
+     */
+    const Etype& FindMin( ) const {
+        const BinaryNode* T = Root;
+        if ( T == NULL ) return ItemNotFound;
+        while ( T->Left != NULL ) T = T->Left;
+        return T->Element;
+    }
+
+    /** returns maximum item.
+     *
+     *	@return ItemNotFound if this version is empty.
+     */
+    const Etype& FindMax( ) const {
+        const BinaryNode* T = Root;
+        if ( T == NULL ) return ItemNotFound;
+        while ( T->Right != NULL ) T = T->Right;
+        return T->Element;
+    }
+
+    /// returns whether this version has no items.
+    int IsEmpty( ) const { return Root == NULL; }
+
+    /// returns the number of items, in O(1).
+    int Size( ) const { return BinaryNode::SizeOf( Root ); }
+
+    /** calls f on every item, in order.
+     *
+     *  @param f function taking a const Etype&.
+     */
+    template <class F>
+    void ForEach( F f ) const { ForEach( Root, f ); }
+
+    /// returns the root node, or NULL.
+    const BinaryNode* GetRoot( ) const { return Root; }
+
+    /// returns the node standing for no node: NULL.
+    const BinaryNode* GetNullNode( ) const { return NULL; }
+
+  protected:
+
+    /// root of this version.
+    const BinaryNode* Root;
+
+    /// item returned by FindMin and FindMax if empty.
+    const Etype ItemNotFound;
+
+    /// comparison object.
+    Cmp compare;
+
+    /// constructor from a root, whose reference is taken over.
+    PersistentSnapshot( const BinaryNode* T, const Cmp& comp ) :
+        Root( T ), ItemNotFound( Etype() ), compare( comp ) { }
+
+    /// returns the node holding an item equivalent to X, as ordered by less, or NULL.
+    template <class Less>
+    const BinaryNode* Search( const Etype& X, const Less& less ) const {
+        const BinaryNode* T = Root;
+        while ( T != NULL )
+            if ( less( &X, &T->Element ) )
+                 T = T->Left;
+            else if ( less( &T->Element, &X ) )
+                 T = T->Right;
+            else
+                 break;
+        return T;
+    }
+
+    /// calls f on the items of T, in order.
+    template <class F>
+    static void ForEach( const BinaryNode* T, F& f ) {
+        for ( ; T != NULL; T = T->Right ) {
+            ForEach( T->Left, f );
+            f( T->Element );
+        }
+    }
+};
+
+/** PersistentAVLTree class interface.
+ *
+ *  An AVL tree whose every change makes a new version, and keeps the
+ *  previous ones readable through snapshots (multiversion concurrency).
+ *  A change copies the O(log n) nodes on the path to the item, rebuilding
+ *  the rotations out of new nodes too, and the new version shares all the
+ *  other nodes with the previous one (path copying). Nodes are reference
+ *  counted, and freed once no version uses them anymore.
+ *
+ *  TakeSnapshot returns the current version in O(1), instead of the
+ *  O(n) copy of an AVLTree, and Restore goes back to any of them, in O(1)
+ *  too. Copying a PersistentAVLTree only takes a snapshot.
+ *
+ *  AVLTreeCore rebalances in place, so this is a tree of its own.
+ *  Searches are those of PersistentSnapshot, on the current version.
+ *
+ *  Etype: must have zero-parameter and copy constructor,
+ *     and must have operator< <br>
+ *  CONSTRUCTION: with (a) no initializer <br>
+ *
+ *  ******************PUBLIC OPERATIONS********************* <br>
+ *  int Insert( const Etype& X )  --> Insert X <br>
+ *  int InsertP( const Etype& X ) --> Insert X, unless its key is there <br>
+ *  int Remove( const Etype& X )  --> Remove X <br>
+ *  int RemoveP( const Etype& X ) --> Remove pair whose key matches X <br>
+ *  void MakeEmpty( )             --> Remove all items <br>
+ *  Snapshot TakeSnapshot( )      --> Return the current version <br>
+ *  void Restore( const Snapshot& s ) --> Make s the current version <br>
+ *  ------------- Inherited ----------------------------- <br>
+ *  Those of PersistentSnapshot. <br>
+ *  ******************ERRORS********************************  <br>
+ *  Predefined exception is propagated if new fails. <br>
+ *
+ *  Writers are serialized by a mutex, and TakeSnapshot may be called
+ *  from any thread. Other threads read through snapshots, and not
+ *  through the inherited searches, which read the current version.
+ */
+template <class Etype, class Cmp=compare_to<Etype> >
+class PersistentAVLTree : public PersistentSnapshot<Etype,Cmp>
+{
+  public:
+
+  /// a version of the tree.
+  typedef PersistentSnapshot<Etype,Cmp> Snapshot;
+
+  /// a binary node definition.
+  typedef typename Snapshot::BinaryNode BinaryNode;
+
+  /** @name constructors  */
+  //@{
+
+    /// empty constructor.
+    PersistentAVLTree( const Cmp& comp = Cmp() ) : Snapshot( comp ) { }
+
+    /// copy constructor: the trees share the current version of Rhs.
+    PersistentAVLTree( const PersistentAVLTree& Rhs ) : Snapshot( Rhs.TakeSnapshot() ) { }
+
+  //@}
+
+    /// assignment operator: the trees share the current version of Rhs.
+    const PersistentAVLTree& operator = ( const PersistentAVLTree& Rhs ) {
+        if ( this != &Rhs ) Restore( Rhs.TakeSnapshot() );
+        return *this;
+    }
+
+    /// returns the current version, in O(1).
+    Snapshot TakeSnapshot( ) const {
+        std::lock_guard<std::mutex> guard( RootLock );
+        return Snapshot( BinaryNode::Ref( this->Root ), this->compare );
+    }
+
+    /// makes s the current version, in O(1).
+    void Restore( const Snapshot& s ) {
+        std::lock_guard<std::mutex> guard( WriteLock );
+        Publish( BinaryNode::Ref( s.Root ) );
+    }
+
+    /** adds X into the tree. If X already present, do nothing.
+     *
+     *  @param X item to be inserted.
+     *	@return true if insertion was successful.
+     */
+    int Insert( const Etype& X )
+        { return Insert( X, utlDerefLess<Etype,Cmp>( this->compare ) ); }
+
+    /** adds X into the tree, unless there is a pair with the key of X.
+     *  Version specialized for pairs, since it uses operator neq.
+     */
+    int InsertP( const Etype& X )
+        { return Insert( X, utlDerefLessP<Etype,Cmp>( this->compare ) ); }
+
+    /** removes X from tree.
+     *
+     *  @param X item to be removed.
+     *	@return 1 if X was found, and 0 otherwise.
+     */
+    int Remove( const Etype& X )
+        { return Remove( X, utlDerefLess<Etype,Cmp>( this->compare ) ); }
+
+    /** removes the pair whose key matches the key of X.
+     *  Version specialized for pairs, since it uses operator neq.
+     */
+    int RemoveP( const Etype& X )
+        { return Remove( X, utlDerefLessP<Etype,Cmp>( this->compare ) ); }
+
+    /// makes the current version empty. The snapshots keep their items.
+    void MakeEmpty( ) {
+        std::lock_guard<std::mutex> guard( WriteLock );
+        Publish( NULL );
+    }
+
+  private:
+
+    /// serializes the writers.
+    std::mutex WriteLock;
+
+    /// guards the root against TakeSnapshot while it is replaced.
+    mutable std::mutex RootLock;
+
+    /// makes T the current root, whose reference is taken over, and releases the previous one.
+    void Publish( const BinaryNode* T ) {
+        const BinaryNode* Old;
+        {
+            std::lock_guard<std::mutex> guard( RootLock );
+            Old = this->Root;
+            this->Root = T;
+        }
+        BinaryNode::Release( Old );
+    }
+
+    /// adds X, unless an item equivalent to it, as ordered by less, is there.
+    template <class Less>
+    int Insert( const Etype& X, const Less& less ) {
+        std::lock_guard<std::mutex> guard( WriteLock );
+        if ( this->Search( X, less ) != NULL ) return 0;
+        Publish( Insert( this->Root, X, less ) );
+        return 1;
+    }
+
+    /// removes the item equivalent to X, as ordered by less.
+    template <class Less>
+    int Remove( const Etype& X, const Less& less ) {
+        std::lock_guard<std::mutex> guard( WriteLock );
+        if ( this->Search( X, less ) == NULL ) return 0;
+        Publish( Remove( this->Root, X, less ) );
+        return 1;
+    }
+
+    /// returns a new subtree: T, which does not hold X, with X added.
+    template <class Less>
+    static const BinaryNode* Insert( const BinaryNode* T, const Etype& X, const Less& less ) {
+        if ( T == NULL )
+             return new BinaryNode( X, NULL, NULL );
+        if ( less( &X, &T->Element ) )
+             return Balance( T->Element, Insert( T->Left, X, less ), BinaryNode::Ref( T->Right ) );
+        else
+             return Balance( T->Element, BinaryNode::Ref( T->Left ), Insert( T->Right, X, less ) );
+    }
+
+    /** returns a new subtree: T, which holds X, without X. A node with
+     *  two children is replaced by a copy of its successor.
+     */
+    template <class Less>
+    static const BinaryNode* Remove( const BinaryNode* T, const Etype& X, const Less& less ) {
+        if ( less( &X, &T->Element ) )
+             return Balance( T->Element, Remove( T->Left, X, less ), BinaryNode::Ref( T->Right ) );
+        if ( less( &T->Element, &X ) )
+             return Balance( T->Element, BinaryNode::Ref( T->Left ), Remove( T->Right, X, less ) );
+        if ( T->Left == NULL )
+             return BinaryNode::Ref( T->Right );
+        if ( T->Right == NULL )
+             return BinaryNode::Ref( T->Left );
+        const BinaryNode* Min = T->Right;
+        while ( Min->Left != NULL ) Min = Min->Left;
+        return Balance( Min->Element, BinaryNode::Ref( T->Left ), RemoveMin( T->Right ) );
+    }
+
+    /// returns a new subtree: T without its smallest item.
+    static const BinaryNode* RemoveMin( const BinaryNode* T ) {
+        if ( T->Left == NULL )
+             return BinaryNode::Ref( T->Right );
+        return Balance( T->Element, RemoveMin( T->Left ), BinaryNode::Ref( T->Right ) );
+    }
+
+    /** returns a new node holding X, with subtrees L and R, whose references
+     *  are taken over. Their heights may differ by 2, after an insertion
+     *  or a removal: the node is then rotated, as in AVLTreeCore::Balance,
+     *  but the nodes moved are made anew, and the taller child released.
+     */
+    static const BinaryNode* Balance( const Etype& X, const BinaryNode* L, const BinaryNode* R ) {
+        const BinaryNode* T;
+        int hl = BinaryNode::HeightOf( L ), hr = BinaryNode::HeightOf( R );
+        if ( hl > hr + 1 ) {
+             const BinaryNode* LL = L->Left;
+             const BinaryNode* LR = L->Right;
+             if ( BinaryNode::HeightOf( LL ) >= BinaryNode::HeightOf( LR ) )	// single rotation
+                  T = new BinaryNode( L->Element, BinaryNode::Ref( LL ),
+                                      new BinaryNode( X, BinaryNode::Ref( LR ), R ) );
+             else							// double rotation
+                  T = new BinaryNode( LR->Element,
+                                      new BinaryNode( L->Element, BinaryNode::Ref( LL ), BinaryNode::Ref( LR->Left ) ),
+                                      new BinaryNode( X, BinaryNode::Ref( LR->Right ), R ) );
+             BinaryNode::Release( L );
+        }
+        else if ( hr > hl + 1 ) {
+             const BinaryNode* RL = R->Left;
+             const BinaryNode* RR = R->Right;
+             if ( BinaryNode::HeightOf( RR ) >= BinaryNode::HeightOf( RL ) )
+                  T = new BinaryNode( R->Element,
+                                      new BinaryNode( X, L, BinaryNode::Ref( RL ) ), BinaryNode::Ref( RR ) );
+             else
+                  T = new BinaryNode( RL->Element,
+                                      new BinaryNode( X, L, BinaryNode::Ref( RL->Left ) ),
+                                      new BinaryNode( R->Element, BinaryNode::Ref( RL->Right ), BinaryNode::Ref( RR ) ) );
+             BinaryNode::Release( R );
+        }
+        else
+             T = new BinaryNode( X, L, R );
+        return T;
+    }
+};
+
+#endif
@@ -41,65 +41,90 @@
  *  Etype: must have zero-parameter and copy constructor,
  *     and must have operator<, operator!=, and operator= <br>
  *  CONSTRUCTION: with (a) Negative infinity sentinel. <br>
- *  Deep copy is supported.
+ *  Copies share their nodes until one of them is changed, and then
+ *  copy the path of the change only (see SearchTreeCore::Share).
  *
  *  ******************PUBLIC OPERATIONS********************* <br>
  *  int Insert( const Etype& X )  --> Insert X <br>
- *  Etype Find( const Etype& X )  --> Return item that matches X <br>
  *  int IsEmpty( )         	  --> Return 1 if empty; else return 0 <br>
  *  void MakeEmpty( )     	  --> Remove all items <br>
  *  BinayNode<Etype>* GetRoot()   --> Return root node <br>
+ *  void Join( T1, X, T2 )        --> Make tree from T1, X and T2 <br>
+ *  int Split( X, Less, Greater ) --> Move items below/above X into two trees <br>
  *  ------------- Inherited ----------------------------- <br>
+ *  Etype Find( const Etype& X )  --> Return item that matches X <br> 
+ *  BinaryNode* Lookup( const Etype& X ) --> Return node holding X, or NULL <br>
  *  int WasFound( )        	  --> Return 1 if last Find succeeded <br>
  *  int IsFound( const Etype& X ) --> Return 1 if X would be found <br>
  *  Etype FindMin( )       	  --> Return smallest item <br>
  *  Etype FindMax( )       	  --> Return largest item <br>
  *  int Height( const BinaryNode* T ) --> Calculates the height of a node <br>
  *  int Size ( const BinaryNode* T )  --> Calculates the size of a node <br>
+ *  Etype FindKth( int K )        --> Return Kth smallest item (see utlCounted) <br>
+ *  int Rank( const Etype& X )    --> Number of items before X (see utlCounted) <br>
+ *  RangeAggregate( A, B )        --> Aggregate of the items in [A, B] (see utlAugmented) <br>
  *  ******************ERRORS******************************** <br>
  *  Predefined exception is propagated if new fails. <br>
  *  Item in NullNode returned on various degenerate conditions. <br>
+ *
+ *  Join and Split take O(log n): nodes are moved, not copied, and
+ *  the trees involved share their NullNode (see ShareNullNode).
+ *  Union, Intersection and Difference join subtrees as well.
+ *
+ *  RedBlackTreeCore has no virtual function. RedBlackTree adds the AbsBst 
+ *  interface to it, and StaticRedBlackTree does not (see SearchTreeCore).
  */
 
-template <class Etype, class Cmp=compare_to<Etype> >
-class RedBlackTree : public SearchTree<Etype, Cmp>
+template <class Derived, class Etype, class Cmp, class Alloc>
+class RedBlackTreeCore : public SearchTreeCore<Derived,Etype,Cmp,Alloc>
 {
-  /// a binary node definition.
-  typedef typename SearchTree<Etype,Cmp>::BinaryNode BinaryNode;
+  /// the core builds trees through SetTree and SetBalance.
+  friend class SearchTreeCore<Derived,Etype,Cmp,Alloc>;
 
   public:
+
+  /// a binary node definition.
+  typedef typename SearchTreeCore<Derived,Etype,Cmp,Alloc>::BinaryNode BinaryNode;
+
+  /// a link between nodes.
+  typedef typename SearchTreeCore<Derived,Etype,Cmp,Alloc>::Link Link;
+
   /** @name constructors  */ 
   //@{
     /// constructor from a negative sentinel.
-    RedBlackTree( const Etype& NegInf, const Cmp& comp = Cmp() ) : 
-                                                 SearchTree<Etype,Cmp>(comp) {
+    RedBlackTreeCore( const Etype& NegInf, const Cmp& comp = Cmp() ) : 
+                                         SearchTreeCore<Derived,Etype,Cmp,Alloc>(comp) {
         initTree ( NegInf );
     }
 
     /// constructor from a comparison function object.
-    RedBlackTree( const Cmp& comp = Cmp() ) : SearchTree<Etype,Cmp>(comp) {
+    RedBlackTreeCore( const Cmp& comp = Cmp() ) : SearchTreeCore<Derived,Etype,Cmp,Alloc>(comp) {
         initTree ( Etype() );
     }
 
-    /// constructor from an AVLTree.
-    RedBlackTree ( const AVLTree<Etype,Cmp>& avl, const Etype& NegInf = Etype() ) {
+    /// constructor from an AVLTree, whatever its node type.
+    template <class D, class A>
+    RedBlackTreeCore ( const AVLTreeCore<D,Etype,Cmp,A>& avl, const Etype& NegInf = Etype() ) :
+        SearchTreeCore<Derived,Etype,Cmp,Alloc>( avl.key_comp() ) {
         initTree ( NegInf );
+        if ( avl.IsEmpty() ) return;
         this->Header->Right = this->Duplicate(avl, avl.GetRoot());
-        Graduate ( this->Header->Right );
+        int rank = Graduate ( this->Header->Right );
         this->Header->Right->Color = Black;
-        SetColor ( this->Header->Right );
+        SetColor ( this->Header->Right, rank );
     }
 
     /// copy constructor.
-    RedBlackTree( const RedBlackTree& Rsh ) {
+    RedBlackTreeCore( const RedBlackTreeCore& Rsh ) : SearchTreeCore<Derived,Etype,Cmp,Alloc>( Rsh.key_comp() ) {
         initTree (  );
-        *this = Rsh;
+        Clone ( Rsh );
     }
 
     /// destructor.
-    virtual ~RedBlackTree( ) {
-	 this->FreeTree( this->Header ); this->Header = NULL;
-	 delete this->NullNode; this->NullNode = NULL;
+    ~RedBlackTreeCore( ) {
+	 this->ReleaseTree( this->Header->Right );
+	 this->Pool.free_sentinel( this->Header ); this->Header = NULL;
+	 this->FreeNullNode( );
     }
   //@}
 
@@ -111,10 +136,12 @@ class RedBlackTree : public SearchTree<Etype, Cmp>
      *
      *  @return true if insertion was successful.
      */
-    virtual int Insert( const Etype& X ) {
+    int Insert( const Etype& X ) {
+        this->Unshare( X );
     	this->Current = Parent = Grand = this->Header;
-    	this->NullNode->setElement ( X );
-    	while ( 1 ) 
+        // The NullNode may be shared by other trees: nothing is put there,
+        // and the descent stops on it.
+    	while ( this->Current != this->NullNode ) 
     	  {
            if ( this->compare (X, this->Current->Element) ) {
                 Great = Grand; Grand = Parent; Parent = this->Current;
@@ -124,16 +151,13 @@ class RedBlackTree : public SearchTree<Etype, Cmp>
                 Great = Grand; Grand = Parent; Parent = this->Current;
                 this->Current = this->Current->Right;
            }
-           else break;
+           else return 0;			// Do not add a duplicate
 
            if( this->Current->Left->Color == Red && this->Current->Right->Color == Red )
                 HandleReorient( X );
           }
 
-        // Do not add a duplicate
-    	if( this->Current != this->NullNode )
-            return 0;
-    	this->Current = new BinaryNode( X, this->NullNode, this->NullNode );
+    	this->Current = this->MakeNode( X, this->NullNode, this->NullNode );
 
         // Attach to parent
     	if( this->compare (X, Parent->Element) )
@@ -141,71 +165,248 @@ class RedBlackTree : public SearchTree<Etype, Cmp>
     	else
             Parent->Right = this->Current;
     	HandleReorient( X );
+        this->Refresh( X );			// the path down to the new node
     	return 1;
     }
 
     /// removes X from the tree. 
-    virtual int Remove( const Etype& X ) 
-        { return Remove( X, this->Root ); }
+    int Remove( const Etype& X ) 
+        { this->Unshare( X ); return Remove( X, this->Root ); }
+
+    /// makes this tree empty.
+    void MakeEmpty( )
+        { this->ReleaseTree( this->Header->Right ); SetRoot( this->NullNode ); }
+
+    /// returns whether the tree is empty.
+    int IsEmpty( ) const
+        { return this->Header->Right == this->NullNode; }
 
-    /** returns element that matches X in a RedBlackTree.
-     *  WasFound() should test if Current is the NullNode sentinel.
+    /// returns root.
+    BinaryNode* GetRoot( ) const { return this->Header->Right; }
+
+    /** makes this tree hold the items of T1, X and the items of T2,
+     *  which must all be smaller than X, and greater than X, respectively.
+     *  T1 and T2 are left empty, and this tree may be any of them. 
+     *  Only the black heights of the trees are walked down, in O(log n). 
+     *  If T1 and T2 do not share their NullNode, the nodes of the 
+     *  lower one are relinked to the NullNode of the other, though.
      *
-     *  @return item X in tree or item in NullNode, if X is not found.  
+     *  @param T1 tree of the smaller items.
+     *  @param X item between them.
+     *  @param T2 tree of the greater items.
      */
-    virtual const Etype& Find( const Etype& X ) const {
-    	this->NullNode->setElement ( X );	// avoids a test in the while below
-
-        BinaryNode** tempCurrent = (BinaryNode**)& this->Current;
-    	*tempCurrent = this->Header->Right;
-
-    	while ( 1 ) {
-            if ( this->compare(X, this->Current->Element) )
-                *tempCurrent = this->Current->Left;
-            else if (this->compare (this->Current->Element, X) )
-                *tempCurrent = this->Current->Right;
-            else
-                break;
-        }
+    void Join( Derived& T1, const Etype& X, Derived& T2 )
+        { this->JoinTrees( T1, X, T2 ); }
+
+    /** moves the items smaller than X into Less, and the items greater
+     *  than X into Greater, in O(log n). X itself, if present, is removed.
+     *  This tree is left empty, unless it is Less or Greater.
+     *  The three trees then share their NullNode.
+     *
+     *  @param X splitting item.
+     *  @param Less tree of the smaller items.
+     *  @param Greater tree of the greater items.
+     *	@return 1 if X was found, and 0 otherwise.
+     */
+    int Split( const Etype& X, Derived& Less, Derived& Greater )
+        { return this->SplitTree( X, Less, Greater ); }
 
-        return ( this->Current != this->NullNode ) ?
-             this->Current->Element:
-             this->ItemNotFound;
+    /** copy operator.
+     *  Header is not a pool node, so it is kept,
+     *  and only the tree below it is copied.
+     */
+    const RedBlackTreeCore& operator=( const RedBlackTreeCore& Rhs ) {
+        if ( this != &Rhs )
+           {
+            MakeEmpty ( );
+            Clone ( Rhs );
+           }
+        return *this;
     }
 
-    /** returns item X in tree. 
-     *  Version specialized for pairs, since it uses operator neq.
-     *	Result can be checked by calling WasFound.
-     *
-     *  @param X item to be searched for.
-     *  @return ItemNotFound, if X is not found.
+  protected:
+
+    /// sizes of nodes are kept (see utlCounted).
+    enum { KeepsSizes = 1 };
+
+    /// aggregates of nodes are kept with their sizes (see utlAugmented).
+    enum { KeepsAggregates = 1 };
+
+    /** hangs the tree rooted at T from the Header, 
+     *  after its NullNode changed. The root is made Black.
      */
-    virtual const Etype& FindP( const Etype& X ) const {
-    	this->NullNode->setElement ( X );	// avoids a test in the while below
+    void SetRoot( BinaryNode* T ) {
+        this->Header->Left = this->NullNode;
+        this->Header->Right = T;
+        if ( T != this->NullNode )
+             T->Color = Black;
+    }
 
-        BinaryNode** tempCurrent = (BinaryNode**)& this->Current;
-    	*tempCurrent = this->Header->Right;
+    /// returns the link to the root, from the Header.
+    Link& RootLink( ) { return this->Header->Right; }
 
-    	while ( this->compare.neq (X, this->Current->Element) ) {
-            *tempCurrent = ( this->compare(X, this->Current->Element) ?
-                this->Current->Left : this->Current->Right );
-        }
+    /// the rotations of Remove reach the children of the siblings of the path, and below.
+    enum { WriteReach = 3 };
+
+    /// subtrees are joined and split in O(log n).
+    enum { Joinable = 1 };
+
+    /// the height compared by joins: the black height.
+    int JoinHeight( const BinaryNode* T ) const { return BlackHeight( T ); }
 
-        return ( this->Current != this->NullNode ) ?
-            this->Current->Element:
-            this->ItemNotFound;
+    /// returns the black heights of the children of T, of black height h.
+    void ChildHeights( const BinaryNode* T, int h, int& hl, int& hr ) const 
+        { hl = hr = h - ( T->Color == Black ); }
+
+    /** returns the black height of the tree rooted at T: the number
+     *  of Black nodes on any path down to the NullNode, which is not counted.
+     */
+    int BlackHeight( const BinaryNode* T ) const {
+        int h = 0;
+        for ( ; T != this->NullNode; T = T->Left )
+             h += ( T->Color == Black );
+        return h;
     }
 
-    /// makes this tree empty.
-    virtual void MakeEmpty( )
-        { this->FreeTree( this->Header->Right ); this->Header->Right = this->NullNode; }
+    /** joins the RedBlack trees rooted at L and R, whose roots may be Red,
+     *  with node K, whose item lies between theirs. If the black heights 
+     *  are the same, K becomes the root. Otherwise, K is hung Red from 
+     *  the spine of the higher tree, above a Black subtree with the 
+     *  black height of the lower one, and a Red parent is fixed by a
+     *  rotation, which may move the Red conflict up.
+     *  The overall operation is O(|hl - hr| + 1).
+     *
+     *	@param L root of the smaller items.
+     *	@param hl black height of L.
+     *	@param K node between them.
+     *	@param R root of the greater items.
+     *	@param hr black height of R.
+     *	@param h returns the black height of the new tree.
+     *	@return root node, which may be Red.
+     */
+    BinaryNode* JoinNodes( BinaryNode* L, int hl, BinaryNode* K, 
+                           BinaryNode* R, int hr, int& h ) {
+        BinaryNode* T;
+        if ( hl == hr ) {
+             K->Left  = L;
+             K->Right = R;
+             this->Resize ( K );
+             if ( L->Color == Black && R->Color == Black ) {
+                  K->Color = Red;
+                  h = hl;
+             }
+             else {
+                  K->Color = Black;
+                  h = hl + 1;
+             }
+             return K;
+        }
+        if ( hl > hr ) {
+             T = JoinRight ( L, hl, K, R, hr );
+             h = hl;
+             if ( T->Color == Red && T->Right->Color == Red ) {
+                  T->Color = Black;
+                  ++h;
+             }
+        }
+        else {
+             T = JoinLeft ( L, hl, K, R, hr );
+             h = hr;
+             if ( T->Color == Red && T->Left->Color == Red ) {
+                  T->Color = Black;
+                  ++h;
+             }
+        }
+        return T;
+    }
 
-    /// returns whether the tree is empty.
-    virtual int IsEmpty( ) const
-        { return this->Header->Right == this->NullNode; }
+    /** hangs K, with R as right child, from the right spine of T, 
+     *  whose black height hl is higher than hr (see JoinNodes).
+     *
+     *	@return root node, which may be Red with a Red right child.
+     */
+    BinaryNode* JoinRight( BinaryNode* T, int hl, BinaryNode* K, BinaryNode* R, int hr ) {
+        if ( T->Color == Black && hl == hr ) {
+             K->Left  = T;
+             K->Right = R;
+             K->Color = Red;
+             this->Resize ( K );
+             return K;
+        }
+        T->Right = JoinRight ( T->Right, hl - ( T->Color == Black ), K, R, hr );
+        this->Resize ( T );
+        if ( T->Color == Black && T->Right->Color == Red && T->Right->Right->Color == Red ) {
+             T->Right->Right->Color = Black;
+             return RotateWithRightChild ( T );
+        }
+        return T;
+    }
 
-    /// returns root.
-    virtual BinaryNode* GetRoot( ) const { return this->Header->Right; }
+    /** hangs K, with L as left child, from the left spine of T,
+     *  whose black height hr is higher than hl (see JoinNodes).
+     *
+     *	@return root node, which may be Red with a Red left child.
+     */
+    BinaryNode* JoinLeft( BinaryNode* L, int hl, BinaryNode* K, BinaryNode* T, int hr ) {
+        if ( T->Color == Black && hl == hr ) {
+             K->Left  = L;
+             K->Right = T;
+             K->Color = Red;
+             this->Resize ( K );
+             return K;
+        }
+        T->Left = JoinLeft ( L, hl, K, T->Left, hr - ( T->Color == Black ) );
+        this->Resize ( T );
+        if ( T->Color == Black && T->Left->Color == Red && T->Left->Left->Color == Red ) {
+             T->Left->Left->Color = Black;
+             return RotateWithLeftChild ( T );
+        }
+        return T;
+    }
+
+    /** splits the RedBlack tree rooted at T, of black height h, by X. 
+     *  The nodes on the path down to X are joined back, bottom up, to the
+     *  subtrees hanging on their other side. Since these are ever higher, 
+     *  the joins add up to O(log n).
+     *
+     *	@param T root node.
+     *	@param h black height of T.
+     *  @param X splitting item.
+     *	@param L returns the root of the smaller items.
+     *	@param hl returns the black height of L.
+     *	@param R returns the root of the greater items.
+     *	@param hr returns the black height of R.
+     *	@param less orders pointers to items.
+     *	@return node of X, taken out of the tree, or NULL if X was not found.
+     */
+    template <class Less>
+    BinaryNode* SplitNodes( BinaryNode* T, int h, const Etype& X, BinaryNode*& L, int& hl,
+                            BinaryNode*& R, int& hr, const Less& less ) {
+        if ( T == this->NullNode ) {
+             L = R = this->NullNode;
+             hl = hr = 0;
+             return NULL;
+        }
+        BinaryNode* A = T->Left;
+        BinaryNode* B = T->Right;
+        int hc = h - ( T->Color == Black );
+        BinaryNode* F;
+        if ( less ( &X, &T->Element ) ) {
+             F = SplitNodes ( A, hc, X, L, hl, R, hr, less );
+             R = JoinNodes ( R, hr, T, B, hc, hr );
+        }
+        else if ( less ( &T->Element, &X ) ) {
+             F = SplitNodes ( B, hc, X, L, hl, R, hr, less );
+             L = JoinNodes ( A, hc, T, L, hl, hl );
+        }
+        else {
+             L = A;
+             R = B;
+             hl = hr = hc;
+             F = T;
+        }
+        return F;
+    }
 
   private:
 
@@ -217,13 +418,47 @@ class RedBlackTree : public SearchTree<Etype, Cmp>
 	Black = 1 
     };  
 
+    /// replaces the items of the tree by *P[0], ..., *P[n-1], sorted and distinct.
+    void SetTree( const Etype* const* P, int n ) {
+        MakeEmpty ( );
+        this->Header->Right = this->MakeTree ( P, n );
+    }
+
+    /** colors a node made by SearchTreeCore::MakeTree, whose subtree
+     *  has n nodes. As in SetColor, the rank of a node is the number of
+     *  nodes on its shortest path down to the NullNode, floor(log2(n+1)),
+     *  and a child is Red if it has the rank of its parent. Only right
+     *  children may be Red, since left subtrees are never the larger ones,
+     *  and their own children have a lower rank. Nodes are made bottom up,
+     *  so T is Black until its parent is made, and the root stays Black.
+     */
+    void SetBalance( BinaryNode* T, int n ) {
+        T->Color = Black;
+        int right = n - 1 - ( n - 1 ) / 2;
+        if ( this->Log2( right + 1 ) == this->Log2( n + 1 ) )
+             T->Right->Color = Red;
+    }
+
+    /** copies the nodes of Rhs into this tree, which must be empty.
+     *  They are shared (see SearchTreeCore::Share), below a Header of its own.
+     */
+    void Clone ( const RedBlackTreeCore& Rhs ) {
+        this->compare = Rhs.compare;
+        this->Header->setElement ( Rhs.Header->Element );
+        BinaryNode* root = Rhs.Header->Right;
+        if ( root != Rhs.NullNode ) {
+             this->Header->Right = Derived::Shareable ? this->Share ( Rhs, root ) 
+                                                      : this->Duplicate ( Rhs, root );
+             this->Header->Left = this->NullNode;
+        }
+    }
+
     /// initializes NulNode and Header.
     void initTree ( const Etype& NegInf = Etype() ) {
-    	this->NullNode = new BinaryNode;
-    	this->Header = new BinaryNode( NegInf ); 
+    	this->MakeNullNode( );
+    	this->Header = this->Pool.make_sentinel( NegInf ); 
 
-    	this->NullNode->Left = this->NullNode->Right =
-            this->Header->Left = this->Header->Right = this->NullNode;
+    	this->Header->Left = this->Header->Right = this->NullNode;
     }
 
  // Globals used to traverse down the tree in an insert
@@ -240,6 +475,8 @@ class RedBlackTree : public SearchTree<Etype, Cmp>
     	BinaryNode* K1 = K2->Left;
     	K2->Left = K1->Right;
     	K1->Right = K2;
+        this->Resize ( K2 );
+        this->Resize ( K1 );
     	return K1;
     }
 
@@ -249,6 +486,8 @@ class RedBlackTree : public SearchTree<Etype, Cmp>
     	BinaryNode* K2 = K1->Right;
     	K1->Right = K2->Left;
     	K2->Left = K1;
+        this->Resize ( K1 );
+        this->Resize ( K2 );
     	return K2;
    }
 
@@ -299,8 +538,10 @@ class RedBlackTree : public SearchTree<Etype, Cmp>
     void HandleReorient( const Etype& Item ) {
         // Do the color flip
     	this->Current->Color = Red;
-    	this->Current->Left->Color = Black;
-    	this->Current->Right->Color = Black;
+    	if ( this->Current->Left != this->NullNode )	// a new leaf: the NullNode
+    	     this->Current->Left->Color = Black;	// is not written
+    	if ( this->Current->Right != this->NullNode )
+    	     this->Current->Right->Color = Black;
 
     	if( Parent->Color == Red )     // Have to rotate
           {
@@ -319,6 +560,7 @@ class RedBlackTree : public SearchTree<Etype, Cmp>
      *  --> rank(T) <= rank(Parent(T)) <= rank(T)+1. <br>
      *  --> rank(T) < rank(GrandParent(T)). <br>
      *  A tree is graduate if and only if it is Red Black.
+     *  Ranks are kept in BalancingInfo, which will hold the colors later.
      *
      *  @param T given node.
      *  @return node rank.
@@ -327,28 +569,28 @@ class RedBlackTree : public SearchTree<Etype, Cmp>
     	if ( T == this->NullNode )
              return 0;
         else {
-    	     T->Size = 1 + min ( Graduate (T->Left), Graduate (T->Right) );
+    	     T->BalancingInfo = 1 + min ( Graduate (T->Left), Graduate (T->Right) );
              if ( T->Left != this->NullNode ) {
                   if ( T->Left->Left != this->NullNode )
-                       if ( T->Left->Left->Size >= T->Size )
-                            --(T->Left->Left->Size);
+                       if ( T->Left->Left->BalancingInfo >= T->BalancingInfo )
+                            --(T->Left->Left->BalancingInfo);
                   
                   if ( T->Left->Right != this->NullNode )
-                       if ( T->Left->Right->Size >= T->Size )
-                            --(T->Left->Right->Size);
+                       if ( T->Left->Right->BalancingInfo >= T->BalancingInfo )
+                            --(T->Left->Right->BalancingInfo);
                   
              }
              if ( T->Right != this->NullNode ) {
                   if ( T->Right->Left != this->NullNode )
-                       if ( T->Right->Left->Size >= T->Size )
-                            --(T->Right->Left->Size);
+                       if ( T->Right->Left->BalancingInfo >= T->BalancingInfo )
+                            --(T->Right->Left->BalancingInfo);
                   
                   if ( T->Right->Right != this->NullNode )
-                       if ( T->Right->Right->Size >= T->Size )
-                            --(T->Right->Right->Size);
+                       if ( T->Right->Right->BalancingInfo >= T->BalancingInfo )
+                            --(T->Right->Right->BalancingInfo);
                   
              }
-             return T->Size;
+             return T->BalancingInfo;
         }
      return 0; 
     }
@@ -359,17 +601,21 @@ class RedBlackTree : public SearchTree<Etype, Cmp>
      *  Otherwise, it is Black.
      *
      *  @param T given node.
+     *  @param rank rank of T, since its color may have replaced it.
      */
-    void SetColor ( BinaryNode* T ) const {
+    void SetColor ( BinaryNode* T, int rank ) const {
+        int childRank;
     	if ( T->Left != this->NullNode )
            {
-             T->Left->Color = ( T->Left->Size == T->Size ) ? Red : Black;
-             SetColor ( T->Left );
+             childRank = T->Left->BalancingInfo;
+             T->Left->Color = ( childRank == rank ) ? Red : Black;
+             SetColor ( T->Left, childRank );
            }
     	if ( T->Right != this->NullNode )
            {
-             T->Right->Color = ( T->Right->Size == T->Size ) ? Red : Black;
-             SetColor ( T->Right );
+             childRank = T->Right->BalancingInfo;
+             T->Right->Color = ( childRank == rank ) ? Red : Black;
+             SetColor ( T->Right, childRank );
            }
     }
 
@@ -499,6 +745,7 @@ Start:
            }	// endif 
         } 	// end while
      this->Header->Right->Color = Black;
+     this->Header->Color = Black;		// or the next Insert rotates it
     }
 
     /** removes node "X" from the RedBlack tree rooted at "T".
@@ -507,7 +754,7 @@ Start:
      *	@param T root node.
      *	@return true unless X was not found.
      */
-    virtual int Remove( const Etype& X, BinaryNode*& T ) {
+    int Remove( const Etype& X, Link& T ) {
     	BinaryNode* tmp;
         BinaryNode* cmp;
 
@@ -540,13 +787,16 @@ Start:
     	             Parent->Left = tmp->Right;
                 else
                      Parent->Right = tmp->Right;
-    	        delete tmp;
+                this->Refresh ( cmp->Element );
+    	        this->FreeNode( tmp );
 #endif
     	        return 1;
                }
             else {
                 T->setElement ( tmp->Element );
-                return this->RemoveMin( T->Right ); 			// Remove minimum
+                this->RemoveMin( T->Right ); 			// Remove minimum
+                this->Refresh ( T->Element );
+                return 1;
             } 
            }
     	// One or zero children
@@ -559,8 +809,83 @@ Start:
               cmp->Color = Black;
         }         
     	T = cmp; 						// Reroot T
-    	delete tmp;                                    		// Delete old root
+        this->Refresh ( tmp->Element );
+    	this->FreeNode( tmp );                               		// Delete old root
     	return 1;
     }
 };
+
+/// Red-Black tree with the virtual AbsBst interface.
+template <class Etype, class Cmp=compare_to<Etype>,
+          class Alloc=utlNodePool<BinNode<Etype,Cmp> > >
+class RedBlackTree : 
+   public AbsBstAdapter<RedBlackTreeCore<RedBlackTree<Etype,Cmp,Alloc>,Etype,Cmp,Alloc>,Etype,Cmp>
+{
+  public:
+
+    /// constructor from a negative sentinel.
+    RedBlackTree( const Etype& NegInf, const Cmp& comp = Cmp() ) : 
+        AbsBstAdapter<RedBlackTreeCore<RedBlackTree,Etype,Cmp,Alloc>,Etype,Cmp>( NegInf, comp ) { }
+
+    /// constructor from a comparison function object.
+    RedBlackTree( const Cmp& comp = Cmp() ) : 
+        AbsBstAdapter<RedBlackTreeCore<RedBlackTree,Etype,Cmp,Alloc>,Etype,Cmp>( comp ) { }
+
+    /// constructor from an AVL tree, whatever its node type.
+    template <class D, class A>
+    RedBlackTree ( const AVLTreeCore<D,Etype,Cmp,A>& avl, const Etype& NegInf = Etype() ) :
+        AbsBstAdapter<RedBlackTreeCore<RedBlackTree,Etype,Cmp,Alloc>,Etype,Cmp>( avl, NegInf ) { }
+};
+
+/// Red-Black tree without virtual functions.
+template <class Etype, class Cmp=compare_to<Etype>,
+          class Alloc=utlNodePool<BinNode<Etype,Cmp> > >
+class StaticRedBlackTree : 
+   public RedBlackTreeCore<StaticRedBlackTree<Etype,Cmp,Alloc>,Etype,Cmp,Alloc>
+{
+  public:
+
+    /// constructor from a negative sentinel.
+    StaticRedBlackTree( const Etype& NegInf, const Cmp& comp = Cmp() ) : 
+        RedBlackTreeCore<StaticRedBlackTree,Etype,Cmp,Alloc>( NegInf, comp ) { }
+
+    /// constructor from a comparison function object.
+    StaticRedBlackTree( const Cmp& comp = Cmp() ) : 
+        RedBlackTreeCore<StaticRedBlackTree,Etype,Cmp,Alloc>( comp ) { }
+
+    /// constructor from an AVL tree, whatever its node type.
+    template <class D, class A>
+    StaticRedBlackTree ( const AVLTreeCore<D,Etype,Cmp,A>& avl, const Etype& NegInf = Etype() ) :
+        RedBlackTreeCore<StaticRedBlackTree,Etype,Cmp,Alloc>( avl, NegInf ) { }
+};
+
+/** RedBlackTree with compact nodes: the color is kept in a byte,
+ *  and there is no size field.
+ *  For small keys, such as int, nodes take 24 bytes instead of 32.
+ */
+template <class Etype, class Cmp=compare_to<Etype> >
+using CompactRedBlackTree = StaticRedBlackTree<Etype,Cmp,utlNodePool<BinNode<Etype,Cmp,utlRBLayout> > >;
+
+/** RedBlackTree with compact nodes which also keep the size of their subtrees
+ *  (see utlCounted), for order statistics in O(log n).
+ */
+template <class Etype, class Cmp=compare_to<Etype> >
+using CountedRedBlackTree = 
+      StaticRedBlackTree<Etype,Cmp,utlNodePool<BinNode<Etype,Cmp,utlCounted<utlRBLayout> > > >;
+
+/** RedBlackTree whose nodes also aggregate the items of their subtrees with
+ *  a Monoid (see utlAugmented and utlMonoid.h), for RangeAggregate in O(log n).
+ */
+template <class Etype, class Monoid, class Cmp=compare_to<Etype> >
+using AugmentedRedBlackTree = 
+      StaticRedBlackTree<Etype,Cmp,utlNodePool<BinNode<Etype,Cmp,utlAugmented<utlRBLayout,Monoid> > > >;
+
+/** RedBlackTree with compact nodes linked by 32-bit indices.
+ *  For small keys, such as int, nodes take 16 bytes.
+ *  All trees of this type share the same NullNode (index 0).
+ */
+template <class Etype, class Cmp=compare_to<Etype> >
+using IndexedRedBlackTree = 
+      StaticRedBlackTree<Etype,Cmp,utlIndexPool<BinNode<Etype,Cmp,utlIndexed<utlRBLayout> > > >;
+
 #endif
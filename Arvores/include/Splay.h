@@ -33,16 +33,19 @@
  *  Etype: must have zero-parameter and copy constructor
  *     and must have operator<, operator!=, and operator= <br>
  *  CONSTRUCTION: with (a) no initializer. <br>
- *  Deep copy is supported.
+ *  Deep copy is supported: a splay tree changes on reads, so its
+ *  copies do not share nodes (see SearchTreeCore::Shareable).
  *
  * ******************PUBLIC OPERATIONS**************** <br>
  *  int Insert( const Etype& X)  --> Insert X <br>
  *  int Remove( const Etype& X)  --> Remove X <br>
  *  Etype Find( const Etype& X)	 --> Return item that matches X <br>
+ *  int IsFound( const Etype& X) --> Return 1 if X is found <br>
+ *  BinaryNode* Peek( const Etype& X) --> Return node holding X, without splaying <br>
+ *  void SetReadPolicy( ReadPolicy P, int N ) --> When IsFound and Find splay <br>
  *  ------------- Inherited ----------------------------- <br>
  *  int RemoveMin( )    	 --> Removes minimum item from tree <br>
  *  int WasFound( )     	 --> Return 1 if last Find succeeded <br>
- *  int IsFound( const Etype& X) --> Return 1 if X would be found <br>
  *  Etype FindMin( )    	 --> Return smallest item <br>
  *  Etype FindMax( )    	 --> Return largest item <br>
  *  int IsEmpty( )      	 --> Return 1 if empty; else return 0 <br>
@@ -51,40 +54,79 @@
  *  void Merge()        	 --> Merge two binary trees <br>
  *  int Height( const BinaryNode* T) --> Calculates the height of a node <br>
  *  int Size( const BinaryNode* T)   --> Calculates the size of a node <br>
+ *  Etype FindKth( int K )   --> Return Kth smallest item (see utlCounted) <br>
+ *  int Rank( const Etype& X ) --> Number of items before X (see utlCounted) <br>
  * ******************ERRORS*************************** <br>
  * Predefined exception is propagated if new fails. <br>
- * Item in NullNode return for Find on empty tree. <br>
+ * ItemNotFound returned for Find on empty tree. <br>
+ *
+ *  By default, every read (IsFound, Find) splays the accessed node to
+ *  the root. For read-mostly trees, SetReadPolicy() may restrict this
+ *  to every Nth read, or to nodes deeper than N, or disable it. Reads
+ *  that do not splay leave the shape of the tree untouched. Peek never
+ *  splays, and writes nothing. Neither does IsFound with SplayNever, or
+ *  with SplayPastDepth when it does not splay: such reads may be done
+ *  by several threads at once. Find and FindP still record the node 
+ *  found in Current, and SplayEveryNth counts every read, so these 
+ *  always write to the tree.
+ *
+ *  SplayTreeCore has no virtual function. SplayTree adds the AbsBst 
+ *  interface to it, and StaticSplayTree does not (see SearchTreeCore).
  */
-template <class Etype, class Cmp=compare_to<Etype> >
-class SplayTree : public SearchTree<Etype,Cmp>
+template <class Derived, class Etype, class Cmp, class Alloc>
+class SplayTreeCore: public SearchTreeCore<Derived,Etype,Cmp,Alloc>
 {
+  /// the core reads KeepsSizes.
+  friend class SearchTreeCore<Derived,Etype,Cmp,Alloc>;
+
   public:
 
   /// a binary node definition.
-  typedef typename SearchTree<Etype,Cmp>::BinaryNode BinaryNode;
+  typedef typename SearchTreeCore<Derived,Etype,Cmp,Alloc>::BinaryNode BinaryNode;
+
+  /// a link between nodes.
+  typedef typename SearchTreeCore<Derived,Etype,Cmp,Alloc>::Link Link;
+
+  /// when reads (IsFound, Find and FindP) splay the tree.
+  enum ReadPolicy { 
+      /// every read splays.
+      SplayAlways, 
+      /// one read out of N splays.
+      SplayEveryNth, 
+      /// reads splay when the node searched for is deeper than N.
+      SplayPastDepth, 
+      /// reads never splay.
+      SplayNever 
+  };
+
+  /// reads splay the tree, so copies do not share its nodes.
+  enum { Shareable = 0 };
+
+  /// reads (IsFound, Find and FindP) splay the tree, by the read policy (see utlTreeRead).
+  enum { SplaysOnRead = 1 };
 
   /** @name constructors  */ 
   //@{
 
 /// empty costructor.
-    SplayTree( const Cmp& comp = Cmp() ) : SearchTree<Etype,Cmp>(comp) {
-    	this->NullNode = new BinaryNode;
-    	this->NullNode->Left = this->NullNode->Right = this->NullNode;
+    SplayTreeCore( const Cmp& comp = Cmp() ) : SearchTreeCore<Derived,Etype,Cmp,Alloc>(comp),
+                   Policy( SplayAlways ), PolicyParam( 0 ), Reads( 0 ) {
+    	this->MakeNullNode( );
     	this->Root = this->NullNode;
     }
 
     /// copy constructor.
-    SplayTree( const SplayTree& Rhs ) {
-    	this->NullNode = new BinaryNode;
-    	this->NullNode->Left = this->NullNode->Right = this->NullNode;
+    SplayTreeCore( const SplayTreeCore& Rhs ) : SearchTreeCore<Derived,Etype,Cmp,Alloc>( Rhs.key_comp() ),
+                   Policy( Rhs.Policy ), PolicyParam( Rhs.PolicyParam ), Reads( 0 ) {
+    	this->MakeNullNode( );
     	this->Root = this->NullNode;
-    	*this = Rhs;
+    	this->Clone( Rhs );
     }
 
 /// destructor.
-    virtual ~SplayTree( ) { 
-	this->FreeTree( this->Root );  this->Root = NULL;
-	delete this->NullNode;   this->NullNode = NULL; 
+    ~SplayTreeCore( ) { 
+	this->ReleaseTree( this->Root );  this->Root = NULL;
+	this->FreeNullNode( );
     }
   //@}
 
@@ -93,17 +135,12 @@ class SplayTree : public SearchTree<Etype,Cmp>
      *  @param X item to be inserted.
      *  @return true if insertion was successful and false otherwise.
      */
-    virtual int Insert( const Etype & X ) {
-    	static BinaryNode* NewNode = NULL;
-
-    	if( NewNode == NULL )
-            NewNode = new BinaryNode( X );
-        else
-            NewNode->setElement ( X );
+    int Insert( const Etype & X ) {
+    	BinaryNode* NewNode;
 
     	if( this->Root == this->NullNode )
     	  {
-           NewNode->Left = NewNode->Right = this->NullNode;
+           NewNode = this->MakeNode( X, this->NullNode, this->NullNode );
            this->Root = NewNode;
     	  }
     	else
@@ -111,23 +148,24 @@ class SplayTree : public SearchTree<Etype,Cmp>
            Splay( X, this->Root );
            if( this->compare (X, this->Root->Element) )
              {
-              NewNode->Left = this->Root->Left;
-              NewNode->Right = this->Root;
+              NewNode = this->MakeNode( X, this->Root->Left, this->Root );
               this->Root->Left = this->NullNode;
+              this->Resize( this->Root );
+              this->Resize( NewNode );
               this->Root = NewNode;
              }
            else if( this->compare(this->Root->Element, X) )
              {
-              NewNode->Right = this->Root->Right;
-              NewNode->Left = this->Root;
+              NewNode = this->MakeNode( X, this->Root, this->Root->Right );
               this->Root->Right = this->NullNode;
+              this->Resize( this->Root );
+              this->Resize( NewNode );
               this->Root = NewNode;
              }
            else    // Already in the tree
               return 0;
           }
 
-    	NewNode = NULL;   // So next Insert will call new
     	return 1;
     }
 
@@ -136,10 +174,10 @@ class SplayTree : public SearchTree<Etype,Cmp>
      *  @param X item to be removed.
      *  @return 1 if X was found and 0 otherwise.
      */
-    virtual int Remove( const Etype& X ) {
-    	BinaryNode* NewTree;
+    int Remove( const Etype& X ) {
+    	Link NewTree;
 
-    	if( !IsFound( X ) )
+    	if( !SplayFound( X ) )
            return 0;
 
         // If X is found, it will be at the root
@@ -152,35 +190,60 @@ class SplayTree : public SearchTree<Etype,Cmp>
            NewTree = this->Root->Left;
            Splay( X, NewTree );
            NewTree->Right = this->Root->Right;
+           this->Resize( NewTree );
     	  }
-    	delete this->Root;
+    	this->FreeNode( this->Root );
     	this->Root = NewTree;
     	return 1;
     }
 
     /** returns whether a given item is into the tree. 
-     *  If X is found, it will be at the root.
-     *  Thus it returns success or failure.
+     *  If the read policy splays, X will be at the root, if found.
      *  GetRoot() can be used to see what is there.
      *
      *  @param X element to be searched for.
      *  @return true if found, and false otherwise.
      */
-    virtual int IsFound( const Etype& X ) const { 
-        BinaryNode** tempRoot = (BinaryNode**)& this->Root;
-	Splay( X, *tempRoot );
-        return (this->Root != this->NullNode && this->Root->Element == X); 
+    int IsFound( const Etype& X ) const { 
+        if ( !SplayOnRead( X, 0 ) )
+             return this->Lookup( X ) != NULL;
+        return SplayFound( X );
     }
 
+    /** returns the node holding X, or NULL, without splaying.
+     *  Nothing is written (see Lookup).
+     *
+     *  @param X element to be searched for.
+     *  @return node containing X or NULL.
+     */
+    const BinaryNode* Peek( const Etype& X ) const { 
+        return this->Lookup( X );
+    }
+
+    /** sets when reads splay the tree.
+     *
+     *  @param P read policy.
+     *  @param N period for SplayEveryNth, or depth for SplayPastDepth.
+     */
+    void SetReadPolicy( ReadPolicy P, int N = 0 ) {
+        EXCEPTION ( P == SplayEveryNth && N < 1, "SplayTree: the period must be positive" );
+        Policy = P; PolicyParam = N; Reads = 0;
+    }
+
+    /// returns the read policy.
+    ReadPolicy GetReadPolicy( ) const { return Policy; }
+
     /** returns item X in tree. 
      *	Result can be checked by calling WasFound().
      *
      *  @param X item to be searched for.
      *  @return ItemNotFound, if X is not found.
      */
-    virtual const Etype& Find( const Etype& X ) const {
+    const Etype& Find( const Etype& X ) const {
+        if ( !SplayOnRead( X, 0 ) )
+             return SearchTreeCore<Derived,Etype,Cmp,Alloc>::Find( X );
         BinaryNode** tempCurrent = (BinaryNode**)& this->Current;
-    	*tempCurrent = (IsFound(X) ? this->Root : this->NullNode); // PRC - 01/02/01
+    	*tempCurrent = (SplayFound(X) ? this->Root : this->NullNode); // PRC - 01/02/01
         return ( this->Current != this->NullNode ) ?
              this->Current->Element:
              this->ItemNotFound;
@@ -193,7 +256,9 @@ class SplayTree : public SearchTree<Etype,Cmp>
      *  @param X item to be searched for.
      *  @return ItemNotFound, if X is not found.
      */
-    virtual const Etype& FindP( const Etype& X ) const {
+    const Etype& FindP( const Etype& X ) const {
+        if ( !SplayOnRead( X, 1 ) )
+             return SearchTreeCore<Derived,Etype,Cmp,Alloc>::FindP( X );
         BinaryNode** tempCurrent = (BinaryNode**)& this->Current;
     	*tempCurrent = (IsFoundKey(X) ? this->Root : this->NullNode); // PRC - 01/02/01
         return ( this->Current!= this->NullNode ) ?
@@ -202,12 +267,77 @@ class SplayTree : public SearchTree<Etype,Cmp>
     }
   private:
 
+    /// sizes of nodes are kept (see utlCounted).
+    enum { KeepsSizes = 1 };
+
+    /// read policy.
+    ReadPolicy Policy;
+
+    /// period or depth of the read policy.
+    int PolicyParam;
+
+    /// reads since the last splaying read (SplayEveryNth).
+    mutable int Reads;
+
+    /** returns whether a read of X should splay the tree.
+     *
+     *  @param X element to be searched for.
+     *  @param pairs whether pairs are compared with operator neq (FindP).
+     */
+    int SplayOnRead( const Etype& X, int pairs ) const {
+        switch ( Policy ) {
+          case SplayNever:
+               return 0;
+          case SplayEveryNth:
+               if ( ++Reads < PolicyParam ) return 0;
+               Reads = 0;
+               return 1;
+          case SplayPastDepth:
+               return Depth( X, pairs ) > PolicyParam;
+          default:
+               return 1;
+        }
+    }
+
+    /** returns the depth of the node where a search for X ends:
+     *  the node holding X, or the last node visited.
+     */
+    int Depth( const Etype& X, int pairs ) const {
+        const BinaryNode* T = this->Root;
+        const BinaryNode* Next;
+        int d = 0;
+
+        if ( T == this->NullNode ) return 0;
+        for ( ; ; ++d ) {
+            if ( pairs ? !this->compare.neq(X, T->Element) : 
+                 !this->compare(X, T->Element) && !this->compare(T->Element, X) )
+                 break;
+            Next = this->compare(X, T->Element) ? T->Left : T->Right;
+            if ( Next == this->NullNode ) break;
+            T = Next;
+        }
+        return d;
+    }
+
+    /** splays X to the root.
+     *
+     *  @param X element to be searched for.
+     *  @return true if found, and false otherwise.
+     */
+    int SplayFound( const Etype& X ) const { 
+        Link* tempRoot = (Link*)& this->Root;
+	Splay( X, *tempRoot );
+        return (this->Root != this->NullNode && this->Root->Element == X); 
+    }
+
     /// usual rotate routine with left child.
     BinaryNode*
     RotateWithLeftChild( BinaryNode* K2 ) const {
     	BinaryNode* K1 = K2->Left;
     	K2->Left = K1->Right;
     	K1->Right = K2;
+        this->Resize( K2 );
+        this->Resize( K1 );
     	return K1;
     }
 
@@ -217,96 +347,131 @@ class SplayTree : public SearchTree<Etype,Cmp>
     	BinaryNode* K2 = K1->Right;
     	K1->Right = K2->Left;
     	K2->Left = K1;
+        this->Resize( K1 );
+        this->Resize( K2 );
     	return K2;
     }
 
     /** Top-down splay routine.
      *  Last accessed node becomes the new root.
+     *  The NullNode is never written, since trees may share it.
      */
-    void Splay( const Etype& X, BinaryNode*& T ) const {
+    void Splay( const Etype& X, Link& T ) const {
     	BinaryNode* LeftTreeMax; 
         BinaryNode* RightTreeMin, Header;
 
     	Header.Left = Header.Right = this->NullNode;
     	LeftTreeMax = RightTreeMin = &Header;
+        int ls = 0, rs = 0;   // sizes of the left and right trees
 
-    	// Copy X to NullNode to guarantee match
-    	this->NullNode->setElement ( X );
+    	if ( T == this->NullNode ) return;
 
     	for ( ; ; ) {
           if( this->compare (X, T->Element) )
             {
-             if( this->compare (X, T->Left->Element) ) 
+             if( T->Left != this->NullNode && this->compare (X, T->Left->Element) ) 
                 T = RotateWithLeftChild( T );
              if( T->Left == this->NullNode )
                 break;
              // Link Right
+             if ( this->HasSizes ) rs += 1 + this->Size( T->Right );
              RightTreeMin->Left = T;
              RightTreeMin = T;
              T = T->Left;
             }
           else if( this->compare(T->Element, X) )
             {
-             if( this->compare(T->Right->Element, X) ) 
+             if( T->Right != this->NullNode && this->compare(T->Right->Element, X) ) 
                 T = RotateWithRightChild( T );
              if( T->Right == this->NullNode )
                 break;
              // Link Left
+             if ( this->HasSizes ) ls += 1 + this->Size( T->Left );
              LeftTreeMax->Right = T;
              LeftTreeMax = T;
              T = T->Right;
             }
           else break;
         }
-    	LeftTreeMax->Right = T->Left;
-    	RightTreeMin->Left = T->Right;
-    	T->Left = Header.Right;
-    	T->Right = Header.Left;
+    	Reassemble( T, Header, LeftTreeMax, RightTreeMin, ls, rs );
     }
 
     /** Top-down splay routine.
      *  Last accessed node becomes the new root.
      *  Version for comparing pairs by using operator!=().
      */
-    void SplayF( const Etype& X, BinaryNode*& T ) const {
+    void SplayF( const Etype& X, Link& T ) const {
     	BinaryNode* LeftTreeMax; 
         BinaryNode* RightTreeMin, Header;
 
     	Header.Left = Header.Right = this->NullNode;
     	LeftTreeMax = RightTreeMin = &Header;
+        int ls = 0, rs = 0;   // sizes of the left and right trees
 
-    	// Copy X to NullNode to guarantee match
-    	this->NullNode->setElement ( X );
+    	if ( T == this->NullNode ) return;
 
     	while ( this->compare.neq(X, T->Element) ) {
           if( this->compare(X, T->Element) )
             {
-             if( this->compare(X, T->Left->Element) && this->compare.neq(X, T->Left->Element) ) 
+             if( T->Left != this->NullNode && 
+                 this->compare(X, T->Left->Element) && this->compare.neq(X, T->Left->Element) ) 
                 T = RotateWithLeftChild( T );
              if( T->Left == this->NullNode )
                 break;
              // Link Right
+             if ( this->HasSizes ) rs += 1 + this->Size( T->Right );
              RightTreeMin->Left = T;
              RightTreeMin = T;
              T = T->Left;
             }
           else // if( T->Element < X )
             {
-             if( this->compare(T->Right->Element, X) && this->compare.neq(X, T->Right->Element) ) 
+             if( T->Right != this->NullNode && 
+                 this->compare(T->Right->Element, X) && this->compare.neq(X, T->Right->Element) ) 
                 T = RotateWithRightChild( T );
              if( T->Right == this->NullNode )
                 break;
              // Link Left
+             if ( this->HasSizes ) ls += 1 + this->Size( T->Left );
              LeftTreeMax->Right = T;
              LeftTreeMax = T;
              T = T->Right;
             }
        // else break;
         }
+    	Reassemble( T, Header, LeftTreeMax, RightTreeMin, ls, rs );
+    }
+
+    /** ends a top-down splay: the left tree, T and the right tree become 
+     *  the new root T and its subtrees. If the tree keeps sizes, the nodes
+     *  linked on the way down get them from ls and rs, the sizes of the
+     *  left and right trees without the children of T, walking down the
+     *  right spine of the left tree and the left spine of the right tree.
+     */
+    void Reassemble( Link& T, BinaryNode& Header, BinaryNode* LeftTreeMax, 
+                     BinaryNode* RightTreeMin, int ls, int rs ) const {
     	LeftTreeMax->Right = T->Left;
     	RightTreeMin->Left = T->Right;
+        if ( this->HasSizes ) 
+          {
+           ls += this->Size( T->Left );
+           rs += this->Size( T->Right );
+           if ( LeftTreeMax != &Header )
+               for ( BinaryNode* Y = Header.Right; ; Y = Y->Right ) {
+                   this->SetSize( Y, ls );
+                   if ( Y == LeftTreeMax ) break;
+                   ls -= 1 + this->Size( Y->Left );
+               }
+           if ( RightTreeMin != &Header )
+               for ( BinaryNode* Y = Header.Left; ; Y = Y->Left ) {
+                   this->SetSize( Y, rs );
+                   if ( Y == RightTreeMin ) break;
+                   rs -= 1 + this->Size( Y->Right );
+               }
+          }
     	T->Left = Header.Right;
     	T->Right = Header.Left;
+        this->Resize( T );
     }
 
     /** returns whether a given item is into the tree. 
@@ -319,10 +484,60 @@ class SplayTree : public SearchTree<Etype,Cmp>
      *  @return true if found, and false otherwise.
      */
     int IsFoundKey( const Etype& X ) const { 
-        BinaryNode** tempRoot = (BinaryNode**)& this->Root;
+        Link* tempRoot = (Link*)& this->Root;
 	SplayF( X, *tempRoot );
         return !(this->Root == this->NullNode || this->compare.neq(this->Root->Element, X)); 
     }
 
 };
+
+/// Splay tree with the virtual AbsBst interface.
+template <class Etype, class Cmp=compare_to<Etype>,
+          class Alloc=utlNodePool<BinNode<Etype,Cmp> > >
+class SplayTree : 
+   public AbsBstAdapter<SplayTreeCore<SplayTree<Etype,Cmp,Alloc>,Etype,Cmp,Alloc>,Etype,Cmp>
+{
+  public:
+
+    /// empty constructor.
+    SplayTree( const Cmp& comp = Cmp() ) : 
+        AbsBstAdapter<SplayTreeCore<SplayTree,Etype,Cmp,Alloc>,Etype,Cmp>( comp ) { }
+};
+
+/// Splay tree without virtual functions.
+template <class Etype, class Cmp=compare_to<Etype>,
+          class Alloc=utlNodePool<BinNode<Etype,Cmp> > >
+class StaticSplayTree : 
+   public SplayTreeCore<StaticSplayTree<Etype,Cmp,Alloc>,Etype,Cmp,Alloc>
+{
+  public:
+
+    /// empty constructor.
+    StaticSplayTree( const Cmp& comp = Cmp() ) : 
+        SplayTreeCore<StaticSplayTree,Etype,Cmp,Alloc>( comp ) { }
+};
+
+/** SplayTree with compact nodes: there is no size field,
+ *  and the unused balancing information takes a byte.
+ *  For small keys, such as int, nodes take 24 bytes instead of 32.
+ */
+template <class Etype, class Cmp=compare_to<Etype> >
+using CompactSplayTree = StaticSplayTree<Etype,Cmp,utlNodePool<BinNode<Etype,Cmp,utlPlainLayout> > >;
+
+/** SplayTree with compact nodes which also keep the size of their subtrees
+ *  (see utlCounted), for order statistics in O(log n) amortized.
+ *  Splaying reads write sizes too.
+ */
+template <class Etype, class Cmp=compare_to<Etype> >
+using CountedSplayTree = 
+      StaticSplayTree<Etype,Cmp,utlNodePool<BinNode<Etype,Cmp,utlCounted<utlPlainLayout> > > >;
+
+/** SplayTree with compact nodes linked by 32-bit indices.
+ *  For small keys, such as int, nodes take 16 bytes.
+ *  All trees of this type share the same NullNode (index 0).
+ */
+template <class Etype, class Cmp=compare_to<Etype> >
+using IndexedSplayTree = 
+      StaticSplayTree<Etype,Cmp,utlIndexPool<BinNode<Etype,Cmp,utlIndexed<utlPlainLayout> > > >;
+
 #endif
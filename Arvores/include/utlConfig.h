@@ -209,6 +209,13 @@ using namespace std;
 #  define HUGE HUGE_VAL
 #endif 
 
+/// hints that the memory at address p is about to be read.
+#if defined(__GNUC__) || defined(__clang__)
+#  define UTL_PREFETCH(p) __builtin_prefetch ( (p) )
+#else
+#  define UTL_PREFETCH(p)
+#endif
+
 #endif
 
 
@@ -0,0 +1,59 @@
+/*
+   utlCounter.h
+
+   A counter which several threads may update.
+*/
+
+#ifndef __UTLCOUNTER_H__
+#define __UTLCOUNTER_H__
+
+#include <atomic>
+#include <cstddef>
+
+/** A number of items, as kept by utlSet and utlMap.
+ *
+ *	Increments and decrements are atomic, so that a container whose tree
+ *	may be changed by several threads (ConcurrentAVLTree, ConcurrentSkipList)
+ *	still knows its size. Nothing is ordered by the counter: it only
+ *	counts. Unlike std::atomic, it may be copied and assigned.
+ */
+class utlCounter {
+ public:
+
+  /// constructor from an initial value.
+  utlCounter ( size_t n = 0 ) : N ( n ) { }
+
+  /// copy constructor.
+  utlCounter ( const utlCounter& c ) : N ( c.get ( ) ) { }
+
+  /// assignment operator.
+  utlCounter& operator = ( const utlCounter& c ) {
+      N.store ( c.get ( ), std::memory_order_relaxed );
+      return *this;
+  }
+
+  /// returns the current value.
+  size_t get ( ) const { return N.load ( std::memory_order_relaxed ); }
+
+  /// returns the current value.
+  operator size_t ( ) const { return get ( ); }
+
+  /// increment operator (prefix).
+  utlCounter& operator ++ ( ) {
+      N.fetch_add ( 1, std::memory_order_relaxed );
+      return *this;
+  }
+
+  /// decrement operator (prefix).
+  utlCounter& operator -- ( ) {
+      N.fetch_sub ( 1, std::memory_order_relaxed );
+      return *this;
+  }
+
+ private:
+
+  /// the value.
+  std::atomic<size_t> N;
+};
+
+#endif
@@ -20,6 +20,101 @@
 #include "utlStack.h"
 #include "utlQueue.h"
 
+/** tells whether the nodes of a Tree form a single chain, in order,
+ *  linked through GetRight() (as in ConcurrentSkipList). An InOrder
+ *  iterator is then positioned on a node without a search from the root.
+ */
+template <class Tree>
+struct utlLinearTree { enum { value = 0 }; };
+
+/** tells whether the nodes of a Tree link to their parents, and the tree
+ *  keeps these links (see utlParented). An in-order iterator then 
+ *  needs no stack (see ParentInOrder).
+ */
+template <class Tree, class Enable = void>
+struct utlParentTree { enum { value = 0 }; };
+
+/// trees with SearchTreeCore::HasParents.
+template <class Tree>
+struct utlParentTree<Tree, typename std::enable_if<Tree::HasParents != 0>::type> 
+   { enum { value = 1 }; };
+
+/** type of the aggregates kept by the nodes of a Tree (see utlAugmented),
+ *  or void, for trees which keep none.
+ */
+template <class Tree, class Enable = void>
+struct utlTreeAggregate { typedef void type; };
+
+/// trees with SearchTreeCore::HasAggregates.
+template <class Tree>
+struct utlTreeAggregate<Tree, typename std::enable_if<Tree::HasAggregates != 0>::type> 
+   { typedef typename Tree::aggregate_type type; };
+
+/** the reads of utlSet and utlMap on a Tree. They find nodes by Lookup, 
+ *  LowerBound and the like, which write nothing, so that several threads 
+ *  may read at once. A splay tree, though, is kept balanced by its reads:
+ *  access reads X through Find first, which splays X to the root as the 
+ *  read policy says (see SplayTreeCore::ReadPolicy). The descent that 
+ *  follows then stops near the root.
+ */
+template <class Tree, class Enable = void>
+struct utlTreeRead { 
+   /// reads X in t, before a search for X: nothing to do.
+   template <class Etype>
+   static void access ( const Tree&, const Etype& ) { }
+   /// same, comparing pairs by key.
+   template <class Etype>
+   static void accessP ( const Tree&, const Etype& ) { }
+};
+
+/// trees with SplayTreeCore::SplaysOnRead.
+template <class Tree>
+struct utlTreeRead<Tree, typename std::enable_if<Tree::SplaysOnRead != 0>::type> { 
+   template <class Etype>
+   static void access ( const Tree& t, const Etype& X ) { t.Find ( X ); }
+   template <class Etype>
+   static void accessP ( const Tree& t, const Etype& X ) { t.FindP ( X ); }
+};
+
+/** the sharing of nodes between a Tree and its copies (see
+ *  SearchTreeCore::Unshare). Iterators find their item again by key
+ *  after the tree replaced nodes by copies (see InOrder). Trees whose
+ *  copies never share nodes are left alone.
+ */
+template <class Tree, class Enable = void>
+struct utlTreeSharing { 
+   /// makes the tree stop sharing any node.
+   static void unshare ( Tree& ) { }
+   /// makes the nodes which a change of X may write belong to the tree only.
+   template <class Etype>
+   static void unshare ( Tree&, const Etype& ) { }
+   /// returns whether the nodes of t may be written in place.
+   static bool isPrivate ( const Tree& ) { return true; }
+   /// returns the number of nodes t replaced by copies.
+   static unsigned generation ( const Tree* ) { return 0; }
+};
+
+/// trees with SearchTreeCore::Shareable.
+template <class Tree>
+struct utlTreeSharing<Tree, typename std::enable_if<Tree::Shareable != 0>::type> { 
+   static void unshare ( Tree& t ) { t.Unshare ( ); }
+   template <class Etype>
+   static void unshare ( Tree& t, const Etype& X ) { t.Unshare ( X ); }
+   static bool isPrivate ( const Tree& t ) { return t.IsPrivate ( ); }
+   static unsigned generation ( const Tree* t ) { return t ? t->GetGeneration ( ) : 0; }
+};
+
+/** tells whether two items of a tree have equivalent keys, for finding 
+ *  an item again after its node was replaced by a copy (see InOrder).
+ *  utlMap compares the keys of its pairs only (see compare_pair).
+ */
+template <class Cmp>
+struct utlSameKey {
+   template <class Etype>
+   static bool apply ( const Cmp& c, const Etype& x, const Etype& y ) 
+       { return !c ( x, y ) && !c ( y, x ); }
+};
+
 //		ITERATOR BASE CLASS
 
 /** TreeIterator class interface; maintains "current position".
@@ -29,6 +124,7 @@
  *  @version $Revision: 1.2 $ $Date: 2005/10/09 22:40:44 $
  *	
  * Etype: same restrictions as for BinaryTree. <br>
+ * Tree: type of the tree being traversed. <br>
  * CONSTRUCTION: with (a) Tree to which iterator is bound. <br>
  *
  * ******************PUBLIC OPERATIONS********************** <br>
@@ -41,10 +137,14 @@
  * EXCEPTION is called for illegal access or advance. <br>
  */
 
-template <class Etype, class Cmp=compare_to<Etype> >
+template <class Etype, class Cmp=compare_to<Etype>, class Tree=SearchTree<Etype,Cmp> >
 class TreeIterator
 {
   public:
+
+  /// a binary node definition.
+  typedef typename Tree::BinaryNode BinaryNode;
+
   /** @name constructors  */ 
   //@{
 
@@ -52,11 +152,11 @@ class TreeIterator
     TreeIterator ( ) : T ( NULL ), Current ( NULL ) {}
 
     /// constructor.
-    TreeIterator( const SearchTree<Etype,Cmp>* TheTree ) :
+    TreeIterator( const Tree* TheTree ) :
         T( TheTree ), Current( NULL ) { }
 
     /// copy constructor.
-    TreeIterator( const TreeIterator& rhs ) {
+    TreeIterator( const TreeIterator& rhs ) : T ( NULL ), Current ( NULL ) {
        *this = rhs;
     }
 
@@ -104,10 +204,10 @@ class TreeIterator
   protected:
 
     /// holds the tree to be traversed.
-    const SearchTree<Etype,Cmp>* T;
+    const Tree* T;
 
     /// current node.
-    const BinNode<Etype,Cmp>* Current;
+    const BinaryNode* Current;
 
     /// assignment operator.
     TreeIterator& operator = ( const TreeIterator& rhs ) { 
@@ -138,14 +238,18 @@ class TreeIterator
  * EXCEPTION is called for illegal access or advance. <br>
  */
 
-template <class Etype, class Cmp=compare_to<Etype> >
-class PreOrder: public TreeIterator<Etype,Cmp>
+template <class Etype, class Cmp=compare_to<Etype>, class Tree=SearchTree<Etype,Cmp> >
+class PreOrder: public TreeIterator<Etype,Cmp,Tree>
 {
   public:
+
+  /// a binary node definition.
+  typedef typename TreeIterator<Etype,Cmp,Tree>::BinaryNode BinaryNode;
+
   /** @name constructors  */ 
   //@{
     /// constructor.
-    PreOrder( const SearchTree<Etype,Cmp>* TheTree ) : TreeIterator<Etype,Cmp>( TheTree ) {}
+    PreOrder( const Tree* TheTree ) : TreeIterator<Etype,Cmp,Tree>( TheTree ) {}
 
     /// copy constructor.
     PreOrder( const PreOrder& rhs ) {
@@ -186,30 +290,33 @@ class PreOrder: public TreeIterator<Etype,Cmp>
 
     /// assignment operator.
     PreOrder& operator = ( const PreOrder& rhs ) { 
-        TreeIterator<Etype,Cmp>::operator = ( rhs );
+        TreeIterator<Etype,Cmp,Tree>::operator = ( rhs );
         S = rhs.S;
         return *this;
     } 
 
   protected:
     /// stack holding branching nodes (where to return).
-    utlStack< const BinNode<Etype,Cmp>* > S;
+    utlStack< const BinaryNode* > S;
 };
 
 //		POSTORDER
 
 /// holds the data necessary for stacking a node.
-template <class Etype, class Cmp=compare_to<Etype> >
+template <class Etype, class Cmp=compare_to<Etype>, class Tree=SearchTree<Etype,Cmp> >
 struct StNode
 {
+    /// a binary node definition.
+    typedef typename Tree::BinaryNode BinaryNode;
+
     /// a pointer to a node.
-    const BinNode<Etype,Cmp>* Node;
+    const BinaryNode* Node;
 
     /// number of times the node has been popped out from the stack.
     int TimesPopped;
 
     /// constructor.
-    StNode( const BinNode<Etype,Cmp>* N = 0 )
+    StNode( const BinaryNode* N = 0 )
             : Node( N ), TimesPopped( 0 ) { }
 };
 
@@ -231,14 +338,18 @@ struct StNode
  * EXCEPTION is called for illegal access or advance. <br>
  */
 
-template <class Etype, class Cmp=compare_to<Etype> >
-class PostOrder : public TreeIterator<Etype,Cmp>
+template <class Etype, class Cmp=compare_to<Etype>, class Tree=SearchTree<Etype,Cmp> >
+class PostOrder : public TreeIterator<Etype,Cmp,Tree>
 {
   public:
+
+  /// a binary node definition.
+  typedef typename TreeIterator<Etype,Cmp,Tree>::BinaryNode BinaryNode;
+
   /** @name constructors  */ 
   //@{
     /// constructor.
-    PostOrder( const SearchTree<Etype,Cmp>* TheTree ) : TreeIterator<Etype,Cmp>( TheTree ) { }
+    PostOrder( const Tree* TheTree ) : TreeIterator<Etype,Cmp,Tree>( TheTree ) { }
 
     /// copy constructor.
     PostOrder( const PostOrder& rhs ) {
@@ -254,7 +365,7 @@ class PostOrder : public TreeIterator<Etype,Cmp>
         if ( this->T == NULL ) return;
     	while ( !S.empty() ) this->S.pop( );
     	if( this->T->GetRoot() != this->T->GetNullNode() ) {
-            this->S.push( StNode<Etype,Cmp>( this->T->GetRoot() ) );
+            this->S.push( StNode<Etype,Cmp,Tree>( this->T->GetRoot() ) );
     	    operator++();
         }
     }
@@ -268,7 +379,7 @@ class PostOrder : public TreeIterator<Etype,Cmp>
            return;
     	  }
 
-    	StNode <Etype,Cmp> Cnode;
+    	StNode <Etype,Cmp,Tree> Cnode;
 
     	for( ; ; )
     	   {
@@ -285,26 +396,26 @@ class PostOrder : public TreeIterator<Etype,Cmp>
             if( Cnode.TimesPopped == 1 )
               {
                if( this->T->hasLeftChild ( Cnode.Node )  )
-                   this->S.push( StNode<Etype,Cmp>( Cnode.Node->GetLeft() ) );
+                   this->S.push( StNode<Etype,Cmp,Tree>( Cnode.Node->GetLeft() ) );
               }
             else  // Cnode.TimesPopped == 2
               {
                if( this->T->hasRightChild ( Cnode.Node ) )
-                   this->S.push( StNode<Etype,Cmp>( Cnode.Node->GetRight() ) );
+                   this->S.push( StNode<Etype,Cmp,Tree>( Cnode.Node->GetRight() ) );
               }
            }
     }
 
     /// assignment operator.
     PostOrder& operator = ( const PostOrder& rhs ) { 
-        TreeIterator<Etype,Cmp>::operator = ( rhs );
+        TreeIterator<Etype,Cmp,Tree>::operator = ( rhs );
         S = rhs.S;
         return *this;
     } 
 
   protected:
     /// stack holding branching nodes (where to return).
-    utlStack< StNode<Etype,Cmp> > S;
+    utlStack< StNode<Etype,Cmp,Tree> > S;
 };
 
 
@@ -324,37 +435,156 @@ class PostOrder : public TreeIterator<Etype,Cmp>
  * const Etype& operator()( ) const --> Return item in current position <br>
  * void First( )        	    --> Set current position to first <br>
  * void operator++( )   	    --> Advance (prefix) <br>   
+ * void operator--( )   	    --> Go back (prefix) <br>   
  * ******************ERRORS*********************************   <br>  
- * EXCEPTION is called for illegal access or advance <br> 
+ * EXCEPTION is called for illegal access, advance or going back <br> 
  */
 
-template <class Etype, class Cmp=compare_to<Etype> >
-class InOrder : public PostOrder<Etype,Cmp>
+template <class Etype, class Cmp=compare_to<Etype>, class Tree=SearchTree<Etype,Cmp> >
+class InOrder : public PostOrder<Etype,Cmp,Tree>
 {
   // Accept PostOrder construction and default destruction.
 
   public:
+
+  /// a binary node definition.
+  typedef typename PostOrder<Etype,Cmp,Tree>::BinaryNode BinaryNode;
+
   /** @name constructors  */ 
   //@{
     /// empty constructor.
-    InOrder( ) : PostOrder<Etype,Cmp>( NULL ) { }
+    InOrder( ) : PostOrder<Etype,Cmp,Tree>( NULL ), Pending( 0 ), Generation( 0 ) { }
 
     /// constructor from a tree.
-    InOrder( const SearchTree<Etype,Cmp>* TheTree ) :
-        PostOrder<Etype,Cmp>( TheTree ) { }
+    InOrder( const Tree* TheTree ) :
+        PostOrder<Etype,Cmp,Tree>( TheTree ), Pending( 0 ), 
+        Generation( utlTreeSharing<Tree>::generation ( TheTree ) ) { }
+
+    /** constructor from a node and a tree.
+     *  The path from the root to the node is only searched for when
+     *  the iterator is advanced: an iterator just compared with another
+     *  one, as the result of utlSet::find, reads nothing but the node.
+     */
+    InOrder( const BinaryNode* node, const Tree* TheTree ) :
+        PostOrder<Etype,Cmp,Tree>( TheTree ), Pending( 1 ),
+        Generation( utlTreeSharing<Tree>::generation ( TheTree ) ) { 
+        this->Current = node;
+    }
 
-    /// constructor from a node and a tree.
-    InOrder( const BinNode<Etype,Cmp>* node, const SearchTree<Etype,Cmp>* TheTree ) :
-        PostOrder<Etype,Cmp>( TheTree ) { 
+    /// copy constructor.
+    InOrder( const InOrder& rhs ) : PostOrder<Etype,Cmp,Tree>(rhs), Pending( rhs.Pending ),
+                                    Generation( rhs.Generation ) { }
+  //@}
 
+    /// sets current position to first node.
+    virtual void First( ) {
+        if ( this->T == NULL ) return;
+        Pending = 0;
+        Generation = utlTreeSharing<Tree>::generation ( this->T );
+    	while ( !this->S.empty() ) this->S.pop( );
+        this->Current = NULL;
+    	if( this->T->GetRoot() != this->T->GetNullNode() ) {
+            PushLeft( this->T->GetRoot() );
+    	    operator++();
+        }
+    }
+
+    /** decrement operator: sets the current position to the previous node,
+     *  or to the last one if past the end. The tree finds it in O(log n)
+     *  (see SearchTreeCore::Predecessor). As for an iterator made from
+     *  a node, the stack is only rebuilt if the iterator is advanced.
+     */
+    void operator--( ) {
+        if ( Stale ( ) ) Position ( );
+        const BinaryNode* node = this->T->Predecessor( this->Current );
+        EXCEPTION( node == NULL, "Moved before first" );
+    	while ( !this->S.empty() ) this->S.pop( );
         this->Current = node;
-        StNode<Etype,Cmp> Cnode;
-        const Etype X = node->GetElement();
-        const BinNode<Etype,Cmp>* curr = this->T->GetRoot();
+        Pending = 1;
+    }
+
+    /** increment operator. The stack holds the nodes whose left subtree
+     *  is being visited, each one pushed and popped once. It is rebuilt
+     *  if the tree replaced nodes by copies since (see Position).
+     */
+    virtual void operator++( ) {
+        if ( Pending || Stale ( ) ) Position( );
+    	if( this->S.empty( ) )
+    	  {
+           EXCEPTION( this->Current == NULL, "Advanced past end" );
+           this->Current = NULL;
+           return;
+          }
+
+        this->Current = this->S.top( ).Node;
+        this->S.pop( );
+        if( this->T->hasRightChild ( this->Current ) ) 
+            PushLeft( this->Current->GetRight() );
+    }
+
+    /** makes Current the node of its item in the tree, after the tree
+     *  replaced nodes by copies (see Position).
+     */
+    void Locate( ) { if ( Stale ( ) ) Position ( ); }
+
+    /** returns whether this and the given iterator are at the same item.
+     *  After the tree replaced nodes by copies, one of them may hold 
+     *  the former node of the item.
+     */
+    bool operator == ( const InOrder& rhs ) const {
+        if ( this->Current == rhs.Current ) return true;
+        if ( this->Current == NULL || rhs.Current == NULL || ( !Stale ( ) && !rhs.Stale ( ) ) )
+             return false;
+        return utlSameKey<Cmp>::apply ( this->T->key_comp(), this->Current->GetElement(),
+                                                             rhs.Current->GetElement() );
+    }
+
+    /// returns whether this and the given iterator are at different items.
+    bool operator != ( const InOrder& rhs ) const { return !operator == ( rhs ); }
+
+  protected:
+
+    /// whether the stack is still to be built, from the root to Current.
+    int Pending;
+
+    /// generation of the tree when the stack was built (see utlTreeSharing).
+    unsigned Generation;
+
+    /// returns whether the tree replaced nodes by copies since the stack was built.
+    bool Stale( ) const { return Generation != utlTreeSharing<Tree>::generation ( this->T ); }
+
+    /// pushes node and its left descendants, down to the first one.
+    void PushLeft( const BinaryNode* node ) {
+        StNode<Etype,Cmp,Tree> Cnode( node );
+        Cnode.TimesPopped = 1;
+        for ( ; ; ) {
+            this->S.push( Cnode );
+            if( !this->T->hasLeftChild ( Cnode.Node ) ) return;
+            Cnode.Node = Cnode.Node->GetLeft();
+        }
+    }
+
+    /** builds the stack, holding the nodes where to return after Current.
+     *  If the tree replaced the node of Current by a copy, which holds
+     *  the same item, the search stops on the copy, which becomes Current.
+     *  If the item is no longer in the tree, it stops on the NullNode, 
+     *  and the stack holds the nodes after the item.
+     */
+    void Position( ) {
+        Pending = 0;
+        Generation = utlTreeSharing<Tree>::generation ( this->T );
+    	while ( !this->S.empty() ) this->S.pop( );
+        const BinaryNode* node = this->Current;
+        if ( node == NULL ) return;
+        StNode<Etype,Cmp,Tree> Cnode;
+        const BinaryNode* curr = utlLinearTree<Tree>::value ? node : this->T->GetRoot();
+        const BinaryNode* Null = this->T->GetNullNode();
         Cmp compare = this->T->key_comp();
-    	while( curr != node ) {
+        const Etype& X = node->GetElement();
+    	while( curr != node && curr != Null &&
+               !utlSameKey<Cmp>::apply ( compare, X, curr->GetElement() ) ) {
            if ( compare (X, curr->GetElement()) ) {
-                Cnode = StNode<Etype,Cmp> ( curr );
+                Cnode = StNode<Etype,Cmp,Tree> ( curr );
                 Cnode.TimesPopped = 1;
                 this->S.push ( Cnode );
                 curr = curr->GetLeft();
@@ -363,45 +593,168 @@ class InOrder : public PostOrder<Etype,Cmp>
                 curr = curr->GetRight();
            } 
         }
+        if ( curr == Null ) return;
+        this->Current = curr;
         if( this->T->hasRightChild ( this->Current ) ) 
-            this->S.push( StNode<Etype,Cmp>( this->Current->GetRight() ) );
+            PushLeft( this->Current->GetRight() );
     }
+};
 
-    /// copy constructor.
-    InOrder( const InOrder& rhs ) : PostOrder<Etype,Cmp>(rhs) { }
+//		INORDER, FOLLOWING PARENTS
+
+/** ParentInOrder class interface; maintains "current position".
+ *	
+ * Etype: same restrictions as for BinaryTree. <br>
+ * Tree: a tree whose nodes link to their parents (see utlParented). <br>
+ * CONSTRUCTION: with (a) Tree to which iterator is bound. <br>
+ *
+ * ******************PUBLIC OPERATIONS********************** <br>
+ * int operator+( )     	    --> True if at valid position in tree <br>
+ * const Etype& operator()( ) const --> Return item in current position <br>
+ * void First( )        	    --> Set current position to first <br>
+ * void operator++( )   	    --> Advance (prefix) <br>   
+ * void operator--( )   	    --> Go back (prefix) <br>   
+ * ******************ERRORS*********************************   <br>  
+ * EXCEPTION is called for illegal access, advance or going back. <br> 
+ *
+ * Unlike InOrder, it has no stack: the next node is the leftmost one
+ * of the right subtree, or else the first ancestor on whose left subtree
+ * the current node is. Each link is followed twice by a full traversal,
+ * so a step takes O(1) amortized. It is not a TreeIterator: nothing is
+ * virtual, and it holds the tree and the current node only, so that it
+ * is copied as two pointers. Trees linking to parents never share nodes
+ * with their copies (see SearchTreeCore::Shareable), so a node stays in
+ * its tree until removed, and is never found again by key.
+ * A step reads the node it leaves to find the next one, though, while the
+ * stack of InOrder already holds it: when nodes lie in memory far from
+ * their neighbours in the order of items, InOrder may scan faster.
+ */
+
+template <class Etype, class Cmp=compare_to<Etype>, class Tree=SearchTree<Etype,Cmp> >
+class ParentInOrder
+{
+  public:
+
+  /// a binary node definition.
+  typedef typename Tree::BinaryNode BinaryNode;
+
+  /** @name constructors  */ 
+  //@{
+    /// empty constructor.
+    ParentInOrder( ) : T( NULL ), Current( NULL ) { }
+
+    /// constructor from a tree.
+    ParentInOrder( const Tree* TheTree ) : T( TheTree ), Current( NULL ) { 
+        static_assert ( sizeof ( ParentInOrder ) == 2 * sizeof ( void* ),
+                        "ParentInOrder holds the tree and the current node only" );
+    }
+
+    /// constructor from a node and a tree.
+    ParentInOrder( const BinaryNode* node, const Tree* TheTree ) : T( TheTree ), Current( node ) { }
   //@}
 
-    /// increment operator.
-    virtual void operator++( ) {
-    	if( this->S.empty( ) )
-    	  {
-           EXCEPTION( this->Current == NULL, "Advanced past end" );
-           this->Current = NULL;
-           return;
-          }
+    /// returns whether the current position is a valid position in tree.
+    int operator+ ( ) const { return Current != NULL; }
 
-    	StNode<Etype,Cmp> Cnode;
+    /// returns the node in current position reading.
+    const Etype& operator( ) ( ) const {
+    	EXCEPTION( Current == NULL, "Illegal access!" );
+    	return Current->GetElement();
+    }
 
-    	for( ; ; )
-    	   {
-            Cnode = this->S.top( );
-            this->S.pop( );
-    
-            if( ++Cnode.TimesPopped == 2 )
-              {
-               this->Current = Cnode.Node;
-               if( this->T->hasRightChild ( Cnode.Node ) ) 
-                   this->S.push( StNode<Etype,Cmp>( Cnode.Node->GetRight() ) );
-               return;
-              }
-    
-            // First time through
-            this->S.push( Cnode );
-            if( this->T->hasLeftChild ( Cnode.Node ) ) 
-                this->S.push( StNode<Etype,Cmp>( Cnode.Node->GetLeft() ) );
-           }
+    /// sets current position to first node.
+    void First( ) {
+        if ( T == NULL ) return;
+        const BinaryNode* node = T->GetRoot();
+        Current = ( node != T->GetNullNode() ) ? Leftmost( node ) : NULL;
     }
 
+    /// increment operator (prefix).
+    void operator++( ) {
+        EXCEPTION( Current == NULL, "Advanced past end" );
+        const BinaryNode* node = Current;
+        if ( T->hasRightChild ( node ) ) {
+             Current = Leftmost( node->GetRight() );
+             return;
+        }
+        const BinaryNode* Null = T->GetNullNode();
+        const BinaryNode* P = node->GetParent();
+        while ( P != Null && node == P->GetRight() ) {
+             node = P;
+             P = P->GetParent();
+        }
+        Current = ( P != Null ) ? P : NULL;
+    }
+
+    /** decrement operator (prefix): sets the current position to the 
+     *  previous node, or to the last one if past the end.
+     */
+    void operator--( ) {
+        const BinaryNode* node = Current;
+        const BinaryNode* Null = T->GetNullNode();
+        if ( node == NULL ) {
+             node = T->GetRoot();
+             EXCEPTION( node == Null, "Moved before first" );
+             Current = Rightmost( node );
+             return;
+        }
+        if ( T->hasLeftChild ( node ) ) {
+             Current = Rightmost( node->GetLeft() );
+             return;
+        }
+        const BinaryNode* P = node->GetParent();
+        while ( P != Null && node == P->GetLeft() ) {
+             node = P;
+             P = P->GetParent();
+        }
+        EXCEPTION( P == Null, "Moved before first" );
+        Current = P;
+    }
+
+    /// does nothing: the node of an item is never replaced (see InOrder::Locate).
+    void Locate( ) { }
+
+    /// returns whether this and the given iterator are at the same item.
+    bool operator == ( const ParentInOrder& rhs ) const { return Current == rhs.Current; }
+
+    /// returns whether this and the given iterator are at different items.
+    bool operator != ( const ParentInOrder& rhs ) const { return Current != rhs.Current; }
+
+  protected:
+
+    /// holds the tree to be traversed.
+    const Tree* T;
+
+    /// current node.
+    const BinaryNode* Current;
+
+    /// returns the first node of the subtree rooted at node.
+    const BinaryNode* Leftmost( const BinaryNode* node ) const {
+        while ( T->hasLeftChild ( node ) ) node = node->GetLeft();
+        return node;
+    }
+
+    /// returns the last node of the subtree rooted at node.
+    const BinaryNode* Rightmost( const BinaryNode* node ) const {
+        while ( T->hasRightChild ( node ) ) node = node->GetRight();
+        return node;
+    }
+};
+
+/** in-order iterator for a Tree: ParentInOrder, if its nodes 
+ *  link to their parents, and InOrder otherwise.
+ */
+template <class Etype, class Cmp, class Tree, int Parents = utlParentTree<Tree>::value>
+struct utlInOrder { 
+  /// iterator type.
+  typedef InOrder<Etype,Cmp,Tree> type;
+};
+
+/// in-order iterator for a Tree whose nodes link to their parents.
+template <class Etype, class Cmp, class Tree>
+struct utlInOrder<Etype,Cmp,Tree,1> { 
+  /// iterator type.
+  typedef ParentInOrder<Etype,Cmp,Tree> type;
 };
 
 //		LEVEL ORDER
@@ -424,14 +777,18 @@ class InOrder : public PostOrder<Etype,Cmp>
  *  EXCEPTION is called for illegal access or advance.
  */
 
-template <class Etype, class Cmp=compare_to<Etype> >
-class LevelOrder : public TreeIterator<Etype,Cmp>
+template <class Etype, class Cmp=compare_to<Etype>, class Tree=SearchTree<Etype,Cmp> >
+class LevelOrder : public TreeIterator<Etype,Cmp,Tree>
 {
   public:
+
+  /// a binary node definition.
+  typedef typename TreeIterator<Etype,Cmp,Tree>::BinaryNode BinaryNode;
+
   /** @name constructors  */ 
   //@{
     /// constructor.
-    LevelOrder( const SearchTree<Etype,Cmp>* TheTree ) : TreeIterator<Etype,Cmp>( TheTree ) {}
+    LevelOrder( const Tree* TheTree ) : TreeIterator<Etype,Cmp,Tree>( TheTree ) {}
 
     /// copy constructor.
     LevelOrder( const LevelOrder& rhs ) { 
@@ -472,13 +829,13 @@ class LevelOrder : public TreeIterator<Etype,Cmp>
 
     /// assignment operator.
     LevelOrder& operator = ( const LevelOrder& rhs ) { 
-        TreeIterator<Etype,Cmp>::operator = ( rhs );
+        TreeIterator<Etype,Cmp,Tree>::operator = ( rhs );
         Q = rhs.Q;
         return *this;
     } 
 
   private:
     /// queue holding branching nodes (where to return).
-    utlQueue< const BinNode<Etype,Cmp>* > Q;
+    utlQueue< const BinaryNode* > Q;
 };
 #endif
@@ -10,6 +10,7 @@
 #ifndef __UTLITERATORBASE_H__
 #define __UTLITERATORBASE_H__
 
+#include <type_traits>
 #include "utlConfig.h"
 
 /// base iterator.
@@ -63,6 +64,21 @@ namespace cgcUtil {
     typedef T&                         reference;
   };
 
+ /** tells whether In is a forward iterator, or a refinement of it:
+  *  its items stay in place, and its range may be traversed again.
+  *  Both the categories of utlIteratorBase and those of the STL are
+  *  recognized.
+  */
+ template <class In>
+ struct is_forward_iterator {
+    /// category of the iterator.
+    typedef typename cgcUtil::iterator_traits<In>::iterator_category category;
+    /// true for forward, bidirectional and random access iterators.
+    enum { value = 
+           std::is_base_of<typename utlIteratorBase<In>::forward_iterator_tag,category>::value ||
+           std::is_base_of<std::forward_iterator_tag,category>::value };
+ };
+
  /** a helper function to select the appropriate algorithm based on the
   *  iterator category. The iterator tag is used exclusively for overload 
   *  resolution; the tag does not take part in the actual computation.
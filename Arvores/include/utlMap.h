@@ -12,6 +12,7 @@
 #define __UTLMAP_H__
 
 #include "utlPair.h"
+#include "utlCounter.h"
 
 /* for STL compatibility test use: -DUSE_STL */
 #ifdef USE_STL
@@ -66,6 +67,14 @@ template <class Key, class T, class Cmp, class Tree> class utlMultiMap;
 
   };
 
+/// the pairs of a utlMap are at the same item if their keys are equal.
+template <class Etype> 
+struct utlSameKey<compare_pair<Etype> > {
+   template <class P>
+   static bool apply ( const compare_pair<Etype>& c, const P& x, const P& y ) 
+       { return !c.neq ( x, y ); }
+};
+
 /**	map for sorted dictionaries. 
  *
  *	Map is a Sorted Associative Container that associates objects 
@@ -78,6 +87,9 @@ template <class Key, class T, class Cmp, class Tree> class utlMultiMap;
  *	map also does not invalidate any iterators, except, of course, for iterators that 
  *	actually point to the element that is being erased. 
  *
+ *	With a tree whose nodes link to their parents, such as ParentAVLTree,
+ *	iterators hold no stack, and step in O(1) amortized (see ParentInOrder).
+ *
  *	@author <A HREF="mailto:roma@lcg.ufrj.br">Paulo Roma Cavalcanti</a>
  *	@version $Revision: 1.2 $ $Date: 2005/10/10 01:32:51 $
  *	
@@ -127,10 +139,13 @@ class utlMap
   typedef Tree tree_type;
 
   /// type of iterator for the search tree.
-  typedef InOrder <value_type,Cmp> iterator_type; 
+  typedef typename utlInOrder <value_type,Cmp,Tree>::type iterator_type; 
 
   /// a binary node definition.
-  typedef typename SearchTree<value_type,Cmp>::BinaryNode BinaryNode;
+  typedef typename Tree::BinaryNode BinaryNode;
+
+  /// type of the aggregates of the tree nodes, or void (see utlAugmented).
+  typedef typename utlTreeAggregate<Tree>::type aggregate_type;
 
   /// function object that compares two values for ordering. 
   class value_compare {
@@ -165,8 +180,8 @@ class utlMap
 
   /** iterator for map.
     * The nested class iterator closely cooperates with utlMap, so that
-    * both are mutually declared as friend. iterator is only supposed
-    * to allow forward traversal. An iterator object
+    * both are mutually declared as friend. iterator also goes back,
+    * in O(log n) (see InOrder::operator--). An iterator object
     * allows you to visit all elements of a utlMap object one after
     * the other. An order or sorting is defined for the
     * elements. The visiting order of the iterator is given by the
@@ -223,14 +238,17 @@ class utlMap
      *	must be excluded because it requires a new address
      *	calculation. Constancy is guaranteed by the const
      *	declaration in the type definition of value_type.
+     *  A node shared with copies of the map is replaced by a copy
+     *  first (see SearchTreeCore::Unshare). A map which was never
+     *  copied is written in place.
      */
     reference operator*() {
-      return (reference) itr();
+      return (reference) own();
     }
 
     /// non-const pointer operator.
     pointer operator->() {
-      return (pointer) &itr();
+      return (pointer) &own();
     }
 
     /// prefix increment operator. 
@@ -248,10 +266,7 @@ class utlMap
 
     /// prefix decrement operator. 
     iterator& operator--() {
-      iterator prv = *this; prv.itr.First();
-      iterator tmp = prv; ++tmp;
-      for ( ; tmp != *this; ++tmp, ++prv );
-      *this = prv;
+      --itr;
       return *this;
     }
 
@@ -285,6 +300,16 @@ class utlMap
     /// iterator for the tree.
     iterator_type itr; 
 
+    /// returns the item, in a node which belongs to the tree only.
+    const value_type& own() {
+      if ( !utlTreeSharing<tree_type>::isPrivate ( *tree ) ) {
+           itr.Locate();
+           utlTreeSharing<tree_type>::unshare ( *tree, itr() );
+           itr.Locate();
+      }
+      return itr();
+    }
+
   }; // iterator
 
   /// compares two utlMap iterators. 
@@ -299,8 +324,8 @@ class utlMap
 
   /** const_iterator for map.
     * The nested class const_iterator closely cooperates with utlMap, so that
-    * both are mutually declared as friend. iterator is only supposed
-    * to allow forward traversal. A const_iterator object
+    * both are mutually declared as friend. const_iterator also goes back,
+    * in O(log n) (see InOrder::operator--). A const_iterator object
     * allows you to visit all elements of a utlMap object one after
     * the other. An order or sorting is defined for the
     * elements. The visiting order of the const_iterator is given by the
@@ -376,12 +401,8 @@ class utlMap
 
     /// prefix decrement operator. 
     const_iterator& operator--() const {
-      const_iterator prv = *this; prv.itr.First();
-      const_iterator tmp = prv; ++tmp;
-      for ( ; tmp != *this; ++tmp, ++prv );
-
       iterator_type* itTemp = (iterator_type*)&itr;
-      *itTemp = prv.itr;
+      --(*itTemp);
       const_iterator* lthis = (const_iterator*)this;
       return *lthis;
     }
@@ -427,8 +448,8 @@ class utlMap
   /// map tree. 
   tree_type mT;
 
-  /// the number of stored pairs of keys and data. 
-  size_type Count;
+  /// the number of stored pairs of keys and data, counted atomically for concurrent trees.
+  utlCounter Count;
 
   /// function object that compares two keys for ordering. 
   key_compare compare;
@@ -436,6 +457,40 @@ class utlMap
   /// function object that compares two values for ordering.
   value_compare val_compare;
 
+  /// whether a range is of value_type, and may be traversed again.
+  template <class InputIterator> struct sortable : std::integral_constant<bool,
+           cgcUtil::is_forward_iterator<InputIterator>::value &&
+           std::is_same<typename std::remove_cv<typename 
+           cgcUtil::iterator_traits<InputIterator>::value_type>::type,value_type>::value> { };
+
+  /** fills the tree with a range. A range of value_type, which may be
+   *  traversed again, is sorted and built at once (see SearchTreeCore::BuildP).
+   *  Other ranges are inserted, one item at a time.
+   */
+  template <class InputIterator> void build(InputIterator f, InputIterator l) {
+    build ( f, l, sortable<InputIterator>() );
+  }
+
+  /// builds the tree at once from a range.
+  template <class InputIterator> void build(InputIterator f, InputIterator l, std::true_type) {
+    Count = mT.BuildP ( f, l );
+  }
+
+  /// inserts a range.
+  template <class InputIterator> void build(InputIterator f, InputIterator l, std::false_type) {
+    insert ( f, l );
+  }
+
+  /// inserts a range at once.
+  template <class InputIterator> void insert_range(InputIterator f, InputIterator l, std::true_type) {
+    Count = Count + mT.InsertBatchP ( f, l );
+  }
+
+  /// inserts a range, one item at a time.
+  template <class InputIterator> void insert_range(InputIterator f, InputIterator l, std::false_type) {
+    while ( f != l ) insert ( *f++ );
+  }
+
  public:
 
   /** @name constructors  */ 
@@ -454,7 +509,7 @@ class utlMap
   utlMap(InputIterator f, InputIterator l) : 
   	          	mT(tree_type(key_compare())), Count(0), 
                         compare(key_compare()), val_compare(key_compare()) {
-      insert ( f, l );
+      build ( f, l );
   }
 
   /// creates a map with a copy of a range, using comp as the key_compare object. 
@@ -462,7 +517,7 @@ class utlMap
   utlMap(InputIterator f, InputIterator l, const key_compare& comp) : 
 			mT(tree_type(comp)), Count(0), 
                         compare(comp), val_compare(comp) {
-      insert ( f, l );
+      build ( f, l );
   }
 
   /// copy constructor.
@@ -550,9 +605,10 @@ class utlMap
    *	        if the element has not been found.
    */
   iterator find(const key_type& k) {
-    mT.FindP ( value_type(k,data_type()) );
-    const BinaryNode* node = mT.GetCurrent();
-    return (node != mT.GetNullNode() ? iterator( node, &mT ) : end());
+    value_type P ( k, data_type() );
+    utlTreeRead<tree_type>::accessP ( mT, P );
+    const BinaryNode* node = mT.LookupP ( P );
+    return (node != NULL ? iterator( node, &mT ) : end());
   }
 
   /** 	finds an element whose key is k.
@@ -562,9 +618,10 @@ class utlMap
    *	        if the element has not been found.
    */
   const_iterator find(const key_type& k) const {
-    mT.FindP ( value_type(k,data_type()) );
-    const BinaryNode* node = mT.GetCurrent();
-    return (node != mT.GetNullNode() ? const_iterator( node, &mT ) : end());
+    value_type P ( k, data_type() );
+    utlTreeRead<tree_type>::accessP ( mT, P );
+    const BinaryNode* node = mT.LookupP ( P );
+    return (node != NULL ? const_iterator( node, &mT ) : end());
   }
 
   /** 	assignment operator.
@@ -602,18 +659,12 @@ class utlMap
    *  @return a pair with a found value and a boolean.
    */
   utlPair<iterator, bool> insert(const value_type& P) {
-    iterator temp = find(P.first);
-    bool inserted = false;
+    // the tree tells whether a pair with the key of P was there, even if
+    // another thread inserted it meanwhile (concurrent trees).
+    bool inserted = mT.InsertP ( P ) != 0;
+    if ( inserted ) ++Count;
 
-    if( temp == end() ) // not present
-      {
-       mT.Insert ( P );
-       ++Count;
-       temp = find(P.first); // redefine temp
-       inserted = true;
-      }
-
-    return cgcUtil::make_pair(temp, inserted);
+    return cgcUtil::make_pair(find(P.first), inserted);
   }
 
   /// inserts x into the map, using pos as a hint to where it will be inserted. 
@@ -621,13 +672,15 @@ class utlMap
     return insert ( x ).first;
   }
 
-  /**	inserts a range into the map. 
+  /**	inserts a range into the map. A range of value_type, which may be
+   *	traversed again, is sorted and merged into the tree at once 
+   *	(see SearchTreeCore::InsertBatchP). Other ranges are inserted, one item at a time.
    *
    *	@param f beginning of the range.
    *	@param l end of the range.
    */
   template <class InputIterator> void insert(InputIterator f, InputIterator l) {
-     while ( f != l ) insert ( *f++ ); 
+     insert_range ( f, l, sortable<InputIterator>() );
   }
 
   /**   erases the element in a given iterator.
@@ -635,8 +688,7 @@ class utlMap
    *	@param q given iterator.
    */
   void erase(iterator q) { 
-     mT.Remove ( *q );
-     --Count;
+     if ( mT.Remove ( *q ) ) --Count;
   }
 
   /** 	erases all elements having a given key.
@@ -649,11 +701,13 @@ class utlMap
    *	@return number of deleted elements.
    */
   size_type erase(const key_type& k) {
-    utlPair<iterator,iterator> itp = equal_range ( k );
-
-    size_type deleted_elements = cgcUtil::distance (itp.first,itp.second); 
-    if ( deleted_elements > 0 ) erase ( itp.first, itp.second );
-
+    // each pair is removed by key, without an iterator, so that
+    // concurrent trees may be erased from by several threads.
+    size_type deleted_elements = 0;
+    while ( mT.RemoveP ( value_type(k,data_type()) ) ) {
+       --Count;
+       ++deleted_elements;
+    }
     return deleted_elements;
   }
 
@@ -670,8 +724,7 @@ class utlMap
        delem.push_back ( *first++ );
 
     for ( typename utlVector<utlPair<Key,T> >::iterator it = delem.begin(); it != delem.end(); ++it ) {
-       mT.Remove ( *it );
-       --Count;
+       if ( mT.Remove ( *it ) ) --Count;
     }
 
   }
@@ -679,7 +732,39 @@ class utlMap
   /// swaps the contents of this and a given utlMap.
   void swap(utlMap& s) {
     mT.swap ( s.mT ); 
-    std::swap(Count, s.Count);
+    utlCounter c = Count; Count = s.Count; s.Count = c;
+  }
+
+  /**	adds the elements of s to this map, and makes s empty.
+   *	Pairs are compared by key, and of two pairs with the same key,
+   *	the one of this map is kept.
+   *	With a tree which joins subtrees (AVLTree, RedBlackTree), nodes are
+   *	moved, in O(m log(n/m + 1)) for sizes m and n >= m, and independent
+   *	subtrees are combined by several threads (see SearchTree::Union).
+   *
+   *	@param s another map.
+   *	@param threads number of threads, or 0 for one per hardware thread.
+   */
+  void set_union(utlMap& s, int threads = 0) {
+    size_type n = mT.UnionP ( s.mT, threads );
+    Count = Count + s.Count - n;
+    s.Count = 0;
+  }
+
+  /**	keeps the elements of this map which are also in s, and makes s empty.
+   *	@see set_union().
+   */
+  void set_intersection(utlMap& s, int threads = 0) {
+    Count = mT.IntersectionP ( s.mT, threads );
+    s.Count = 0;
+  }
+
+  /**	erases the elements of this map which are also in s, and makes s empty.
+   *	@see set_union().
+   */
+  void set_difference(utlMap& s, int threads = 0) {
+    Count = Count - mT.DifferenceP ( s.mT, threads );
+    s.Count = 0;
   }
 
   /// comparison operator. Tests two maps for equality.
@@ -709,72 +794,128 @@ class utlMap
     return out;
   }
     
-  /// returns how many pairs with a given key are in the multimap.
+  /** returns how many pairs with a given key are in the map: 0 or 1, 
+   *  or more in a multimap. This is O(log n) when the tree keeps the
+   *  size of its nodes (see SearchTreeCore::CountP).
+   */
   size_type count ( const key_type& k ) const { 
-    size_type nb = 0;
-
-    const_iterator it = find( k );
-    const_iterator itr = it;
-    if ( it != end() ) {
-      do {
-         ++nb;
-         ++it;
-      }
-      while ( it != end() && (*it).first == k );
-      while ( itr != begin() && (*itr).first == k ) {
-         ++nb;
-         --itr;
-      }  
-      if ( (*itr).first != k ) --nb;
-    }  
-  
-    return nb; 
+    value_type P ( k, data_type() );
+    utlTreeRead<tree_type>::accessP ( mT, P );
+    return mT.CountP ( P );
+  }
+
+  /** returns how many pairs have keys in [a, b): not before a, and before b.
+   *  This is O(log n), and needs a tree which keeps the size of its nodes,
+   *  such as CountedAVLTree (see SearchTreeCore::CountRangeP).
+   *
+   *  @param a first key of the range.
+   *  @param b key past the end of the range.
+   *  @return number of pairs, 0 if b is not after a.
+   *  @see count(const key_type&).
+   */
+  size_type count ( const key_type& a, const key_type& b ) const { 
+    return mT.CountRangeP ( value_type(a,data_type()), value_type(b,data_type()) );
+  }
+
+  /** 	returns the pair of rank i, from 0: nth(size()/2) has the median key.
+   *	This is O(log n) when the tree keeps the size of its nodes,
+   *	such as CountedAVLTree (see SearchTreeCore::LookupKth).
+   *
+   *	@param i rank of the pair.
+   *	@return an iterator with the pair, or an end() iterator,
+   *	        if i is not less than size().
+   */
+  iterator nth ( size_type i ) {
+    const BinaryNode* node = i < size() ? mT.LookupKth ( (int) i + 1 ) : NULL;
+    return (node != NULL ? iterator( node, &mT ) : end());
+  }
+
+  /// returns the pair of rank i, from 0 (see nth).
+  const_iterator nth ( size_type i ) const {
+    const BinaryNode* node = i < size() ? mT.LookupKth ( (int) i + 1 ) : NULL;
+    return (node != NULL ? const_iterator( node, &mT ) : end());
+  }
+
+  /// returns how many pairs have keys before k (see nth).
+  size_type rank ( const key_type& k ) const { 
+    return mT.RankP ( value_type(k,data_type()) );
+  }
+
+  /** 	returns the aggregate of the pairs whose keys are from a to b, 
+   *	inclusive, when the tree keeps one, such as AugmentedAVLTree with
+   *	utlSumMonoid of the pairs, which adds their data, in O(log n)
+   *	(see SearchTreeCore::RangeAggregateP).
+   *
+   *	@param a first key of the range.
+   *	@param b last key of the range.
+   *	@return aggregate, the identity of the monoid if the range is empty.
+   */
+  aggregate_type aggregate ( const key_type& a, const key_type& b ) const { 
+    return mT.RangeAggregateP ( value_type(a,data_type()), value_type(b,data_type()) );
+  }
+
+  /** 	finds the first pair whose key is not before k.
+   *
+   *	@param k given key.
+   *	@return an iterator with the found pair, or an end() iterator,
+   *	        if every key comes before k.
+   */
+  iterator lower_bound ( const key_type& k ) {
+    value_type P ( k, data_type() );
+    utlTreeRead<tree_type>::accessP ( mT, P );
+    const BinaryNode* node = mT.LowerBoundP ( P );
+    return (node != NULL ? iterator( node, &mT ) : end());
+  }
+
+  /// finds the first pair whose key is not before k (see lower_bound).
+  const_iterator lower_bound ( const key_type& k ) const {
+    value_type P ( k, data_type() );
+    utlTreeRead<tree_type>::accessP ( mT, P );
+    const BinaryNode* node = mT.LowerBoundP ( P );
+    return (node != NULL ? const_iterator( node, &mT ) : end());
+  }
+
+  /** 	finds the first pair whose key is after k.
+   *
+   *	@param k given key.
+   *	@return an iterator with the found pair, or an end() iterator,
+   *	        if no key comes after k.
+   */
+  iterator upper_bound ( const key_type& k ) {
+    value_type P ( k, data_type() );
+    utlTreeRead<tree_type>::accessP ( mT, P );
+    const BinaryNode* node = mT.UpperBoundP ( P );
+    return (node != NULL ? iterator( node, &mT ) : end());
+  }
+
+  /// finds the first pair whose key is after k (see upper_bound).
+  const_iterator upper_bound ( const key_type& k ) const {
+    value_type P ( k, data_type() );
+    utlTreeRead<tree_type>::accessP ( mT, P );
+    const BinaryNode* node = mT.UpperBoundP ( P );
+    return (node != NULL ? const_iterator( node, &mT ) : end());
   }
 
   /**  returns two iterators pointing to the beginning and the end of a subsequence
-   *   of elements whose keys are k.
+   *   of elements whose keys are k: lower_bound(k) and upper_bound(k).
    *
-   *   If there is any element that have the same key as k, then the return value of
-   *   the second iterator points to one past the last such element. 
+   *   If there is no such element, both iterators point to where k would be.
    *
    *   @param k given key.
    *   @return a pair of iterators.
    */
   utlPair<iterator, iterator> equal_range ( const key_type& k ) { 
-       iterator it1 = find( k ), it2 = end();
-       if ( it1 != end() ) {	// found at least one
-         it2 = it1;
-         do
-           ++it2;
-         while ( it2 != end() && (*it2).first == k );
-         while ( it1 != begin() && (*it1).first == k )
-           --it1;
-         if ( (*it1).first != k ) ++it1;
-       }
-       return cgcUtil::make_pair ( it1, it2 ); 
+       return cgcUtil::make_pair ( lower_bound( k ), upper_bound( k ) ); 
   }
 
   /**  returns two const_iterators pointing to the beginning and the end of a subsequence
-   *   of elements whose keys are k.
-   *
-   *   If there is any element that have the same key as k, then the return value of
-   *   the second iterator points to one past the last such element. 
+   *   of elements whose keys are k (see equal_range).
    *
    *   @param k given key.
    *   @return a pair of const_iterators.
    */
   utlPair<const_iterator, const_iterator> equal_range ( const key_type& k ) const { 
-       const_iterator it1 = find( k ), it2 = end();
-       if ( it1 != end() ) {	// found at least one
-         it2 = it1;
-         do
-           ++it2;
-         while ( it2 != end() && (*it2).first == k );
-         while ( it1 != begin() && (*it1).first == k )
-           --it1;
-         if ( (*it1).first != k ) ++it1;
-       }
-       return cgcUtil::make_pair ( it1, it2 ); 
+       return cgcUtil::make_pair ( lower_bound( k ), upper_bound( k ) ); 
   }
 
 };
@@ -850,10 +991,9 @@ class utlMultiMap : public utlMap <Key,T,Cmp,Tree>
   iterator insert(const value_type& P) {
 
     this->mT.Insert ( P );
-    this->mT.Find(P);
        
     ++this->Count;
-    return iterator( this->mT.GetCurrent(), &this->mT );
+    return iterator( this->mT.Lookup ( P ), &this->mT );
   }
 
   /// inserts x into the multimap, using pos as a hint to where it will be inserted. 
@@ -861,18 +1001,66 @@ class utlMultiMap : public utlMap <Key,T,Cmp,Tree>
     return insert ( x ).first;
   }
 
-  /**	inserts a range into the multimap. 
+  /**	inserts a range into the multimap. As in a utlMap, a range of value_type,
+   *	which may be traversed again, is merged into the tree at once, but pairs
+   *	are compared whole (see SearchTreeCore::InsertBatch).
    *
    *	@param f beginning of the range.
    *	@param l end of the range.
    */
   template <class InputIterator> void insert(InputIterator f, InputIterator l) {
-     while ( f != l ) insert ( *f++ ); 
+     insert_range ( f, l, typename utlMap<Key,T,Cmp,Tree>::template sortable<InputIterator>() );
+  }
+
+  /**	adds the pairs of s to this multimap, and makes s empty.
+   *	Unlike in a utlMap, pairs are compared whole, so that
+   *	pairs with the same key and different values are kept.
+   *	@see utlMap::set_union().
+   */
+  void set_union(utlMultiMap& s, int threads = 0) {
+    size_t n = this->mT.Union ( s.mT, threads );
+    this->Count = this->Count + s.Count - n;
+    s.Count = 0;
+  }
+
+  /// keeps the pairs which are also in s, and makes s empty (see set_union()).
+  void set_intersection(utlMultiMap& s, int threads = 0) {
+    this->Count = this->mT.Intersection ( s.mT, threads );
+    s.Count = 0;
+  }
+
+  /// erases the pairs which are also in s, and makes s empty (see set_union()).
+  void set_difference(utlMultiMap& s, int threads = 0) {
+    this->Count = this->Count - this->mT.Difference ( s.mT, threads );
+    s.Count = 0;
   }
 
   /// bracket operator is non-sense in a multimap.
   reference operator[] ( const key_type& k ) { return T(); } 
+
+ protected:
+
+  /// inserts a range at once.
+  template <class InputIterator> void insert_range(InputIterator f, InputIterator l, std::true_type) {
+    this->Count = this->Count + this->mT.InsertBatch ( f, l );
+  }
+
+  /// inserts a range, one pair at a time.
+  template <class InputIterator> void insert_range(InputIterator f, InputIterator l, std::false_type) {
+    while ( f != l ) insert ( *f++ );
+  }
 };
 
+/** map on an AVL tree with compact nodes, which have no size field
+ *  and keep their height in a byte (see CompactAVLTree).
+ *  The tree has no virtual AbsBst interface.
+ */
+template < class Key, class T, class Cmp = compare_pair<utlPair<const Key,T> > >
+using utlCompactMap = utlMap<Key,T,Cmp,CompactAVLTree<utlPair<const Key,T>, Cmp> >;
+
+/// multimap on an AVL tree with compact nodes (see utlCompactMap).
+template < class Key, class T, class Cmp = compare_pair<utlPair<const Key,T> > >
+using utlCompactMultiMap = utlMultiMap<Key,T,Cmp,CompactAVLTree<utlPair<const Key,T>, Cmp> >;
+
 #endif   // __UTLMAP_H__
 #endif
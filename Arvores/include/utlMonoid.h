@@ -0,0 +1,79 @@
+/*
+   utlMonoid.h
+
+   Monoids aggregating the items of a subtree.
+*/
+
+#ifndef __UTLMONOID_H__
+#define __UTLMONOID_H__
+
+#include <limits>
+#include "utlPair.h"
+
+/** the value aggregated for an item: the item itself.
+ */
+template <class Etype>
+struct utlItemValue {
+  /// type of the value.
+  typedef Etype type;
+  /// returns the value of an item.
+  static const type& get ( const Etype& e ) { return e; }
+};
+
+/// the value aggregated for a pair of a utlMap: its data.
+template <class Key, class T>
+struct utlItemValue< utlPair<Key,T> > {
+  /// type of the value.
+  typedef T type;
+  /// returns the value of a pair.
+  static const type& get ( const utlPair<Key,T>& e ) { return e.second; }
+};
+
+/** sum of the values of the items (see utlAugmented).
+ *
+ *  A monoid has a value_type, and three static functions:
+ *  identity(), the aggregate of no item; value(e), the aggregate
+ *  of item e alone; and combine(a, b), the aggregate of the items
+ *  of a followed by those of b, which must be associative.
+ *  Value may be wider than the values themselves, for sums that
+ *  would overflow them.
+ */
+template <class Etype, class Value = typename utlItemValue<Etype>::type>
+struct utlSumMonoid {
+  /// type of the aggregates.
+  typedef Value value_type;
+  /// aggregate of no item.
+  static value_type identity ( ) { return value_type ( ); }
+  /// aggregate of a single item.
+  static value_type value ( const Etype& e ) { return utlItemValue<Etype>::get ( e ); }
+  /// aggregate of the items of a followed by those of b.
+  static value_type combine ( const value_type& a, const value_type& b ) { return a + b; }
+};
+
+/// smallest value of the items (see utlSumMonoid).
+template <class Etype, class Value = typename utlItemValue<Etype>::type>
+struct utlMinMonoid {
+  /// type of the aggregates.
+  typedef Value value_type;
+  /// aggregate of no item: the largest value.
+  static value_type identity ( ) { return (std::numeric_limits<value_type>::max) ( ); }
+  /// aggregate of a single item.
+  static value_type value ( const Etype& e ) { return utlItemValue<Etype>::get ( e ); }
+  /// aggregate of the items of a followed by those of b.
+  static value_type combine ( const value_type& a, const value_type& b ) { return b < a ? b : a; }
+};
+
+/// largest value of the items (see utlSumMonoid).
+template <class Etype, class Value = typename utlItemValue<Etype>::type>
+struct utlMaxMonoid {
+  /// type of the aggregates.
+  typedef Value value_type;
+  /// aggregate of no item: the lowest value.
+  static value_type identity ( ) { return std::numeric_limits<value_type>::lowest ( ); }
+  /// aggregate of a single item.
+  static value_type value ( const Etype& e ) { return utlItemValue<Etype>::get ( e ); }
+  /// aggregate of the items of a followed by those of b.
+  static value_type combine ( const value_type& a, const value_type& b ) { return a < b ? b : a; }
+};
+
+#endif
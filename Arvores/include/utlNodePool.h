@@ -0,0 +1,712 @@
+/*
+   utlNodePool.h
+
+   Slab allocator for the nodes of binary search trees.
+*/
+
+#ifndef __UTLNODEPOOL_H__
+#define __UTLNODEPOOL_H__
+
+#include <new>
+#include <atomic>
+#include <mutex>
+#include <type_traits>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utlConfig.h"
+#include "Exception.h"
+
+/** returns the size, in bytes, of the chunks holding nodes of a given size.
+ *
+ *  Chunks are a power of two, and at least 64 KB, so that the chunk
+ *  of any node can be found by masking the node address.
+ *  A chunk holds at least "minSlots" nodes.
+ */
+inline constexpr size_t utlChunkBytes ( size_t nodeBytes, size_t minSlots = 64, 
+                                        size_t bytes = 65536 ) {
+    return ( bytes >= 256 + minSlots * nodeBytes ) ? bytes : 
+             utlChunkBytes ( nodeBytes, minSlots, 2 * bytes );
+}
+
+/// allocates "bytes" of memory aligned to "bytes" (a power of two).
+inline void* utlAlignedAlloc ( size_t bytes ) {
+#if defined(_MSC_VER)
+    void* p = _aligned_malloc ( bytes, bytes );
+#else
+    void* p = NULL;
+    if ( posix_memalign ( &p, bytes, bytes ) != 0 ) p = NULL;
+#endif
+    if ( p == NULL ) throw std::bad_alloc();
+    return p;
+}
+
+/// releases memory obtained from utlAlignedAlloc.
+inline void utlAlignedFree ( void* p ) {
+#if defined(_MSC_VER)
+    _aligned_free ( p );
+#else
+    free ( p );
+#endif
+}
+
+/** A slab (arena) allocator for tree nodes.
+ *
+ *	Nodes are carved out of large contiguous chunks, instead of being
+ *	requested one by one from operator new. A freed node goes to a free list
+ *	and is handed out again by the next allocation, so a tree that grows
+ *	and shrinks does not go back to malloc at all. shrink_to_fit()
+ *	gives the chunks with no live nodes back to the system.
+ *
+ *	Chunks belong to an arena. Each pool (one per tree) owns an arena, and
+ *	may also share the arenas of other pools through adopt(): this is what
+ *	happens when nodes move from one tree into another, as in
+ *	SearchTree::Merge(). A chunk records its arena in its header, and chunks
+ *	are aligned to their size, so deallocate() always returns a node to the
+ *	arena it came from, whatever pool it is called on. An arena is released
+ *	when the last pool referring to it goes away. Arenas shared by several
+ *	pools are protected by a spin lock, so that trees which exchanged nodes
+ *	may still be used by different threads. For the same reason, the NullNode
+ *	of a tree may be shared with other trees, through share_null_node(),
+ *	and it is counted as the arenas are.
+ *
+ *	The pool only handles raw memory: construction and destruction of the
+ *	nodes is up to the caller, as in utlAllocator.
+ *	Copying a pool yields a new, empty pool.
+ *
+ *	When Indexed is true, every node also has a 32-bit index, used by
+ *	utlIndexLink in place of a pointer. Chunks are then numbered through a
+ *	directory, shared by all pools of the same node type, which grows
+ *	without moving. Index 0 is a NullNode shared by all trees using
+ *	this node type. Up to 2^32 nodes may be alive at the same time.
+ */
+template <class Node, int Indexed = 0> class utlNodePool {
+ public:
+
+  /// value type.
+  typedef Node value_type;
+
+  /// pointer type.
+  typedef Node* pointer;
+
+  /// size type.
+  typedef size_t size_type;
+
+ private:
+
+  /** an unused node slot, linked into the free list. Slots of nodes
+   *  which are not aligned as pointers (20-byte indexed nodes) hold the
+   *  link unaligned, so it is only read and written through memcpy.
+   */
+  struct Slot {
+     /// next free slot.
+     Slot* Next;
+  };
+
+  /// returns the free slot after s.
+  static Slot* next ( const Slot* s ) {
+      Slot* n;
+      memcpy ( &n, s, sizeof(Slot*) );
+      return n;
+  }
+
+  /// links n after the free slot s.
+  static void setNext ( Slot* s, Slot* n ) { memcpy ( s, &n, sizeof(Slot*) ); }
+
+  struct Arena;
+
+  /// header of a chunk of nodes.
+  struct Chunk {
+     /// next chunk in the arena.
+     Chunk* Next;
+     /// arena owning this chunk.
+     Arena* Owner;
+     /// number of slots ever handed out from this chunk.
+     size_type Used;
+     /// number of live nodes in this chunk.
+     size_type Live;
+     /// chunk number in the directory (indexed pools only).
+     uint32_t Number;
+  };
+
+  /// whether nodes are indexed.
+  typedef std::integral_constant<bool,Indexed!=0> indexed;
+
+  /// size of a chunk in bytes.
+  static constexpr size_type ChunkBytes = 
+                utlChunkBytes ( sizeof(Node), Indexed ? 4096 : 64 );
+
+  /// offset of the first node in a chunk.
+  static constexpr size_type HeaderBytes =
+                ( sizeof(Chunk) + alignof(Node) - 1 ) / alignof(Node) * alignof(Node);
+
+  /// number of nodes in a chunk.
+  static constexpr size_type ChunkSlots = ( ChunkBytes - HeaderBytes ) / sizeof(Node);
+
+  /// log2 of the number of chunks in a directory segment.
+  static constexpr int SegBits = 12;
+
+  /// maximum number of chunks, so that indices fit in 32 bits.
+  static constexpr size_type MaxChunks = ( (uint64_t) 1 << 32 ) / ChunkSlots;
+
+  /// number of directory segments.
+  static constexpr size_type Segments = ( MaxChunks >> SegBits ) + 1;
+
+  /// directory of chunks, by number (indexed pools only).
+  static Chunk** Dir[Segments];
+
+  /// protects the directory.
+  static std::mutex DirLock;
+
+  /// first chunk number never used.
+  static uint32_t NextChunk;
+
+  /// chunk numbers given back.
+  static uint32_t* FreeNumbers;
+
+  /// number of chunk numbers given back, and capacity of FreeNumbers.
+  static uint32_t NFree, CapFree;
+
+  /// a list of chunks, with its free list.
+  struct Arena {
+     /// number of pools referring to this arena.
+     std::atomic<int> Refs;
+     /// spin lock, used when the arena is shared.
+     std::atomic_flag Busy;
+     /// chunks of this arena. The first one is being filled.
+     Chunk* Chunks;
+     /// free slots.
+     Slot* Free;
+     /// number of allocated chunks.
+     size_type NChunks;
+
+     /// constructor.
+     Arena ( ) : Refs(1), Chunks(NULL), Free(NULL), NChunks(0) { Busy.clear(); }
+
+     /// destructor. Gives all chunks back to the system.
+     ~Arena ( ) {
+        while ( Chunks ) {
+           Chunk* c = Chunks; Chunks = c->Next;
+           freeChunk ( c );
+        }
+     }
+
+     /// acquires the arena, if it is shared.
+     void lock ( ) {
+        if ( Refs.load ( std::memory_order_relaxed ) > 1 )
+           while ( Busy.test_and_set ( std::memory_order_acquire ) ) ;
+     }
+
+     /// releases the arena, if it is shared.
+     void unlock ( ) {
+        if ( Refs.load ( std::memory_order_relaxed ) > 1 )
+           Busy.clear ( std::memory_order_release );
+     }
+
+     /// returns an uninitialized node.
+     Node* get ( ) {
+        lock ( );
+        void* p;
+        if ( Free ) {
+           p = Free; Free = next ( Free );
+        }
+        else {
+           if ( Chunks == NULL || Chunks->Used == ChunkSlots ) {
+              Chunk* c = newChunk ( this );
+              c->Next = Chunks;
+              Chunks = c; ++NChunks;
+           }
+           p = slot ( Chunks, Chunks->Used++ );
+        }
+        ++chunk ( p )->Live;
+        unlock ( );
+        return (Node*) p;
+     }
+
+     /// puts a node in the free list.
+     void put ( Node* p ) {
+        lock ( );
+        Slot* s = (Slot*) p;
+        setNext ( s, Free ); Free = s;
+        --chunk ( p )->Live;
+        unlock ( );
+     }
+
+     /** releases every chunk with no live nodes.
+      *  The free list is rebuilt with the slots of the remaining chunks.
+      */
+     void trim ( ) {
+        lock ( );
+        Chunk* dead = NULL;
+        Chunk** link = &Chunks;
+        Chunk* c;
+        while ( ( c = *link ) != NULL ) {
+            if ( c->Live == 0 ) {
+                 *link = c->Next;
+                 c->Next = dead; dead = c;
+                 c->Owner = NULL;  // mark as released
+                 --NChunks;
+            }
+            else
+                 link = &c->Next;
+        }
+        if ( dead ) {
+           // drop the free slots of released chunks.
+           Slot* prev = NULL;
+           for ( Slot* sl = Free; sl; ) {
+               Slot* n = next ( sl );
+               if ( chunk ( sl )->Owner != NULL ) prev = sl;
+               else if ( prev ) setNext ( prev, n );
+               else Free = n;
+               sl = n;
+           }
+           while ( dead ) {
+               c = dead; dead = c->Next;
+               freeChunk ( c );
+           }
+        }
+        unlock ( );
+     }
+  };
+
+  /// returns the address of the i-th slot of a chunk.
+  static void* slot ( Chunk* c, size_type i ) {
+      return (char*) c + HeaderBytes + i * sizeof(Node);
+  }
+
+  /// returns the chunk holding a given node.
+  static Chunk* chunk ( const void* p ) {
+      return (Chunk*) ( (uintptr_t) p & ~(uintptr_t) ( ChunkBytes - 1 ) );
+  }
+
+  /// allocates a chunk for a given arena.
+  static Chunk* newChunk ( Arena* a ) {
+      Chunk* c = (Chunk*) utlAlignedAlloc ( ChunkBytes );
+      c->Next = NULL; c->Owner = a; c->Used = c->Live = 0; c->Number = 0;
+      number ( c, indexed() );
+      return c;
+  }
+
+  /// gives a chunk back to the system.
+  static void freeChunk ( Chunk* c ) {
+      unnumber ( c, indexed() );
+      utlAlignedFree ( c );
+  }
+
+  /// chunks are not numbered in a pointer pool.
+  static void number ( Chunk*, std::false_type ) { }
+
+  /// gives a number to a new chunk, and registers it in the directory.
+  static void number ( Chunk* c, std::true_type ) {
+      std::lock_guard<std::mutex> guard ( DirLock );
+      uint32_t n;
+      if ( NFree > 0 )
+           n = FreeNumbers[--NFree];
+      else {
+           EXCEPTION ( NextChunk >= MaxChunks, "utlNodePool: out of node indices" );
+           n = NextChunk++;
+      }
+      if ( Dir[n >> SegBits] == NULL )
+           Dir[n >> SegBits] = new Chunk* [(size_type) 1 << SegBits];
+      Dir[n >> SegBits][n & ( ( 1 << SegBits ) - 1 )] = c;
+      c->Number = n;
+  }
+
+  /// chunks are not numbered in a pointer pool.
+  static void unnumber ( Chunk*, std::false_type ) { }
+
+  /// makes the number of a chunk available again.
+  static void unnumber ( Chunk* c, std::true_type ) {
+      std::lock_guard<std::mutex> guard ( DirLock );
+      if ( NFree == CapFree ) {
+           CapFree = CapFree ? 2 * CapFree : 64;
+           uint32_t* tmp = new uint32_t [CapFree];
+           for ( uint32_t i = 0; i < NFree; ++i ) tmp[i] = FreeNumbers[i];
+           delete [] FreeNumbers;
+           FreeNumbers = tmp;
+      }
+      Dir[c->Number >> SegBits][c->Number & ( ( 1 << SegBits ) - 1 )] = NULL;
+      FreeNumbers[NFree++] = c->Number;
+  }
+
+  /** returns the arena holding the nodes which belong to no tree.
+   *  Its first node, of index 0, is the shared NullNode.
+   */
+  static Arena* sentinels ( ) {
+      static Arena* a = newSentinels ( );
+      return a;
+  }
+
+  /** creates the arena of sentinels, and the shared NullNode, 
+   *  whose empty constructor gives it the balancing information 
+   *  of its layout (see utlNodeLayout::null_balance).
+   */
+  static Arena* newSentinels ( ) {
+      Arena* a = new Arena;
+      a->Refs = 2;   // never released, and always locked
+      Node* n = a->get ( );
+      EXCEPTION ( index ( n ) != 0, "utlNodePool: NullNode must have index 0" );
+      new ( n ) Node ( );
+      return a;
+  }
+
+  /// a pointer pool has no shared sentinels.
+  void init ( std::false_type ) { }
+
+  /// makes sure the shared NullNode exists, before any node is indexed.
+  void init ( std::true_type ) { sentinels ( ); }
+
+  /// a NullNode of a pointer pool, which several trees may share.
+  struct SharedNull : public Node {
+     /// number of trees using it.
+     std::atomic<int> Refs;
+     /// empty constructor.
+     SharedNull ( ) : Node ( ), Refs ( 1 ) { }
+  };
+
+  /// returns a new NullNode.
+  Node* nullNode ( std::false_type ) { return new SharedNull; }
+
+  /// returns the shared NullNode.
+  Node* nullNode ( std::true_type ) { return node ( 0 ); }
+
+  /// adds a tree to the users of a NullNode.
+  Node* shareNullNode ( Node* p, std::false_type ) { 
+      static_cast<SharedNull*> ( p )->Refs.fetch_add ( 1, std::memory_order_relaxed );
+      return p;
+  }
+
+  /// the shared NullNode is used by every tree.
+  Node* shareNullNode ( Node* p, std::true_type ) { return p; }
+
+  /// deletes a NullNode, once no tree uses it.
+  void freeNullNode ( Node* p, std::false_type ) { 
+      SharedNull* s = static_cast<SharedNull*> ( p );
+      if ( s->Refs.fetch_sub ( 1, std::memory_order_acq_rel ) == 1 )
+           delete s;
+  }
+
+  /// the shared NullNode is never deleted.
+  void freeNullNode ( Node*, std::true_type ) { }
+
+  /// returns a new sentinel holding X.
+  template <class Etype> 
+  Node* sentinel ( const Etype& X, std::false_type ) { return new Node ( X ); }
+
+  /// returns a new sentinel holding X, which has an index.
+  template <class Etype> 
+  Node* sentinel ( const Etype& X, std::true_type ) { 
+      return new ( sentinels ( )->get ( ) ) Node ( X ); 
+  }
+
+  /// deletes a sentinel.
+  void freeSentinel ( Node* p, std::false_type ) { delete p; }
+
+  /// deletes a sentinel which has an index.
+  void freeSentinel ( Node* p, std::true_type ) { 
+      p->~Node ( );
+      sentinels ( )->put ( p );
+  }
+
+  /// drops a reference to an arena.
+  static void unref ( Arena* a ) {
+      if ( a && a->Refs.fetch_sub ( 1, std::memory_order_acq_rel ) == 1 )
+           delete a;
+  }
+
+  /// arena of this pool, where new nodes come from.
+  Arena* Own;
+
+  /// arenas shared with other pools.
+  Arena** Adopted;
+
+  /// number of shared arenas.
+  int NAdopted;
+
+  /// capacity of Adopted.
+  int CapAdopted;
+
+  /// adds a reference to a shared arena, unless it is already known.
+  void share ( Arena* a ) {
+      if ( a == NULL || a == Own ) return;
+      for ( int i = 0; i < NAdopted; ++i )
+          if ( Adopted[i] == a ) return;
+      if ( NAdopted == CapAdopted ) {
+           CapAdopted = CapAdopted ? 2 * CapAdopted : 4;
+           Arena** tmp = new Arena* [CapAdopted];
+           for ( int i = 0; i < NAdopted; ++i ) tmp[i] = Adopted[i];
+           delete [] Adopted;
+           Adopted = tmp;
+      }
+      a->Refs.fetch_add ( 1, std::memory_order_relaxed );
+      Adopted[NAdopted++] = a;
+  }
+
+  /// drops all arenas.
+  void clear ( ) {
+      unref ( Own ); Own = NULL;
+      for ( int i = 0; i < NAdopted; ++i ) unref ( Adopted[i] );
+      NAdopted = 0;
+  }
+
+ public:
+
+  /** @name constructors  */
+  //@{
+
+  /// empty constructor.
+  utlNodePool ( ) : Own(NULL), Adopted(NULL), NAdopted(0), CapAdopted(0) 
+      { init ( indexed() ); }
+
+  /// copy constructor. Creates an empty pool.
+  utlNodePool ( const utlNodePool& ) : Own(NULL), Adopted(NULL), NAdopted(0), CapAdopted(0) 
+      { init ( indexed() ); }
+
+  /// destructor. Arenas no longer used by other pools are released.
+  ~utlNodePool ( ) { clear ( ); delete [] Adopted; }
+
+  //@}
+
+  /// assignment operator. Pools are not copied: this pool is kept.
+  utlNodePool& operator = ( const utlNodePool& ) { return *this; }
+
+  /// returns memory for one node.
+  Node* allocate ( ) {
+      if ( Own == NULL ) Own = new Arena;
+      return Own->get ( );
+  }
+
+  /// gives a node back to the arena it came from.
+  void deallocate ( Node* p ) {
+      if ( p ) chunk ( p )->Owner->put ( p );
+  }
+
+  /** returns a constructed node, to be used as the NullNode of a tree.
+   *  Indexed pools return the NullNode shared by all their trees.
+   */
+  Node* null_node ( ) { return nullNode ( indexed() ); }
+
+  /** whether null_node() returns the NullNode shared by all trees.
+   *  It is made once, with the balancing information of its layout
+   *  (see utlNodeLayout::null_balance), and is never written.
+   */
+  enum { shares_null_node = Indexed };
+
+  /** returns p, a node returned by null_node(), to be used as the NullNode
+   *  of one more tree. Trees sharing their NullNode may exchange nodes
+   *  without relinking them. It is deleted by the last free_null_node().
+   */
+  Node* share_null_node ( Node* p ) { return shareNullNode ( p, indexed() ); }
+
+  /// releases a node returned by null_node() or share_null_node().
+  void free_null_node ( Node* p ) { freeNullNode ( p, indexed() ); }
+
+  /** returns a constructed node holding X, which does not belong
+   *  to the tree, such as a header. It survives release().
+   */
+  template <class Etype> 
+  Node* make_sentinel ( const Etype& X ) { return sentinel ( X, indexed() ); }
+
+  /// deletes a node returned by make_sentinel().
+  void free_sentinel ( Node* p ) { freeSentinel ( p, indexed() ); }
+
+  /// returns the node of a given index (indexed pools only).
+  static Node* node ( uint32_t i ) {
+      uint32_t n = (uint32_t) ( i / ChunkSlots );
+      return (Node*) slot ( Dir[n >> SegBits][n & ( ( 1 << SegBits ) - 1 )], 
+                            i - n * ChunkSlots );
+  }
+
+  /// returns the index of a given node (indexed pools only). NULL has index 0.
+  static uint32_t index ( const Node* p ) {
+      if ( p == NULL ) return 0;
+      const Chunk* c = chunk ( p );
+      return (uint32_t) ( c->Number * ChunkSlots +
+                          ( (const char*) p - (const char*) c - HeaderBytes ) / sizeof(Node) );
+  }
+
+  /** makes this pool share the arenas of another pool.
+   *  Must be called before nodes of "p" are moved into the
+   *  tree using this pool.
+   */
+  void adopt ( const utlNodePool& p ) {
+      share ( p.Own );
+      for ( int i = 0; i < p.NAdopted; ++i ) share ( p.Adopted[i] );
+  }
+
+  /** gives all the memory of this pool back to the system at once.
+   *  Every node taken from this pool becomes invalid, and no
+   *  destructor is called. Nothing is done if an arena is still
+   *  shared with another pool, since it may hold nodes of another tree.
+   *
+   *  @return true if the memory was released.
+   */
+  bool release ( ) {
+      if ( Own && Own->Refs.load ( std::memory_order_acquire ) != 1 ) return false;
+      for ( int i = 0; i < NAdopted; ++i )
+          if ( Adopted[i]->Refs.load ( std::memory_order_acquire ) != 1 ) return false;
+      clear ( );
+      return true;
+  }
+
+  /// gives back to the system all chunks without live nodes.
+  void shrink_to_fit ( ) {
+      if ( Own ) Own->trim ( );
+      for ( int i = 0; i < NAdopted; ++i ) Adopted[i]->trim ( );
+  }
+
+  /// returns the number of bytes held by the arena of this pool.
+  size_type capacity ( ) const { return Own ? Own->NChunks * ChunkBytes : 0; }
+
+  /// swaps two pools.
+  void swap ( utlNodePool& p ) {
+      Arena* a = Own; Own = p.Own; p.Own = a;
+      Arena** b = Adopted; Adopted = p.Adopted; p.Adopted = b;
+      int n = NAdopted; NAdopted = p.NAdopted; p.NAdopted = n;
+      n = CapAdopted; CapAdopted = p.CapAdopted; p.CapAdopted = n;
+  }
+};
+
+template <class Node, int I> constexpr size_t utlNodePool<Node,I>::ChunkBytes;
+template <class Node, int I> constexpr size_t utlNodePool<Node,I>::HeaderBytes;
+template <class Node, int I> constexpr size_t utlNodePool<Node,I>::ChunkSlots;
+template <class Node, int I> constexpr int utlNodePool<Node,I>::SegBits;
+template <class Node, int I> constexpr size_t utlNodePool<Node,I>::MaxChunks;
+template <class Node, int I> constexpr size_t utlNodePool<Node,I>::Segments;
+template <class Node, int I> 
+typename utlNodePool<Node,I>::Chunk** utlNodePool<Node,I>::Dir[utlNodePool<Node,I>::Segments];
+template <class Node, int I> std::mutex utlNodePool<Node,I>::DirLock;
+template <class Node, int I> uint32_t utlNodePool<Node,I>::NextChunk = 0;
+template <class Node, int I> uint32_t* utlNodePool<Node,I>::FreeNumbers = NULL;
+template <class Node, int I> uint32_t utlNodePool<Node,I>::NFree = 0;
+template <class Node, int I> uint32_t utlNodePool<Node,I>::CapFree = 0;
+
+/** A slab allocator whose nodes are linked by 32-bit indices.
+ *  See utlIndexLink.
+ */
+template <class Node>
+using utlIndexPool = utlNodePool<Node,1>;
+
+/** A link to a node, holding its 32-bit index in a utlIndexPool.
+ *
+ *	It behaves as a pointer to the node: it may be dereferenced,
+ *	compared, and converted to and from Node*. Index 0, which is also
+ *	what NULL converts to, is the shared NullNode. Links are compared
+ *	by index, without touching the nodes.
+ */
+template <class Node> class utlIndexLink {
+ public:
+
+  /// pool type.
+  typedef utlNodePool<Node,1> pool_type;
+
+  /** @name constructors  */
+  //@{
+
+  /// empty constructor: a link to the NullNode.
+  utlIndexLink ( ) : Index ( 0 ) { }
+
+  /// constructor from a pointer.
+  utlIndexLink ( const Node* p ) : Index ( pool_type::index ( p ) ) { }
+
+  //@}
+
+  /// returns the node pointed to.
+  operator Node* ( ) const { return pool_type::node ( Index ); }
+
+  /// member access operator.
+  Node* operator -> ( ) const { return pool_type::node ( Index ); }
+
+  /// dereferencing operator.
+  Node& operator * ( ) const { return *pool_type::node ( Index ); }
+
+  /// returns the node index.
+  uint32_t index ( ) const { return Index; }
+
+  /// compares two links.
+  friend bool operator == ( const utlIndexLink& a, const utlIndexLink& b ) 
+     { return a.Index == b.Index; }
+
+  /// compares two links.
+  friend bool operator != ( const utlIndexLink& a, const utlIndexLink& b ) 
+     { return a.Index != b.Index; }
+
+  /// compares a link and a pointer.
+  friend bool operator == ( const utlIndexLink& a, const Node* p ) 
+     { return a.Index == pool_type::index ( p ); }
+
+  /// compares a link and a pointer.
+  friend bool operator != ( const utlIndexLink& a, const Node* p ) 
+     { return a.Index != pool_type::index ( p ); }
+
+  /// compares a pointer and a link.
+  friend bool operator == ( const Node* p, const utlIndexLink& a ) 
+     { return a.Index == pool_type::index ( p ); }
+
+  /// compares a pointer and a link.
+  friend bool operator != ( const Node* p, const utlIndexLink& a ) 
+     { return a.Index != pool_type::index ( p ); }
+
+  /// compares a link and a pointer, rather than the node it links to.
+  friend bool operator == ( const utlIndexLink& a, Node* p ) 
+     { return a.Index == pool_type::index ( p ); }
+
+  /// compares a link and a pointer, rather than the node it links to.
+  friend bool operator != ( const utlIndexLink& a, Node* p ) 
+     { return a.Index != pool_type::index ( p ); }
+
+  /// compares a pointer and a link, rather than the node it links to.
+  friend bool operator == ( Node* p, const utlIndexLink& a ) 
+     { return a.Index == pool_type::index ( p ); }
+
+  /// compares a pointer and a link, rather than the node it links to.
+  friend bool operator != ( Node* p, const utlIndexLink& a ) 
+     { return a.Index != pool_type::index ( p ); }
+
+ private:
+
+  /// node index.
+  uint32_t Index;
+};
+
+/** a link to a node, which may be followed by a thread while another
+ *  one changes it. Loads acquire, and stores release, the node pointed to:
+ *  a thread following a link sees the node as it was when it was linked.
+ *  See ConcurrentAVLTree.
+ */
+template <class Node> class utlAtomicLink {
+ public:
+
+  /** @name constructors  */
+  //@{
+
+  /// constructor from a pointer.
+  utlAtomicLink ( const Node* p = NULL ) : Ptr ( (Node*) p ) { }
+
+  /// copy constructor.
+  utlAtomicLink ( const utlAtomicLink& l ) : Ptr ( (Node*) l ) { }
+
+  //@}
+
+  /// assignment operator.
+  utlAtomicLink& operator = ( const utlAtomicLink& l ) {
+      Ptr.store ( (Node*) l, std::memory_order_release );
+      return *this;
+  }
+
+  /// returns the node pointed to.
+  operator Node* ( ) const { return Ptr.load ( std::memory_order_acquire ); }
+
+  /// member access operator.
+  Node* operator -> ( ) const { return Ptr.load ( std::memory_order_acquire ); }
+
+  /// dereferencing operator.
+  Node& operator * ( ) const { return *Ptr.load ( std::memory_order_acquire ); }
+
+ private:
+
+  /// node pointer.
+  std::atomic<Node*> Ptr;
+};
+
+#endif
@@ -12,6 +12,7 @@
 #define __UTLSET_H__
 
 #include "utlPair.h"
+#include "utlCounter.h"
 
 /* for STL compatibility test use: -DUSE_STL */
 #ifdef USE_STL
@@ -54,6 +55,9 @@ template <class Key, class Cmp, class Tree> class utlMultiSet;
  *	a set also does not invalidate any iterators, except, of course, 
  *	for iterators that actually point to the element that is being erased.  
  *
+ *	With a tree whose nodes link to their parents, such as ParentAVLTree,
+ *	iterators hold no stack, and step in O(1) amortized (see ParentInOrder).
+ *
  *	@author <A HREF="mailto:roma@lcg.ufrj.br">Paulo Roma Cavalcanti</a>
  *	@version $Revision: 1.3 $ $Date: 2018/10/11 14:44:13 $
  *	
@@ -94,10 +98,13 @@ class utlSet
   typedef Tree tree_type;
 
   /// type of iterator for the search tree.
-  typedef InOrder <value_type,Cmp> iterator_type; 
+  typedef typename utlInOrder <value_type,Cmp,Tree>::type iterator_type; 
 
   /// a binary node definition.
-  typedef typename SearchTree<value_type,Cmp>::BinaryNode BinaryNode;
+  typedef typename Tree::BinaryNode BinaryNode;
+
+  /// type of the aggregates of the tree nodes, or void (see utlAugmented).
+  typedef typename utlTreeAggregate<Tree>::type aggregate_type;
 
   /// forward declaration of const_iterator class.
   class const_iterator;
@@ -113,8 +120,8 @@ class utlSet
 
   /** const_iterator for set.
     * The nested class const_iterator closely cooperates with utlSet, so that
-    * both are mutually declared as friend. const_iterator is only supposed
-    * to allow forward traversal. A const_iterator object
+    * both are mutually declared as friend. const_iterator also goes back,
+    * in O(log n) (see InOrder::operator--). A const_iterator object
     * allows you to visit all elements of a utlSet object one after
     * the other. An order or sorting is defined for the
     * elements. The visiting order of the const_iterator is given by the
@@ -186,12 +193,8 @@ class utlSet
 
     /// prefix decrement operator. 
     const_iterator& operator--() const {
-      const_iterator prv = *this; prv.itr.First();
-      const_iterator tmp = prv; ++tmp;
-      for ( ; tmp != *this; ++tmp, ++prv );
-
       iterator_type* itTemp = (iterator_type*)&itr;
-      *itTemp = prv.itr;
+      --(*itTemp);
       const_iterator* lthis = (const_iterator*)this;
       return *lthis;
     }
@@ -241,12 +244,46 @@ class utlSet
   /// set tree. 
   tree_type mT;
 
-  /// the number of stored elements.
-  size_type Count;
+  /// the number of stored elements, counted atomically for concurrent trees.
+  utlCounter Count;
 
   /// function object that compares two keys for ordering. 
   key_compare compare;
 
+  /// whether a range is of value_type, and may be traversed again.
+  template <class InputIterator> struct sortable : std::integral_constant<bool,
+           cgcUtil::is_forward_iterator<InputIterator>::value &&
+           std::is_same<typename std::remove_cv<typename 
+           cgcUtil::iterator_traits<InputIterator>::value_type>::type,value_type>::value> { };
+
+  /** fills the tree with a range. A range of value_type, which may be
+   *  traversed again, is sorted and built at once (see SearchTreeCore::Build).
+   *  Other ranges are inserted, one item at a time.
+   */
+  template <class InputIterator> void build(InputIterator f, InputIterator l) {
+    build ( f, l, sortable<InputIterator>() );
+  }
+
+  /// builds the tree at once from a range.
+  template <class InputIterator> void build(InputIterator f, InputIterator l, std::true_type) {
+    Count = mT.Build ( f, l );
+  }
+
+  /// inserts a range.
+  template <class InputIterator> void build(InputIterator f, InputIterator l, std::false_type) {
+    insert ( f, l );
+  }
+
+  /// inserts a range at once.
+  template <class InputIterator> void insert_range(InputIterator f, InputIterator l, std::true_type) {
+    Count = Count + mT.InsertBatch ( f, l );
+  }
+
+  /// inserts a range, one item at a time.
+  template <class InputIterator> void insert_range(InputIterator f, InputIterator l, std::false_type) {
+    while ( f != l ) insert ( *f++ );
+  }
+
  public:
 
   /** @name constructors  */ 
@@ -262,14 +299,14 @@ class utlSet
   template <class InputIterator> 
   utlSet(InputIterator f, InputIterator l) : 
 			mT(tree_type(key_compare())), Count(0), compare(key_compare()) {
-      insert ( f, l );
+      build ( f, l );
   }
 
   /// creates a set with a copy of a range, using comp as the key_compare object. 
   template <class InputIterator>
   utlSet(InputIterator f, InputIterator l, const key_compare& comp) : 
 			mT(tree_type(comp)), Count(0), compare(comp) {
-      insert ( f, l );
+      build ( f, l );
   }
 
   /// copy constructor.
@@ -337,9 +374,9 @@ class utlSet
    *	        if the element has not been found.
    */
   iterator find(const key_type& k) const {
-    mT.Find ( k );
-    const BinaryNode* node = mT.GetCurrent();
-    return (node != mT.GetNullNode() ? iterator( node, &mT ) : end());
+    utlTreeRead<tree_type>::access ( mT, k );
+    const BinaryNode* node = mT.Lookup ( k );
+    return (node != NULL ? iterator( node, &mT ) : end());
   }
 
 
@@ -367,18 +404,12 @@ class utlSet
    *  @return a pair with a found value and a boolean.
    */
   utlPair<iterator, bool> insert(const value_type& P) {
-    iterator temp = find(P);
-    bool inserted = false;
-
-    if( temp == end() ) // not present
-      {
-       mT.Insert ( P );
-       ++Count;
-       temp = find(P); // redefine temp
-       inserted = true;
-      }
+    // the tree tells whether P was there, even if
+    // another thread inserted it meanwhile (concurrent trees).
+    bool inserted = mT.Insert ( P ) != 0;
+    if ( inserted ) ++Count;
 
-    return cgcUtil::make_pair(temp, inserted);
+    return cgcUtil::make_pair(find(P), inserted);
   }
 
   /// inserts x into the set, using pos as a hint to where it will be inserted. 
@@ -386,13 +417,15 @@ class utlSet
     return insert ( x ).first;
   }
 
-  /**	inserts a range into the set. 
+  /**	inserts a range into the set. A range of value_type, which may be
+   *	traversed again, is sorted and merged into the tree at once 
+   *	(see SearchTreeCore::InsertBatch). Other ranges are inserted, one item at a time.
    *
    *	@param f beginning of the range.
    *	@param l end of the range.
    */
   template <class InputIterator> void insert(InputIterator f, InputIterator l) {
-     while ( f != l ) insert ( *f++ ); 
+     insert_range ( f, l, sortable<InputIterator>() );
   }
 
   /**   erases the element in a given iterator.
@@ -400,8 +433,7 @@ class utlSet
    *	@param q given iterator.
    */
   void erase(iterator q) { 
-     mT.Remove ( *q );
-     --Count;
+     if ( mT.Remove ( *q ) ) --Count;
   }
 
   /** 	erases all elements having a given key.
@@ -414,12 +446,10 @@ class utlSet
    *	@return number of deleted elements.
    */
   size_type erase(const key_type& k) {
-    utlPair<iterator,iterator> itp = equal_range ( k );
-
-    size_type deleted_elements = cgcUtil::distance (itp.first,itp.second); 
-    if ( deleted_elements > 0 ) erase ( itp.first, itp.second );
-
-    return deleted_elements;
+    // the tree holds no two equal keys.
+    if ( !mT.Remove ( k ) ) return 0;
+    --Count;
+    return 1;
   }
 
   /// erases all elements in a range. 
@@ -435,8 +465,7 @@ class utlSet
        delem.push_back ( *first++ );
 
     for ( typename utlVector<value_type>::iterator it = delem.begin(); it != delem.end(); ++it ) {
-       mT.Remove ( *it );
-       --Count;
+       if ( mT.Remove ( *it ) ) --Count;
     }
 
   }
@@ -444,7 +473,38 @@ class utlSet
   /// swaps the contents of this and a given utlSet.
   void swap(utlSet& s) {
     mT.swap ( s.mT ); 
-    std::swap(Count, s.Count);
+    utlCounter c = Count; Count = s.Count; s.Count = c;
+  }
+
+  /**	adds the elements of s to this set, and makes s empty.
+   *	Of two equivalent items, the one of this set is kept.
+   *	With a tree which joins subtrees (AVLTree, RedBlackTree), nodes are
+   *	moved, in O(m log(n/m + 1)) for sizes m and n >= m, and independent
+   *	subtrees are combined by several threads (see SearchTree::Union).
+   *
+   *	@param s another set.
+   *	@param threads number of threads, or 0 for one per hardware thread.
+   */
+  void set_union(utlSet& s, int threads = 0) {
+    size_type n = mT.Union ( s.mT, threads );
+    Count = Count + s.Count - n;
+    s.Count = 0;
+  }
+
+  /**	keeps the elements of this set which are also in s, and makes s empty.
+   *	@see set_union().
+   */
+  void set_intersection(utlSet& s, int threads = 0) {
+    Count = mT.Intersection ( s.mT, threads );
+    s.Count = 0;
+  }
+
+  /**	erases the elements of this set which are also in s, and makes s empty.
+   *	@see set_union().
+   */
+  void set_difference(utlSet& s, int threads = 0) {
+    Count = Count - mT.Difference ( s.mT, threads );
+    s.Count = 0;
   }
 
   /// comparison operator. Tests two sets for equality.
@@ -472,49 +532,88 @@ class utlSet
     return out;
   }
     
-  /// returns how many pairs with a given key are in the multiset.
+  /// returns how many elements with a given key are in the set: 0 or 1.
   size_type count ( const key_type& k ) const { 
-    size_type nb = 0;
-
-    const_iterator it = find( k );
-    const_iterator itr = it;
-    if ( it != end() ) {
-      do {
-         ++nb;
-         ++it;
-      }
-      while ( it != end() && *it == k );
-      while ( itr != begin() && *itr == k ) {
-         ++nb;
-         --itr;
-      }  
-      if ( *itr != k ) --nb;
-    }  
-  
-    return nb; 
+    utlTreeRead<tree_type>::access ( mT, k );
+    return mT.Lookup ( k ) != NULL;
+  }
+
+  /** returns how many elements are in [a, b): not before a, and before b.
+   *  This is O(log n), and needs a tree which keeps the size of its nodes,
+   *  such as CountedAVLTree (see SearchTreeCore::CountRange).
+   *
+   *  @param a first key of the range.
+   *  @param b key past the end of the range.
+   *  @return number of elements, 0 if b is not after a.
+   */
+  size_type count ( const key_type& a, const key_type& b ) const { 
+    return mT.CountRange ( a, b );
+  }
+
+  /** 	returns the element of rank i, from 0: nth(size()/2) is the median.
+   *	This is O(log n) when the tree keeps the size of its nodes,
+   *	such as CountedAVLTree (see SearchTreeCore::LookupKth).
+   *
+   *	@param i rank of the element.
+   *	@return an iterator with the element, or an end() iterator,
+   *	        if i is not less than size().
+   */
+  iterator nth ( size_type i ) const {
+    const BinaryNode* node = i < size() ? mT.LookupKth ( (int) i + 1 ) : NULL;
+    return (node != NULL ? iterator( node, &mT ) : end());
+  }
+
+  /// returns how many elements come before k (see nth).
+  size_type rank ( const key_type& k ) const { 
+    return mT.Rank ( k );
+  }
+
+  /** 	returns the aggregate of the elements from a to b, inclusive,
+   *	when the tree keeps one, such as AugmentedAVLTree, in O(log n)
+   *	(see SearchTreeCore::RangeAggregate).
+   *
+   *	@param a first key of the range.
+   *	@param b last key of the range.
+   *	@return aggregate, the identity of the monoid if the range is empty.
+   */
+  aggregate_type aggregate ( const key_type& a, const key_type& b ) const { 
+    return mT.RangeAggregate ( a, b );
+  }
+
+  /** 	finds the first element whose key is not before k.
+   *
+   *	@param k given key.
+   *	@return an iterator with the found element, or an end() iterator,
+   *	        if every element comes before k.
+   */
+  iterator lower_bound ( const key_type& k ) const {
+    utlTreeRead<tree_type>::access ( mT, k );
+    const BinaryNode* node = mT.LowerBound ( k );
+    return (node != NULL ? iterator( node, &mT ) : end());
+  }
+
+  /** 	finds the first element whose key is after k.
+   *
+   *	@param k given key.
+   *	@return an iterator with the found element, or an end() iterator,
+   *	        if no element comes after k.
+   */
+  iterator upper_bound ( const key_type& k ) const {
+    utlTreeRead<tree_type>::access ( mT, k );
+    const BinaryNode* node = mT.UpperBound ( k );
+    return (node != NULL ? iterator( node, &mT ) : end());
   }
 
   /**  returns two iterators pointing to the beginning and the end of a subsequence
-   *   of elements whose keys are k.
+   *   of elements whose keys are k: lower_bound(k) and upper_bound(k).
    *
-   *   If there is any element that have the same key as k, then the return value of
-   *   the second iterator points to one past the last such element. 
+   *   If there is no such element, both iterators point to where k would be.
    *
    *   @param k given key.
    *   @return a pair of iterators.
    */
   utlPair<iterator, iterator> equal_range ( const key_type& k ) const { 
-       iterator it1 = find( k ), it2 = end();
-       if ( it1 != end() ) {	// found at least one
-         it2 = it1;
-         do
-           ++it2;
-         while ( it2 != end() && *it2 == k );
-         while ( it1 != begin() && *it1 == k )
-           --it1;
-         if ( *it1 != k ) ++it1;
-       }
-       return cgcUtil::make_pair ( it1, it2 ); 
+       return cgcUtil::make_pair ( lower_bound( k ), upper_bound( k ) ); 
   }
 
 };
@@ -613,5 +712,16 @@ class utlMultiSet : public utlSet <Key,Cmp,Tree>
 
 };
 
+/** set on a splay tree with compact nodes, which have no size field
+ *  and keep their balancing information in a byte (see CompactSplayTree).
+ *  The tree has no virtual AbsBst interface.
+ */
+template < class Key, class Cmp=compare_to<Key> >
+using utlCompactSet = utlSet<Key,Cmp,CompactSplayTree<Key,Cmp> >;
+
+/// multiset on a splay tree with compact nodes (see utlCompactSet).
+template < class Key, class Cmp=compare_to<Key> >
+using utlCompactMultiSet = utlMultiSet<Key,Cmp,CompactSplayTree<Key,Cmp> >;
+
 #endif   // __UTLSET_H__
 #endif
@@ -0,0 +1,247 @@
+/*
+   utlSharedLock.h
+
+   Reader-writer lock and epoch based reclamation, for read-mostly data.
+*/
+
+#ifndef __UTLSHAREDLOCK_H__
+#define __UTLSHAREDLOCK_H__
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include "utlConfig.h"
+
+/** returns a number in [0,n) for the calling thread, which
+ *  never changes. Threads are numbered in the order they ask for it.
+ */
+inline int utlThreadSlot ( int n ) {
+    static std::atomic<unsigned> Next ( 0 );
+    static thread_local unsigned Mine = Next.fetch_add ( 1, std::memory_order_relaxed );
+    return Mine % n;
+}
+
+/** A reader-writer lock, for data which is read much more often than written.
+ *
+ *	A single reader counter, as in std::shared_timed_mutex, is a cache line
+ *	written by every reader, and it stops readers from scaling with the number
+ *	of cores. Here, readers are spread over Slots counters, each one on its own
+ *	cache line, and a thread always uses the same counter. A reader only
+ *	touches its counter and reads the writer flag. A writer raises the flag,
+ *	so that new readers wait, and then waits for every counter to drop to zero.
+ *	Writers have priority, and are serialized by a mutex.
+ *
+ *	The lock keeps the number of times a thread had to wait for it, and the
+ *	total time spent waiting, in nanoseconds. Nothing is measured when the
+ *	lock is acquired at once.
+ *
+ *	It has the interface of std::shared_timed_mutex (lock, unlock, lock_shared,
+ *	unlock_shared), so it may be used with std::lock_guard. It is not reentrant:
+ *	a thread holding a shared lock must not ask for it again, since a writer
+ *	may be waiting in between.
+ */
+class utlSharedLock {
+ public:
+
+  /// number of reader counters.
+  enum { Slots = 64 };
+
+  /// empty constructor.
+  utlSharedLock ( ) : Writer ( 0 ), Waits ( 0 ), WaitNanos ( 0 ) {
+      for ( int i = 0; i < Slots; ++i ) Readers[i].Count = 0;
+  }
+
+  /// acquires the lock for reading.
+  void lock_shared ( ) {
+      std::atomic<int>& c = Readers[utlThreadSlot(Slots)].Count;
+      c.fetch_add ( 1 );
+      if ( Writer.load ( ) == 0 ) return;
+
+      // a writer holds the lock, or is waiting for it.
+      std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+      for ( ; ; ) {
+           c.fetch_sub ( 1, std::memory_order_release );
+           while ( Writer.load ( std::memory_order_relaxed ) )
+                   std::this_thread::yield ( );
+           c.fetch_add ( 1 );
+           if ( Writer.load ( ) == 0 ) break;
+      }
+      contended ( t0 );
+  }
+
+  /// releases a lock acquired for reading.
+  void unlock_shared ( ) {
+      Readers[utlThreadSlot(Slots)].Count.fetch_sub ( 1, std::memory_order_release );
+  }
+
+  /// acquires the lock for writing.
+  void lock ( ) {
+      std::chrono::steady_clock::time_point t0;
+      int waited = !WriteLock.try_lock ( );
+      if ( waited ) {
+           t0 = std::chrono::steady_clock::now();
+           WriteLock.lock ( );
+      }
+      Writer.store ( 1 );
+      for ( int i = 0; i < Slots; ++i ) {
+           if ( Readers[i].Count.load ( ) == 0 ) continue;
+           if ( !waited ) {
+                waited = 1;
+                t0 = std::chrono::steady_clock::now();
+           }
+           while ( Readers[i].Count.load ( ) != 0 )
+                   std::this_thread::yield ( );
+      }
+      if ( waited ) contended ( t0 );
+  }
+
+  /// releases a lock acquired for writing.
+  void unlock ( ) {
+      Writer.store ( 0, std::memory_order_release );
+      WriteLock.unlock ( );
+  }
+
+  /// returns the number of times a thread had to wait for the lock.
+  unsigned long long contentions ( ) const { return Waits.load ( std::memory_order_relaxed ); }
+
+  /// returns the total time spent waiting for the lock, in nanoseconds.
+  unsigned long long wait_time ( ) const { return WaitNanos.load ( std::memory_order_relaxed ); }
+
+  /// sets the contention counters to zero.
+  void reset_counters ( ) {
+      Waits.store ( 0, std::memory_order_relaxed );
+      WaitNanos.store ( 0, std::memory_order_relaxed );
+  }
+
+ private:
+
+  /// a reader counter, alone in its cache line.
+  struct Slot {
+     /// number of readers holding the lock through this counter.
+     std::atomic<int> Count;
+     /// padding up to a cache line.
+     char Pad[64 - sizeof(std::atomic<int>)];
+  };
+
+  /// reader counters.
+  Slot Readers[Slots];
+
+  /// whether a writer holds the lock, or is waiting for it.
+  std::atomic<int> Writer;
+
+  /// serializes the writers.
+  std::mutex WriteLock;
+
+  /// number of waits.
+  std::atomic<unsigned long long> Waits;
+
+  /// time spent waiting, in nanoseconds.
+  std::atomic<unsigned long long> WaitNanos;
+
+  /// records a wait, which started at t0.
+  void contended ( std::chrono::steady_clock::time_point t0 ) {
+      Waits.fetch_add ( 1, std::memory_order_relaxed );
+      WaitNanos.fetch_add ( std::chrono::duration_cast<std::chrono::nanoseconds>
+                            ( std::chrono::steady_clock::now() - t0 ).count(),
+                            std::memory_order_relaxed );
+  }
+
+  /// not copyable.
+  utlSharedLock ( const utlSharedLock& );
+
+  /// not assignable.
+  utlSharedLock& operator = ( const utlSharedLock& );
+};
+
+/** Epoch based reclamation, for data read without locks.
+ *
+ *	Readers enter() before following pointers into shared data, and leave()
+ *	when done. A writer which unlinked some memory calls synchronize(),
+ *	which returns once every reader that was inside when it was called
+ *	has left. Then, no reader can still hold a pointer to that memory,
+ *	and it may be freed.
+ *
+ *	Readers are counted as in utlSharedLock, by thread, with one counter for
+ *	each parity of the current epoch. synchronize() advances the epoch and
+ *	waits for the counters of the previous parity to drop to zero. Readers
+ *	never wait. Only one thread at a time may call synchronize().
+ */
+class utlEpoch {
+ public:
+
+  /// number of reader counters.
+  enum { Slots = 64 };
+
+  /// a read-side critical section, for the lifetime of the guard.
+  class Guard {
+   public:
+    /// enters the critical section.
+    explicit Guard ( const utlEpoch& e ) : E ( e ), Ticket ( e.enter ( ) ) { }
+    /// leaves the critical section.
+    ~Guard ( ) { E.leave ( Ticket ); }
+   private:
+    /// the epoch.
+    const utlEpoch& E;
+    /// ticket returned by enter().
+    int Ticket;
+    /// not copyable.
+    Guard ( const Guard& );
+    /// not assignable.
+    Guard& operator = ( const Guard& );
+  };
+
+  /// empty constructor.
+  utlEpoch ( ) : Epoch ( 0 ) {
+      for ( int i = 0; i < Slots; ++i ) Readers[i].Count[0] = Readers[i].Count[1] = 0;
+  }
+
+  /// enters a read-side critical section, and returns a ticket for leave().
+  int enter ( ) const {
+      int s = utlThreadSlot ( Slots );
+      for ( ; ; ) {
+           unsigned e = Epoch.load ( );
+           std::atomic<int>& c = Readers[s].Count[e & 1];
+           c.fetch_add ( 1 );
+           if ( Epoch.load ( ) == e ) return 2 * s + ( e & 1 );
+           c.fetch_sub ( 1 );
+      }
+  }
+
+  /// leaves a read-side critical section.
+  void leave ( int ticket ) const {
+      Readers[ticket >> 1].Count[ticket & 1].fetch_sub ( 1, std::memory_order_release );
+  }
+
+  /// waits for the readers inside a critical section to leave it.
+  void synchronize ( ) {
+      unsigned e = Epoch.fetch_add ( 1 );
+      for ( int i = 0; i < Slots; ++i )
+           while ( Readers[i].Count[e & 1].load ( ) != 0 )
+                   std::this_thread::yield ( );
+  }
+
+ private:
+
+  /// reader counters of a slot, alone in their cache line.
+  struct Slot {
+     /// number of readers, by parity of the epoch they entered.
+     std::atomic<int> Count[2];
+     /// padding up to a cache line.
+     char Pad[64 - 2 * sizeof(std::atomic<int>)];
+  };
+
+  /// reader counters.
+  mutable Slot Readers[Slots];
+
+  /// current epoch.
+  std::atomic<unsigned> Epoch;
+
+  /// not copyable.
+  utlEpoch ( const utlEpoch& );
+
+  /// not assignable.
+  utlEpoch& operator = ( const utlEpoch& );
+};
+
+#endif
@@ -15,7 +15,9 @@
 #ifndef __UTLSORTER_H__
 #define __UTLSORTER_H__
 
+#include <thread>
 #include "utlConfig.h"
+#include "Exception.h"
 
 /**	compares the keys of two objects. 
  *
@@ -85,6 +87,10 @@ QSORT,
 ISORT
 };	
 
+/// smallest piece of an array given to a thread by psort().
+enum { MinPiece = 8192 };
+
+
  /** @name constructor  */ 
  //@{
 
@@ -92,7 +98,7 @@ ISORT
  utlSorter () : compare (Cmp()) { }
 
  /// constructor from a comparison function object.
- utlSorter ( const Cmp& C ) : compare (C()) { }
+ utlSorter ( const Cmp& C ) : compare (C) { }
 
  //@}
 
@@ -124,6 +130,52 @@ ISORT
        }
    }
 
+ /** parallel merge sort. Array X = (X0, X1, ...., Xn-1) is cut 
+  *	into one piece per thread, and the pieces are sorted at the
+  *	same time by merge sort. Then, adjacent pieces are merged pairwise,
+  *	the merges of each pass also running at the same time, until
+  *	a single piece is left. Stable. <br>
+  *	Note: pieces have at least MinPiece records, so small arrays
+  *	are sorted by the calling thread alone.
+  *	
+  *	@param X array to be sorted.
+  *	@param n number of elements in X.
+  *	@param threads number of threads, or 0 for one per hardware thread.
+  *	@see msort(), merge().
+  */
+  void psort ( Etype* X, int n, int threads = 0 ) const {
+     if ( threads <= 0 ) threads = (int) std::thread::hardware_concurrency ( );
+     if ( threads > n / MinPiece ) threads = n / MinPiece;
+     if ( threads <= 1 ) { sort ( X, n, MSORT ); return; }
+
+     int l = ( n + threads - 1 ) / threads;	// length of the pieces
+     std::thread* T = new std::thread [threads];
+     int t = 0;
+     for ( int i = 0; i < n; i += l ) {
+       int m = ( n - i < l ? n - i : l );
+       T[t++] = std::thread ( [=] { sort ( X + i, m, MSORT ); } );
+     }
+     for ( int k = 0; k < t; ++k ) T[k].join ( );
+
+     Etype* Y = new Etype [n];		// auxiliary array
+     Etype* S = X;
+     Etype* Z = Y;
+     for ( ; l < n; l *= 2 ) {		// merge pieces of length l from S to Z
+       t = 0;
+       for ( int i = 0; i < n; i += 2*l ) {
+         int e = ( n - i > 2*l ? i + 2*l : n ) - 1;
+         int m = ( i + l - 1 < e ? i + l - 1 : e );
+         T[t++] = std::thread ( [=] { merge ( S, i, m, e, Z ); } );
+       }
+       for ( int k = 0; k < t; ++k ) T[k].join ( );
+       Etype* W = S; S = Z; Z = W;		// interchange role of S and Z
+     }
+     if ( S != X )
+       for ( int i = 0; i < n; ++i ) X[i] = S[i];
+     delete[] Y;
+     delete[] T;
+  }
+
  /** quick select. finds Kth smallest of first N items in array X=(Xm, ..., Xn).
   *	A recursive routine finds Kth smallest and puts it at X[k+m-1].
   *	The average computational time is O(n), and the worst case is 
@@ -484,6 +536,74 @@ ISORT
 
 };
 
+/** orders pointers to items as Cmp orders the items.
+ *  Used for sorting a range without moving its items (see utlSortUnique).
+ */
+template <class Etype, class Cmp> class utlDerefLess {
+  public:
+   /// constructor from the comparison object of a tree.
+   utlDerefLess ( const Cmp& C ) : compare ( &C ) { }
+   /// returns whether *x comes before *y.
+   bool operator ( ) ( const Etype* x, const Etype* y ) const
+       { return (*compare) ( *x, *y ); }
+  private:
+   /// comparison object.
+   const Cmp* compare;
+};
+
+/** orders pointers to pairs by key: pairs whose keys match (operator neq)
+ *  are equivalent, whatever their values.
+ */
+template <class Etype, class Cmp> class utlDerefLessP {
+  public:
+   /// constructor from the comparison object of a tree.
+   utlDerefLessP ( const Cmp& C ) : compare ( &C ) { }
+   /// returns whether the key of *x comes before the key of *y.
+   bool operator ( ) ( const Etype* x, const Etype* y ) const
+       { return compare->neq ( *x, *y ) && (*compare) ( *x, *y ); }
+  private:
+   /// comparison object.
+   const Cmp* compare;
+};
+
+/** gathers pointers to the items of a range, in order, and keeps the
+ *  first of each run of equivalent items. The range is sorted first,
+ *  through utlSorter::psort, unless it is sorted already. Only pointers
+ *  are moved, so items need no assignment (utlPair<const Key,T>).
+ *
+ *  @param first beginning of the range (forward iterator).
+ *  @param last end of the range.
+ *  @param L orders pointers to items (utlDerefLess, utlDerefLessP).
+ *  @param sort whether the range may be out of order. If not, and it is,
+ *         an exception is raised.
+ *  @param threads number of threads used for sorting, or 0 for one per
+ *         hardware thread.
+ *  @param P pointers to the items kept, allocated by new[].
+ *  @return number of items kept.
+ */
+template <class Etype, class Less, class Iter>
+int utlSortUnique ( Iter first, Iter last, const Less& L, int sort, 
+                    int threads, const Etype**& P ) {
+    int n = 0;
+    for ( Iter i = first; i != last; ++i ) ++n;
+    P = new const Etype* [n > 0 ? n : 1];
+    int sorted = 1;
+    n = 0;
+    for ( Iter i = first; i != last; ++i, ++n ) {
+        P[n] = &*i;
+        if ( n > 0 && L ( P[n], P[n-1] ) ) sorted = 0;
+    }
+    EXCEPTION ( !sorted && !sort, "Range is not sorted; build aborted" );
+    if ( !sorted ) {
+        utlSorter<const Etype*,Less> S ( L );
+        S.psort ( P, n, threads );
+    }
+    int m = 0;
+    for ( int i = 0; i < n; ++i )
+        if ( m == 0 || L ( P[m-1], P[i] ) ) P[m++] = P[i];
+    return m;
+}
+
 #include "utlIteratorBase.h"
 
 #if !defined(__GNUC__) || !defined(USE_STL) // gnu g++ has an extended version of STL
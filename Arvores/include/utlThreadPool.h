@@ -0,0 +1,141 @@
+/*
+   utlThreadPool.h
+
+   A fixed pool of threads, for fork-join algorithms.
+*/
+
+#ifndef __UTLTHREADPOOL_H__
+#define __UTLTHREADPOOL_H__
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** A fixed pool of worker threads, running the tasks forked by a divide
+ *  and conquer algorithm (see SearchTreeCore::SetOperation).
+ *
+ *	A thread forks a task, does the other half of the work, and then joins
+ *	the task. If no worker took the task meanwhile, the joining thread runs
+ *	it itself: a thread never waits for a task which is not running, and a
+ *	task forked while every worker is busy costs no thread switch. Workers
+ *	take the oldest task first, which is the largest one.
+ *
+ *	The shared pool is started on first use, with one worker less than the
+ *	hardware threads: the forking thread is the last one. Thus, no thread
+ *	is created per fork, and forks beyond the size of the pool do not
+ *	oversubscribe the cores.
+ */
+class utlThreadPool {
+ public:
+
+  /// a task forked on the pool. It must live until it is joined.
+  class Task {
+    friend class utlThreadPool;
+   public:
+    /// constructor from the work to be done.
+    Task ( const std::function<void()>& f ) : Run ( f ), State ( Queued ) { }
+   private:
+    /// work to be done.
+    std::function<void()> Run;
+    /// Queued, Running or Done, guarded by the mutex of the pool.
+    int State;
+  };
+
+  /// returns the pool shared by every algorithm.
+  static utlThreadPool& shared ( ) {
+      static utlThreadPool Pool ( Hardware ( ) - 1 );
+      return Pool;
+  }
+
+  /// returns the number of threads which may run tasks: the workers and the caller.
+  int size ( ) const { return (int) Workers.size ( ) + 1; }
+
+  /// queues t, for a worker to run.
+  void fork ( Task& t ) {
+      {
+        std::lock_guard<std::mutex> l ( M );
+        Queue.push_back ( &t );
+      }
+      Ready.notify_one ( );
+  }
+
+  /// runs t, if no worker took it yet, or waits until it is done.
+  void join ( Task& t ) {
+      std::unique_lock<std::mutex> l ( M );
+      if ( t.State == Queued ) {
+           Queue.erase ( std::find ( Queue.begin ( ), Queue.end ( ), &t ) );
+           t.State = Running;
+           l.unlock ( );
+           t.Run ( );
+           return;
+      }
+      Finished.wait ( l, [&t] { return t.State == Done; } );
+  }
+
+  /// destructor: stops the workers.
+  ~utlThreadPool ( ) {
+      {
+        std::lock_guard<std::mutex> l ( M );
+        Stop = true;
+      }
+      Ready.notify_all ( );
+      for ( size_t i = 0; i < Workers.size ( ); ++i ) Workers[i].join ( );
+  }
+
+ private:
+
+  /// states of a task.
+  enum { Queued, Running, Done };
+
+  /// returns the number of hardware threads, 1 if unknown.
+  static int Hardware ( ) {
+      int n = (int) std::thread::hardware_concurrency ( );
+      return n > 0 ? n : 1;
+  }
+
+  /// constructor: starts n workers.
+  utlThreadPool ( int n ) : Stop ( false ) {
+      for ( int i = 0; i < n; ++i ) Workers.push_back ( std::thread ( [this] { work ( ); } ) );
+  }
+
+  /// runs the queued tasks, until the pool is destroyed.
+  void work ( ) {
+      std::unique_lock<std::mutex> l ( M );
+      for ( ; ; ) {
+          Ready.wait ( l, [this] { return Stop || !Queue.empty ( ); } );
+          if ( Queue.empty ( ) ) return;
+          Task* t = Queue.front ( );
+          Queue.pop_front ( );
+          t->State = Running;
+          l.unlock ( );
+          t->Run ( );
+          l.lock ( );
+          t->State = Done;
+          Finished.notify_all ( );
+      }
+  }
+
+  /// guards the queue and the states of the tasks.
+  std::mutex M;
+
+  /// signaled when a task is queued, or the pool stops.
+  std::condition_variable Ready;
+
+  /// signaled when a worker finished a task.
+  std::condition_variable Finished;
+
+  /// tasks forked and not taken yet.
+  std::deque<Task*> Queue;
+
+  /// whether the pool is being destroyed.
+  bool Stop;
+
+  /// the worker threads.
+  std::vector<std::thread> Workers;
+};
+
+#endif
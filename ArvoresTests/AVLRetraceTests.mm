@@ -0,0 +1,140 @@
+//
+//  AVLRetraceTests.mm
+//  ArvoresTests
+//
+//  Iterative Insert and Remove of AVL trees: the heights and balance of
+//  every node after retracing stops early, the sizes and parents kept
+//  above it, and paths too long to have been walked recursively.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <set>
+#include "AVLTree.h"
+
+/** returns the number of nodes under p whose height is not one more than
+ *  that of their higher child, or whose children differ by more than one
+ *  in height, or whose items are out of order.
+ */
+template <class Tree>
+static int checkHeights ( const Tree& t, const typename Tree::BinaryNode* p ) {
+    int h = t.Height ( p );
+    if ( h < 0 ) return 0;
+    int hl = t.Height ( p->GetLeft ( ) ), hr = t.Height ( p->GetRight ( ) );
+    int errors = h != ( hl > hr ? hl : hr ) + 1;
+    errors += hl - hr > 1 || hr - hl > 1;
+    errors += hl >= 0 && !( p->GetLeft ( )->GetElement ( ) < p->GetElement ( ) );
+    errors += hr >= 0 && !( p->GetElement ( ) < p->GetRight ( )->GetElement ( ) );
+    return errors + checkHeights ( t, p->GetLeft ( ) ) + checkHeights ( t, p->GetRight ( ) );
+}
+
+/// returns the number of nodes under p whose size is not that of their children plus one.
+template <class Tree>
+static int checkSizes ( const Tree& t, const typename Tree::BinaryNode* p ) {
+    if ( t.Height ( p ) < 0 ) return 0;
+    int errors = p->GetSize ( ) != t.Size ( p->GetLeft ( ) ) + t.Size ( p->GetRight ( ) ) + 1;
+    return errors + checkSizes ( t, p->GetLeft ( ) ) + checkSizes ( t, p->GetRight ( ) );
+}
+
+/// returns the number of nodes under p whose children do not link back to them.
+template <class Tree>
+static int checkParents ( const Tree& t, const typename Tree::BinaryNode* p ) {
+    if ( t.Height ( p ) < 0 ) return 0;
+    int errors = 0;
+    if ( t.Height ( p->GetLeft ( ) ) >= 0 ) errors += p->GetLeft ( )->GetParent ( ) != p;
+    if ( t.Height ( p->GetRight ( ) ) >= 0 ) errors += p->GetRight ( )->GetParent ( ) != p;
+    return errors + checkParents ( t, p->GetLeft ( ) ) + checkParents ( t, p->GetRight ( ) );
+}
+
+/** inserts and removes random keys below n in t, against a std::set,
+ *  checking the results, and every node every few steps.
+ *  Returns the number of errors.
+ */
+template <class Tree>
+static int checkRandomOps ( Tree& t, int n, int ops, unsigned seed ) {
+    std::set<int> s;
+    TestRandom r ( seed );
+    int errors = 0;
+    for ( int i = 0; i < ops; ++i ) {
+        int k = r ( n );
+        if ( r ( 2 ) ) errors += t.Insert ( k ) != (int) s.insert ( k ).second;
+        else           errors += t.Remove ( k ) != (int) s.erase ( k );
+        if ( i % 97 == 0 ) errors += checkHeights ( t, t.GetRoot ( ) );
+    }
+    for ( int k = 0; k < n; ++k ) errors += ( t.IsFound ( k ) != 0 ) != ( s.count ( k ) != 0 );
+    errors += t.Size ( t.GetRoot ( ) ) != (int) s.size ( );
+    return errors + checkHeights ( t, t.GetRoot ( ) );
+}
+
+@interface AVLRetraceTests : XCTestCase
+
+@end
+
+@implementation AVLRetraceTests
+
+/// every node keeps its height and balance, however early retracing stops.
+- (void)testRandomOps {
+    StaticAVLTree<int> t;
+    XCTAssertEqual ( checkRandomOps ( t, 3000, 60000, 1 ), 0 );
+    CompactAVLTree<int> c;
+    XCTAssertEqual ( checkRandomOps ( c, 3000, 60000, 2 ), 0 );
+    IndexedAVLTree<int> x;
+    XCTAssertEqual ( checkRandomOps ( x, 3000, 60000, 3 ), 0 );
+}
+
+/// the sizes above the node where retracing stopped are updated.
+- (void)testSizesAboveRetrace {
+    CountedAVLTree<int> t;
+    XCTAssertEqual ( checkRandomOps ( t, 2000, 30000, 4 ), 0 );
+    XCTAssertEqual ( checkSizes ( t, t.GetRoot ( ) ), 0 );
+    TestRandom r ( 5 );
+    int errors = 0;
+    for ( int i = 0; i < 2000; ++i ) {
+        t.Insert ( r ( 4000 ) );
+        t.Remove ( r ( 4000 ) );
+        if ( i % 50 == 0 ) errors += checkSizes ( t, t.GetRoot ( ) );
+    }
+    XCTAssertEqual ( errors, 0 );
+}
+
+/// a successor relinked in place of a removed node keeps the parent links right.
+- (void)testParentsAfterRemove {
+    ParentAVLTree<int> t;
+    XCTAssertEqual ( checkRandomOps ( t, 2000, 30000, 6 ), 0 );
+    XCTAssertEqual ( checkParents ( t, t.GetRoot ( ) ), 0 );
+    XCTAssert ( t.GetRoot ( )->GetParent ( ) == NULL || t.Height ( t.GetRoot ( )->GetParent ( ) ) < 0 );
+    for ( int k = 0; k < 2000; k += 2 ) t.Remove ( k );
+    XCTAssertEqual ( checkParents ( t, t.GetRoot ( ) ), 0 );
+    XCTAssertEqual ( checkHeights ( t, t.GetRoot ( ) ), 0 );
+}
+
+/// removing a node with two children relinks its successor, and copies no item.
+- (void)testRemoveInnerNodes {
+    StaticAVLTree<int> t;
+    for ( int k = 0; k < 1023; ++k ) t.Insert ( k );
+    const StaticAVLTree<int>::BinaryNode* successor = t.Lookup ( t.GetRoot ( )->GetElement ( ) + 1 );
+    int root = t.GetRoot ( )->GetElement ( );
+    XCTAssertTrue ( t.Remove ( root ) );
+    XCTAssert ( t.Lookup ( root + 1 ) == successor );
+    int errors = 0;
+    while ( !t.IsEmpty ( ) ) {
+        errors += !t.Remove ( t.GetRoot ( )->GetElement ( ) );
+        errors += checkHeights ( t, t.GetRoot ( ) );
+    }
+    XCTAssertEqual ( errors, 0 );
+}
+
+/// sorted inserts and removes of many items walk no recursion.
+- (void)testLongSequences {
+    const int n = 1 << 20;
+    StaticAVLTree<int> t;
+    for ( int k = 0; k < n; ++k ) t.Insert ( k );
+    XCTAssertEqual ( t.Height ( t.GetRoot ( ) ), 20 );
+    for ( int k = n - 1; k >= n / 2; --k ) t.Remove ( k );
+    XCTAssertEqual ( t.Size ( t.GetRoot ( ) ), n / 2 );
+    XCTAssertEqual ( checkHeights ( t, t.GetRoot ( ) ), 0 );
+    XCTAssertEqual ( t.FindMax ( ), n / 2 - 1 );
+}
+
+@end
@@ -0,0 +1,164 @@
+//
+//  AggregateTests.mm
+//  ArvoresTests
+//
+//  Trees whose nodes aggregate their subtrees with a monoid: the
+//  aggregate of every node after changes, RangeAggregate against sums,
+//  minima and maxima over a std::set, and aggregate of sets and maps.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <set>
+#include <string>
+#include "AVLTree.h"
+#include "AATree.h"
+#include "RedBlack.h"
+#include "utlMonoid.h"
+#include "utlSet.h"
+#include "utlMap.h"
+
+typedef utlSumMonoid<int,long long> SumMonoid;
+typedef utlMinMonoid<int> MinMonoid;
+typedef utlMaxMonoid<int> MaxMonoid;
+typedef utlPair<const int,int> IntPair;
+typedef compare_pair<IntPair> PairLess;
+typedef utlSet<int,compare_to<int>,AugmentedAVLTree<int,SumMonoid> > SumSet;
+typedef utlMap<int,int,PairLess,AugmentedAATree<IntPair,utlMaxMonoid<IntPair>,PairLess> > MaxMap;
+
+/// the items in order, separated by commas: a monoid which is not commutative.
+struct ConcatMonoid {
+    typedef std::string value_type;
+    static value_type identity ( ) { return value_type ( ); }
+    static value_type value ( const int& e ) { return std::to_string ( e ) + ","; }
+    static value_type combine ( const value_type& a, const value_type& b ) { return a + b; }
+};
+
+/// returns the number of nodes under p whose aggregate does not combine their subtree.
+template <class Monoid, class Tree>
+static int checkNodes ( const Tree& t, const typename Tree::BinaryNode* p ) {
+    if ( t.Size ( p ) == 0 ) return 0;
+    typename Monoid::value_type a = Monoid::identity ( );
+    if ( t.Size ( p->GetLeft ( ) ) > 0 ) a = p->GetLeft ( )->GetAggregate ( );
+    a = Monoid::combine ( a, Monoid::value ( p->GetElement ( ) ) );
+    if ( t.Size ( p->GetRight ( ) ) > 0 ) a = Monoid::combine ( a, p->GetRight ( )->GetAggregate ( ) );
+    int errors = !( a == p->GetAggregate ( ) );
+    return errors + checkNodes<Monoid> ( t, p->GetLeft ( ) ) + checkNodes<Monoid> ( t, p->GetRight ( ) );
+}
+
+/** returns the number of random ranges of keys below n whose aggregate
+ *  in t differs from that of the items of s in the range.
+ */
+template <class Monoid, class Tree>
+static int checkRanges ( const Tree& t, const std::set<int>& s, int n, TestRandom& r ) {
+    int errors = 0;
+    for ( int i = 0; i < 200; ++i ) {
+        int a = r ( n ), b = r ( n );
+        typename Monoid::value_type x = Monoid::identity ( );
+        for ( std::set<int>::const_iterator it = s.lower_bound ( a ); it != s.end ( ) && *it <= b; ++it )
+            x = Monoid::combine ( x, Monoid::value ( *it ) );
+        errors += !( t.RangeAggregate ( a, b ) == x );
+    }
+    return errors;
+}
+
+/** inserts and removes random keys below n in t, against a std::set,
+ *  and returns the number of wrong aggregates of nodes and ranges.
+ */
+template <class Monoid, class Tree>
+static int checkRandomOps ( Tree& t, int n, int ops, unsigned seed ) {
+    std::set<int> s;
+    TestRandom r ( seed );
+    int errors = 0;
+    for ( int i = 0; i < ops; ++i ) {
+        int k = r ( n );
+        if ( r ( 3 ) ) { t.Insert ( k ); s.insert ( k ); }
+        else           { t.Remove ( k ); s.erase ( k ); }
+        if ( i % 500 == 0 ) errors += checkNodes<Monoid> ( t, t.GetRoot ( ) ) + checkRanges<Monoid> ( t, s, n, r );
+    }
+    return errors + checkNodes<Monoid> ( t, t.GetRoot ( ) ) + checkRanges<Monoid> ( t, s, n, r );
+}
+
+@interface AggregateTests : XCTestCase
+
+@end
+
+@implementation AggregateTests
+
+/// sums on every augmented tree.
+- (void)testSums {
+    AugmentedAVLTree<int,SumMonoid> avl;
+    AugmentedAATree<int,SumMonoid> aa;
+    AugmentedRedBlackTree<int,SumMonoid> rb ( -1 );
+    XCTAssertEqual ( checkRandomOps<SumMonoid> ( avl, 3000, 20000, 1 ), 0 );
+    XCTAssertEqual ( checkRandomOps<SumMonoid> ( aa, 3000, 20000, 2 ), 0 );
+    XCTAssertEqual ( checkRandomOps<SumMonoid> ( rb, 3000, 5000, 3 ), 0 );
+}
+
+/// minima and maxima, and the identity of an empty range.
+- (void)testMinAndMax {
+    AugmentedAVLTree<int,MinMonoid> least;
+    AugmentedRedBlackTree<int,MaxMonoid> most ( -1 );
+    XCTAssertEqual ( checkRandomOps<MinMonoid> ( least, 3000, 10000, 4 ), 0 );
+    XCTAssertEqual ( checkRandomOps<MaxMonoid> ( most, 3000, 5000, 5 ), 0 );
+    AugmentedAVLTree<int,MinMonoid> t;
+    XCTAssertEqual ( t.RangeAggregate ( 0, 100 ), MinMonoid::identity ( ) );
+    for ( int k = 10; k < 20; ++k ) t.Insert ( k );
+    XCTAssertEqual ( t.RangeAggregate ( 20, 100 ), MinMonoid::identity ( ) );
+    XCTAssertEqual ( t.RangeAggregate ( 15, 12 ), MinMonoid::identity ( ) );
+    XCTAssertEqual ( t.RangeAggregate ( 0, 100 ), 10 );
+}
+
+/// the items are combined in order.
+- (void)testOrderOfCombination {
+    AugmentedAVLTree<int,ConcatMonoid> t;
+    XCTAssertEqual ( checkRandomOps<ConcatMonoid> ( t, 300, 3000, 6 ), 0 );
+    AugmentedAATree<int,ConcatMonoid> u;
+    for ( int k = 9; k >= 0; --k ) u.Insert ( k );
+    XCTAssert ( u.RangeAggregate ( 2, 5 ) == "2,3,4,5," );
+}
+
+/// batches, joins, splits and copies keep the aggregates.
+- (void)testAggregatesAfterBulkChanges {
+    typedef AugmentedAVLTree<int,SumMonoid> SumTree;
+    SumTree t, less, greater;
+    std::vector<int> keys = shuffledKeys ( 4000, 7 );
+    t.InsertBatch ( keys.begin ( ), keys.end ( ) );
+    XCTAssertEqual ( checkNodes<SumMonoid> ( t, t.GetRoot ( ) ), 0 );
+    XCTAssertEqual ( t.RangeAggregate ( 0, 3999 ), 3999LL * 4000 / 2 );
+    t.RemoveBatch ( keys.begin ( ), keys.begin ( ) + 2000 );
+    XCTAssertEqual ( checkNodes<SumMonoid> ( t, t.GetRoot ( ) ), 0 );
+    SumTree c ( t );
+    t.Split ( 2000, less, greater );
+    XCTAssertEqual ( checkNodes<SumMonoid> ( less, less.GetRoot ( ) ), 0 );
+    XCTAssertEqual ( checkNodes<SumMonoid> ( greater, greater.GetRoot ( ) ), 0 );
+    XCTAssertEqual ( less.RangeAggregate ( 0, 4000 ) + greater.RangeAggregate ( 0, 4000 ) + ( c.IsFound ( 2000 ) ? 2000 : 0 ),
+                     c.RangeAggregate ( 0, 4000 ) );
+    t.Join ( less, 2000, greater );
+    XCTAssertEqual ( checkNodes<SumMonoid> ( t, t.GetRoot ( ) ), 0 );
+    XCTAssertEqual ( t.RangeAggregate ( 0, 4000 ), c.RangeAggregate ( 0, 4000 ) + ( c.IsFound ( 2000 ) ? 0 : 2000 ) );
+    t.Build ( keys.begin ( ), keys.end ( ) );
+    XCTAssertEqual ( checkNodes<SumMonoid> ( t, t.GetRoot ( ) ), 0 );
+    XCTAssertEqual ( t.RangeAggregate ( 100, 199 ), 14950LL );
+}
+
+/// aggregate of sets sums keys, and of maps, their data.
+- (void)testSetsAndMaps {
+    SumSet s;
+    for ( int k = 1; k <= 100; ++k ) s.insert ( k );
+    XCTAssertEqual ( s.aggregate ( 1, 100 ), 5050LL );
+    XCTAssertEqual ( s.aggregate ( 50, 60 ), 605LL );
+    s.erase ( 55 );
+    XCTAssertEqual ( s.aggregate ( 50, 60 ), 550LL );
+
+    MaxMap m;
+    for ( int k = 0; k < 100; ++k ) m[k] = ( k * 37 ) % 101;
+    int most = 0;
+    for ( int k = 10; k <= 20; ++k ) most = max ( most, ( k * 37 ) % 101 );
+    XCTAssertEqual ( m.aggregate ( 10, 20 ), most );
+    m[15] = 1000;
+    XCTAssertEqual ( m.aggregate ( 10, 20 ), 1000 );
+}
+
+@end
@@ -0,0 +1,163 @@
+//
+//  BatchTests.mm
+//  ArvoresTests
+//
+//  InsertBatch and RemoveBatch on every tree: their counts and items
+//  against std::set, the balance they leave, and range inserts of
+//  utlSet and utlMap.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <math.h>
+#include <set>
+#include "AVLTree.h"
+#include "AATree.h"
+#include "RedBlack.h"
+#include "Splay.h"
+#include "Ordered.h"
+#include "ConcurrentAVLTree.h"
+#include "ConcurrentSkipList.h"
+#include "ConcurrentTree.h"
+#include "utlSet.h"
+#include "utlMap.h"
+
+typedef utlPair<const int,int> IntPair;
+typedef compare_pair<IntPair> PairLess;
+typedef StaticRedBlackTree<IntPair,PairLess> PairTree;
+typedef utlSet<int,compare_to<int>,AVLTree<int> > AVLSet;
+typedef utlMap<int,int,PairLess,RedBlackTree<IntPair,PairLess> > RBMap;
+
+/// returns m random keys below n, with repeats.
+static std::vector<int> randomBatch ( int m, int n, TestRandom& r ) {
+    std::vector<int> keys ( m );
+    for ( int i = 0; i < m; ++i ) keys[i] = r ( n );
+    return keys;
+}
+
+/// returns whether t, of n items, is higher than most * log2(n).
+template <class Tree>
+static int tooHigh ( const Tree& t, size_t n, double most ) {
+    return most > 0 && t.Height ( t.GetRoot ( ) ) + 1 > most * log2 ( n + 2.0 );
+}
+
+/// the height of the concurrent AVL tree is not checked.
+static int tooHigh ( const ConcurrentAVLTree<int>&, size_t, double ) { return 0; }
+
+/// a skip list has no height.
+static int tooHigh ( const ConcurrentSkipList<int>&, size_t, double ) { return 0; }
+
+/** returns the number of wrong counts and items while batches of random
+ *  keys below n, small and large, are inserted into and removed from t,
+ *  against a std::set. If most > 0, t must not be higher than most * log2
+ *  of its size.
+ */
+template <class Tree>
+static int checkBatches ( Tree& t, int n, double most, unsigned seed ) {
+    std::set<int> s;
+    TestRandom r ( seed );
+    int errors = 0;
+    for ( int round = 0; round < 40; ++round ) {
+        int m = round % 4 == 3 ? n : 1 + r ( n / 20 );
+        std::vector<int> batch = randomBatch ( m, n, r );
+        int changed = 0;
+        if ( r ( 3 ) ) {
+             for ( size_t i = 0; i < batch.size ( ); ++i ) changed += s.insert ( batch[i] ).second;
+             errors += t.InsertBatch ( batch.begin ( ), batch.end ( ), 1 + round % 3 ) != changed;
+        }
+        else {
+             for ( size_t i = 0; i < batch.size ( ); ++i ) changed += (int) s.erase ( batch[i] );
+             errors += t.RemoveBatch ( batch.begin ( ), batch.end ( ), 1 + round % 3 ) != changed;
+        }
+        for ( int k = 0; k < n; ++k ) errors += ( t.IsFound ( k ) != 0 ) != ( s.count ( k ) != 0 );
+        errors += tooHigh ( t, s.size ( ), most );
+    }
+    return errors;
+}
+
+@interface BatchTests : XCTestCase
+
+@end
+
+@implementation BatchTests
+
+/// trees which merge a batch by joins.
+- (void)testJoinableTrees {
+    StaticAVLTree<int> avl;
+    StaticRedBlackTree<int> rb ( -1 );
+    CountedAVLTree<int> counted;
+    XCTAssertEqual ( checkBatches ( avl, 4000, 1.45, 1 ), 0 );
+    XCTAssertEqual ( checkBatches ( rb, 4000, 2.0, 2 ), 0 );
+    XCTAssertEqual ( checkBatches ( counted, 4000, 1.45, 3 ), 0 );
+}
+
+/// trees which rebuild, or insert one item at a time.
+- (void)testOtherTrees {
+    StaticAATree<int> aa;
+    StaticSplayTree<int> splay;
+    StaticSearchTree<int> bst;
+    StaticOrderedSearchTree<int> ordered;
+    XCTAssertEqual ( checkBatches ( aa, 4000, 2.0, 4 ), 0 );
+    XCTAssertEqual ( checkBatches ( splay, 4000, 0, 5 ), 0 );
+    XCTAssertEqual ( checkBatches ( bst, 4000, 0, 6 ), 0 );
+    XCTAssertEqual ( checkBatches ( ordered, 4000, 0, 7 ), 0 );
+}
+
+/// concurrent trees sort the batch first, and apply it item by item.
+- (void)testConcurrentTrees {
+    ConcurrentAVLTree<int> avl;
+    ConcurrentSkipList<int> list;
+    XCTAssertEqual ( checkBatches ( avl, 3000, 0, 8 ), 0 );
+    XCTAssertEqual ( checkBatches ( list, 3000, 0, 9 ), 0 );
+    ConcurrentTree<StaticAVLTree<int> > locked;
+    std::vector<int> keys = shuffledKeys ( 1000, 10 );
+    XCTAssertEqual ( locked.InsertBatch ( keys.begin ( ), keys.end ( ) ), 1000 );
+    XCTAssertEqual ( locked.RemoveBatch ( keys.begin ( ), keys.begin ( ) + 500 ), 500 );
+    XCTAssertFalse ( locked.IsFound ( keys[0] ) );
+    XCTAssertTrue ( locked.IsFound ( keys[999] ) );
+}
+
+/// a pair is not inserted if its key is there, or earlier in the batch.
+- (void)testPairBatches {
+    PairTree t ( IntPair ( -1, 0 ) );
+    for ( int k = 0; k < 1000; k += 2 ) t.Insert ( IntPair ( k, -1 ) );
+    std::vector<IntPair> batch;
+    for ( int i = 0; i < 2000; ++i ) batch.push_back ( IntPair ( i % 1000, i ) );
+    XCTAssertEqual ( t.InsertBatchP ( batch.begin ( ), batch.end ( ) ), 500 );
+    int errors = 0;
+    for ( int k = 0; k < 1000; ++k ) {
+        const PairTree::BinaryNode* node = t.LookupP ( IntPair ( k, 0 ) );
+        errors += node == NULL || node->GetElement ( ).second != ( k % 2 ? k : -1 );
+    }
+    XCTAssertEqual ( errors, 0 );
+    std::vector<IntPair> keys;
+    for ( int k = 0; k < 1000; k += 3 ) keys.push_back ( IntPair ( k, 12345 ) );
+    XCTAssertEqual ( t.RemoveBatchP ( keys.begin ( ), keys.end ( ) ), (int) keys.size ( ) );
+    XCTAssert ( t.LookupP ( IntPair ( 3, 0 ) ) == NULL );
+    XCTAssert ( t.LookupP ( IntPair ( 4, 0 ) ) != NULL );
+}
+
+/// range inserts of utlSet and utlMap go through the batches.
+- (void)testRangeInserts {
+    AVLSet s;
+    for ( int k = 0; k < 100; ++k ) s.insert ( 2 * k );
+    std::vector<int> keys;
+    for ( int k = 0; k < 300; ++k ) keys.push_back ( k % 200 );
+    s.insert ( keys.begin ( ), keys.end ( ) );
+    XCTAssertEqual ( (int) s.size ( ), 200 );
+    int expected = 0, errors = 0;
+    for ( AVLSet::iterator it = s.begin ( ); it != s.end ( ); ++it ) errors += *it != expected++;
+    XCTAssertEqual ( errors, 0 );
+
+    RBMap m;
+    m[5] = 50;
+    std::vector<IntPair> pairs;
+    for ( int k = 0; k < 10; ++k ) pairs.push_back ( IntPair ( k, k ) );
+    m.insert ( pairs.begin ( ), pairs.end ( ) );
+    XCTAssertEqual ( (int) m.size ( ), 10 );
+    XCTAssertEqual ( m.find ( 5 )->second, 50 );
+    XCTAssertEqual ( m.find ( 6 )->second, 6 );
+}
+
+@end
@@ -0,0 +1,176 @@
+//
+//  BulkBuildTests.mm
+//  ArvoresTests
+//
+//  Trees built at once from sorted or unsorted ranges: their items,
+//  their shape, and their balance under later changes. Also the
+//  parallel merge sort which sorts the ranges.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <math.h>
+#include <set>
+#include "AVLTree.h"
+#include "AATree.h"
+#include "RedBlack.h"
+#include "Ordered.h"
+#include "ConcurrentSkipList.h"
+#include "utlSet.h"
+#include "utlMap.h"
+
+typedef utlPair<const int,int> IntPair;
+typedef compare_pair<IntPair> PairLess;
+typedef StaticAVLTree<IntPair,PairLess> PairTree;
+typedef utlMap<int,int,PairLess,AVLTree<IntPair,PairLess> > AVLMap;
+typedef utlSet<int,compare_to<int>,AVLTree<int> > AVLSet;
+
+/// an item sorted by key only, remembering its place in the input.
+struct Keyed {
+    int Key, Place;
+    bool operator < ( const Keyed& k ) const { return Key < k.Key; }
+};
+
+/// returns keys below limit, with repeats, in random order.
+static std::vector<int> keysWithRepeats ( int n, int limit, unsigned seed ) {
+    std::vector<int> keys ( n );
+    TestRandom r ( seed );
+    for ( int i = 0; i < n; ++i ) keys[i] = r ( limit );
+    return keys;
+}
+
+/** returns the number of differences between the items of t and those
+ *  of s, which are below limit, and whether t is higher than most * log2(n).
+ */
+template <class Tree>
+static int checkItems ( const Tree& t, const std::set<int>& s, int limit, double most ) {
+    int errors = 0;
+    for ( int k = 0; k < limit; ++k ) errors += ( t.Lookup ( k ) != NULL ) != ( s.count ( k ) != 0 );
+    errors += t.Size ( t.GetRoot ( ) ) != (int) s.size ( );
+    errors += most > 0 && t.Height ( t.GetRoot ( ) ) + 1 > most * log2 ( s.size ( ) + 2.0 );
+    return errors;
+}
+
+/** returns the number of errors of t, built from keys below limit, and
+ *  then changed at random against a std::set.
+ */
+template <class Tree>
+static int checkBuild ( Tree& t, const std::vector<int>& keys, int limit, double most ) {
+    std::set<int> s ( keys.begin ( ), keys.end ( ) );
+    int errors = t.Build ( keys.begin ( ), keys.end ( ) ) != (int) s.size ( );
+    errors += checkItems ( t, s, limit, most );
+    TestRandom r ( (unsigned) keys.size ( ) );
+    for ( int i = 0; i < (int) keys.size ( ); ++i ) {
+        int k = r ( limit );
+        if ( r ( 2 ) ) { t.Insert ( k ); s.insert ( k ); }
+        else           { t.Remove ( k ); s.erase ( k ); }
+    }
+    return errors + checkItems ( t, s, limit, most );
+}
+
+@interface BulkBuildTests : XCTestCase
+
+@end
+
+@implementation BulkBuildTests
+
+/// an unsorted range with repeats gives a balanced tree, which stays so.
+- (void)testBuildUnsorted {
+    std::vector<int> keys = keysWithRepeats ( 20000, 30000, 1 );
+    StaticAVLTree<int> avl;
+    StaticAATree<int> aa;
+    StaticRedBlackTree<int> rb ( -1 );
+    StaticOrderedSearchTree<int> ordered;
+    XCTAssertEqual ( checkBuild ( avl, keys, 30000, 1.45 ), 0 );
+    XCTAssertEqual ( checkBuild ( aa, keys, 30000, 2.0 ), 0 );
+    XCTAssertEqual ( checkBuild ( rb, keys, 30000, 2.0 ), 0 );
+    XCTAssertEqual ( checkBuild ( ordered, keys, 30000, 0 ), 0 );
+}
+
+/// a sorted range is built as a perfectly balanced tree, replacing the items.
+- (void)testBuildFromSorted {
+    std::vector<int> keys;
+    for ( int k = 0; k < 1023; ++k ) keys.push_back ( 3 * k );
+    StaticAVLTree<int> t;
+    for ( int k = 0; k < 100; ++k ) t.Insert ( -k - 1 );
+    XCTAssertEqual ( t.BuildFromSorted ( keys.begin ( ), keys.end ( ) ), 1023 );
+    XCTAssertEqual ( t.Height ( t.GetRoot ( ) ), 9 );
+    XCTAssertFalse ( t.IsFound ( -1 ) );
+    int missing = 0;
+    for ( size_t i = 0; i < keys.size ( ); ++i ) missing += !t.IsFound ( keys[i] );
+    XCTAssertEqual ( missing, 0 );
+    XCTAssertEqual ( t.FindMin ( ), 0 );
+    XCTAssertEqual ( t.FindMax ( ), 3 * 1022 );
+}
+
+/// of pairs with the same key, the first one is kept, as InsertP would.
+- (void)testBuildP {
+    std::vector<IntPair> pairs;
+    for ( int i = 0; i < 3000; ++i ) pairs.push_back ( IntPair ( ( i * 7 ) % 1000, i ) );
+    PairTree t;
+    XCTAssertEqual ( t.BuildP ( pairs.begin ( ), pairs.end ( ) ), 1000 );
+    int errors = 0;
+    for ( int k = 0; k < 1000; ++k ) {
+        const PairTree::BinaryNode* node = t.LookupP ( IntPair ( k, 0 ) );
+        errors += node == NULL || node->GetElement ( ).second >= 1000;
+    }
+    XCTAssertEqual ( errors, 0 );
+}
+
+/// the range constructors of utlSet and utlMap build at once.
+- (void)testRangeConstructors {
+    std::vector<int> keys = keysWithRepeats ( 5000, 3000, 2 );
+    std::set<int> s ( keys.begin ( ), keys.end ( ) );
+    AVLSet set ( keys.begin ( ), keys.end ( ) );
+    XCTAssertEqual ( set.size ( ), s.size ( ) );
+    int errors = 0;
+    std::set<int>::const_iterator it = s.begin ( );
+    for ( AVLSet::iterator i = set.begin ( ); i != set.end ( ); ++i, ++it ) errors += *i != *it;
+    XCTAssertEqual ( errors, 0 );
+
+    std::vector<IntPair> pairs;
+    for ( size_t i = 0; i < keys.size ( ); ++i ) pairs.push_back ( IntPair ( keys[i], (int) i ) );
+    AVLMap m ( pairs.begin ( ), pairs.end ( ) );
+    XCTAssertEqual ( m.size ( ), s.size ( ) );
+    errors = 0;
+    for ( size_t i = 0; i < keys.size ( ); ++i ) errors += m.find ( keys[i] )->second > (int) i;
+    XCTAssertEqual ( errors, 0 );
+}
+
+/// the skip list builds from a range too.
+- (void)testBuildSkipList {
+    std::vector<int> keys = keysWithRepeats ( 10000, 8000, 3 );
+    std::set<int> s ( keys.begin ( ), keys.end ( ) );
+    ConcurrentSkipList<int> l;
+    l.Insert ( -5 );
+    XCTAssertEqual ( l.Build ( keys.begin ( ), keys.end ( ) ), (int) s.size ( ) );
+    int errors = 0;
+    std::set<int>::const_iterator it = s.begin ( );
+    for ( const ConcurrentSkipList<int>::BinaryNode* p = l.GetRoot ( ); p != NULL; p = p->GetRight ( ), ++it )
+        errors += it == s.end ( ) || p->GetElement ( ) != *it;
+    XCTAssertEqual ( errors, 0 );
+    XCTAssert ( it == s.end ( ) );
+    errors = 0;
+    for ( int k = 0; k < 8000; ++k ) errors += ( l.IsFound ( k ) != 0 ) != ( s.count ( k ) != 0 );
+    XCTAssertEqual ( errors, 0 );
+}
+
+/// psort sorts on several threads, and keeps equal items in their order.
+- (void)testParallelSort {
+    const int n = 100000;
+    std::vector<Keyed> items ( n );
+    TestRandom r ( 4 );
+    for ( int i = 0; i < n; ++i ) { items[i].Key = r ( 1000 ); items[i].Place = i; }
+    utlSorter<Keyed> sorter;
+    for ( int threads = 1; threads <= 8; threads *= 2 ) {
+        std::vector<Keyed> v = items;
+        sorter.psort ( &v[0], n, threads );
+        int errors = 0;
+        for ( int i = 1; i < n; ++i )
+            errors += v[i].Key < v[i-1].Key || ( v[i].Key == v[i-1].Key && v[i].Place < v[i-1].Place );
+        XCTAssertEqual ( errors, 0 );
+    }
+}
+
+@end
@@ -0,0 +1,122 @@
+//
+//  ConcurrentAVLTreeTests.mm
+//  ArvoresTests
+//
+//  Stress test of ConcurrentAVLTree: readers search the tree, without
+//  locks, while writers insert and remove items.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "ConcurrentAVLTree.h"
+
+/// number of items never removed: the even keys 0, 2, ..., 2*(StableItems-1).
+static const int StableItems = 20000;
+
+/// number of writer threads. Writer w changes the keys 4*i+2*w+1.
+static const int Writers = 2;
+
+/// number of reader threads.
+static const int Readers = 4;
+
+/// fills t with the stable items.
+static void fillStable ( ConcurrentAVLTree<int>& t ) {
+    for ( int i = 0; i < StableItems; ++i ) t.Insert ( 2 * i );
+}
+
+/** inserts and removes the keys of writer w, ops times, and records
+ *  in present whether each of them is in the tree at the end.
+ *  Returns the number of unexpected results of Insert and Remove.
+ */
+static int churn ( ConcurrentAVLTree<int>& t, int w, int ops, std::vector<char>& present ) {
+    TestRandom r ( 17 * w + 5 );
+    int errors = 0;
+    present.assign ( StableItems / 2, 0 );
+    for ( int i = 0; i < ops; ++i ) {
+        int k = r ( StableItems / 2 );
+        int key = 4 * k + 2 * w + 1;
+        if ( present[k] ) errors += t.Remove ( key ) != 1;
+        else              errors += t.Insert ( key ) != 1;
+        present[k] = !present[k];
+    }
+    return errors;
+}
+
+/** searches the tree until done is set, and returns the number of
+ *  stable items not found, of wrong items visited, and of wrong extremes.
+ */
+static int search ( const ConcurrentAVLTree<int>& t, int seed, const std::atomic<int>& done, long& searches ) {
+    TestRandom r ( seed );
+    int errors = 0;
+    searches = 0;
+    while ( !done.load ( std::memory_order_acquire ) ) {
+        int key = 2 * r ( StableItems );
+        errors += !t.IsFound ( key );
+        int seen = -1;
+        errors += !t.Visit ( key, [&seen] ( const int& x ) { seen = x; } ) || seen != key;
+        t.IsFound ( key + 1 );                   // a key being changed
+        if ( ( ++searches & 1023 ) == 0 )
+             errors += t.FindMin ( ) != 0;
+    }
+    return errors;
+}
+
+/** runs the writers and readers on t, and returns the number of errors.
+ *  Writers do ops changes each. Searches is the number of searches done.
+ *  t is left with the stable items only.
+ */
+static int stress ( ConcurrentAVLTree<int>& t, int ops, long& searches ) {
+    std::atomic<int> done ( 0 );
+    std::atomic<int> errors ( 0 );
+    std::vector<std::vector<char> > present ( Writers );
+    std::vector<long> count ( Readers, 0 );
+    std::vector<std::thread> readers, writers;
+
+    for ( int i = 0; i < Readers; ++i )
+        readers.push_back ( std::thread ( [&, i] { errors += search ( t, 31 * i + 7, done, count[i] ); } ) );
+    for ( int w = 0; w < Writers; ++w )
+        writers.push_back ( std::thread ( [&, w] { errors += churn ( t, w, ops, present[w] ); } ) );
+    for ( auto& th : writers ) th.join ( );
+    done.store ( 1, std::memory_order_release );
+    for ( auto& th : readers ) th.join ( );
+
+    searches = 0;
+    for ( int i = 0; i < Readers; ++i ) searches += count[i];
+
+    // the tree holds the stable items, and what the writers left
+    for ( int i = 0; i < StableItems; ++i ) errors += !t.IsFound ( 2 * i );
+    for ( int w = 0; w < Writers; ++w )
+        for ( int k = 0; k < StableItems / 2; ++k )
+            if ( t.IsFound ( 4 * k + 2 * w + 1 ) != present[w][k] ) ++errors;
+            else if ( present[w][k] ) t.Remove ( 4 * k + 2 * w + 1 );
+    return errors;
+}
+
+@interface ConcurrentAVLTreeTests : XCTestCase
+
+@end
+
+@implementation ConcurrentAVLTreeTests
+
+- (void)testConcurrentReadersAndWriters {
+    ConcurrentAVLTree<int> t;
+    fillStable ( t );
+    long searches = 0;
+    XCTAssertEqual ( stress ( t, 50000, searches ), 0 );
+    XCTAssertGreaterThan ( searches, 0 );
+}
+
+- (void)testPerformanceConcurrentReadersAndWriters {
+    ConcurrentAVLTree<int> t;
+    fillStable ( t );
+    measureTree ( self, t, [self] ( ConcurrentAVLTree<int>& tree ) {
+        long searches = 0;
+        XCTAssertEqual ( stress ( tree, 10000, searches ), 0 );
+    } );
+}
+
+@end
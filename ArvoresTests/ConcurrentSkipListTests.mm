@@ -0,0 +1,153 @@
+//
+//  ConcurrentSkipListTests.mm
+//  ArvoresTests
+//
+//  ConcurrentSkipList: its results against std::set, threads changing
+//  and searching one list, and the list as the Tree of utlSet and utlMap.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+#include "ConcurrentSkipList.h"
+#include "utlSet.h"
+#include "utlMap.h"
+
+typedef ConcurrentSkipList<int> IntList;
+typedef utlSet<int,compare_to<int>,IntList> ListSet;
+typedef compare_pair<utlPair<const int,int> > PairLess;
+typedef utlMap<int,int,PairLess,ConcurrentSkipList<utlPair<const int,int>,PairLess> > ListMap;
+
+/** returns the number of differences between l and s: the items in
+ *  order, and the bounds and predecessors of the keys below n.
+ */
+static int compareList ( const IntList& l, const std::set<int>& s, int n ) {
+    int errors = 0;
+    std::set<int>::const_iterator it = s.begin ( );
+    for ( const IntList::BinaryNode* p = l.GetRoot ( ); p != NULL; p = p->GetRight ( ), ++it )
+        errors += it == s.end ( ) || p->GetElement ( ) != *it;
+    errors += it != s.end ( );
+    for ( int k = 0; k < n; ++k ) {
+        std::set<int>::const_iterator lb = s.lower_bound ( k ), ub = s.upper_bound ( k );
+        const IntList::BinaryNode* a = l.LowerBound ( k );
+        const IntList::BinaryNode* b = l.UpperBound ( k );
+        errors += lb == s.end ( ) ? a != NULL : a == NULL || a->GetElement ( ) != *lb;
+        errors += ub == s.end ( ) ? b != NULL : b == NULL || b->GetElement ( ) != *ub;
+        if ( a != NULL ) {
+             const IntList::BinaryNode* p = l.Predecessor ( a );
+             errors += lb == s.begin ( ) ? p != NULL : p == NULL || p->GetElement ( ) != *--lb;
+        }
+    }
+    return errors;
+}
+
+@interface ConcurrentSkipListTests : XCTestCase
+
+@end
+
+@implementation ConcurrentSkipListTests
+
+/// on one thread, the list behaves as a std::set.
+- (void)testAgainstSet {
+    IntList l;
+    std::set<int> s;
+    TestRandom r ( 1 );
+    int errors = 0;
+    for ( int i = 0; i < 20000; ++i ) {
+        int k = r ( 2000 );
+        if ( r ( 2 ) ) errors += l.Insert ( k ) != (int) s.insert ( k ).second;
+        else           errors += l.Remove ( k ) != (int) s.erase ( k );
+        k = r ( 2000 );
+        errors += ( l.IsFound ( k ) != 0 ) != ( s.count ( k ) != 0 );
+    }
+    XCTAssertEqual ( errors, 0 );
+    XCTAssertEqual ( compareList ( l, s, 2000 ), 0 );
+    XCTAssertEqual ( l.FindMin ( ), *s.begin ( ) );
+    XCTAssertEqual ( l.FindMax ( ), *s.rbegin ( ) );
+    IntList c ( l );
+    XCTAssertEqual ( compareList ( c, s, 2000 ), 0 );
+    l.MakeEmpty ( );
+    XCTAssertTrue ( l.IsEmpty ( ) );
+    XCTAssertEqual ( compareList ( c, s, 2000 ), 0 );
+}
+
+/// writers change their own keys while readers search the stable ones.
+- (void)testConcurrentReadersAndWriters {
+    IntList l;
+    for ( int k = 0; k < 10000; k += 2 ) l.Insert ( k );
+    std::atomic<int> done ( 0 ), errors ( 0 );
+    std::vector<std::thread> readers, writers;
+    for ( int i = 0; i < 2; ++i )
+        readers.push_back ( std::thread ( [&, i] {
+            TestRandom r ( i + 7 );
+            int wrong = 0;
+            while ( !done.load ( std::memory_order_acquire ) ) {
+                int k = 2 * r ( 5000 );
+                wrong += !l.IsFound ( k );
+                int seen = -1;
+                wrong += !l.Visit ( k, [&seen] ( const int& x ) { seen = x; } ) || seen != k;
+                const IntList::BinaryNode* b = l.LowerBound ( k );
+                wrong += b == NULL || b->GetElement ( ) != k;
+            }
+            errors += wrong;
+        } ) );
+    for ( int w = 0; w < 3; ++w )
+        writers.push_back ( std::thread ( [&, w] {
+            int wrong = 0;
+            for ( int round = 0; round < 3; ++round ) {
+                for ( int k = 2 * w + 1; k < 10000; k += 6 ) wrong += l.Insert ( k ) != 1;
+                for ( int k = 2 * w + 1; k < 10000; k += 6 ) wrong += l.Remove ( k ) != 1;
+            }
+            for ( int k = 2 * w + 1; k < 10000; k += 12 ) wrong += l.Insert ( k ) != 1;
+            errors += wrong;
+        } ) );
+    for ( size_t i = 0; i < writers.size ( ); ++i ) writers[i].join ( );
+    done.store ( 1, std::memory_order_release );
+    for ( size_t i = 0; i < readers.size ( ); ++i ) readers[i].join ( );
+    XCTAssertEqual ( errors.load ( ), 0 );
+    std::set<int> s;
+    for ( int k = 0; k < 10000; k += 2 ) s.insert ( k );
+    for ( int w = 0; w < 3; ++w )
+        for ( int k = 2 * w + 1; k < 10000; k += 12 ) s.insert ( k );
+    XCTAssertEqual ( compareList ( l, s, 10000 ), 0 );
+}
+
+/// threads insert into and erase from one utlSet, which is then iterated.
+- (void)testSetOnSkipList {
+    ListSet s;
+    std::vector<std::thread> threads;
+    for ( int w = 0; w < 4; ++w )
+        threads.push_back ( std::thread ( [&s, w] {
+            for ( int k = w; k < 8000; k += 4 ) s.insert ( k );
+            for ( int k = w; k < 8000; k += 8 ) s.erase ( k );
+        } ) );
+    for ( size_t i = 0; i < threads.size ( ); ++i ) threads[i].join ( );
+    int expected = 0, errors = 0;
+    for ( ListSet::iterator it = s.begin ( ); it != s.end ( ); ++it ) {
+        while ( expected % 8 < 4 ) ++expected;
+        errors += *it != expected++;
+    }
+    XCTAssertEqual ( errors, 0 );
+    XCTAssertEqual ( (int) s.size ( ), 4000 );
+    XCTAssert ( s.find ( 8 ) == s.end ( ) );
+    XCTAssertEqual ( *s.find ( 12 ), 12 );
+    XCTAssertEqual ( *s.lower_bound ( 8 ), 12 );
+}
+
+- (void)testMapOnSkipList {
+    ListMap m;
+    for ( int k = 0; k < 1000; ++k ) m[k] = k * 2;
+    XCTAssertEqual ( m.find ( 500 )->second, 1000 );
+    m.erase ( 500 );
+    XCTAssert ( m.find ( 500 ) == m.end ( ) );
+    XCTAssertEqual ( (int) m.size ( ), 999 );
+    int sum = 0;
+    for ( ListMap::iterator it = m.begin ( ); it != m.end ( ); ++it ) sum += it->second - 2 * it->first;
+    XCTAssertEqual ( sum, 0 );
+}
+
+@end
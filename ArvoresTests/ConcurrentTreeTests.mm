@@ -0,0 +1,140 @@
+//
+//  ConcurrentTreeTests.mm
+//  ArvoresTests
+//
+//  ConcurrentTree: readers and writers sharing one tree through its
+//  lock, several changes made under a single WriteSection, and maps
+//  searched by key.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "ConcurrentTree.h"
+#include "AVLTree.h"
+#include "RedBlack.h"
+#include "utlMap.h"
+
+typedef ConcurrentTree<StaticAVLTree<int> > ConcurrentAVL;
+typedef compare_pair<utlPair<const int,int> > PairLess;
+typedef utlPair<const int,int> IntPair;
+typedef ConcurrentTree<StaticRedBlackTree<IntPair,PairLess> > ConcurrentMap;
+
+/// number of pairs of keys changed together: 2*k and 2*k+1.
+static const int Pairs = 2000;
+
+/** inserts or removes both keys of a pair, at random, under one
+ *  WriteSection, ops times.
+ */
+static void writePairs ( ConcurrentAVL& t, int ops, unsigned seed ) {
+    TestRandom r ( seed );
+    for ( int i = 0; i < ops; ++i ) {
+        int k = r ( Pairs );
+        ConcurrentAVL::WriteSection w ( t );
+        if ( w->IsFound ( 2 * k ) ) { w->Remove ( 2 * k ); w->Remove ( 2 * k + 1 ); }
+        else                        { w->Insert ( 2 * k ); w->Insert ( 2 * k + 1 ); }
+    }
+}
+
+/** reads both keys of pairs under one ReadSection until done is set,
+ *  and returns the number of pairs found with only one of their keys.
+ */
+static int readPairs ( const ConcurrentAVL& t, const std::atomic<int>& done, unsigned seed ) {
+    TestRandom r ( seed );
+    int errors = 0;
+    while ( !done.load ( std::memory_order_acquire ) ) {
+        int k = r ( Pairs );
+        ConcurrentAVL::ReadSection s ( t );
+        errors += ( s->Lookup ( 2 * k ) != NULL ) != ( s->Lookup ( 2 * k + 1 ) != NULL );
+    }
+    return errors;
+}
+
+@interface ConcurrentTreeTests : XCTestCase
+
+@end
+
+@implementation ConcurrentTreeTests
+
+/// readers never see half of the changes made under one WriteSection.
+- (void)testWriteSections {
+    ConcurrentAVL t;
+    std::atomic<int> done ( 0 ), errors ( 0 );
+    std::vector<std::thread> readers, writers;
+    for ( int i = 0; i < 3; ++i )
+        readers.push_back ( std::thread ( [&, i] { errors += readPairs ( t, done, i + 1 ); } ) );
+    for ( int w = 0; w < 2; ++w )
+        writers.push_back ( std::thread ( [&, w] { writePairs ( t, 20000, w + 10 ); } ) );
+    for ( size_t i = 0; i < writers.size ( ); ++i ) writers[i].join ( );
+    done.store ( 1, std::memory_order_release );
+    for ( size_t i = 0; i < readers.size ( ); ++i ) readers[i].join ( );
+    XCTAssertEqual ( errors.load ( ), 0 );
+    ConcurrentAVL::ReadSection s ( t );
+    XCTAssertEqual ( s->Size ( s->GetRoot ( ) ) % 2, 0 );
+}
+
+/// threads insert and remove their own keys; the others are untouched.
+- (void)testInsertRemove {
+    ConcurrentAVL t;
+    for ( int k = 0; k < 1000; ++k ) t.Insert ( 4 * k );
+    std::vector<std::thread> threads;
+    std::atomic<int> errors ( 0 );
+    for ( int w = 1; w < 4; ++w )
+        threads.push_back ( std::thread ( [&t, &errors, w] {
+            int wrong = 0;
+            for ( int k = 0; k < 1000; ++k ) wrong += t.Insert ( 4 * k + w ) != 1;
+            for ( int k = 0; k < 1000; k += 2 ) wrong += t.Remove ( 4 * k + w ) != 1;
+            errors += wrong;
+        } ) );
+    for ( size_t i = 0; i < threads.size ( ); ++i ) threads[i].join ( );
+    XCTAssertEqual ( errors.load ( ), 0 );
+    int wrong = 0;
+    for ( int k = 0; k < 1000; ++k )
+        for ( int w = 0; w < 4; ++w )
+            wrong += t.IsFound ( 4 * k + w ) != ( w == 0 || k % 2 == 1 );
+    XCTAssertEqual ( wrong, 0 );
+    int least = -1, most = -1;
+    XCTAssertTrue ( t.FindMin ( least ) );
+    XCTAssertTrue ( t.FindMax ( most ) );
+    XCTAssertEqual ( least, 0 );
+    XCTAssertEqual ( most, 4 * 999 + 3 );
+    t.MakeEmpty ( );
+    XCTAssertTrue ( t.IsEmpty ( ) );
+    XCTAssertFalse ( t.FindMin ( least ) );
+}
+
+/// pairs are found by key, and copied out or visited under the lock.
+- (void)testMapByKey {
+    StaticRedBlackTree<IntPair,PairLess> rb ( IntPair ( -1, 0 ) );
+    for ( int k = 0; k < 500; ++k ) rb.Insert ( IntPair ( k, k * k ) );
+    ConcurrentMap m ( rb );
+    IntPair found ( 0, 0 );
+    XCTAssertTrue ( m.FindP ( IntPair ( 20, 0 ), found ) );
+    XCTAssertEqual ( found.second, 400 );
+    XCTAssertFalse ( m.FindP ( IntPair ( 500, 0 ), found ) );
+    XCTAssertEqual ( found.first, 20 );
+    int value = 0;
+    XCTAssertTrue ( m.VisitP ( IntPair ( 30, 0 ), [&value] ( const IntPair& p ) { value = p.second; } ) );
+    XCTAssertEqual ( value, 900 );
+    m.Insert ( IntPair ( 600, 1 ) );
+    XCTAssertFalse ( rb.LookupP ( IntPair ( 600, 0 ) ) != NULL );
+}
+
+/// the lock counts the waits of the threads.
+- (void)testContentionCounters {
+    ConcurrentAVL t;
+    t.ResetCounters ( );
+    XCTAssertEqual ( t.Contentions ( ), 0ull );
+    std::vector<std::thread> threads;
+    for ( int w = 0; w < 4; ++w )
+        threads.push_back ( std::thread ( [&t, w] { writePairs ( t, 5000, w + 20 ); } ) );
+    for ( size_t i = 0; i < threads.size ( ); ++i ) threads[i].join ( );
+    XCTAssertTrue ( t.Contentions ( ) == 0 || t.WaitTime ( ) > 0 );
+    t.ResetCounters ( );
+    XCTAssertEqual ( t.WaitTime ( ), 0ull );
+}
+
+@end
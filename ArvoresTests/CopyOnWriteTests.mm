@@ -0,0 +1,163 @@
+//
+//  CopyOnWriteTests.mm
+//  ArvoresTests
+//
+//  Copies of search trees, which share their nodes until one of them
+//  is written: changes on either side, iterators kept across writes,
+//  and the copies destroyed in any order.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <set>
+#include <string>
+#include "utlSet.h"
+#include "utlMap.h"
+#include "RedBlack.h"
+
+/// an item counting its live instances, to find nodes leaked or freed twice.
+struct Tracked {
+    static int Live;
+    int Key;
+    std::string Name;
+    Tracked ( int k = 0 ) : Key ( k ), Name ( "item" ) { ++Live; }
+    Tracked ( const Tracked& t ) : Key ( t.Key ), Name ( t.Name ) { ++Live; }
+    ~Tracked ( ) { --Live; }
+    Tracked& operator = ( const Tracked& t ) { Key = t.Key; Name = t.Name; return *this; }
+    bool operator < ( const Tracked& t ) const { return Key < t.Key; }
+    bool operator == ( const Tracked& t ) const { return Key == t.Key; }
+    bool operator != ( const Tracked& t ) const { return Key != t.Key; }
+};
+
+int Tracked::Live = 0;
+
+typedef utlSet<int,compare_to<int>,AVLTree<int> > AVLSet;
+typedef compare_pair<utlPair<const int,int> > PairLess;
+typedef utlMap<int,int,PairLess,AATree<utlPair<const int,int>,PairLess> > AAMap;
+
+/// returns the number of keys below n on which tree t and the model s differ.
+template <class Tree>
+static int checkTree ( const Tree& t, const std::set<int>& s, int n ) {
+    int errors = 0;
+    for ( int k = 0; k < n; ++k ) errors += ( t.Lookup ( k ) != NULL ) != ( s.count ( k ) != 0 );
+    errors += t.Size ( t.GetRoot ( ) ) != (int) s.size ( );
+    return errors;
+}
+
+/** returns the number of differences found while a tree and its copy,
+ *  made from a tree holding half of the keys below n, are changed at
+ *  random, each one against a std::set.
+ */
+template <class Tree>
+static int checkCopies ( Tree& a, int n, unsigned seed ) {
+    std::set<int> sa, sb;
+    TestRandom r ( seed );
+    for ( int i = 0; i < n / 2; ++i ) {
+        int k = r ( n );
+        a.Insert ( k );
+        sa.insert ( k );
+    }
+    Tree b ( a );
+    sb = sa;
+    int errors = checkTree ( b, sb, n );
+    for ( int i = 0; i < 4 * n; ++i ) {
+        int k = r ( n );
+        Tree& t = r ( 2 ) ? a : b;
+        std::set<int>& s = &t == &a ? sa : sb;
+        if ( r ( 2 ) ) { t.Insert ( k ); s.insert ( k ); }
+        else           { t.Remove ( k ); s.erase ( k ); }
+        if ( i % 1000 == 0 ) errors += checkTree ( a, sa, n ) + checkTree ( b, sb, n );
+    }
+    return errors + checkTree ( a, sa, n ) + checkTree ( b, sb, n );
+}
+
+@interface CopyOnWriteTests : XCTestCase
+
+@end
+
+@implementation CopyOnWriteTests
+
+/// the copy or the original, in turn, is changed after the copy.
+- (void)testChangeEitherSide {
+    StaticAVLTree<int> avl;
+    StaticAATree<int> aa;
+    StaticRedBlackTree<int> rb ( -1 );
+    CountedAVLTree<int> counted;
+    XCTAssertEqual ( checkCopies ( avl, 2000, 1 ), 0 );
+    XCTAssertEqual ( checkCopies ( aa, 2000, 2 ), 0 );
+    XCTAssertEqual ( checkCopies ( rb, 2000, 3 ), 0 );
+    XCTAssertEqual ( checkCopies ( counted, 2000, 4 ), 0 );
+}
+
+/// a tree which was never copied, or was emptied since, writes in place.
+- (void)testPrivateTrees {
+    StaticAVLTree<int> a;
+    for ( int k = 0; k < 100; ++k ) a.Insert ( k );
+    XCTAssertTrue ( a.IsPrivate ( ) );
+    StaticAVLTree<int> b ( a );
+    XCTAssertFalse ( a.IsPrivate ( ) );
+    XCTAssertFalse ( b.IsPrivate ( ) );
+    b.MakeEmpty ( );
+    XCTAssertTrue ( b.IsPrivate ( ) );
+    a.Insert ( 100 );
+    a.MakeEmpty ( );
+    XCTAssertTrue ( a.IsPrivate ( ) );
+}
+
+/// an iterator stays on its item while the shared tree is written around it.
+- (void)testIteratorSurvivesWrite {
+    AVLSet a;
+    for ( int k = 0; k < 1000; ++k ) a.insert ( 2 * k );
+    AVLSet::iterator it = a.find ( 1000 );
+    AVLSet b ( a );
+    for ( int k = 0; k < 1000; ++k ) a.insert ( 2 * k + 1 );
+    for ( int k = 0; k < 400; ++k ) a.erase ( 2 * k );
+    XCTAssertEqual ( *it, 1000 );
+    XCTAssertEqual ( *++it, 1001 );
+    XCTAssertEqual ( *--it, 1000 );
+    XCTAssertEqual ( *--it, 999 );
+    XCTAssert ( a.find ( 999 ) == it );
+    XCTAssertEqual ( (int) b.size ( ), 1000 );
+    XCTAssert ( b.find ( 999 ) == b.end ( ) );
+}
+
+/// writing through a map iterator changes its own map only.
+- (void)testMapWriteThroughIterator {
+    AAMap m;
+    for ( int k = 0; k < 500; ++k ) m[k] = k;
+    AAMap::iterator it = m.find ( 250 );
+    AAMap c;
+    c = m;
+    it->second = -1;
+    ++it;
+    it->second = -2;
+    XCTAssertEqual ( m.find ( 250 )->second, -1 );
+    XCTAssertEqual ( m.find ( 251 )->second, -2 );
+    XCTAssertEqual ( c.find ( 250 )->second, 250 );
+    XCTAssertEqual ( c.find ( 251 )->second, 251 );
+    AAMap::iterator jt = c.find ( 10 );
+    m.erase ( 10 );
+    jt->second = 7;
+    XCTAssertEqual ( c.find ( 10 )->second, 7 );
+    XCTAssert ( m.find ( 10 ) == m.end ( ) );
+}
+
+/// copies are destroyed in any order, and every item exactly once.
+- (void)testDestructionOrder {
+    XCTAssertEqual ( Tracked::Live, 0 );
+    for ( int order = 0; order < 3; ++order ) {
+        StaticAVLTree<Tracked>* t[3];
+        t[0] = new StaticAVLTree<Tracked> ( );
+        for ( int k = 0; k < 300; ++k ) t[0]->Insert ( Tracked ( k ) );
+        t[1] = new StaticAVLTree<Tracked> ( *t[0] );
+        t[0]->Insert ( Tracked ( 1000 ) );
+        t[2] = new StaticAVLTree<Tracked> ( *t[1] );
+        t[1]->Remove ( Tracked ( 5 ) );
+        t[2]->Insert ( Tracked ( 2000 ) );
+        for ( int i = 0; i < 3; ++i ) delete t[( order + i ) % 3];
+        XCTAssertEqual ( Tracked::Live, 0 );
+    }
+}
+
+@end
@@ -0,0 +1,119 @@
+//
+//  FindBatchTests.mm
+//  ArvoresTests
+//
+//  Batched lookups (SearchTreeCore::FindBatch) against a loop on Find,
+//  on trees much larger than the cache.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <vector>
+#include "AVLTree.h"
+#include "RedBlack.h"
+
+/// number of items in the trees: the even keys 0, 2, ..., 2*(TreeItems-1).
+static const int TreeItems = 1 << 21;
+
+/// number of keys looked up, half of them absent.
+static const int Lookups = 1 << 20;
+
+/// returns Lookups keys in random order, half of them odd, thus absent.
+static std::vector<int> lookupKeys ( ) {
+    std::vector<int> keys ( Lookups );
+    TestRandom r ( 12345 );
+    for ( int i = 0; i < Lookups; ++i ) keys[i] = r ( 2 * TreeItems );
+    return keys;
+}
+
+/// fills t with the tree items, inserted in random order.
+template <class Tree>
+static void fillTree ( Tree& t ) {
+    std::vector<int> items = shuffledKeys ( TreeItems, 54321, 0, 2 );
+    for ( int i = 0; i < TreeItems; ++i ) t.Insert ( items[i] );
+}
+
+/// returns the number of keys found by a loop on Find.
+template <class Tree>
+static int findLoop ( Tree& t, const std::vector<int>& keys ) {
+    int found = 0;
+    for ( size_t i = 0; i < keys.size(); ++i ) {
+        t.Find ( keys[i] );
+        found += t.WasFound ( );
+    }
+    return found;
+}
+
+/// returns the number of keys found by FindBatch.
+template <class Tree>
+static int findBatch ( const Tree& t, const std::vector<int>& keys,
+                       std::vector<const typename Tree::BinaryNode*>& out ) {
+    out.resize ( keys.size() );
+    return t.FindBatch ( &keys[0], (int) keys.size(), &out[0] );
+}
+
+@interface FindBatchTests : XCTestCase
+
+@end
+
+@implementation FindBatchTests
+
+- (void)testFindBatchMatchesLookup {
+    StaticAVLTree<int> avl;
+    StaticRedBlackTree<int> rb ( -1 );
+    fillTree ( avl );
+    fillTree ( rb );
+    std::vector<int> keys = lookupKeys ( );
+    std::vector<const StaticAVLTree<int>::BinaryNode*> outAVL;
+    std::vector<const StaticRedBlackTree<int>::BinaryNode*> outRB;
+    int found = 0;
+    for ( size_t i = 0; i < keys.size(); ++i ) found += keys[i] % 2 == 0;
+
+    XCTAssertEqual ( findBatch ( avl, keys, outAVL ), found );
+    XCTAssertEqual ( findBatch ( rb, keys, outRB ), found );
+    for ( size_t i = 0; i < keys.size(); ++i ) {
+        XCTAssert ( outAVL[i] == avl.Lookup ( keys[i] ) );
+        XCTAssert ( outRB[i] == rb.Lookup ( keys[i] ) );
+    }
+}
+
+- (void)testPerformanceFindLoopAVL {
+    StaticAVLTree<int> t;
+    fillTree ( t );
+    std::vector<int> keys = lookupKeys ( );
+    measureTree ( self, t, [&keys] ( StaticAVLTree<int>& tree ) {
+        findLoop ( tree, keys );
+    } );
+}
+
+- (void)testPerformanceFindBatchAVL {
+    StaticAVLTree<int> t;
+    fillTree ( t );
+    std::vector<int> keys = lookupKeys ( );
+    measureTree ( self, t, [&keys] ( StaticAVLTree<int>& tree ) {
+        std::vector<const StaticAVLTree<int>::BinaryNode*> out;
+        findBatch ( tree, keys, out );
+    } );
+}
+
+- (void)testPerformanceFindLoopRedBlack {
+    StaticRedBlackTree<int> t ( -1 );
+    fillTree ( t );
+    std::vector<int> keys = lookupKeys ( );
+    measureTree ( self, t, [&keys] ( StaticRedBlackTree<int>& tree ) {
+        findLoop ( tree, keys );
+    } );
+}
+
+- (void)testPerformanceFindBatchRedBlack {
+    StaticRedBlackTree<int> t ( -1 );
+    fillTree ( t );
+    std::vector<int> keys = lookupKeys ( );
+    measureTree ( self, t, [&keys] ( StaticRedBlackTree<int>& tree ) {
+        std::vector<const StaticRedBlackTree<int>::BinaryNode*> out;
+        findBatch ( tree, keys, out );
+    } );
+}
+
+@end
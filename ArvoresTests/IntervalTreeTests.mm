@@ -0,0 +1,124 @@
+//
+//  IntervalTreeTests.mm
+//  ArvoresTests
+//
+//  IntervalTree: overlap and stabbing queries against a scan of all the
+//  intervals, under random inserts and removes, and the order in which
+//  the iterator returns them.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <set>
+#include <utility>
+#include <vector>
+#include "IntervalTree.h"
+
+typedef IntervalTree<int> Intervals;
+typedef utlInterval<int> Interval;
+typedef std::set<std::pair<int,int> > IntervalSet;
+
+/// returns the intervals of s overlapping [a, b], in order.
+static std::vector<std::pair<int,int> > scan ( const IntervalSet& s, int a, int b ) {
+    std::vector<std::pair<int,int> > found;
+    for ( IntervalSet::const_iterator it = s.begin ( ); it != s.end ( ); ++it )
+        if ( it->first <= b && a <= it->second ) found.push_back ( *it );
+    return found;
+}
+
+/** returns the number of wrong answers of Overlapping and LookupOverlap
+ *  for [a, b], against a scan of s.
+ */
+static int checkQuery ( const Intervals& t, const IntervalSet& s, int a, int b ) {
+    std::vector<std::pair<int,int> > expected = scan ( s, a, b );
+    int errors = 0;
+    size_t i = 0;
+    for ( Intervals::iterator it = t.Overlapping ( a, b ); +it; ++it, ++i )
+        errors += i >= expected.size ( ) || it ( ).low != expected[i].first || it ( ).high != expected[i].second;
+    errors += i != expected.size ( );
+    const Intervals::BinaryNode* node = t.LookupOverlap ( a, b );
+    errors += expected.empty ( ) ? node != NULL : node == NULL || !node->GetElement ( ).Overlaps ( a, b );
+    return errors;
+}
+
+/** inserts and removes random intervals within [0, n), of length below
+ *  most, and returns the number of wrong answers to random queries.
+ */
+static int checkRandomOps ( int n, int most, int ops, unsigned seed ) {
+    Intervals t;
+    IntervalSet s;
+    TestRandom r ( seed );
+    int errors = 0;
+    for ( int i = 0; i < ops; ++i ) {
+        int a = r ( n ), b = a + r ( most );
+        if ( r ( 3 ) ) { t.Insert ( Interval ( a, b ) ); s.insert ( std::make_pair ( a, b ) ); }
+        else if ( !s.empty ( ) && r ( 2 ) ) {
+             IntervalSet::iterator it = s.lower_bound ( std::make_pair ( a, b ) );
+             if ( it == s.end ( ) ) it = s.begin ( );
+             errors += !t.Remove ( Interval ( it->first, it->second ) );
+             s.erase ( it );
+        }
+        else { t.Remove ( Interval ( a, b ) ); s.erase ( std::make_pair ( a, b ) ); }
+        if ( i % 100 == 0 ) {
+             int x = r ( n ), y = x + r ( most );
+             errors += checkQuery ( t, s, x, y ) + checkQuery ( t, s, x, x );
+        }
+    }
+    for ( int x = 0; x < n; x += n / 50 ) errors += checkQuery ( t, s, x, x + r ( most ) );
+    return errors;
+}
+
+@interface IntervalTreeTests : XCTestCase
+
+@end
+
+@implementation IntervalTreeTests
+
+/// short and long intervals, under random changes.
+- (void)testAgainstScan {
+    XCTAssertEqual ( checkRandomOps ( 10000, 50, 20000, 1 ), 0 );
+    XCTAssertEqual ( checkRandomOps ( 10000, 5000, 10000, 2 ), 0 );
+    XCTAssertEqual ( checkRandomOps ( 100, 10, 5000, 3 ), 0 );
+}
+
+/// intervals sharing end points, nested and disjoint ones.
+- (void)testEndPoints {
+    Intervals t;
+    t.Insert ( Interval ( 0, 10 ) );
+    t.Insert ( Interval ( 10, 20 ) );
+    t.Insert ( Interval ( 2, 3 ) );
+    t.Insert ( Interval ( 30, 40 ) );
+    t.Insert ( Interval ( 0, 10 ) );
+    XCTAssertEqual ( t.Size ( t.GetRoot ( ) ), 4 );
+    int found = 0;
+    for ( Intervals::iterator it = t.Stabbing ( 10 ); +it; ++it ) ++found;
+    XCTAssertEqual ( found, 2 );
+    Intervals::iterator it = t.Stabbing ( 2 );
+    XCTAssertEqual ( it ( ).low, 0 );
+    ++it;
+    XCTAssertEqual ( it ( ).low, 2 );
+    ++it;
+    XCTAssertFalse ( +it );
+    XCTAssertFalse ( +t.Overlapping ( 21, 29 ) );
+    XCTAssert ( t.LookupOverlap ( 21, 29 ) == NULL );
+    XCTAssert ( t.LookupOverlap ( 25, 30 ) != NULL );
+    XCTAssertEqual ( t.LookupOverlap ( 25, 30 )->GetElement ( ).high, 40 );
+    t.Remove ( Interval ( 0, 10 ) );
+    found = 0;
+    for ( Intervals::iterator i = t.Overlapping ( 0, 100 ); +i; ++i ) ++found;
+    XCTAssertEqual ( found, 3 );
+}
+
+/// an empty tree overlaps nothing.
+- (void)testEmpty {
+    Intervals t;
+    XCTAssertFalse ( +t.Overlapping ( 0, 100 ) );
+    XCTAssert ( t.LookupOverlap ( 0, 100 ) == NULL );
+    t.Insert ( Interval ( 5, 5 ) );
+    t.Remove ( Interval ( 5, 5 ) );
+    XCTAssertTrue ( t.IsEmpty ( ) );
+    XCTAssertFalse ( +t.Stabbing ( 5 ) );
+}
+
+@end
@@ -0,0 +1,138 @@
+//
+//  JoinSplitTests.mm
+//  ArvoresTests
+//
+//  Join and Split of AVL and red-black trees: the items on each side,
+//  the balance of the trees made, and trees changed afterwards.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <math.h>
+#include <set>
+#include "AVLTree.h"
+#include "RedBlack.h"
+
+/** returns the number of differences between t and s, whose items are
+ *  below n, and whether t is higher than most * log2 of its size.
+ */
+template <class Tree>
+static int checkTree ( const Tree& t, const std::set<int>& s, int n, double most ) {
+    int errors = 0;
+    for ( int k = 0; k < n; ++k ) errors += ( t.Lookup ( k ) != NULL ) != ( s.count ( k ) != 0 );
+    errors += t.Size ( t.GetRoot ( ) ) != (int) s.size ( );
+    errors += t.Height ( t.GetRoot ( ) ) + 1 > most * log2 ( s.size ( ) + 2.0 );
+    return errors;
+}
+
+/** splits t, which holds random keys below n, at random keys, checks both
+ *  sides, changes them, and joins them back; rounds times.
+ *  Returns the number of errors.
+ */
+template <class Tree>
+static int checkSplitJoin ( Tree& t, Tree& less, Tree& greater, int n, double most, unsigned seed ) {
+    std::set<int> s;
+    TestRandom r ( seed );
+    for ( int i = 0; i < n / 2; ++i ) {
+        int k = r ( n );
+        t.Insert ( k );
+        s.insert ( k );
+    }
+    int errors = 0;
+    for ( int round = 0; round < 20; ++round ) {
+        int x = r ( n );
+        std::set<int> sl ( s.begin ( ), s.lower_bound ( x ) ), sg ( s.upper_bound ( x ), s.end ( ) );
+        errors += t.Split ( x, less, greater ) != (int) s.count ( x );
+        errors += !t.IsEmpty ( );
+        errors += checkTree ( less, sl, n, most ) + checkTree ( greater, sg, n, most );
+        // both sides stay usable trees
+        for ( int i = 0; i < 50; ++i ) {
+            int k = r ( n );
+            if ( k < x ) { less.Insert ( k ); sl.insert ( k ); }
+            else if ( k > x ) { greater.Remove ( k ); sg.erase ( k ); }
+        }
+        errors += checkTree ( less, sl, n, most ) + checkTree ( greater, sg, n, most );
+        t.Join ( less, x, greater );
+        errors += !less.IsEmpty ( ) || !greater.IsEmpty ( );
+        s = sl;
+        s.insert ( x );
+        s.insert ( sg.begin ( ), sg.end ( ) );
+        errors += checkTree ( t, s, n, most );
+    }
+    return errors;
+}
+
+/** joins two trees built apart, which do not share their NullNode, and
+ *  returns the number of errors.
+ */
+template <class Tree>
+static int checkJoinApart ( Tree& t, Tree& a, Tree& b, double most ) {
+    std::set<int> s;
+    for ( int k = 0; k < 3000; ++k ) { a.Insert ( k ); s.insert ( k ); }
+    for ( int k = 3001; k < 3100; ++k ) { b.Insert ( k ); s.insert ( k ); }
+    s.insert ( 3000 );
+    t.Join ( a, 3000, b );
+    int errors = checkTree ( t, s, 3200, most );
+    for ( int k = 0; k < 3100; k += 3 ) { t.Remove ( k ); s.erase ( k ); }
+    return errors + checkTree ( t, s, 3200, most );
+}
+
+@interface JoinSplitTests : XCTestCase
+
+@end
+
+@implementation JoinSplitTests
+
+- (void)testAVLSplitJoin {
+    StaticAVLTree<int> t, less, greater;
+    XCTAssertEqual ( checkSplitJoin ( t, less, greater, 5000, 1.45, 1 ), 0 );
+    CountedAVLTree<int> ct, cl, cg;
+    XCTAssertEqual ( checkSplitJoin ( ct, cl, cg, 5000, 1.45, 2 ), 0 );
+    IndexedAVLTree<int> it, il, ig;
+    XCTAssertEqual ( checkSplitJoin ( it, il, ig, 5000, 1.45, 3 ), 0 );
+}
+
+- (void)testRedBlackSplitJoin {
+    StaticRedBlackTree<int> t ( -1 ), less ( -1 ), greater ( -1 );
+    XCTAssertEqual ( checkSplitJoin ( t, less, greater, 5000, 2.0, 4 ), 0 );
+    CountedRedBlackTree<int> ct ( -1 ), cl ( -1 ), cg ( -1 );
+    XCTAssertEqual ( checkSplitJoin ( ct, cl, cg, 5000, 2.0, 5 ), 0 );
+}
+
+/// trees of very different heights, built apart.
+- (void)testJoinTreesBuiltApart {
+    StaticAVLTree<int> t, a, b;
+    XCTAssertEqual ( checkJoinApart ( t, a, b, 1.45 ), 0 );
+    StaticRedBlackTree<int> rt ( -1 ), ra ( -1 ), rb ( -1 );
+    XCTAssertEqual ( checkJoinApart ( rt, ra, rb, 2.0 ), 0 );
+}
+
+/// a side may be empty, and a tree may be split into itself.
+- (void)testEdgeCases {
+    StaticAVLTree<int> t, less, greater;
+    t.Join ( less, 5, greater );
+    XCTAssertTrue ( t.IsFound ( 5 ) );
+    XCTAssertEqual ( t.Size ( t.GetRoot ( ) ), 1 );
+    for ( int k = 0; k < 100; ++k ) t.Insert ( k );
+    XCTAssertEqual ( t.Split ( -1, less, greater ), 0 );
+    XCTAssertTrue ( less.IsEmpty ( ) );
+    XCTAssertEqual ( greater.Size ( greater.GetRoot ( ) ), 100 );
+    XCTAssertEqual ( greater.Split ( 50, greater, less ), 1 );
+    XCTAssertEqual ( greater.FindMax ( ), 49 );
+    XCTAssertEqual ( less.FindMin ( ), 51 );
+}
+
+/// splitting a copy leaves the tree it was copied from as it was.
+- (void)testSplitCopy {
+    StaticAVLTree<int> t, less, greater;
+    for ( int k = 0; k < 1000; ++k ) t.Insert ( k );
+    StaticAVLTree<int> c ( t );
+    c.Split ( 500, less, greater );
+    std::set<int> s;
+    for ( int k = 0; k < 1000; ++k ) s.insert ( k );
+    XCTAssertEqual ( checkTree ( t, s, 1000, 1.45 ), 0 );
+    XCTAssertEqual ( less.Size ( less.GetRoot ( ) ) + greater.Size ( greater.GetRoot ( ) ), 999 );
+}
+
+@end
@@ -0,0 +1,116 @@
+//
+//  LookupTests.mm
+//  ArvoresTests
+//
+//  Lookup and LookupP, the searches which write nothing in the tree:
+//  their results, and several threads searching one tree.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <atomic>
+#include <thread>
+#include "AVLTree.h"
+#include "AATree.h"
+#include "RedBlack.h"
+#include "Splay.h"
+#include "utlMap.h"
+
+typedef compare_pair<utlPair<const int,int> > PairLess;
+typedef StaticAVLTree<utlPair<const int,int>,PairLess> PairTree;
+
+/** returns the number of wrong results of Lookup on t, which holds
+ *  the even keys below 2*n.
+ */
+template <class Tree>
+static int checkLookup ( const Tree& t, int n ) {
+    int errors = 0;
+    for ( int k = -1; k <= 2 * n; ++k ) {
+        const typename Tree::BinaryNode* node = t.Lookup ( k );
+        if ( k >= 0 && k < 2 * n && k % 2 == 0 ) errors += node == NULL || node->GetElement ( ) != k;
+        else errors += node != NULL;
+    }
+    return errors;
+}
+
+/// fills t with the even keys below 2*n, in random order.
+template <class Tree>
+static void fillEven ( Tree& t, int n ) {
+    std::vector<int> keys = shuffledKeys ( n, n, 0, 2 );
+    for ( size_t i = 0; i < keys.size ( ); ++i ) t.Insert ( keys[i] );
+}
+
+@interface LookupTests : XCTestCase
+
+@end
+
+@implementation LookupTests
+
+- (void)testLookup {
+    StaticSearchTree<int> bst;
+    StaticAVLTree<int> avl;
+    StaticAATree<int> aa;
+    StaticRedBlackTree<int> rb ( -10 );
+    StaticSplayTree<int> splay;
+    fillEven ( bst, 1000 );
+    fillEven ( avl, 1000 );
+    fillEven ( aa, 1000 );
+    fillEven ( rb, 1000 );
+    fillEven ( splay, 1000 );
+    XCTAssertEqual ( checkLookup ( bst, 1000 ), 0 );
+    XCTAssertEqual ( checkLookup ( avl, 1000 ), 0 );
+    XCTAssertEqual ( checkLookup ( aa, 1000 ), 0 );
+    XCTAssertEqual ( checkLookup ( rb, 1000 ), 0 );
+    XCTAssertEqual ( checkLookup ( splay, 1000 ), 0 );
+}
+
+/// pairs are looked up by key, whatever their value.
+- (void)testLookupP {
+    PairTree t;
+    for ( int k = 0; k < 500; ++k ) t.Insert ( utlPair<const int,int> ( k, -k ) );
+    int errors = 0;
+    for ( int k = 0; k < 500; ++k ) {
+        const PairTree::BinaryNode* node = t.LookupP ( utlPair<const int,int> ( k, 12345 ) );
+        errors += node == NULL || node->GetElement ( ).second != -k;
+    }
+    XCTAssertEqual ( errors, 0 );
+    XCTAssert ( t.LookupP ( utlPair<const int,int> ( 500, 0 ) ) == NULL );
+}
+
+/// Lookup neither splays, nor changes what the last Find found.
+- (void)testLookupWritesNothing {
+    StaticSplayTree<int> s;
+    fillEven ( s, 1000 );
+    s.Find ( 500 );
+    XCTAssertTrue ( s.WasFound ( ) );
+    const StaticSplayTree<int>::BinaryNode* root = s.GetRoot ( );
+    XCTAssert ( s.Lookup ( 1 ) == NULL );
+    XCTAssert ( s.Lookup ( 0 ) != NULL );
+    XCTAssert ( s.GetRoot ( ) == root );
+    XCTAssertTrue ( s.WasFound ( ) );
+    XCTAssertEqual ( s.GetCurrent ( )->GetElement ( ), 500 );
+}
+
+/// threads look up items of one tree at once.
+- (void)testConcurrentLookups {
+    StaticRedBlackTree<int> t ( -10 );
+    fillEven ( t, 20000 );
+    const StaticRedBlackTree<int>& ct = t;
+    std::atomic<int> errors ( 0 );
+    std::vector<std::thread> threads;
+    for ( int i = 0; i < 4; ++i )
+        threads.push_back ( std::thread ( [&ct, &errors, i] {
+            TestRandom r ( i + 1 );
+            int wrong = 0;
+            for ( int j = 0; j < 100000; ++j ) {
+                int k = r ( 40000 );
+                wrong += ( ct.Lookup ( k ) != NULL ) != ( k % 2 == 0 );
+            }
+            errors += wrong;
+        } ) );
+    for ( size_t i = 0; i < threads.size ( ); ++i ) threads[i].join ( );
+    XCTAssertEqual ( errors.load ( ), 0 );
+}
+
+@end
@@ -0,0 +1,136 @@
+//
+//  NodeLayoutTests.mm
+//  ArvoresTests
+//
+//  Trees on compact node layouts, and on nodes linked by 32-bit indices:
+//  the size of their nodes, and their items and balance against std::set.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <math.h>
+#include <set>
+#include "AVLTree.h"
+#include "AATree.h"
+#include "RedBlack.h"
+#include "Splay.h"
+
+/** returns the number of differences with a std::set while items below n
+ *  are inserted into and removed from t at random, and of checks in which
+ *  t is higher than most times log2 of its size. t holds no other items.
+ */
+template <class Tree>
+static int checkTree ( Tree& t, int n, double most, unsigned seed ) {
+    std::set<int> s;
+    for ( int k = 0; k < n; ++k )
+         if ( t.IsFound ( k ) ) s.insert ( k );
+    TestRandom r ( seed );
+    int errors = 0;
+    for ( int i = 0; i < 8 * n; ++i ) {
+        int k = r ( n );
+        if ( r ( 3 ) ) { t.Insert ( k ); s.insert ( k ); }
+        else           { t.Remove ( k ); s.erase ( k ); }
+        if ( i % 997 == 0 ) {
+             for ( int j = 0; j < n; ++j ) errors += ( t.Lookup ( j ) != NULL ) != ( s.count ( j ) != 0 );
+             int size = t.Size ( t.GetRoot ( ) );
+             errors += size != (int) s.size ( );
+             errors += most > 0 && t.Height ( t.GetRoot ( ) ) + 1 > most * log2 ( size + 2.0 );
+        }
+    }
+    return errors;
+}
+
+typedef BinNode<int,compare_to<int> > FullNode;
+typedef IndexedAVLTree<int>::BinaryNode IndexedNode;
+typedef utlIndexLink<IndexedNode> IndexedLink;
+
+@interface NodeLayoutTests : XCTestCase
+
+@end
+
+@implementation NodeLayoutTests
+
+/// a one-byte balancing field fits in the padding after an int key.
+- (void)testCompactNodeSizes {
+    if ( sizeof ( void* ) != 8 ) return;
+    XCTAssertEqual ( sizeof ( FullNode ), (size_t) 32 );
+    XCTAssertEqual ( sizeof ( CompactAVLTree<int>::BinaryNode ), (size_t) 24 );
+    XCTAssertEqual ( sizeof ( CompactAATree<int>::BinaryNode ), (size_t) 24 );
+    XCTAssertEqual ( sizeof ( CompactRedBlackTree<int>::BinaryNode ), (size_t) 24 );
+    XCTAssertEqual ( sizeof ( CompactSplayTree<int>::BinaryNode ), (size_t) 24 );
+}
+
+/// the compact trees hold the same items, and keep their balance.
+- (void)testCompactTrees {
+    CompactAVLTree<int> avl;
+    CompactAATree<int> aa;
+    CompactRedBlackTree<int> rb ( -1 );
+    CompactSplayTree<int> splay;
+    XCTAssertEqual ( checkTree ( avl, 3000, 1.45, 1 ), 0 );
+    XCTAssertEqual ( checkTree ( aa, 3000, 2.0, 2 ), 0 );
+    XCTAssertEqual ( checkTree ( rb, 3000, 2.0, 3 ), 0 );
+    XCTAssertEqual ( checkTree ( splay, 3000, 0, 4 ), 0 );
+}
+
+/// a red-black tree is built from an AVL tree of another layout.
+- (void)testRedBlackFromCompactAVL {
+    CompactAVLTree<int> avl;
+    std::vector<int> keys = shuffledKeys ( 1000, 5 );
+    for ( size_t i = 0; i < keys.size ( ); ++i ) avl.Insert ( keys[i] );
+    CompactRedBlackTree<int> rb ( avl, -1 );
+    int missing = 0;
+    for ( int k = 0; k < 1000; ++k ) missing += !rb.IsFound ( k );
+    XCTAssertEqual ( missing, 0 );
+    XCTAssertEqual ( rb.Size ( rb.GetRoot ( ) ), 1000 );
+    XCTAssertEqual ( checkTree ( rb, 1000, 2.0, 6 ), 0 );
+}
+
+/// two 32-bit links and an int key, with a one-byte balancing field.
+- (void)testIndexedNodeSizes {
+    XCTAssertEqual ( sizeof ( IndexedNode ), (size_t) 16 );
+    XCTAssertEqual ( sizeof ( IndexedAATree<int>::BinaryNode ), (size_t) 16 );
+    XCTAssertEqual ( sizeof ( IndexedRedBlackTree<int>::BinaryNode ), (size_t) 16 );
+    XCTAssertEqual ( sizeof ( IndexedSplayTree<int>::BinaryNode ), (size_t) 16 );
+    XCTAssertEqual ( sizeof ( IndexedLink ), (size_t) 4 );
+}
+
+- (void)testIndexedTrees {
+    IndexedAVLTree<int> avl;
+    IndexedAATree<int> aa;
+    IndexedRedBlackTree<int> rb ( -1 );
+    IndexedSplayTree<int> splay;
+    XCTAssertEqual ( checkTree ( avl, 3000, 1.45, 7 ), 0 );
+    XCTAssertEqual ( checkTree ( aa, 3000, 2.0, 8 ), 0 );
+    XCTAssertEqual ( checkTree ( rb, 3000, 2.0, 9 ), 0 );
+    XCTAssertEqual ( checkTree ( splay, 3000, 0, 10 ), 0 );
+}
+
+/// links convert to and from node pointers, and index 0 is the shared NullNode.
+- (void)testIndexLinks {
+    IndexedAVLTree<int> a, b;
+    for ( int k = 0; k < 100; ++k ) a.Insert ( k );
+    const IndexedNode* root = a.GetRoot ( );
+    IndexedLink l ( root );
+    XCTAssert ( (IndexedNode*) l == root );
+    XCTAssertNotEqual ( l.index ( ), (uint32_t) 0 );
+    XCTAssertEqual ( l->GetElement ( ), root->GetElement ( ) );
+    XCTAssertEqual ( IndexedLink ( ).index ( ), (uint32_t) 0 );
+    XCTAssert ( IndexedLink ( ) == b.GetRoot ( ) );
+    XCTAssert ( a.GetRoot ( ) != b.GetRoot ( ) );
+}
+
+/// trees of one node type interleave their nodes, and are destroyed apart.
+- (void)testManyIndexedTrees {
+    std::vector<IndexedAVLTree<int>*> trees;
+    for ( int i = 0; i < 20; ++i ) trees.push_back ( new IndexedAVLTree<int> );
+    for ( int k = 0; k < 20000; ++k ) trees[k % 20]->Insert ( k );
+    for ( int i = 0; i < 20; i += 2 ) delete trees[i];
+    int errors = 0;
+    for ( int k = 0; k < 20000; ++k )
+        if ( k % 2 ) errors += !trees[k % 20]->IsFound ( k ) || trees[k % 20]->IsFound ( k + 1 );
+    for ( int i = 1; i < 20; i += 2 ) delete trees[i];
+    XCTAssertEqual ( errors, 0 );
+}
+
+@end
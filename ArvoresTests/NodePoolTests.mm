@@ -0,0 +1,171 @@
+//
+//  NodePoolTests.mm
+//  ArvoresTests
+//
+//  The slab allocator of tree nodes: reuse of freed nodes, chunks given
+//  back to the system, and trees taking their nodes from a pool and
+//  giving them back, one by one or all at once.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <set>
+#include "utlNodePool.h"
+#include "AVLTree.h"
+#include "Splay.h"
+
+typedef BinNode<int,compare_to<int> > IntNode;
+typedef utlNodePool<IntNode> IntPool;
+
+/// a pool counting the nodes it hands out and takes back, and its releases.
+struct CountingPool : public IntPool {
+    static long Allocated, Deallocated, Released;
+    IntNode* allocate ( ) { ++Allocated; return IntPool::allocate ( ); }
+    void deallocate ( IntNode* p ) { if ( p ) ++Deallocated; IntPool::deallocate ( p ); }
+    bool release ( ) { bool done = IntPool::release ( ); Released += done; return done; }
+    static long live ( ) { return Allocated - Deallocated; }
+};
+
+long CountingPool::Allocated = 0;
+long CountingPool::Deallocated = 0;
+long CountingPool::Released = 0;
+
+/// an item with a destructor, counting its live instances.
+struct PoolItem {
+    static int Live;
+    int Key;
+    PoolItem ( int k = 0 ) : Key ( k ) { ++Live; }
+    PoolItem ( const PoolItem& p ) : Key ( p.Key ) { ++Live; }
+    ~PoolItem ( ) { --Live; }
+    PoolItem& operator = ( const PoolItem& p ) { Key = p.Key; return *this; }
+    bool operator < ( const PoolItem& p ) const { return Key < p.Key; }
+    bool operator == ( const PoolItem& p ) const { return Key == p.Key; }
+    bool operator != ( const PoolItem& p ) const { return Key != p.Key; }
+};
+
+int PoolItem::Live = 0;
+
+typedef StaticAVLTree<int,compare_to<int>,CountingPool> CountingAVLTree;
+typedef StaticSplayTree<int,compare_to<int>,CountingPool> CountingSplayTree;
+
+@interface NodePoolTests : XCTestCase
+
+@end
+
+@implementation NodePoolTests
+
+/// freed nodes are handed out again, without growing the pool.
+- (void)testReuseFreedNodes {
+    IntPool p;
+    std::vector<IntNode*> nodes;
+    for ( int i = 0; i < 5000; ++i ) nodes.push_back ( p.allocate ( ) );
+    size_t bytes = p.capacity ( );
+    XCTAssertGreaterThanOrEqual ( bytes, 5000 * sizeof ( IntNode ) );
+    std::set<IntNode*> freed ( nodes.begin ( ), nodes.end ( ) );
+    XCTAssertEqual ( freed.size ( ), nodes.size ( ) );
+    for ( size_t i = 0; i < nodes.size ( ); ++i ) p.deallocate ( nodes[i] );
+    int reused = 0;
+    for ( int i = 0; i < 5000; ++i ) reused += (int) freed.count ( p.allocate ( ) );
+    XCTAssertEqual ( reused, 5000 );
+    XCTAssertEqual ( p.capacity ( ), bytes );
+}
+
+/// chunks with no live node go back to the system.
+- (void)testShrinkToFit {
+    IntPool p;
+    std::vector<IntNode*> nodes;
+    for ( int i = 0; i < 20000; ++i ) nodes.push_back ( p.allocate ( ) );
+    IntNode* kept = nodes[0];
+    for ( size_t i = 1; i < nodes.size ( ); ++i ) p.deallocate ( nodes[i] );
+    size_t bytes = p.capacity ( );
+    p.shrink_to_fit ( );
+    XCTAssertLessThan ( p.capacity ( ), bytes );
+    XCTAssertGreaterThan ( p.capacity ( ), (size_t) 0 );
+    // slots of the chunk kept are still handed out
+    IntNode* n = p.allocate ( );
+    XCTAssert ( n != kept );
+    p.deallocate ( n );
+    p.deallocate ( kept );
+    p.shrink_to_fit ( );
+    XCTAssertEqual ( p.capacity ( ), (size_t) 0 );
+}
+
+/// a tree takes a node per item from its pool, and gives it back on removal.
+- (void)testTreeNodesFromPool {
+    CountingPool::Allocated = CountingPool::Deallocated = 0;
+    {
+      CountingAVLTree t;
+      std::vector<int> keys = shuffledKeys ( 3000, 3 );
+      for ( size_t i = 0; i < keys.size ( ); ++i ) t.Insert ( keys[i] );
+      XCTAssertEqual ( CountingPool::live ( ), 3000 );
+      for ( int k = 0; k < 3000; k += 2 ) t.Remove ( k );
+      XCTAssertEqual ( CountingPool::live ( ), 1500 );
+      XCTAssertEqual ( CountingPool::Deallocated, 1500 );
+      for ( int k = 1; k < 3000; k += 2 ) XCTAssertTrue ( t.IsFound ( k ) );
+    }
+    // a splay tree allocates nothing for an item it already holds
+    CountingSplayTree s;
+    for ( int k = 0; k < 100; ++k ) s.Insert ( k );
+    long before = CountingPool::Allocated;
+    for ( int k = 0; k < 100; ++k ) s.Insert ( k );
+    XCTAssertEqual ( CountingPool::Allocated, before );
+}
+
+/// a merged tree shares the memory of the trees it took its nodes from.
+- (void)testMergeOutlivesSources {
+    StaticSearchTree<int>* merged = new StaticSearchTree<int>;
+    {
+      StaticSearchTree<int> left, right;
+      for ( int k = 0; k < 500; ++k ) left.Insert ( k );
+      for ( int k = 501; k < 1000; ++k ) right.Insert ( k );
+      merged->Merge ( 500, left, right );
+      XCTAssertTrue ( left.IsEmpty ( ) );
+      XCTAssertTrue ( right.IsEmpty ( ) );
+    }
+    int missing = 0;
+    for ( int k = 0; k < 1000; ++k ) missing += !merged->IsFound ( k );
+    XCTAssertEqual ( missing, 0 );
+    merged->Insert ( 1000 );
+    delete merged;
+}
+
+/// a tree of trivially destructible items gives its pool back without visiting its nodes.
+- (void)testReleaseWithoutWalking {
+    CountingPool::Allocated = CountingPool::Deallocated = CountingPool::Released = 0;
+    CountingAVLTree t;
+    for ( int k = 0; k < 5000; ++k ) t.Insert ( k );
+    t.MakeEmpty ( );
+    XCTAssertEqual ( CountingPool::Deallocated, 0 );
+    XCTAssertEqual ( CountingPool::Released, 1 );
+    XCTAssertTrue ( t.IsEmpty ( ) );
+    for ( int k = 0; k < 100; ++k ) t.Insert ( k );
+    XCTAssertEqual ( t.Size ( t.GetRoot ( ) ), 100 );
+}
+
+/// items with a destructor are destroyed, each once, on MakeEmpty and destruction.
+- (void)testItemsDestroyed {
+    XCTAssertEqual ( PoolItem::Live, 0 );
+    {
+      StaticAVLTree<PoolItem> t;
+      int sentinels = PoolItem::Live;
+      for ( int k = 0; k < 2000; ++k ) t.Insert ( PoolItem ( k ) );
+      t.MakeEmpty ( );
+      XCTAssertEqual ( PoolItem::Live, sentinels );
+      for ( int k = 0; k < 2000; ++k ) t.Insert ( PoolItem ( k ) );
+    }
+    XCTAssertEqual ( PoolItem::Live, 0 );
+}
+
+/** items inserted in order leave a splay tree as a path, which is
+ *  freed without recursion.
+ */
+- (void)testDegenerateTreeFreed {
+    {
+      StaticSplayTree<PoolItem> t;
+      for ( int k = 0; k < 300000; ++k ) t.Insert ( PoolItem ( k ) );
+    }
+    XCTAssertEqual ( PoolItem::Live, 0 );
+}
+
+@end
@@ -0,0 +1,161 @@
+//
+//  OrderStatisticsTests.mm
+//  ArvoresTests
+//
+//  Order statistics of the trees which keep sizes: LookupKth, FindKth,
+//  Rank, RemoveKth and Sample against std::set, the sizes of every node
+//  after changes and splaying reads, and nth and rank of sets and maps.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <set>
+#include <vector>
+#include "AVLTree.h"
+#include "AATree.h"
+#include "RedBlack.h"
+#include "Splay.h"
+#include "Ordered.h"
+#include "utlSet.h"
+#include "utlMap.h"
+
+typedef utlPair<const int,int> IntPair;
+typedef compare_pair<IntPair> PairLess;
+typedef utlSet<int,compare_to<int>,CountedAVLTree<int> > CountedSet;
+typedef utlMap<int,int,PairLess,CountedAATree<IntPair,PairLess> > CountedMap;
+
+/// returns the number of nodes under p whose size is not that of their children plus one.
+template <class Tree>
+static int checkSizes ( const Tree& t, const typename Tree::BinaryNode* p ) {
+    if ( t.Size ( p ) == 0 ) return 0;
+    int errors = p->GetSize ( ) != t.Size ( p->GetLeft ( ) ) + t.Size ( p->GetRight ( ) ) + 1;
+    return errors + checkSizes ( t, p->GetLeft ( ) ) + checkSizes ( t, p->GetRight ( ) );
+}
+
+/** returns the number of wrong answers of LookupKth, FindKth and Rank
+ *  of t, against s, whose items are below n.
+ */
+template <class Tree>
+static int checkRanks ( Tree& t, const std::set<int>& s, int n ) {
+    std::vector<int> v ( s.begin ( ), s.end ( ) );
+    int errors = 0;
+    for ( int i = 0; i < (int) v.size ( ); ++i ) {
+        const typename Tree::BinaryNode* node = t.LookupKth ( i + 1 );
+        errors += node == NULL || node->GetElement ( ) != v[i];
+        errors += t.FindKth ( i + 1 ) != v[i];
+    }
+    errors += t.LookupKth ( 0 ) != NULL || t.LookupKth ( (int) v.size ( ) + 1 ) != NULL;
+    for ( int k = 0; k < n; ++k )
+        errors += t.Rank ( k ) != (int) std::distance ( s.begin ( ), s.lower_bound ( k ) );
+    return errors;
+}
+
+/** inserts, removes and removes by rank random items below n in t,
+ *  against a std::set, reading some of them between the changes.
+ *  The sizes of the nodes are checked if the tree keeps them.
+ *  Returns the number of errors.
+ */
+template <class Tree>
+static int checkRandomOps ( Tree& t, int n, int ops, unsigned seed, bool sized = true ) {
+    std::set<int> s;
+    TestRandom r ( seed );
+    int errors = 0;
+    for ( int i = 0; i < ops; ++i ) {
+        int k = r ( n );
+        switch ( r ( 4 ) ) {
+        case 0:
+        case 1:
+             errors += ( t.Insert ( k ) != 0 ) != s.insert ( k ).second;
+             break;
+        case 2:
+             errors += ( t.Remove ( k ) != 0 ) != ( s.erase ( k ) != 0 );
+             break;
+        default:
+             if ( s.empty ( ) ) break;
+             int K = 1 + r ( (int) s.size ( ) );
+             std::set<int>::iterator it = s.begin ( );
+             std::advance ( it, K - 1 );
+             s.erase ( it );
+             errors += !t.RemoveKth ( K );
+        }
+        t.IsFound ( r ( n ) );
+        if ( sized && i % 500 == 0 ) errors += checkSizes ( t, t.GetRoot ( ) );
+    }
+    if ( sized ) errors += checkSizes ( t, t.GetRoot ( ) );
+    return errors + checkRanks ( t, s, n );
+}
+
+@interface OrderStatisticsTests : XCTestCase
+
+@end
+
+@implementation OrderStatisticsTests
+
+/// every counted tree keeps the sizes of its nodes, and answers by rank.
+- (void)testCountedTrees {
+    CountedAVLTree<int> avl;
+    CountedAATree<int> aa;
+    CountedSplayTree<int> splay;
+    CountedRedBlackTree<int> rb ( -1 );
+    XCTAssertEqual ( checkRandomOps ( avl, 2000, 20000, 1 ), 0 );
+    XCTAssertEqual ( checkRandomOps ( aa, 2000, 20000, 2 ), 0 );
+    XCTAssertEqual ( checkRandomOps ( splay, 2000, 20000, 3 ), 0 );
+    XCTAssertEqual ( checkRandomOps ( rb, 2000, 5000, 4 ), 0 );
+}
+
+/// the ordered tree keeps sizes, and other trees count them, in O(n).
+- (void)testOtherTrees {
+    StaticOrderedSearchTree<int> ordered;
+    StaticAVLTree<int> avl;
+    XCTAssertEqual ( checkRandomOps ( ordered, 1000, 5000, 5 ), 0 );
+    XCTAssertEqual ( checkRandomOps ( avl, 500, 2000, 6, false ), 0 );
+}
+
+/// Sample maps [0, 1) onto the ranks.
+- (void)testSample {
+    CountedAVLTree<int> t;
+    for ( int k = 0; k < 1000; ++k ) t.Insert ( 10 * k );
+    XCTAssertEqual ( t.Sample ( 0 ), 0 );
+    XCTAssertEqual ( t.Sample ( 0.5 ), 5000 );
+    XCTAssertEqual ( t.Sample ( 0.9999 ), 9990 );
+    XCTAssertEqual ( t.Sample ( 1 ), 9990 );
+    int errors = 0;
+    for ( int i = 0; i < 1000; ++i ) errors += t.Sample ( ( i + 0.5 ) / 1000 ) != 10 * i;
+    XCTAssertEqual ( errors, 0 );
+}
+
+/// trees changed by batches, joins and splits keep their sizes.
+- (void)testSizesAfterJoinAndSplit {
+    CountedAVLTree<int> t, less, greater;
+    std::vector<int> keys = shuffledKeys ( 5000, 7 );
+    t.InsertBatch ( keys.begin ( ), keys.end ( ) );
+    t.Split ( 2500, less, greater );
+    XCTAssertEqual ( checkSizes ( less, less.GetRoot ( ) ) + checkSizes ( greater, greater.GetRoot ( ) ), 0 );
+    XCTAssertEqual ( greater.Rank ( 2501 ), 0 );
+    XCTAssertEqual ( greater.FindKth ( 1 ), 2501 );
+    t.Join ( less, 2500, greater );
+    XCTAssertEqual ( checkSizes ( t, t.GetRoot ( ) ), 0 );
+    XCTAssertEqual ( t.Rank ( 2500 ), 2500 );
+    XCTAssertEqual ( t.FindKth ( 5000 ), 4999 );
+}
+
+/// nth and rank of sets and maps.
+- (void)testNthAndRank {
+    CountedSet s;
+    for ( int k = 0; k < 1000; ++k ) s.insert ( 2 * k );
+    XCTAssertEqual ( *s.nth ( 0 ), 0 );
+    XCTAssertEqual ( *s.nth ( s.size ( ) / 2 ), 1000 );
+    XCTAssert ( s.nth ( s.size ( ) ) == s.end ( ) );
+    XCTAssertEqual ( (int) s.rank ( 1000 ), 500 );
+    XCTAssertEqual ( (int) s.rank ( 1001 ), 501 );
+
+    CountedMap m;
+    for ( int k = 0; k < 100; ++k ) m[k * 3] = k;
+    XCTAssertEqual ( m.nth ( 10 )->first, 30 );
+    XCTAssertEqual ( m.nth ( 10 )->second, 10 );
+    XCTAssertEqual ( (int) m.rank ( 31 ), 11 );
+    XCTAssert ( m.nth ( 100 ) == m.end ( ) );
+}
+
+@end
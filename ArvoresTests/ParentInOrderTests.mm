@@ -0,0 +1,92 @@
+//
+//  ParentInOrderTests.mm
+//  ArvoresTests
+//
+//  Stackless in-order iterators of utlSet and utlMap on trees whose
+//  nodes link to their parents.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include "utlSet.h"
+#include "utlMap.h"
+
+typedef utlSet<int,compare_to<int>,ParentAVLTree<int> > ParentSet;
+typedef compare_pair<utlPair<const int,int> > PairLess;
+typedef utlMap<int,int,PairLess,ParentAVLTree<utlPair<const int,int>,PairLess> > ParentMap;
+
+/** returns the number of items of s, which holds the keys 0, step, 2*step, ...
+ *  below n*step, met out of place going forward and then back.
+ */
+template <class Set>
+static int checkWalk ( const Set& s, int n, int step ) {
+    int errors = 0, k = 0;
+    typename Set::iterator it = s.begin ( );
+    for ( ; it != s.end ( ); ++it, ++k ) errors += *it != k * step;
+    errors += k != n;
+    while ( it != s.begin ( ) ) {
+        --it;
+        errors += *it != --k * step;
+    }
+    return errors + ( k != 0 );
+}
+
+@interface ParentInOrderTests : XCTestCase
+
+@end
+
+@implementation ParentInOrderTests
+
+- (void)testIteratorIsTwoPointers {
+    XCTAssertEqual ( sizeof ( ParentSet::iterator_type ), 2 * sizeof ( void* ) );
+    XCTAssertFalse ( std::is_polymorphic<ParentSet::iterator_type>::value );
+    XCTAssertEqual ( (int) ParentAVLTree<int>::Shareable, 0 );
+}
+
+- (void)testWalk {
+    const int n = 5000;
+    std::vector<int> keys = shuffledKeys ( n, 3, 0, 2 );
+    ParentSet s;
+    for ( size_t i = 0; i < keys.size ( ); ++i ) s.insert ( keys[i] );
+    XCTAssertEqual ( checkWalk ( s, n, 2 ), 0 );
+    XCTAssertEqual ( *s.find ( 1000 ), 1000 );
+    XCTAssertEqual ( *--s.find ( 1000 ), 998 );
+    XCTAssertEqual ( *++s.lower_bound ( 1001 ), 1004 );
+    XCTAssert ( ++s.find ( 2 * ( n - 1 ) ) == s.end ( ) );
+    XCTAssertEqual ( *--s.end ( ), 2 * ( n - 1 ) );
+}
+
+/// erasing the other items keeps an iterator on its node.
+- (void)testEraseAround {
+    ParentSet s;
+    std::vector<int> keys = shuffledKeys ( 1000, 5 );
+    for ( size_t i = 0; i < keys.size ( ); ++i ) s.insert ( keys[i] );
+    ParentSet::iterator it = s.find ( 500 );
+    for ( int k = 0; k < 1000; ++k )
+         if ( k % 100 != 0 ) s.erase ( k );
+    XCTAssertEqual ( *it, 500 );
+    ++it;
+    XCTAssertEqual ( *it, 600 );
+    XCTAssertEqual ( checkWalk ( s, 10, 100 ), 0 );
+}
+
+/// copies do not share nodes, and change on their own.
+- (void)testCopies {
+    ParentMap m;
+    for ( int k = 0; k < 1000; ++k ) m[k] = k;
+    ParentMap c;
+    c = m;
+    ParentMap::iterator it = c.find ( 10 );
+    it->second = -10;
+    c.erase ( 11 );
+    m[1000] = 1000;
+    XCTAssertEqual ( m.find ( 10 )->second, 10 );
+    XCTAssert ( m.find ( 11 ) != m.end ( ) );
+    XCTAssert ( c.find ( 1000 ) == c.end ( ) );
+    XCTAssertEqual ( (int) m.size ( ), 1001 );
+    XCTAssertEqual ( (int) c.size ( ), 999 );
+    XCTAssertEqual ( (++it)->first, 12 );
+}
+
+@end
@@ -0,0 +1,201 @@
+//
+//  PersistentAVLTreeTests.mm
+//  ArvoresTests
+//
+//  PersistentAVLTree: snapshots which keep their items while the tree
+//  changes, restores, the nodes shared between versions and freed with
+//  the last of them, and threads reading snapshots during writes.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+#include "PersistentAVLTree.h"
+#include "utlMap.h"
+
+typedef PersistentAVLTree<int> IntTree;
+typedef IntTree::Snapshot IntSnapshot;
+typedef utlPair<const int,int> IntPair;
+typedef PersistentAVLTree<IntPair,compare_pair<IntPair> > PairTree;
+
+/// an item which counts its live instances.
+struct Versioned {
+    static int Live;
+    int Key;
+    Versioned ( int k = 0 ) : Key ( k ) { ++Live; }
+    Versioned ( const Versioned& v ) : Key ( v.Key ) { ++Live; }
+    ~Versioned ( ) { --Live; }
+    bool operator < ( const Versioned& v ) const { return Key < v.Key; }
+};
+
+int Versioned::Live = 0;
+
+/** returns the number of nodes under p whose height or size is not that
+ *  of their children, or whose children differ by more than one in height.
+ */
+static int checkNodes ( const IntSnapshot::BinaryNode* p ) {
+    if ( p == NULL ) return 0;
+    int hl = p->GetLeft ( ) ? p->GetLeft ( )->GetHeight ( ) : 0;
+    int hr = p->GetRight ( ) ? p->GetRight ( )->GetHeight ( ) : 0;
+    int sl = p->GetLeft ( ) ? p->GetLeft ( )->GetSize ( ) : 0;
+    int sr = p->GetRight ( ) ? p->GetRight ( )->GetSize ( ) : 0;
+    int errors = p->GetHeight ( ) != ( hl > hr ? hl : hr ) + 1 || p->GetSize ( ) != sl + sr + 1;
+    errors += hl - hr > 1 || hr - hl > 1;
+    return errors + checkNodes ( p->GetLeft ( ) ) + checkNodes ( p->GetRight ( ) );
+}
+
+/// returns the number of differences between the version v and s.
+static int checkVersion ( const IntSnapshot& v, const std::set<int>& s ) {
+    std::vector<int> items;
+    v.ForEach ( [&items] ( const int& x ) { items.push_back ( x ); } );
+    int errors = items != std::vector<int> ( s.begin ( ), s.end ( ) );
+    errors += v.Size ( ) != (int) s.size ( );
+    if ( !s.empty ( ) ) errors += v.FindMin ( ) != *s.begin ( ) || v.FindMax ( ) != *s.rbegin ( );
+    return errors + checkNodes ( v.GetRoot ( ) );
+}
+
+/// collects the nodes under p.
+static void collect ( const IntSnapshot::BinaryNode* p, std::set<const IntSnapshot::BinaryNode*>& nodes ) {
+    if ( p == NULL ) return;
+    nodes.insert ( p );
+    collect ( p->GetLeft ( ), nodes );
+    collect ( p->GetRight ( ), nodes );
+}
+
+@interface PersistentAVLTreeTests : XCTestCase
+
+@end
+
+@implementation PersistentAVLTreeTests
+
+/// every snapshot keeps the items it was taken with.
+- (void)testSnapshotsUnchanged {
+    IntTree t;
+    std::set<int> s;
+    std::vector<IntSnapshot> versions;
+    std::vector<std::set<int> > expected;
+    TestRandom r ( 1 );
+    int errors = 0;
+    for ( int i = 0; i < 20000; ++i ) {
+        int k = r ( 3000 );
+        if ( r ( 2 ) ) errors += t.Insert ( k ) != (int) s.insert ( k ).second;
+        else           errors += t.Remove ( k ) != (int) s.erase ( k );
+        if ( i % 1000 == 0 ) {
+             versions.push_back ( t.TakeSnapshot ( ) );
+             expected.push_back ( s );
+        }
+    }
+    XCTAssertEqual ( errors, 0 );
+    XCTAssertEqual ( checkVersion ( t.TakeSnapshot ( ), s ), 0 );
+    for ( size_t i = 0; i < versions.size ( ); ++i ) errors += checkVersion ( versions[i], expected[i] );
+    XCTAssertEqual ( errors, 0 );
+    t.MakeEmpty ( );
+    XCTAssertTrue ( t.IsEmpty ( ) );
+    XCTAssertEqual ( checkVersion ( versions.back ( ), expected.back ( ) ), 0 );
+}
+
+/// an old version made current again, and changed, leaves the others as they were.
+- (void)testRestore {
+    IntTree t;
+    for ( int k = 0; k < 100; ++k ) t.Insert ( k );
+    IntSnapshot before = t.TakeSnapshot ( );
+    for ( int k = 0; k < 100; k += 2 ) t.Remove ( k );
+    IntSnapshot after = t.TakeSnapshot ( );
+    t.Restore ( before );
+    XCTAssertEqual ( t.Size ( ), 100 );
+    t.Insert ( 1000 );
+    XCTAssertTrue ( t.IsFound ( 1000 ) );
+    XCTAssertFalse ( before.IsFound ( 1000 ) );
+    XCTAssertEqual ( after.Size ( ), 50 );
+    XCTAssertFalse ( after.IsFound ( 0 ) );
+    IntTree c ( t );
+    c.Remove ( 1000 );
+    XCTAssertTrue ( t.IsFound ( 1000 ) );
+    XCTAssertEqual ( before.LowerBound ( 50 )->GetElement ( ), 50 );
+}
+
+/// a change copies only the path to the item.
+- (void)testPathCopying {
+    IntTree t;
+    for ( int k = 0; k < 4096; ++k ) t.Insert ( k );
+    IntSnapshot old = t.TakeSnapshot ( );
+    t.Remove ( 1234 );
+    t.Insert ( 5000 );
+    std::set<const IntSnapshot::BinaryNode*> a, b;
+    collect ( old.GetRoot ( ), a );
+    collect ( t.GetRoot ( ), b );
+    int copied = 0;
+    for ( std::set<const IntSnapshot::BinaryNode*>::iterator it = b.begin ( ); it != b.end ( ); ++it )
+        copied += a.count ( *it ) == 0;
+    XCTAssertLessThan ( copied, 4 * 13 );
+    XCTAssertGreaterThan ( copied, 0 );
+}
+
+/// nodes are freed with the last version using them.
+- (void)testNodesFreed {
+    int before = Versioned::Live;
+    {
+        PersistentAVLTree<Versioned> t;
+        PersistentAVLTree<Versioned>::Snapshot s = t.TakeSnapshot ( );
+        int live = Versioned::Live;
+        for ( int k = 0; k < 1000; ++k ) t.Insert ( Versioned ( k ) );
+        s = t.TakeSnapshot ( );
+        for ( int k = 0; k < 1000; ++k ) t.Remove ( Versioned ( k ) );
+        XCTAssertTrue ( t.IsEmpty ( ) );
+        XCTAssertEqual ( Versioned::Live - live, 1000 );
+        s = t.TakeSnapshot ( );
+        XCTAssertEqual ( Versioned::Live, live );
+        t.Insert ( Versioned ( 1 ) );
+    }
+    XCTAssertEqual ( Versioned::Live, before );
+}
+
+/// pairs are found, inserted and removed by key.
+- (void)testPairs {
+    PairTree t;
+    for ( int k = 0; k < 100; ++k ) t.InsertP ( IntPair ( k, k * k ) );
+    XCTAssertFalse ( t.InsertP ( IntPair ( 5, 0 ) ) );
+    XCTAssertEqual ( t.LookupP ( IntPair ( 9, 0 ) )->GetElement ( ).second, 81 );
+    PairTree::Snapshot s = t.TakeSnapshot ( );
+    XCTAssertTrue ( t.RemoveP ( IntPair ( 9, -1 ) ) );
+    XCTAssertFalse ( t.IsFoundP ( IntPair ( 9, 0 ) ) );
+    XCTAssertTrue ( s.IsFoundP ( IntPair ( 9, 0 ) ) );
+}
+
+/** readers take snapshots while the tree is written, and see whole
+ *  versions: both keys of a pair, changed in a copy which is then restored.
+ */
+- (void)testConcurrentReaders {
+    IntTree t;
+    std::atomic<int> done ( 0 ), errors ( 0 );
+    std::vector<std::thread> readers;
+    for ( int i = 0; i < 3; ++i )
+        readers.push_back ( std::thread ( [&] {
+            int wrong = 0;
+            while ( !done.load ( std::memory_order_acquire ) ) {
+                IntSnapshot v = t.TakeSnapshot ( );
+                int n = 0, last = -1;
+                v.ForEach ( [&] ( const int& x ) { wrong += x <= last; last = x; ++n; } );
+                wrong += n != v.Size ( ) || n % 2 != 0;
+                wrong += checkNodes ( v.GetRoot ( ) );
+            }
+            errors += wrong;
+        } ) );
+    TestRandom r ( 2 );
+    for ( int i = 0; i < 20000; ++i ) {
+        int k = r ( 2000 );
+        IntTree next ( t );
+        if ( next.IsFound ( 2 * k ) ) { next.Remove ( 2 * k ); next.Remove ( 2 * k + 1 ); }
+        else                          { next.Insert ( 2 * k ); next.Insert ( 2 * k + 1 ); }
+        t.Restore ( next.TakeSnapshot ( ) );
+    }
+    done.store ( 1, std::memory_order_release );
+    for ( size_t i = 0; i < readers.size ( ); ++i ) readers[i].join ( );
+    XCTAssertEqual ( errors.load ( ), 0 );
+}
+
+@end
@@ -0,0 +1,149 @@
+//
+//  PredecessorTests.mm
+//  ArvoresTests
+//
+//  Backward steps of the iterators of utlSet and utlMap, which ask the
+//  tree for the predecessor of a node: reverse scans against std::set,
+//  iterators stepped both ways, and the predecessors of the trees.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <set>
+#include "AVLTree.h"
+#include "AATree.h"
+#include "RedBlack.h"
+#include "Splay.h"
+#include "ConcurrentSkipList.h"
+#include "utlSet.h"
+#include "utlMap.h"
+
+typedef utlPair<const int,int> IntPair;
+typedef compare_pair<IntPair> PairLess;
+typedef utlSet<int,compare_to<int>,CompactAVLTree<int> > AVLSet;
+typedef utlSet<int,compare_to<int>,AATree<int> > AASet;
+typedef utlSet<int,compare_to<int>,SplayTree<int> > SplaySet;
+typedef utlSet<int,compare_to<int>,ConcurrentSkipList<int> > ListSet;
+typedef utlMap<int,int,PairLess,AVLTree<IntPair,PairLess> > AVLMap;
+
+/// returns the number of differences between t.Predecessor and s, for every node and the end.
+template <class Tree>
+static int checkPredecessors ( const Tree& t, const std::set<int>& s ) {
+    int errors = 0;
+    const typename Tree::BinaryNode* p = t.Predecessor ( NULL );
+    for ( std::set<int>::const_reverse_iterator it = s.rbegin ( ); it != s.rend ( ); ++it ) {
+        errors += p == NULL || p->GetElement ( ) != *it;
+        if ( p == NULL ) return errors;
+        p = t.Predecessor ( p );
+    }
+    return errors + ( p != NULL );
+}
+
+/** fills set with random keys below n, and returns the number of items
+ *  met out of place by a reverse scan, against a std::set.
+ */
+template <class Set>
+static int checkReverse ( Set& set, int n, unsigned seed ) {
+    std::set<int> s;
+    TestRandom r ( seed );
+    for ( int i = 0; i < n; ++i ) {
+        int k = r ( 2 * n );
+        set.insert ( k );
+        s.insert ( k );
+    }
+    int errors = 0;
+    std::set<int>::const_reverse_iterator e = s.rbegin ( );
+    for ( typename Set::reverse_iterator it = set.rbegin ( ); it != set.rend ( ); ++it, ++e )
+        errors += e == s.rend ( ) || *it != *e;
+    return errors + ( e != s.rend ( ) );
+}
+
+@interface PredecessorTests : XCTestCase
+
+@end
+
+@implementation PredecessorTests
+
+/// the predecessor of every node, and of the end, is the previous item.
+- (void)testTreePredecessors {
+    std::set<int> s;
+    StaticAVLTree<int> avl;
+    StaticAATree<int> aa;
+    StaticRedBlackTree<int> rb ( -1 );
+    TestRandom r ( 1 );
+    for ( int i = 0; i < 3000; ++i ) {
+        int k = r ( 10000 );
+        s.insert ( k ); avl.Insert ( k ); aa.Insert ( k ); rb.Insert ( k );
+    }
+    XCTAssertEqual ( checkPredecessors ( avl, s ), 0 );
+    XCTAssertEqual ( checkPredecessors ( aa, s ), 0 );
+    XCTAssertEqual ( checkPredecessors ( rb, s ), 0 );
+    StaticAVLTree<int> empty;
+    XCTAssert ( empty.Predecessor ( NULL ) == NULL );
+}
+
+/// reverse scans of large sets, which took O(n) per step before.
+- (void)testReverseScans {
+    AVLSet avl;
+    AASet aa;
+    SplaySet splay;
+    ListSet list;
+    XCTAssertEqual ( checkReverse ( avl, 100000, 2 ), 0 );
+    XCTAssertEqual ( checkReverse ( aa, 100000, 3 ), 0 );
+    XCTAssertEqual ( checkReverse ( splay, 100000, 4 ), 0 );
+    XCTAssertEqual ( checkReverse ( list, 100000, 5 ), 0 );
+}
+
+/// an iterator stepped back may be stepped forward again.
+- (void)testBackAndForth {
+    AVLSet s;
+    for ( int k = 0; k < 1000; ++k ) s.insert ( 2 * k );
+    AVLSet::iterator it = s.find ( 1000 );
+    XCTAssertEqual ( *--it, 998 );
+    XCTAssertEqual ( *--it, 996 );
+    XCTAssertEqual ( *++it, 998 );
+    XCTAssertEqual ( *++it, 1000 );
+    XCTAssertEqual ( *++it, 1002 );
+    it = s.end ( );
+    XCTAssertEqual ( *--it, 1998 );
+    ++it;
+    XCTAssert ( it == s.end ( ) );
+    int errors = 0;
+    for ( int k = 1; k < 1000; ++k ) {
+        AVLSet::iterator i = s.find ( 2 * k );
+        --i;
+        errors += *i != 2 * k - 2;
+        ++i;
+        errors += *i != 2 * k;
+    }
+    XCTAssertEqual ( errors, 0 );
+}
+
+/// count and equal_range step back from the bound they find.
+- (void)testCountAndEqualRange {
+    AVLSet s;
+    for ( int k = 0; k < 50000; ++k ) s.insert ( 3 * k );
+    int errors = 0;
+    for ( int k = 0; k < 3000; ++k ) {
+        errors += (int) s.count ( k ) != ( k % 3 == 0 );
+        utlPair<AVLSet::iterator,AVLSet::iterator> r = s.equal_range ( k );
+        errors += ( r.first != r.second ) != ( k % 3 == 0 );
+    }
+    XCTAssertEqual ( errors, 0 );
+}
+
+/// maps scan backwards too.
+- (void)testMapReverse {
+    AVLMap m;
+    for ( int k = 0; k < 20000; ++k ) m[k] = -k;
+    int k = 20000, errors = 0;
+    for ( AVLMap::reverse_iterator it = m.rbegin ( ); it != m.rend ( ); ++it ) {
+        --k;
+        errors += it->first != k || it->second != -k;
+    }
+    XCTAssertEqual ( errors, 0 );
+    XCTAssertEqual ( k, 0 );
+}
+
+@end
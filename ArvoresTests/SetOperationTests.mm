@@ -0,0 +1,140 @@
+//
+//  SetOperationTests.mm
+//  ArvoresTests
+//
+//  Union, intersection and difference of utlSet and utlMap, against
+//  std::set_union, std::set_intersection and std::set_difference.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include "utlSet.h"
+#include "utlMap.h"
+
+/// returns n distinct keys below limit, sorted.
+static std::vector<int> sortedKeys ( int n, int limit, unsigned seed ) {
+    std::vector<int> all = shuffledKeys ( limit, seed );
+    std::vector<int> keys ( all.begin ( ), all.begin ( ) + n );
+    std::sort ( keys.begin ( ), keys.end ( ) );
+    return keys;
+}
+
+/// returns a set holding keys.
+template <class Set>
+static void fillSet ( Set& s, const std::vector<int>& keys ) {
+    std::vector<int> order = keys;
+    TestRandom r ( (unsigned) keys.size ( ) );
+    for ( int i = (int) order.size ( ) - 1; i > 0; --i ) std::swap ( order[i], order[r ( i + 1 )] );
+    for ( size_t i = 0; i < order.size ( ); ++i ) s.insert ( order[i] );
+}
+
+/** returns the number of differences between the set operations of Set
+ *  on a and b, done with the given number of threads, and those of std.
+ */
+template <class Set>
+static int checkSetOperations ( const std::vector<int>& a, const std::vector<int>& b, int threads ) {
+    int errors = 0;
+    for ( int op = 0; op < 3; ++op ) {
+        Set x, y;
+        fillSet ( x, a );
+        fillSet ( y, b );
+        std::vector<int> expected;
+        if ( op == 0 ) {
+             x.set_union ( y, threads );
+             std::set_union ( a.begin(), a.end(), b.begin(), b.end(), std::back_inserter ( expected ) );
+        }
+        else if ( op == 1 ) {
+             x.set_intersection ( y, threads );
+             std::set_intersection ( a.begin(), a.end(), b.begin(), b.end(), std::back_inserter ( expected ) );
+        }
+        else {
+             x.set_difference ( y, threads );
+             std::set_difference ( a.begin(), a.end(), b.begin(), b.end(), std::back_inserter ( expected ) );
+        }
+        std::vector<int> got;
+        for ( typename Set::iterator it = x.begin ( ); it != x.end ( ); ++it ) got.push_back ( *it );
+        errors += got != expected;
+        errors += x.size ( ) != expected.size ( );
+        errors += y.size ( ) != 0 || y.begin ( ) != y.end ( );
+    }
+    return errors;
+}
+
+/// same, for maps: the values of a are kept.
+template <class Map>
+static int checkMapUnion ( const std::vector<int>& a, const std::vector<int>& b, int threads ) {
+    Map x, y;
+    for ( size_t i = 0; i < a.size ( ); ++i ) x[a[i]] = 1;
+    for ( size_t i = 0; i < b.size ( ); ++i ) y[b[i]] = 2;
+    x.set_union ( y, threads );
+    std::vector<int> expected;
+    std::set_union ( a.begin(), a.end(), b.begin(), b.end(), std::back_inserter ( expected ) );
+    int errors = x.size ( ) != expected.size ( );
+    size_t i = 0;
+    for ( typename Map::iterator it = x.begin ( ); it != x.end ( ); ++it, ++i ) {
+        errors += i >= expected.size ( ) || it->first != expected[i];
+        errors += it->second != ( std::binary_search ( a.begin(), a.end(), it->first ) ? 1 : 2 );
+    }
+    return errors;
+}
+
+/// sets on trees which join subtrees, and on trees which do not.
+typedef utlSet<int,compare_to<int>,AVLTree<int> > AVLSet;
+typedef utlSet<int,compare_to<int>,AATree<int> > AASet;
+typedef compare_pair<utlPair<const int,int> > PairLess;
+typedef utlMap<int,int,PairLess,AVLTree<utlPair<const int,int>,PairLess> > AVLMap;
+typedef utlMap<int,int> SplayMap;
+
+@interface SetOperationTests : XCTestCase
+
+@end
+
+@implementation SetOperationTests
+
+/// trees which join subtrees, on one thread and on several.
+- (void)testJoinableSets {
+    std::vector<int> a = sortedKeys ( 20000, 60000, 1 );
+    std::vector<int> b = sortedKeys ( 5000, 60000, 2 );
+    std::vector<int> none;
+    for ( int threads = 1; threads <= 8; threads *= 2 ) {
+        XCTAssertEqual ( checkSetOperations<AVLSet> ( a, b, threads ), 0 );
+        XCTAssertEqual ( checkSetOperations<AVLSet> ( b, a, threads ), 0 );
+        XCTAssertEqual ( checkSetOperations<AVLSet> ( a, none, threads ), 0 );
+        XCTAssertEqual ( checkSetOperations<AVLSet> ( none, a, threads ), 0 );
+    }
+    // more threads than the pool: they are capped
+    XCTAssertEqual ( checkSetOperations<AVLSet> ( a, b, 1000 ), 0 );
+    XCTAssertEqual ( checkSetOperations<AVLSet> ( a, b, 0 ), 0 );
+}
+
+/// trees which combine item by item.
+- (void)testOtherSets {
+    std::vector<int> a = sortedKeys ( 3000, 8000, 3 );
+    std::vector<int> b = sortedKeys ( 3000, 8000, 4 );
+    XCTAssertEqual ( checkSetOperations<utlSet<int> > ( a, b, 0 ), 0 );
+    XCTAssertEqual ( checkSetOperations<AASet> ( a, b, 0 ), 0 );
+}
+
+- (void)testMapUnion {
+    std::vector<int> a = sortedKeys ( 10000, 30000, 5 );
+    std::vector<int> b = sortedKeys ( 10000, 30000, 6 );
+    XCTAssertEqual ( checkMapUnion<AVLMap> ( a, b, 4 ), 0 );
+    XCTAssertEqual ( checkMapUnion<SplayMap> ( a, b, 1 ), 0 );
+}
+
+- (void)testPerformanceIntersection {
+    std::vector<int> a = sortedKeys ( 1 << 20, 1 << 22, 7 );
+    std::vector<int> b = sortedKeys ( 1 << 20, 1 << 22, 8 );
+    [self measureBlock:^{
+        AVLSet x, y;
+        fillSet ( x, a );
+        fillSet ( y, b );
+        x.set_intersection ( y );
+    }];
+}
+
+@end
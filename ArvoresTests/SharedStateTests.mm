@@ -0,0 +1,133 @@
+//
+//  SharedStateTests.mm
+//  ArvoresTests
+//
+//  AA and splay trees which share no state between them: removals which
+//  fail or alternate between trees, items with no operator==, and
+//  threads each changing their own trees.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+#include "AATree.h"
+#include "Splay.h"
+
+/// an item ordered by key only, which has no operator==.
+struct Ranked {
+    int Key, Payload;
+    Ranked ( int k = 0, int p = 0 ) : Key ( k ), Payload ( p ) { }
+    bool operator < ( const Ranked& r ) const { return Key < r.Key; }
+};
+
+/** inserts and removes random keys below n in t, against a std::set,
+ *  and returns the number of wrong results and items.
+ */
+template <class Tree>
+static int checkAgainstSet ( Tree& t, int n, int ops, unsigned seed ) {
+    std::set<int> s;
+    TestRandom r ( seed );
+    int errors = 0;
+    for ( int i = 0; i < ops; ++i ) {
+        int k = r ( n );
+        if ( r ( 2 ) ) errors += t.Insert ( k ) != (int) s.insert ( k ).second;
+        else           errors += t.Remove ( k ) != (int) s.erase ( k );
+    }
+    for ( int k = 0; k < n; ++k ) errors += ( t.IsFound ( k ) != 0 ) != ( s.count ( k ) != 0 );
+    return errors + ( t.Size ( t.GetRoot ( ) ) != (int) s.size ( ) );
+}
+
+@interface SharedStateTests : XCTestCase
+
+@end
+
+@implementation SharedStateTests
+
+/// a removal which finds nothing leaves no stale node for the next one.
+- (void)testFailedRemovals {
+    StaticAATree<int> t;
+    for ( int k = 0; k < 1000; k += 2 ) t.Insert ( k );
+    int errors = 0;
+    for ( int k = 0; k < 1000; ++k ) {
+        errors += t.Remove ( 2 * k + 1 ) != 0;
+        errors += t.Remove ( k ) != ( k % 2 == 0 );
+        errors += t.IsFound ( k + 2 ) != ( k % 2 == 0 && k + 2 < 1000 );
+    }
+    XCTAssertEqual ( errors, 0 );
+    XCTAssertTrue ( t.IsEmpty ( ) );
+}
+
+/// duplicates are not inserted, wherever they are found.
+- (void)testDuplicates {
+    StaticAATree<int> t;
+    int errors = 0;
+    for ( int k = 0; k < 500; ++k ) errors += t.Insert ( k ) != 1;
+    for ( int k = 0; k < 500; ++k ) errors += t.Insert ( k ) != 0;
+    XCTAssertEqual ( errors, 0 );
+    XCTAssertEqual ( t.Size ( t.GetRoot ( ) ), 500 );
+    StaticAATree<int> random;
+    XCTAssertEqual ( checkAgainstSet ( random, 1000, 20000, 1 ), 0 );
+}
+
+/// removals from two trees of the same type, one after the other.
+- (void)testInterleavedTrees {
+    StaticAATree<int> a, b;
+    CompactSplayTree<int> c, d;
+    std::set<int> sa, sb;
+    TestRandom r ( 2 );
+    int errors = 0;
+    for ( int i = 0; i < 20000; ++i ) {
+        int k = r ( 500 ), j = r ( 500 );
+        if ( r ( 2 ) ) {
+             a.Insert ( k ); c.Insert ( k ); sa.insert ( k );
+             b.Insert ( j ); d.Insert ( j ); sb.insert ( j );
+        }
+        else {
+             errors += a.Remove ( k ) != (int) sa.count ( k );
+             errors += b.Remove ( j ) != (int) sb.count ( j );
+             c.Remove ( k ); sa.erase ( k );
+             d.Remove ( j ); sb.erase ( j );
+        }
+    }
+    for ( int k = 0; k < 500; ++k ) {
+        errors += ( a.IsFound ( k ) != 0 ) != ( sa.count ( k ) != 0 );
+        errors += ( b.IsFound ( k ) != 0 ) != ( sb.count ( k ) != 0 );
+        errors += ( c.IsFound ( k ) != 0 ) != ( sa.count ( k ) != 0 );
+        errors += ( d.IsFound ( k ) != 0 ) != ( sb.count ( k ) != 0 );
+    }
+    XCTAssertEqual ( errors, 0 );
+}
+
+/// AATree::Remove matches items by the comparator, and needs no operator==.
+- (void)testComparatorOnly {
+    StaticAATree<Ranked> t;
+    for ( int k = 0; k < 100; ++k ) t.Insert ( Ranked ( k, k * 10 ) );
+    XCTAssertTrue ( t.Remove ( Ranked ( 50, -1 ) ) );
+    XCTAssertFalse ( t.IsFound ( Ranked ( 50 ) ) );
+    XCTAssertFalse ( t.Remove ( Ranked ( 50, 500 ) ) );
+    XCTAssertEqual ( t.Size ( t.GetRoot ( ) ), 99 );
+}
+
+/// threads each change their own trees, which may share a NullNode.
+- (void)testThreadsWithOwnTrees {
+    std::atomic<int> errors ( 0 );
+    std::vector<std::thread> threads;
+    for ( int w = 0; w < 4; ++w )
+        threads.push_back ( std::thread ( [&errors, w] {
+            IndexedAATree<int> aa;
+            IndexedSplayTree<int> splay;
+            StaticAATree<int> plain;
+            int wrong = checkAgainstSet ( aa, 1000, 20000, 10 + w );
+            wrong += checkAgainstSet ( splay, 1000, 20000, 20 + w );
+            wrong += checkAgainstSet ( plain, 1000, 20000, 30 + w );
+            errors += wrong;
+        } ) );
+    for ( size_t i = 0; i < threads.size ( ); ++i ) threads[i].join ( );
+    XCTAssertEqual ( errors.load ( ), 0 );
+}
+
+@end
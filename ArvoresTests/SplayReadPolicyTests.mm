@@ -0,0 +1,111 @@
+//
+//  SplayReadPolicyTests.mm
+//  ArvoresTests
+//
+//  When the reads of a splay tree splay it: Peek, and each read policy.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include "Splay.h"
+
+typedef StaticSplayTree<int> IntSplayTree;
+
+/// returns the number of wrong results of IsFound on t, which holds the keys below n.
+static int checkFound ( const IntSplayTree& t, int n, unsigned seed ) {
+    TestRandom r ( seed );
+    int errors = 0;
+    for ( int i = 0; i < 4 * n; ++i ) {
+        int k = r ( 2 * n );
+        errors += ( t.IsFound ( k ) != 0 ) != ( k < n );
+        t.Find ( k );
+        errors += ( t.WasFound ( ) != 0 ) != ( k < n );
+    }
+    return errors;
+}
+
+/// fills t with the keys below n, in random order.
+static void fill ( IntSplayTree& t, int n ) {
+    std::vector<int> keys = shuffledKeys ( n, 3 );
+    for ( size_t i = 0; i < keys.size ( ); ++i ) t.Insert ( keys[i] );
+}
+
+@interface SplayReadPolicyTests : XCTestCase
+
+@end
+
+@implementation SplayReadPolicyTests
+
+/// by default every read splays; Peek never does.
+- (void)testSplayAlwaysAndPeek {
+    IntSplayTree t;
+    fill ( t, 1000 );
+    XCTAssertEqual ( t.GetReadPolicy ( ), IntSplayTree::SplayAlways );
+    const IntSplayTree::BinaryNode* root = t.GetRoot ( );
+    XCTAssertEqual ( t.Peek ( 123 )->GetElement ( ), 123 );
+    XCTAssert ( t.Peek ( 1000 ) == NULL );
+    XCTAssert ( t.GetRoot ( ) == root );
+    XCTAssertTrue ( t.IsFound ( 123 ) );
+    XCTAssertEqual ( t.GetRoot ( )->GetElement ( ), 123 );
+    t.Find ( 456 );
+    XCTAssertEqual ( t.GetRoot ( )->GetElement ( ), 456 );
+    XCTAssertEqual ( checkFound ( t, 1000, 1 ), 0 );
+}
+
+- (void)testSplayNever {
+    IntSplayTree t;
+    fill ( t, 1000 );
+    t.SetReadPolicy ( IntSplayTree::SplayNever );
+    const IntSplayTree::BinaryNode* root = t.GetRoot ( );
+    XCTAssertEqual ( checkFound ( t, 1000, 2 ), 0 );
+    XCTAssert ( t.GetRoot ( ) == root );
+}
+
+/// one read out of N splays.
+- (void)testSplayEveryNth {
+    IntSplayTree t;
+    fill ( t, 1000 );
+    t.SetReadPolicy ( IntSplayTree::SplayEveryNth, 3 );
+    int splays = 0;
+    for ( int i = 0; i < 300; ++i ) {
+        int k = ( 7 * i + 1 ) % 1000;
+        const IntSplayTree::BinaryNode* root = t.GetRoot ( );
+        XCTAssertTrue ( t.IsFound ( k ) );
+        if ( t.GetRoot ( ) != root ) {
+             ++splays;
+             XCTAssertEqual ( i % 3, 2 );
+             XCTAssertEqual ( t.GetRoot ( )->GetElement ( ), k );
+        }
+    }
+    XCTAssertGreaterThan ( splays, 90 );
+    XCTAssertEqual ( checkFound ( t, 1000, 3 ), 0 );
+}
+
+/// reads splay nodes deeper than N only.
+- (void)testSplayPastDepth {
+    IntSplayTree t;
+    for ( int k = 0; k < 1000; ++k ) t.Insert ( k );
+    // a path: 999 at the root, and k at depth 999-k
+    t.SetReadPolicy ( IntSplayTree::SplayPastDepth, 10 );
+    XCTAssertTrue ( t.IsFound ( 995 ) );
+    XCTAssertEqual ( t.GetRoot ( )->GetElement ( ), 999 );
+    XCTAssertTrue ( t.IsFound ( 0 ) );
+    XCTAssertEqual ( t.GetRoot ( )->GetElement ( ), 0 );
+    XCTAssertEqual ( checkFound ( t, 1000, 4 ), 0 );
+    XCTAssertLessThan ( t.Height ( t.GetRoot ( ) ), 999 );
+}
+
+/// a copy reads by the policy of the tree it was copied from.
+- (void)testCopyKeepsPolicy {
+    IntSplayTree t;
+    fill ( t, 100 );
+    t.SetReadPolicy ( IntSplayTree::SplayNever );
+    IntSplayTree c ( t );
+    XCTAssertEqual ( c.GetReadPolicy ( ), IntSplayTree::SplayNever );
+    const IntSplayTree::BinaryNode* root = c.GetRoot ( );
+    XCTAssertTrue ( c.IsFound ( 50 ) );
+    XCTAssert ( c.GetRoot ( ) == root );
+}
+
+@end
@@ -0,0 +1,95 @@
+//
+//  TreeInterfaceTests.mm
+//  ArvoresTests
+//
+//  The trees through the virtual AbsBst interface, and their static
+//  versions, which have no virtual functions.
+//
+
+#import <XCTest/XCTest.h>
+#import "TreeTestSupport.h"
+
+#include <set>
+#include <type_traits>
+#include "AVLTree.h"
+#include "AATree.h"
+#include "RedBlack.h"
+#include "Splay.h"
+#include "Ordered.h"
+
+typedef AbsBst<int,compare_to<int> > IntBst;
+
+/** returns the number of wrong results while t, through the AbsBst
+ *  interface, is changed at random with items below n, against a std::set.
+ */
+static int checkAbsBst ( IntBst& t, int n, unsigned seed ) {
+    std::set<int> s;
+    TestRandom r ( seed );
+    int errors = 0;
+    for ( int i = 0; i < 6 * n; ++i ) {
+        int k = r ( n );
+        if ( r ( 2 ) ) { t.Insert ( k ); s.insert ( k ); }
+        else           { t.Remove ( k ); s.erase ( k ); }
+        k = r ( n );
+        bool in = s.count ( k ) != 0;
+        errors += ( t.IsFound ( k ) != 0 ) != in;
+        t.Find ( k );
+        errors += ( t.WasFound ( ) != 0 ) != in;
+        errors += ( t.IsEmpty ( ) != 0 ) != s.empty ( );
+        if ( !s.empty ( ) ) errors += t.FindMin ( ) != *s.begin ( ) || t.FindMax ( ) != *s.rbegin ( );
+    }
+    t.MakeEmpty ( );
+    return errors + !t.IsEmpty ( );
+}
+
+@interface TreeInterfaceTests : XCTestCase
+
+@end
+
+@implementation TreeInterfaceTests
+
+/// the static trees have no vtable; the others implement AbsBst.
+- (void)testStaticTreesAreNotPolymorphic {
+    XCTAssertFalse ( std::is_polymorphic<StaticSearchTree<int> >::value );
+    XCTAssertFalse ( std::is_polymorphic<StaticAVLTree<int> >::value );
+    XCTAssertFalse ( std::is_polymorphic<StaticAATree<int> >::value );
+    XCTAssertFalse ( std::is_polymorphic<StaticRedBlackTree<int> >::value );
+    XCTAssertFalse ( std::is_polymorphic<StaticSplayTree<int> >::value );
+    XCTAssertFalse ( std::is_polymorphic<StaticOrderedSearchTree<int> >::value );
+    XCTAssertTrue ( ( std::is_base_of<IntBst,AVLTree<int> >::value ) );
+    XCTAssertTrue ( ( std::is_base_of<IntBst,RedBlackTree<int> >::value ) );
+    XCTAssertTrue ( ( std::is_base_of<IntBst,OrderedSearchTree<int> >::value ) );
+}
+
+- (void)testAbsBstInterface {
+    SearchTree<int> bst;
+    AVLTree<int> avl;
+    AATree<int> aa;
+    RedBlackTree<int> rb ( -1 );
+    SplayTree<int> splay;
+    OrderedSearchTree<int> ordered;
+    IntBst* trees[] = { &bst, &avl, &aa, &rb, &splay, &ordered };
+    for ( int i = 0; i < 6; ++i )
+        XCTAssertEqual ( checkAbsBst ( *trees[i], 500, i + 1 ), 0 );
+}
+
+/// a copy holds the same items, and the virtual calls reach it.
+- (void)testCopies {
+    AVLTree<int> avl;
+    RedBlackTree<int> rb ( -1 );
+    for ( int k = 0; k < 300; ++k ) { avl.Insert ( k ); rb.Insert ( k ); }
+    AVLTree<int> avlCopy ( avl );
+    RedBlackTree<int> rbCopy ( rb );
+    IntBst* copies[] = { &avlCopy, &rbCopy };
+    for ( int i = 0; i < 2; ++i ) {
+        int missing = 0;
+        for ( int k = 0; k < 300; ++k ) missing += !copies[i]->IsFound ( k );
+        XCTAssertEqual ( missing, 0 );
+        copies[i]->Remove ( 7 );
+        XCTAssertFalse ( copies[i]->IsFound ( 7 ) );
+    }
+    XCTAssertTrue ( avl.IsFound ( 7 ) );
+    XCTAssertTrue ( rb.IsFound ( 7 ) );
+}
+
+@end
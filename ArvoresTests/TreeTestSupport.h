@@ -0,0 +1,43 @@
+//
+//  TreeTestSupport.h
+//  ArvoresTests
+//
+//  Helpers shared by the tree tests: random numbers, shuffled keys,
+//  and measuring a tree in a block.
+//
+
+#ifndef TreeTestSupport_h
+#define TreeTestSupport_h
+
+#import <XCTest/XCTest.h>
+
+#include <algorithm>
+#include <vector>
+
+/// a small random number generator, one per thread.
+struct TestRandom {
+    unsigned State;
+    TestRandom ( unsigned seed ) : State ( seed ) { }
+    /// returns a number in [0, n).
+    int operator () ( int n ) { State = State * 1103515245u + 12345u; return (int) ( ( State >> 8 ) % n ); }
+};
+
+/// returns the keys first, first+step, ..., n of them, in random order.
+static inline std::vector<int> shuffledKeys ( int n, unsigned seed, int first = 0, int step = 1 ) {
+    std::vector<int> keys ( n );
+    for ( int i = 0; i < n; ++i ) keys[i] = first + i * step;
+    TestRandom r ( seed );
+    for ( int i = n - 1; i > 0; --i ) std::swap ( keys[i], keys[r ( i + 1 )] );
+    return keys;
+}
+
+/** measures f(t) with measureBlock. Blocks copy the C++ objects they
+ *  capture, so the block gets a pointer to t.
+ */
+template <class Tree, class F>
+static void measureTree ( XCTestCase* test, Tree& t, F f ) {
+    Tree* tree = &t;
+    [test measureBlock:^{ f ( *tree ); }];
+}
+
+#endif
@@ -0,0 +1,123 @@
+//
+//  utlSetTests.mm
+//  ArvoresTests
+//
+//  Reads of utlSet and utlMap: searches, bounds and counts, on the
+//  default splay trees and on balanced trees.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "TreeTestSupport.h"
+
+#include "utlSet.h"
+#include "utlMap.h"
+
+/// compares ints, counting the comparisons.
+struct CountingLess {
+    static long Calls;
+    bool operator () ( int x, int y ) const { ++Calls; return x < y; }
+    bool eq ( int x, int y ) const { return x == y; }
+    bool neq ( int x, int y ) const { return x != y; }
+};
+
+long CountingLess::Calls = 0;
+
+/** returns the number of wrong results of find, count and the bounds
+ *  of s, which holds the even keys below 2*n.
+ */
+template <class Set>
+static int checkReads ( const Set& s, int n ) {
+    int errors = 0;
+    for ( int k = -1; k <= 2 * n; ++k ) {
+        bool even = k >= 0 && k < 2 * n && k % 2 == 0;
+        errors += ( s.find ( k ) != s.end() ) != even;
+        errors += (int) s.count ( k ) != (int) even;
+        typename Set::iterator lb = s.lower_bound ( k ), ub = s.upper_bound ( k );
+        int first = k <= 0 ? 0 : ( k + 1 ) / 2 * 2;
+        int after = k < 0 ? 0 : k / 2 * 2 + 2;
+        errors += first < 2 * n ? *lb != first : lb != s.end();
+        errors += after < 2 * n ? *ub != after : ub != s.end();
+    }
+    return errors;
+}
+
+/** returns the number of ranges [a, b) for which count(a, b) of s, or of m,
+ *  differs from the number of keys in the range, which are those of keys.
+ */
+template <class Set, class Map>
+static int checkCountRanges ( const Set& s, const Map& m, const std::vector<int>& keys, int n ) {
+    int errors = 0;
+    TestRandom r ( 77 );
+    for ( int i = 0; i < 2000; ++i ) {
+        int a = r ( n + 20 ) - 10, b = r ( n + 20 ) - 10, in = 0;
+        for ( size_t j = 0; j < keys.size(); ++j ) in += keys[j] >= a && keys[j] < b;
+        errors += (int) s.count ( a, b ) != in;
+        errors += (int) m.count ( a, b ) != in;
+    }
+    return errors;
+}
+
+@interface utlSetTests : XCTestCase
+
+@end
+
+@implementation utlSetTests
+
+- (void)testReads {
+    utlSet<int> splay;
+    utlSet<int,compare_to<int>,AVLTree<int> > avl;
+    for ( int i = 0; i < 500; ++i ) {
+        splay.insert ( 2 * i );
+        avl.insert ( 2 * ( 499 - i ) );
+    }
+    XCTAssertEqual ( checkReads ( splay, 500 ), 0 );
+    XCTAssertEqual ( checkReads ( avl, 500 ), 0 );
+}
+
+/// ranges are counted in O(log n), on trees which keep the size of their nodes.
+- (void)testCountRange {
+    const int n = 3000;
+    std::vector<int> keys = shuffledKeys ( n / 3, 11, 0, 3 );
+    utlSet<int,compare_to<int>,CountedAVLTree<int> > s;
+    utlMap<int,int,compare_pair<utlPair<const int,int> >,
+           CountedAATree<utlPair<const int,int>,compare_pair<utlPair<const int,int> > > > m;
+    for ( size_t i = 0; i < keys.size(); ++i ) {
+        s.insert ( keys[i] );
+        m[keys[i]] = 1;
+    }
+    XCTAssertEqual ( checkCountRanges ( s, m, keys, n ), 0 );
+    XCTAssertEqual ( (int) s.count ( n, 0 ), 0 );
+    XCTAssertEqual ( (int) s.count ( 0, n ), n / 3 );
+}
+
+/** items inserted in order leave a splay tree as a path: find must
+ *  splay, or every later search would walk it.
+ */
+- (void)testSplayTreeFindSplays {
+    utlSet<int,CountingLess,SplayTree<int,CountingLess> > s;
+    for ( int i = 0; i < 1000; ++i ) s.insert ( i );
+
+    XCTAssert ( s.find ( 0 ) != s.end() );
+    CountingLess::Calls = 0;
+    XCTAssert ( s.find ( 0 ) != s.end() );
+    XCTAssertLessThan ( CountingLess::Calls, 10 );
+
+    XCTAssertEqual ( (int) s.count ( 500 ), 1 );
+    CountingLess::Calls = 0;
+    XCTAssertEqual ( *s.lower_bound ( 500 ), 500 );
+    XCTAssertLessThan ( CountingLess::Calls, 10 );
+}
+
+- (void)testSplayTreeMapFindSplays {
+    utlMap<int,int> m;
+    for ( int i = 0; i < 1000; ++i ) m[i] = -i;
+
+    XCTAssertEqual ( m.find ( 0 )->second, 0 );
+    XCTAssertEqual ( m.find ( 999 )->second, -999 );
+    XCTAssertEqual ( m.lower_bound ( 10 )->second, -10 );
+    XCTAssertEqual ( (int) m.count ( 20 ), 1 );
+    XCTAssert ( m.find ( 1000 ) == m.end() );
+}
+
+@end